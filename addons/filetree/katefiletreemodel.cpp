@@ -38,6 +38,8 @@
 
 #include "katefiletreedebug.h"
 
+#include "documentplaceholder.h"
+
 class ProxyItemDir;
 class ProxyItem
 {
@@ -357,7 +359,7 @@ const QString &ProxyItem::host() const
 
 void ProxyItem::updateDocumentName()
 {
-    const QString docName = m_doc ? m_doc->documentName() : QString();
+    const QString docName = m_doc ? DocumentPlaceholder::name(m_doc) : QString();
 
     if (flag(ProxyItem::Host)) {
         m_documentName = QStringLiteral("[%1]%2").arg(m_host, docName);
@@ -504,7 +506,7 @@ Qt::ItemFlags KateFileTreeModel::flags(const QModelIndex &index) const
             flags |= Qt::ItemIsSelectable;
         }
 
-        if (item->doc() && item->doc()->url().isValid()) {
+        if (item->doc() && DocumentPlaceholder::url(item->doc()).isValid()) {
             flags |= Qt::ItemIsDragEnabled;
         }
     }
@@ -528,7 +530,7 @@ QVariant KateFileTreeModel::data(const QModelIndex &index, int role) const
     switch (role) {
     case KateFileTreeModel::PathRole:
         // allow to sort with hostname + path, bug 271488
-        return (item->doc() && !item->doc()->url().isEmpty()) ? item->doc()->url().toString() : item->path();
+        return (item->doc() && !DocumentPlaceholder::url(item->doc()).isEmpty()) ? DocumentPlaceholder::url(item->doc()).toString() : item->path();
 
     case KateFileTreeModel::DocumentRole:
         return QVariant::fromValue(item->doc());
@@ -583,11 +585,11 @@ QMimeData *KateFileTreeModel::mimeData(const QModelIndexList &indexes) const
 
     for (const auto &index : indexes) {
         ProxyItem *item = static_cast<ProxyItem *>(index.internalPointer());
-        if (!item || !item->doc() || !item->doc()->url().isValid()) {
+        if (!item || !item->doc() || !DocumentPlaceholder::url(item->doc()).isValid()) {
             continue;
         }
 
-        urls.append(item->doc()->url());
+        urls.append(DocumentPlaceholder::url(item->doc()));
     }
 
     if (urls.isEmpty()) {
@@ -1282,17 +1284,18 @@ void KateFileTreeModel::handleNameChange(ProxyItem *item)
 
 void KateFileTreeModel::updateItemPathAndHost(ProxyItem *item) const
 {
-    const KTextEditor::Document *doc = item->doc();
+    KTextEditor::Document *doc = item->doc();
     Q_ASSERT(doc); // this method should not be called at directory items
 
-    QString path = doc->url().path();
+    const QUrl url = DocumentPlaceholder::url(doc);
+    QString path = url.path();
     QString host;
-    if (doc->url().isEmpty()) {
+    if (url.isEmpty()) {
         path = doc->documentName();
         item->setFlag(ProxyItem::Empty);
     } else {
         item->clearFlag(ProxyItem::Empty);
-        host = doc->url().host();
+        host = url.host();
         if (!host.isEmpty()) {
             path = QStringLiteral("[%1]%2").arg(host, path);
         }
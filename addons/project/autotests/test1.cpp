@@ -20,16 +20,38 @@
 
 #include "test1.h"
 #include "fileutil.h"
+#include "kateprojectgitindex.h"
+#include "kateproject.h"
+#include "kateprojectindex.h"
+#include "kateprojectplugin.h"
+#include "kateprojectsnapshot.h"
+#include "kateprojecttrigramindex.h"
+#include "kateprojectwatcher.h"
+#include "kateprojectworker.h"
 #include "tools/kateprojectcodeanalysistoolshellcheck.h"
 
+#include "pathstore.h"
+
 #include <QtTest>
 
+#include <QBuffer>
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QProcess>
+#include <QSignalSpy>
 #include <QString>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+
+#include <ThreadWeaver/Queue>
 
 QTEST_MAIN(Test1)
 
 void Test1::initTestCase()
 {
+    // the project snapshots are stored in the cache directory
+    QStandardPaths::setTestModeEnabled(true);
 }
 
 void Test1::cleanupTestCase()
@@ -52,4 +74,536 @@ void Test1::testShellCheckParsing()
     QCOMPARE(outList.size(), 4);
 }
 
+static bool runGit(const QString &dir, const QStringList &args, QByteArray *output = nullptr)
+{
+    QProcess git;
+    git.setWorkingDirectory(dir);
+    git.start(QStringLiteral("git"), args);
+    if (!git.waitForStarted() || !git.waitForFinished(-1) || git.exitCode() != 0) {
+        return false;
+    }
+    if (output) {
+        *output = git.readAllStandardOutput();
+    }
+    return true;
+}
+
+void Test1::testGitIndex()
+{
+    QTemporaryDir tempDir;
+    const QString repo = tempDir.path();
+    if (!runGit(repo, {QStringLiteral("init"), QStringLiteral("-q")})) {
+        QSKIP("git is not available");
+    }
+
+    QDir(repo).mkpath(QStringLiteral("a/b"));
+    QDir(repo).mkpath(QStringLiteral("Der Bäcker"));
+    const QStringList paths = {QStringLiteral("top.txt"), QStringLiteral("a/b/one.txt"), QStringLiteral("a/b/two.txt"), QStringLiteral("a/three.txt"), QStringLiteral("Der Bäcker/Das Brötchen.txt")};
+    for (const QString &path : paths) {
+        QFile file(repo + QLatin1Char('/') + path);
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        file.write(path.toUtf8());
+    }
+    QVERIFY(runGit(repo, {QStringLiteral("add"), QStringLiteral(".")}));
+
+    // all index versions, v4 compresses the paths
+    const QStringList versions = {QStringLiteral("2"), QStringLiteral("3"), QStringLiteral("4")};
+    for (const QString &version : versions) {
+        QVERIFY(runGit(repo, {QStringLiteral("update-index"), QStringLiteral("--index-version"), version}));
+
+        const QStringList dirs = {repo, repo + QStringLiteral("/a")};
+        for (const QString &dir : dirs) {
+            QByteArray output;
+            QVERIFY(runGit(dir, {QStringLiteral("ls-files"), QStringLiteral("-z"), QStringLiteral(".")}, &output));
+            QStringList expected;
+            for (const QByteArray &path : output.split('\0')) {
+                if (!path.isEmpty()) {
+                    expected << QString::fromUtf8(path);
+                }
+            }
+
+            QStringList files;
+            QVERIFY(KateProjectGitIndex::listFiles(dir, files));
+            QCOMPARE(files, expected);
+        }
+    }
+
+    // garbage is rejected
+    QStringList files;
+    QList<QByteArray> submodules;
+    QVERIFY(!KateProjectGitIndex::parseIndex(QByteArray("DIRC\0\0\0\x02\0\0\0\x05", 12), 20, QByteArray(), files, submodules));
+    QVERIFY(files.isEmpty());
+}
+
+void Test1::testWatcher()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QVERIFY(QDir(dir.path()).mkdir(QStringLiteral("sub")));
+    const QString sub = dir.path() + QStringLiteral("/sub");
+
+    KateProjectWatcher watcher;
+    watcher.setPaths({dir.path(), sub}, {dir.path()});
+    QVERIFY(!watcher.isFallback());
+    QSignalSpy spy(&watcher, &KateProjectWatcher::changed);
+
+    // a burst of changes is reported once
+    for (int i = 0; i < 10; ++i) {
+        QFile file(sub + QStringLiteral("/file%1.cpp").arg(i));
+        QVERIFY(file.open(QIODevice::WriteOnly));
+    }
+    QVERIFY(spy.wait(5000));
+    QTest::qWait(1000);
+    QCOMPARE(spy.count(), 1);
+    QCOMPARE(spy.at(0).at(0).toStringList(), QStringList(sub));
+
+    // too many directories, only the fallback paths are watched
+    QStringList tooMany;
+    for (int i = 0; i <= KateProjectWatcher::maxDirectories(); ++i) {
+        tooMany << sub;
+    }
+    watcher.setPaths(tooMany, {dir.path()});
+    QVERIFY(watcher.isFallback());
+    spy.clear();
+    QVERIFY(QFile::remove(sub + QStringLiteral("/file0.cpp")));
+    QVERIFY(!spy.wait(1000));
+    QFile file(dir.path() + QStringLiteral("/top.cpp"));
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    QVERIFY(spy.wait(5000));
+    QCOMPARE(spy.at(0).at(0).toStringList(), QStringList(dir.path()));
+
+    // the index files the project writes itself are ignored
+    const QString indexFile = dir.path() + QStringLiteral("/tags");
+    watcher.setPaths({dir.path(), sub}, {dir.path()}, {indexFile});
+    QVERIFY(!watcher.isFallback());
+    spy.clear();
+    QFile tags(indexFile);
+    QVERIFY(tags.open(QIODevice::WriteOnly));
+    tags.close();
+    QFile tempTags(indexFile + QStringLiteral(".aB3dE9"));
+    QVERIFY(tempTags.open(QIODevice::WriteOnly));
+    tempTags.close();
+    QVERIFY(tempTags.remove());
+    QVERIFY(!spy.wait(1000));
+    QFile other(dir.path() + QStringLiteral("/tags2.cpp"));
+    QVERIFY(other.open(QIODevice::WriteOnly));
+    QVERIFY(spy.wait(5000));
+    QCOMPARE(spy.at(0).at(0).toStringList(), QStringList(dir.path()));
+}
+
+void Test1::testCtagsMerge()
+{
+    const QByteArray header = "!_TAG_FILE_FORMAT\t2\t/extended format/\n"
+                              "!_TAG_FILE_SORTED\t1\t/0=unsorted, 1=sorted, 2=foldcase/\n";
+    const QByteArray previous = header
+        + "Alpha\t/p/a.cpp\t1;\"\tkind:class\tline:1\n"
+          "Beta\t/p/b.cpp\t2;\"\tkind:class\tline:2\n"
+          "Gamma\t/p/c.cpp\t3;\"\tkind:class\tline:3\n"
+          "alpha\t/p/a.cpp\t4;\"\tkind:function\tline:4\n";
+
+    // b.cpp changed, c.cpp was removed, d.cpp is new
+    const QList<QByteArray> newTags = {"Delta\t/p/d.cpp\t1;\"\tkind:class\tline:1\n",
+                                       "Beta2\t/p/b.cpp\t5;\"\tkind:class\tline:5\n",
+                                       "beta\t/p/b.cpp\t6;\"\tkind:function\tline:6\n"};
+    const QSet<QByteArray> dropFiles = {"/p/b.cpp", "/p/c.cpp"};
+
+    QBuffer previousTags;
+    previousTags.setData(previous);
+    QVERIFY(previousTags.open(QIODevice::ReadOnly));
+    QBuffer output;
+    QVERIFY(output.open(QIODevice::WriteOnly));
+    KateProjectIndex::mergeCtags(previousTags, newTags, dropFiles, output);
+    QCOMPARE(output.data(),
+             header
+                 + "Alpha\t/p/a.cpp\t1;\"\tkind:class\tline:1\n"
+                   "Beta2\t/p/b.cpp\t5;\"\tkind:class\tline:5\n"
+                   "Delta\t/p/d.cpp\t1;\"\tkind:class\tline:1\n"
+                   "alpha\t/p/a.cpp\t4;\"\tkind:function\tline:4\n"
+                   "beta\t/p/b.cpp\t6;\"\tkind:function\tline:6\n");
+
+    // case folded tags keep their order
+    const QByteArray foldCaseHeader = "!_TAG_FILE_FORMAT\t2\t/extended format/\n"
+                                      "!_TAG_FILE_SORTED\t2\t/0=unsorted, 1=sorted, 2=foldcase/\n";
+    QBuffer foldCaseTags;
+    foldCaseTags.setData(foldCaseHeader
+                         + "Alpha\t/p/a.cpp\t1;\"\tkind:class\tline:1\n"
+                           "alpha\t/p/a.cpp\t4;\"\tkind:function\tline:4\n"
+                           "Beta\t/p/b.cpp\t2;\"\tkind:class\tline:2\n"
+                           "Gamma\t/p/c.cpp\t3;\"\tkind:class\tline:3\n");
+    QVERIFY(foldCaseTags.open(QIODevice::ReadOnly));
+    QBuffer foldCaseOutput;
+    QVERIFY(foldCaseOutput.open(QIODevice::WriteOnly));
+    KateProjectIndex::mergeCtags(foldCaseTags, newTags, dropFiles, foldCaseOutput);
+    QCOMPARE(foldCaseOutput.data(),
+             foldCaseHeader
+                 + "Alpha\t/p/a.cpp\t1;\"\tkind:class\tline:1\n"
+                   "alpha\t/p/a.cpp\t4;\"\tkind:function\tline:4\n"
+                   "beta\t/p/b.cpp\t6;\"\tkind:function\tline:6\n"
+                   "Beta2\t/p/b.cpp\t5;\"\tkind:class\tline:5\n"
+                   "Delta\t/p/d.cpp\t1;\"\tkind:class\tline:1\n");
+}
+
+void Test1::testPathStore()
+{
+    const QStringList paths = {QStringLiteral("/p/a.cpp"),
+                               QStringLiteral("/p/src/b.cpp"),
+                               QStringLiteral("/p/src/c.h"),
+                               QStringLiteral("/p/b.cpp"),
+                               QStringLiteral("/p/src/d/e.cpp"),
+                               QStringLiteral("noslash")};
+
+    PathStore::Builder builder;
+    for (const QString &path : paths) {
+        builder.append(path);
+    }
+    const PathStore store = builder.build();
+    QCOMPARE(store.size(), paths.size());
+    QCOMPARE(store.toStringList(), paths);
+    QCOMPARE(store.fileName(1).toString(), QStringLiteral("b.cpp"));
+    QCOMPARE(store.directory(1), QStringLiteral("/p/src/"));
+    QCOMPARE(store.fileName(5).toString(), QStringLiteral("noslash"));
+    QCOMPARE(store.directory(5), QString());
+
+    // the builder starts over
+    QVERIFY(builder.build().isEmpty());
+
+    // copies share the data
+    const PathStore copy = store;
+    QVERIFY(copy.isSharedWith(store));
+
+    // joined stores keep the order
+    PathStore::Builder otherBuilder;
+    otherBuilder.append(QStringLiteral("/q/x.cpp"));
+    otherBuilder.append(QStringLiteral("/p/src/y.cpp"));
+    const PathStore other = otherBuilder.build();
+    const PathStore joined = PathStore::joined({store, PathStore(), other});
+    QCOMPARE(joined.toStringList(), paths + other.toStringList());
+    QCOMPARE(joined.directory(joined.size() - 1), QStringLiteral("/p/src/"));
+    QVERIFY(PathStore::joined({store}).isSharedWith(store));
+    QVERIFY(PathStore().toStringList().isEmpty());
+}
+
+static bool writeFile(const QString &fileName, const QByteArray &content = QByteArray())
+{
+    QFile file(fileName);
+    return file.open(QIODevice::WriteOnly) && file.write(content) == content.size();
+}
+
+/**
+ * run the queued workers of the project and deliver their results
+ */
+static void finishWorkers(ThreadWeaver::Queue &weaver)
+{
+    weaver.finish();
+    QCoreApplication::processEvents();
+}
+
+void Test1::testSnapshotRefresh()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString baseDir = QFileInfo(dir.path()).canonicalFilePath();
+    const QString projectFile = baseDir + QStringLiteral("/.kateproject");
+    const QString a = baseDir + QStringLiteral("/a.txt");
+    const QString b = baseDir + QStringLiteral("/b.txt");
+    QVERIFY(writeFile(projectFile, "{ \"name\": \"test\", \"files\": [ { \"filters\": [ \"*.txt\" ] } ] }"));
+    QVERIFY(writeFile(a));
+
+    // no project of the working directory is opened by the plugin
+    const QString currentDir = QDir::currentPath();
+    QDir::setCurrent(baseDir);
+    KateProjectPlugin plugin;
+    QDir::setCurrent(currentDir);
+    ThreadWeaver::Queue weaver;
+
+    // the first start stores the snapshot
+    {
+        KateProject project(&weaver, &plugin);
+        QVERIFY(project.loadFromFile(projectFile));
+        finishWorkers(weaver);
+        QVERIFY(project.itemForFile(a));
+    }
+
+    // the next start shows the outdated snapshot, the refresh adds the new file
+    QVERIFY(writeFile(b));
+    {
+        KateProject project(&weaver, &plugin);
+        QSignalSpy spy(&project, &KateProject::modelChanged);
+        QVERIFY(project.loadFromFile(projectFile));
+        finishWorkers(weaver);
+        QCOMPARE(spy.count(), 2);
+        QVERIFY(project.itemForFile(a));
+        QVERIFY(project.itemForFile(b));
+    }
+
+    // the refresh stored the snapshot again, it is shown at once
+    {
+        KateProject project(&weaver, &plugin);
+        int modelChanges = 0;
+        bool shownAtOnce = false;
+        connect(&project, &KateProject::modelChanged, &project, [&]() {
+            if (modelChanges++ == 0) {
+                shownAtOnce = project.itemForFile(b);
+            }
+        });
+        QVERIFY(project.loadFromFile(projectFile));
+        finishWorkers(weaver);
+        QCOMPARE(modelChanges, 1);
+        QVERIFY(shownAtOnce);
+    }
+}
+
+void Test1::testChangedDirectories()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString baseDir = QFileInfo(dir.path()).canonicalFilePath();
+    const QString projectFile = baseDir + QStringLiteral("/.kateproject");
+    QVERIFY(writeFile(projectFile, "{ \"name\": \"test\", \"files\": [ { \"filters\": [ \"*.txt\" ] } ] }"));
+    QVERIFY(QDir(baseDir).mkpath(QStringLiteral("sub")));
+    QVERIFY(QDir(baseDir).mkpath(QStringLiteral("other")));
+    QVERIFY(writeFile(baseDir + QStringLiteral("/a.txt")));
+    QVERIFY(writeFile(baseDir + QStringLiteral("/sub/c.txt")));
+    QVERIFY(writeFile(baseDir + QStringLiteral("/other/d.txt")));
+
+    const QString currentDir = QDir::currentPath();
+    QDir::setCurrent(baseDir);
+    KateProjectPlugin plugin;
+    QDir::setCurrent(currentDir);
+    ThreadWeaver::Queue weaver;
+    KateProject project(&weaver, &plugin);
+    QVERIFY(project.loadFromFile(projectFile));
+    finishWorkers(weaver);
+    QVERIFY(project.itemForFile(baseDir + QStringLiteral("/sub/c.txt")));
+
+    // only the reported directories and the new directories in them are listed again
+    QVERIFY(QFile::remove(baseDir + QStringLiteral("/sub/c.txt")));
+    QVERIFY(writeFile(baseDir + QStringLiteral("/sub/e.txt")));
+    QVERIFY(QDir(baseDir).mkpath(QStringLiteral("new/deep")));
+    QVERIFY(writeFile(baseDir + QStringLiteral("/new/deep/f.txt")));
+    QVERIFY(writeFile(baseDir + QStringLiteral("/other/g.txt")));
+    QVERIFY(QMetaObject::invokeMethod(&project, "slotFilesChanged", Q_ARG(QStringList, QStringList({baseDir, baseDir + QStringLiteral("/sub")}))));
+    finishWorkers(weaver);
+    QVERIFY(project.itemForFile(baseDir + QStringLiteral("/a.txt")));
+    QVERIFY(!project.itemForFile(baseDir + QStringLiteral("/sub/c.txt")));
+    QVERIFY(project.itemForFile(baseDir + QStringLiteral("/sub/e.txt")));
+    QVERIFY(project.itemForFile(baseDir + QStringLiteral("/new/deep/f.txt")));
+    QVERIFY(project.itemForFile(baseDir + QStringLiteral("/other/d.txt")));
+    QVERIFY(!project.itemForFile(baseDir + QStringLiteral("/other/g.txt")));
+
+    // a removed directory takes the files of its sub-directories along
+    QVERIFY(QDir(baseDir + QStringLiteral("/new")).removeRecursively());
+    QVERIFY(QMetaObject::invokeMethod(&project, "slotFilesChanged", Q_ARG(QStringList, QStringList({baseDir, baseDir + QStringLiteral("/new")}))));
+    finishWorkers(weaver);
+    QVERIFY(!project.itemForFile(baseDir + QStringLiteral("/new/deep/f.txt")));
+    QVERIFY(project.itemForFile(baseDir + QStringLiteral("/sub/e.txt")));
+}
+
+void Test1::testTrigramIndex()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString baseDir = dir.path() + QStringLiteral("/project");
+    QVERIFY(QDir(dir.path()).mkpath(QStringLiteral("project/sub")));
+    const QString a = baseDir + QStringLiteral("/a.txt");
+    const QString b = baseDir + QStringLiteral("/sub/b.txt");
+    const QString wide = baseDir + QStringLiteral("/wide.txt");
+    QVERIFY(writeFile(a, "hello world"));
+    QVERIFY(writeFile(b, "goodbye moon"));
+    QVERIFY(writeFile(wide, QByteArray("\xFF\xFEh\0e\0l\0l\0o\0", 12)));
+    const QStringList files{a, b, wide};
+
+    // the files that might contain all literals, UTF-16 files are not indexed
+    KateProjectTrigramIndex index(baseDir, dir.path(), files, false);
+    QCOMPARE(index.filterCandidates(files, {QStringLiteral("hello")}), QStringList({a, wide}));
+    QCOMPARE(index.filterCandidates(files, {QStringLiteral("HELLO"), QStringLiteral("world")}), QStringList({a, wide}));
+    QCOMPARE(index.filterCandidates(files, {QStringLiteral("hello"), QStringLiteral("moon")}), QStringList({wide}));
+    QCOMPARE(index.filterCandidates(files, {QStringLiteral("he")}), files);
+
+    // files the index doesn't know and files of changed directories are kept
+    const QString unknown = baseDir + QStringLiteral("/unknown.txt");
+    QCOMPARE(index.filterCandidates({unknown, b}, {QStringLiteral("hello")}), QStringList({unknown}));
+    QCOMPARE(index.filterCandidates(files, {QStringLiteral("hello")}, {baseDir + QStringLiteral("/sub")}), files);
+
+    // files written since they were indexed are kept
+    QVERIFY(writeFile(b, "hello again, moon"));
+    QCOMPARE(index.filterCandidates(files, {QStringLiteral("hello")}), files);
+
+    // the next index only reads the changed file again
+    const QDateTime aModified = QFileInfo(a).lastModified();
+    {
+        KateProjectTrigramIndex updated(baseDir, dir.path(), files, false);
+        QCOMPARE(updated.filterCandidates(files, {QStringLiteral("hello")}), files);
+        QCOMPARE(updated.filterCandidates(files, {QStringLiteral("goodbye")}), QStringList({wide}));
+    }
+
+    // a file with the same time and size is taken from the stored index
+    QVERIFY(writeFile(a, "xxxxx yyyyy"));
+    QFile file(a);
+    QVERIFY(file.open(QIODevice::ReadWrite));
+    QVERIFY(file.setFileTime(aModified, QFileDevice::FileModificationTime));
+    file.close();
+    {
+        KateProjectTrigramIndex reused(baseDir, dir.path(), files, false);
+        QCOMPARE(reused.filterCandidates(files, {QStringLiteral("world")}), QStringList({a, wide}));
+        QCOMPARE(reused.filterCandidates(files, {QStringLiteral("xxxxx")}), QStringList({wide}));
+    }
+
+    // unless the index is built again
+    KateProjectTrigramIndex forced(baseDir, dir.path(), files, true);
+    QCOMPARE(forced.filterCandidates(files, {QStringLiteral("world")}), QStringList({wide}));
+    QCOMPARE(forced.filterCandidates(files, {QStringLiteral("xxxxx")}), QStringList({a, wide}));
+}
+
+void Test1::testSnapshot()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString baseDir = dir.path();
+    const QString otherDir = baseDir + QStringLiteral("/other");
+    const QByteArray key("key");
+
+    const KateProjectSnapshot::FilesEntries entries{
+        QStringList{baseDir + QStringLiteral("/a.txt"), baseDir + QStringLiteral("/sub/b.txt"), baseDir + QStringLiteral("/sub/c.txt"), baseDir + QString::fromUtf8("/\xC3\xBC.txt")},
+        QStringList(),
+        QStringList{otherDir + QStringLiteral("/d.txt")}};
+
+    KateProjectSnapshot snapshot(baseDir);
+    KateProjectSnapshot::FilesEntries read;
+    QVERIFY(!snapshot.read(key, read));
+
+    snapshot.write(key, entries);
+    QVERIFY(snapshot.read(key, read));
+    QCOMPARE(read, entries);
+
+    // only read with the same key and for the same project
+    read.clear();
+    QVERIFY(!snapshot.read(QByteArray("other key"), read));
+    QVERIFY(!KateProjectSnapshot(otherDir).read(key, read));
+    QVERIFY(read.isEmpty());
+
+    // the snapshot file is named after the base directory
+    const QString fileName = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/projects/")
+        + QString::fromLatin1(QCryptographicHash::hash(baseDir.toUtf8(), QCryptographicHash::Sha1).toHex().left(16)) + QStringLiteral(".snapshot");
+    QFile file(fileName);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    const QByteArray data = file.readAll();
+    file.close();
+
+    // a corrupt snapshot is never read, wherever it ends
+    for (int size = 0; size < data.size(); ++size) {
+        QVERIFY(writeFile(fileName, data.left(size)));
+        QVERIFY(!snapshot.read(key, read));
+    }
+    QByteArray wrongVersion = data;
+    wrongVersion[4] = char(wrongVersion.at(4) + 1);
+    QVERIFY(writeFile(fileName, wrongVersion));
+    QVERIFY(!snapshot.read(key, read));
+    QVERIFY(read.isEmpty());
+
+    // a directory index after the directories of the files entry
+    QByteArray wrongDirectory = data;
+    const int dirIndex = data.indexOf("a.txt") - 8;
+    QCOMPARE(wrongDirectory.at(dirIndex), char(0));
+    wrongDirectory[dirIndex] = char(7);
+    QVERIFY(writeFile(fileName, wrongDirectory));
+    QVERIFY(!snapshot.read(key, read));
+
+    // writing it again replaces the corrupt one
+    const KateProjectSnapshot::FilesEntries single{QStringList{baseDir + QStringLiteral("/a.txt")}};
+    snapshot.write(key, single);
+    QVERIFY(snapshot.read(key, read));
+    QCOMPARE(read, single);
+    QFile::remove(fileName);
+}
+
+void Test1::testFilesDiff()
+{
+    const QString a = QStringLiteral("/p/a");
+    const QString b = QStringLiteral("/p/b");
+    const QString c = QStringLiteral("/p/c");
+    const QString d = QStringLiteral("/p/d");
+    const KateProjectSnapshot::FilesEntries base{QStringList{a, b, c}, QStringList{d}};
+    const KateProjectSnapshot::FilesEntries entries{QStringList{a, c, d}, QStringList{d}};
+
+    const KateProjectSharedFilesDiff diff = KateProjectWorker::diffFiles(base, entries);
+    QVERIFY(diff);
+    QCOMPARE(diff->base, base);
+    QCOMPARE(diff->entries, entries);
+    QCOMPARE(diff->added, QVector<QStringList>({QStringList{d}, QStringList()}));
+    QCOMPARE(diff->removed, QVector<QStringList>({QStringList{b}, QStringList()}));
+
+    // other files entries can't be patched
+    QVERIFY(!KateProjectWorker::diffFiles(base, KateProjectSnapshot::FilesEntries{QStringList{a}}));
+}
+
+/**
+ * all items of the project tree as paths, sorted
+ */
+static void collectItems(const QStandardItem *parent, const QString &path, QStringList &items)
+{
+    for (int row = 0; row < parent->rowCount(); ++row) {
+        const QStandardItem *item = parent->child(row);
+        const QString itemPath = path + QLatin1Char('/') + item->text();
+        items.append(itemPath);
+        collectItems(item, itemPath, items);
+    }
+    items.sort();
+}
+
+void Test1::testLoadFilesChanged()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString baseDir = QFileInfo(dir.path()).canonicalFilePath();
+    const QString projectFile = baseDir + QStringLiteral("/.kateproject");
+    QVERIFY(writeFile(projectFile,
+                      "{ \"name\": \"test\", \"files\": [ { \"directory\": \"src\", \"filters\": [ \"*.txt\" ] }, { \"filters\": [ \"*.md\" ] } ] }"));
+    QVERIFY(QDir(baseDir).mkpath(QStringLiteral("src/old")));
+    QVERIFY(QDir(baseDir).mkpath(QStringLiteral("src/keep")));
+    QVERIFY(writeFile(baseDir + QStringLiteral("/src/a.txt")));
+    QVERIFY(writeFile(baseDir + QStringLiteral("/src/old/b.txt")));
+    QVERIFY(writeFile(baseDir + QStringLiteral("/src/keep/c.txt")));
+    QVERIFY(writeFile(baseDir + QStringLiteral("/readme.md")));
+
+    const QString currentDir = QDir::currentPath();
+    QDir::setCurrent(baseDir);
+    KateProjectPlugin plugin;
+    QDir::setCurrent(currentDir);
+    ThreadWeaver::Queue weaver;
+    KateProject project(&weaver, &plugin);
+    QVERIFY(project.loadFromFile(projectFile));
+    finishWorkers(weaver);
+    KateProjectItem *kept = project.itemForFile(baseDir + QStringLiteral("/src/keep/c.txt"));
+    QVERIFY(kept);
+
+    // a directory gets empty, new directories and files in both files entries
+    QVERIFY(QDir(baseDir + QStringLiteral("/src/old")).removeRecursively());
+    QVERIFY(QDir(baseDir).mkpath(QStringLiteral("src/new/deep")));
+    QVERIFY(writeFile(baseDir + QStringLiteral("/src/new/deep/d.txt")));
+    QVERIFY(writeFile(baseDir + QStringLiteral("/src/e.txt")));
+    QVERIFY(writeFile(baseDir + QStringLiteral("/notes.md")));
+    QVERIFY(project.reload(true));
+    finishWorkers(weaver);
+
+    // the model is patched, not built again
+    QCOMPARE(project.itemForFile(baseDir + QStringLiteral("/src/keep/c.txt")), kept);
+    QVERIFY(!project.itemForFile(baseDir + QStringLiteral("/src/old/b.txt")));
+    QVERIFY(project.itemForFile(baseDir + QStringLiteral("/src/new/deep/d.txt")));
+    QVERIFY(project.itemForFile(baseDir + QStringLiteral("/notes.md")));
+
+    // and looks like the model of the project loaded now
+    QStringList patched;
+    collectItems(project.model()->invisibleRootItem(), QString(), patched);
+    QVERIFY(patched.contains(QStringLiteral("/new/deep/d.txt")));
+    QVERIFY(!patched.contains(QStringLiteral("/old")));
+
+    KateProject loaded(&weaver, &plugin);
+    QVERIFY(loaded.loadFromFile(projectFile));
+    finishWorkers(weaver);
+    QStringList items;
+    collectItems(loaded.model()->invisibleRootItem(), QString(), items);
+    QCOMPARE(patched, items);
+}
+
 // kate: space-indent on; indent-width 4; replace-tabs on;
@@ -34,6 +34,16 @@ public Q_SLOTS:
 private Q_SLOTS:
     void testCommonParent();
     void testShellCheckParsing();
+    void testGitIndex();
+    void testWatcher();
+    void testCtagsMerge();
+    void testPathStore();
+    void testSnapshotRefresh();
+    void testChangedDirectories();
+    void testTrigramIndex();
+    void testSnapshot();
+    void testFilesDiff();
+    void testLoadFilesChanged();
 };
 
 #endif
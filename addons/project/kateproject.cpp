@@ -19,6 +19,7 @@
  */
 
 #include "kateproject.h"
+#include "kateprojectgitindex.h"
 #include "kateprojectplugin.h"
 #include "kateprojectworker.h"
 
@@ -36,16 +37,21 @@
 #include <QJsonObject>
 #include <QJsonParseError>
 #include <QPlainTextDocumentLayout>
+#include <QSet>
 #include <utility>
 
 KateProject::KateProject(ThreadWeaver::Queue *weaver, KateProjectPlugin *plugin)
     : QObject()
     , m_fileLastModified()
+    , m_filesStoreDirty(true)
+    , m_filesLoaded(false)
+    , m_pendingIndexLoads(0)
     , m_notesDocument(nullptr)
     , m_untrackedDocumentsRoot(nullptr)
     , m_weaver(weaver)
     , m_plugin(plugin)
 {
+    connect(&m_filesWatcher, &KateProjectWatcher::changed, this, &KateProject::slotFilesChanged);
 }
 
 KateProject::~KateProject()
@@ -144,6 +150,19 @@ bool KateProject::loadFromData(const QVariantMap &globalProject, const QString &
     return load(globalProject);
 }
 
+/**
+ * do both project maps lead to the same files entries?
+ */
+static bool sameFilesEntries(const QVariantMap &project, const QVariantMap &other)
+{
+    for (const QString &key : {QStringLiteral("directory"), QStringLiteral("files"), QStringLiteral("projects")}) {
+        if (project.value(key) != other.value(key)) {
+            return false;
+        }
+    }
+    return true;
+}
+
 bool KateProject::load(const QVariantMap &globalProject, bool force)
 {
     /**
@@ -168,6 +187,12 @@ bool KateProject::load(const QVariantMap &globalProject, bool force)
         return true;
     }
 
+    /**
+     * the files are searched like before?
+     * then the worker only needs to send the changes of the files shown
+     */
+    const bool filesShown = m_filesLoaded && sameFilesEntries(m_projectMap, globalProject);
+
     /**
      * setup global attributes in this object
      */
@@ -177,6 +202,33 @@ bool KateProject::load(const QVariantMap &globalProject, bool force)
     emit projectMapChanged();
 
     // trigger loading of project in background thread
+    startWorker(force, filesShown);
+
+    // we are done here
+    return true;
+}
+
+void KateProject::startWorker(bool force, bool filesShown, const QSet<QString> *changedDirectories)
+{
+    auto w = new KateProjectWorker(m_baseDir, indexDirectory(), m_projectMap, force);
+    if (filesShown) {
+        w->setShownFiles(m_filesEntries);
+        if (changedDirectories) {
+            w->setChangedDirectories(*changedDirectories);
+        }
+    }
+    if (!force) {
+        w->setPreviousIndex(m_projectIndex);
+    }
+    connect(w, &KateProjectWorker::loadDone, this, &KateProject::loadProjectDone);
+    connect(w, &KateProjectWorker::filesChanged, this, &KateProject::loadFilesChanged);
+    connect(w, &KateProjectWorker::loadIndexDone, this, &KateProject::loadIndexDone);
+    ++m_pendingIndexLoads;
+    m_weaver->stream() << w;
+}
+
+QString KateProject::indexDirectory() const
+{
     QString indexDir;
     if (m_plugin->getIndexEnabled()) {
         indexDir = m_plugin->getIndexDirectory().toLocalFile();
@@ -185,21 +237,102 @@ bool KateProject::load(const QVariantMap &globalProject, bool force)
             indexDir = QDir::tempPath();
         }
     }
-    auto w = new KateProjectWorker(m_baseDir, indexDir, m_projectMap, force);
-    connect(w, &KateProjectWorker::loadDone, this, &KateProject::loadProjectDone);
-    connect(w, &KateProjectWorker::loadIndexDone, this, &KateProject::loadIndexDone);
-    m_weaver->stream() << w;
+    return indexDir;
+}
 
-    // we are done here
-    return true;
+void KateProject::slotFilesChanged(const QStringList &directories)
+{
+    /**
+     * searches keep the files of these directories until the index is updated
+     */
+    for (const QString &directory : directories) {
+        m_staleDirectories.insert(directory);
+    }
+
+    /**
+     * nothing shown yet, the running load will find the changes
+     */
+    if (!m_filesLoaded) {
+        return;
+    }
+
+    /**
+     * only the directories changed since the last index are listed and indexed again,
+     * the shown files might miss the changes of running workers
+     * files written in place don't change their directory, searches check these on disk
+     * with only the fallback paths watched the changes could be anywhere
+     */
+    startWorker(false, true, m_filesWatcher.isFallback() ? nullptr : &m_staleDirectories);
 }
 
-void KateProject::loadProjectDone(const KateProjectSharedQStandardItem &topLevel, KateProjectSharedQMapStringItem file2Item)
+void KateProject::watchFiles()
+{
+    QVector<QStandardItem *> roots;
+    QStringList entryDirs;
+    collectEntryRoots(m_model.invisibleRootItem(), m_projectMap, roots, entryDirs);
+
+    /**
+     * watch the directories of the files entries and all directories below them
+     * containing files, without them at least the directories of the files entries
+     * and the git directories, checkouts and commits change these
+     */
+    QSet<QString> directories;
+    QStringList fallbackPaths;
+    for (int i = 0; i < entryDirs.size() && i < m_filesEntries.size(); ++i) {
+        const QString &entryDir = entryDirs.at(i);
+        if (entryDir.isEmpty()) {
+            continue;
+        }
+        directories.insert(entryDir);
+        fallbackPaths.append(entryDir);
+        const QString gitIndex = KateProjectGitIndex::indexFileName(entryDir);
+        if (!gitIndex.isEmpty()) {
+            fallbackPaths.append(QFileInfo(gitIndex).path());
+        }
+
+        QStringRef lastDirectory;
+        for (const QString &file : m_filesEntries.at(i)) {
+            const QStringRef directory = file.leftRef(file.lastIndexOf(QLatin1Char('/')));
+            if (directory == lastDirectory) {
+                continue;
+            }
+            lastDirectory = directory;
+            QString path = directory.toString();
+            while (path.size() > entryDir.size() && !directories.contains(path)) {
+                directories.insert(path);
+                path.truncate(qMax(0, path.lastIndexOf(QLatin1Char('/'))));
+            }
+        }
+    }
+    fallbackPaths.removeDuplicates();
+
+    /**
+     * the files the project writes itself would trigger endless updates,
+     * the project file is reloaded on its own
+     */
+    QStringList ignoredFiles;
+    ignoredFiles.append(m_fileName);
+    const QString indexDir = indexDirectory();
+    if (!indexDir.isEmpty()) {
+        ignoredFiles.append(QDir(indexDir).absoluteFilePath(QStringLiteral("kate.project")));
+        const QVariant indexFile = m_projectMap.value(QStringLiteral("ctags")).toMap().value(QStringLiteral("index_file"));
+        if (indexFile.userType() == QMetaType::QString) {
+            ignoredFiles.append(QDir::cleanPath(QDir(m_baseDir).absoluteFilePath(indexFile.toString())));
+        }
+    }
+
+    m_filesWatcher.setPaths(directories.values(), fallbackPaths, ignoredFiles);
+}
+
+void KateProject::loadProjectDone(const KateProjectSharedQStandardItem &topLevel, KateProjectSharedQMapStringItem file2Item, const KateProjectSnapshot::FilesEntries &entries)
 {
     m_model.clear();
     m_model.invisibleRootItem()->appendColumn(topLevel->takeColumn(0));
 
     m_file2Item = std::move(file2Item);
+    m_filesStoreDirty = true;
+    m_filesEntries = entries;
+    m_filesLoaded = true;
 
     /**
      * readd the documents that are open atm
@@ -209,9 +342,195 @@ void KateProject::loadProjectDone(const KateProjectSharedQStandardItem &topLevel
         registerDocument(i.key());
     }
 
+    watchFiles();
+
     emit modelChanged();
 }
 
+void KateProject::loadFilesChanged(const KateProjectSharedFilesDiff &diff)
+{
+    /**
+     * changes of files searched in another way than now are outdated,
+     * if the model changed since the worker started, compute the changes against it
+     */
+    if (!m_filesLoaded || !sameFilesEntries(diff->projectMap, m_projectMap)) {
+        return;
+    }
+    KateProjectSharedFilesDiff changes = diff;
+    if (diff->base != m_filesEntries) {
+        changes = KateProjectWorker::diffFiles(m_filesEntries, diff->entries);
+        if (!changes) {
+            return;
+        }
+    }
+
+    /**
+     * find the parent item of each files entry, the model is built like the worker does it
+     * if it doesn't fit, build it again
+     */
+    QVector<QStandardItem *> roots;
+    QStringList dirs;
+    collectEntryRoots(m_model.invisibleRootItem(), m_projectMap, roots, dirs);
+    if (roots.size() != changes->entries.size()) {
+        m_filesLoaded = false;
+        load(m_projectMap, true);
+        return;
+    }
+
+    /**
+     * a file can be in several files entries, it is only removed if it is in none of them anymore
+     */
+    QSet<QString> allFiles;
+    if (changes->entries.size() > 1) {
+        for (const QStringList &entry : qAsConst(changes->entries)) {
+            for (const QString &file : entry) {
+                allFiles.insert(file);
+            }
+        }
+    }
+
+    /**
+     * remove all files first, this drops the directories that get empty
+     */
+    QSet<QString> changedFiles;
+    for (const QStringList &removed : qAsConst(changes->removed)) {
+        for (const QString &file : removed) {
+            KateProjectItem *item = itemForFile(file);
+            if (!item || item->data(Qt::UserRole + 3).toBool() || allFiles.contains(file)) {
+                continue;
+            }
+            m_file2Item->remove(file);
+            removeFileItem(item);
+            changedFiles.insert(file);
+        }
+    }
+
+    /**
+     * add the new files, the items of untracked documents are replaced
+     */
+    for (int i = 0; i < changes->added.size(); ++i) {
+        QMap<QString, QStandardItem *> dir2Item;
+        for (const QString &file : changes->added.at(i)) {
+            if (KateProjectItem *item = itemForFile(file)) {
+                if (!item->data(Qt::UserRole + 3).toBool()) {
+                    continue;
+                }
+                m_file2Item->remove(file);
+                unregisterUntrackedItem(item);
+            }
+            addFileItem(roots.at(i), dirs.at(i), file, dir2Item);
+            changedFiles.insert(file);
+        }
+    }
+
+    m_filesEntries = changes->entries;
+    m_filesStoreDirty = true;
+    watchFiles();
+
+    /**
+     * readd the documents that are open atm and got added or removed
+     */
+    for (auto i = m_documents.constBegin(); i != m_documents.constEnd(); i++) {
+        if (changedFiles.contains(i.value())) {
+            registerDocument(i.key());
+        }
+    }
+
+    emit modelChanged();
+}
+
+void KateProject::collectEntryRoots(QStandardItem *parent, const QVariantMap &project, QVector<QStandardItem *> &roots, QStringList &dirs) const
+{
+    /**
+     * sub-projects FIRST, the worker appended their items in order before any directory or file
+     */
+    int row = 0;
+    const QVariantList subGroups = project[QStringLiteral("projects")].toList();
+    for (const QVariant &subGroupVariant : subGroups) {
+        const QVariantMap subProject = subGroupVariant.toMap();
+        if (subProject[QStringLiteral("name")].toString().isEmpty()) {
+            continue;
+        }
+
+        QStandardItem *subProjectItem = nullptr;
+        while (!subProjectItem && row < parent->rowCount()) {
+            QStandardItem *child = parent->child(row++);
+            if (child->type() == QStandardItem::UserType + KateProjectItem::Project) {
+                subProjectItem = child;
+            }
+        }
+        if (!subProjectItem) {
+            return;
+        }
+        collectEntryRoots(subProjectItem, subProject, roots, dirs);
+    }
+
+    /**
+     * all files entries of a project share its item
+     */
+    const QVariantList files = project[QStringLiteral("files")].toList();
+    for (const QVariant &fileVariant : files) {
+        QDir dir(m_baseDir);
+        roots.append(parent);
+        dirs.append(dir.cd(fileVariant.toMap()[QStringLiteral("directory")].toString()) ? dir.path() : QString());
+    }
+}
+
+void KateProject::addFileItem(QStandardItem *root, const QString &entryDir, const QString &filePath, QMap<QString, QStandardItem *> &dir2Item)
+{
+    /**
+     * directories relative to the directory of the files entry, like the worker creates them
+     */
+    const int slash = filePath.lastIndexOf(QLatin1Char('/'));
+    QString dirRelPath = QDir(entryDir).relativeFilePath(filePath.left(slash));
+    if (dirRelPath == QLatin1Char('.')) {
+        dirRelPath = QString();
+    }
+
+    QStandardItem *parent = dir2Item.value(dirRelPath);
+    if (!parent) {
+        parent = root;
+        const QVector<QStringRef> parts = dirRelPath.splitRef(QLatin1Char('/'), QString::SkipEmptyParts);
+        for (const QStringRef &part : parts) {
+            QStandardItem *directory = nullptr;
+            for (int row = 0; !directory && row < parent->rowCount(); ++row) {
+                QStandardItem *child = parent->child(row);
+                if (child != m_untrackedDocumentsRoot && child->type() == QStandardItem::UserType + KateProjectItem::Directory && child->text() == part) {
+                    directory = child;
+                }
+            }
+            if (!directory) {
+                directory = new KateProjectItem(KateProjectItem::Directory, part.toString());
+                parent->appendRow(directory);
+            }
+            parent = directory;
+        }
+        dir2Item[dirRelPath] = parent;
+    }
+
+    KateProjectItem *fileItem = new KateProjectItem(KateProjectItem::File, filePath.mid(slash + 1));
+    fileItem->setData(filePath, Qt::ToolTipRole);
+    fileItem->setData(filePath, Qt::UserRole);
+    parent->appendRow(fileItem);
+    (*m_file2Item)[filePath] = fileItem;
+}
+
+void KateProject::removeFileItem(QStandardItem *item)
+{
+    /**
+     * remove the item and the directories that got empty by that
+     */
+    QStandardItem *const root = m_model.invisibleRootItem();
+    while (item != root) {
+        QStandardItem *parent = item->parent() ? item->parent() : root;
+        parent->removeRow(item->row());
+        if (parent == root || parent == m_untrackedDocumentsRoot || parent->rowCount() > 0 || parent->type() != QStandardItem::UserType + KateProjectItem::Directory) {
+            return;
+        }
+        item = parent;
+    }
+}
+
 void KateProject::loadIndexDone(KateProjectSharedProjectIndex projectIndex)
 {
     /**
@@ -219,12 +538,36 @@ void KateProject::loadIndexDone(KateProjectSharedProjectIndex projectIndex)
      */
     m_projectIndex = std::move(projectIndex);
 
+    /**
+     * the last running worker started after all changes seen so far
+     */
+    if (--m_pendingIndexLoads <= 0) {
+        m_pendingIndexLoads = 0;
+        m_staleDirectories.clear();
+    }
+
     /**
      * notify external world that data is available
      */
     emit indexChanged();
 }
 
+PathStore KateProject::files()
+{
+    if (m_filesStoreDirty) {
+        PathStore::Builder builder;
+        if (m_file2Item) {
+            builder.reserve(m_file2Item->size());
+            for (auto it = m_file2Item->keyBegin(); it != m_file2Item->keyEnd(); ++it) {
+                builder.append(*it);
+            }
+        }
+        m_filesStore = builder.build();
+        m_filesStoreDirty = false;
+    }
+    return m_filesStore;
+}
+
 QString KateProject::projectLocalFileName(const QString &suffix) const
 {
     /**
@@ -412,6 +755,7 @@ void KateProject::registerUntrackedDocument(KTextEditor::Document *document)
         m_file2Item = KateProjectSharedQMapStringItem(new QMap<QString, KateProjectItem *>());
     }
     (*m_file2Item)[document->url().toLocalFile()] = fileItem;
+    m_filesStoreDirty = true;
 }
 
 void KateProject::unregisterDocument(KTextEditor::Document *document)
@@ -429,6 +773,7 @@ void KateProject::unregisterDocument(KTextEditor::Document *document)
         if (item && item->data(Qt::UserRole + 3).toBool()) {
             unregisterUntrackedItem(item);
             m_file2Item->remove(file);
+            m_filesStoreDirty = true;
         }
     }
 
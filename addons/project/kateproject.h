@@ -23,9 +23,15 @@
 
 #include "kateprojectindex.h"
 #include "kateprojectitem.h"
+#include "kateprojectsnapshot.h"
+#include "kateprojectwatcher.h"
+
+#include "pathstore.h"
+
 #include <KTextEditor/ModificationInterface>
 #include <QDateTime>
 #include <QMap>
+#include <QSet>
 #include <QSharedPointer>
 #include <QTextDocument>
 
@@ -42,6 +48,23 @@ Q_DECLARE_METATYPE(KateProjectSharedQMapStringItem)
 typedef QSharedPointer<KateProjectIndex> KateProjectSharedProjectIndex;
 Q_DECLARE_METATYPE(KateProjectSharedProjectIndex)
 
+/**
+ * Changes of the files of a project found on reload.
+ * For each files entry the files added and removed since base.
+ */
+class KateProjectFilesDiff
+{
+public:
+    QVariantMap projectMap;
+    KateProjectSnapshot::FilesEntries base;
+    KateProjectSnapshot::FilesEntries entries;
+    QVector<QStringList> added;
+    QVector<QStringList> removed;
+};
+
+typedef QSharedPointer<KateProjectFilesDiff> KateProjectSharedFilesDiff;
+Q_DECLARE_METATYPE(KateProjectSharedFilesDiff)
+
 namespace ThreadWeaver
 {
 class Queue;
@@ -142,12 +165,10 @@ public:
 
     /**
      * Flat list of all files in the project
+     * Implicitly shared, only built again after the files changed.
      * @return list of files in project
      */
-    QStringList files()
-    {
-        return m_file2Item ? m_file2Item->keys() : QStringList();
-    }
+    PathStore files();
 
     /**
      * get item for file
@@ -170,6 +191,16 @@ public:
         return m_projectIndex.data();
     }
 
+    /**
+     * Directories that changed on disk since the index was built.
+     * Searches can't rule out their files with the index.
+     * @return changed directories, without trailing slash
+     */
+    const QSet<QString> &staleDirectories() const
+    {
+        return m_staleDirectories;
+    }
+
     /**
      * Computes a suitable file name for the given suffix.
      * If you e.g. want to store a "notes" file, you could pass "notes" and get
@@ -210,8 +241,23 @@ private Q_SLOTS:
      * Used for worker to send back the results of project loading
      * @param topLevel new toplevel element for model
      * @param file2Item new file => item mapping
+     * @param entries files of each files entry the model was built from
+     */
+    void loadProjectDone(const KateProjectSharedQStandardItem &topLevel, KateProjectSharedQMapStringItem file2Item, const KateProjectSnapshot::FilesEntries &entries);
+
+    /**
+     * Used for worker to send back the changes of the files on reload,
+     * these are applied to the existing model
+     * @param diff files added and removed per files entry
+     */
+    void loadFilesChanged(const KateProjectSharedFilesDiff &diff);
+
+    /**
+     * Files of the project were added, removed or changed on disk.
+     * Searches the changed directories again and updates the model and index with the changes.
+     * @param directories the watched directories that changed
      */
-    void loadProjectDone(const KateProjectSharedQStandardItem &topLevel, KateProjectSharedQMapStringItem file2Item);
+    void slotFilesChanged(const QStringList &directories);
 
     /**
      * Used for worker to send back the results of index loading
@@ -244,6 +290,12 @@ Q_SIGNALS:
 
 private:
     void registerUntrackedDocument(KTextEditor::Document *document);
+    void startWorker(bool force, bool filesShown, const QSet<QString> *changedDirectories = nullptr);
+    QString indexDirectory() const;
+    void watchFiles();
+    void collectEntryRoots(QStandardItem *parent, const QVariantMap &project, QVector<QStandardItem *> &roots, QStringList &dirs) const;
+    void addFileItem(QStandardItem *root, const QString &entryDir, const QString &filePath, QMap<QString, QStandardItem *> &dir2Item);
+    void removeFileItem(QStandardItem *item);
     void unregisterUntrackedItem(const KateProjectItem *item);
     QVariantMap readProjectFile() const;
 
@@ -283,11 +335,36 @@ private:
      */
     KateProjectSharedQMapStringItem m_file2Item;
 
+    /**
+     * files of m_file2Item for files(), built on demand
+     */
+    PathStore m_filesStore;
+    bool m_filesStoreDirty;
+
+    /**
+     * files of each files entry shown in the model, the worker sends the
+     * changes against these on reload
+     */
+    KateProjectSnapshot::FilesEntries m_filesEntries;
+    bool m_filesLoaded;
+
+    /**
+     * watcher for the directories of the files, to keep the files up to date
+     */
+    KateProjectWatcher m_filesWatcher;
+
     /**
      * project index, if any
      */
     KateProjectSharedProjectIndex m_projectIndex;
 
+    /**
+     * directories changed since the index was built and the number of
+     * workers still building an index, see staleDirectories()
+     */
+    QSet<QString> m_staleDirectories;
+    int m_pendingIndexLoads;
+
     /**
      * notes buffer for project local notes
      */
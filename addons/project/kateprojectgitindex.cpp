@@ -0,0 +1,324 @@
+/*  This file is part of the Kate project.
+ *
+ *  Copyright (C) 2020 by Kate Developers <kwrite-devel@kde.org>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Library General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public License
+ *  along with this library; see the file COPYING.LIB.  If not, write to
+ *  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301, USA.
+ */
+
+#include "kateprojectgitindex.h"
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QRegularExpression>
+
+#include <cstring>
+
+/**
+ * index entries: 40 bytes of stat data, the object id, then 16 bits of flags,
+ * followed by another 16 bits of flags if extended
+ */
+static const int StatDataSize = 40;
+static const quint16 FlagExtended = 0x4000;
+static const quint32 ModeTypeMask = 0170000;
+static const quint32 ModeGitLink = 0160000;
+static const quint32 ModeDirectory = 0040000;
+
+static inline quint32 readUInt32(const uchar *data)
+{
+    return (quint32(data[0]) << 24) | (quint32(data[1]) << 16) | (quint32(data[2]) << 8) | quint32(data[3]);
+}
+
+static inline quint16 readUInt16(const uchar *data)
+{
+    return quint16((data[0] << 8) | data[1]);
+}
+
+bool KateProjectGitIndex::parseIndex(const QByteArray &index, int hashSize, const QByteArray &prefix, QStringList &files, QList<QByteArray> &submodules)
+{
+    const uchar *const begin = reinterpret_cast<const uchar *>(index.constData());
+    const uchar *const end = begin + index.size();
+
+    // header: signature, version, number of entries, the file ends with the checksum
+    if (index.size() < 12 + hashSize || std::memcmp(begin, "DIRC", 4) != 0) {
+        return false;
+    }
+    const quint32 version = readUInt32(begin + 4);
+    if (version < 2 || version > 4) {
+        return false;
+    }
+    const quint32 count = readUInt32(begin + 8);
+
+    const uchar *p = begin + 12;
+    const uchar *const entriesEnd = end - hashSize;
+    QByteArray path;
+    QByteArray lastPath;
+    for (quint32 i = 0; i < count; ++i) {
+        const uchar *const entry = p;
+        if (entriesEnd - p < StatDataSize + hashSize + 2) {
+            return false;
+        }
+        const quint32 mode = readUInt32(entry + 24);
+        const quint16 flags = readUInt16(entry + StatDataSize + hashSize);
+        p = entry + StatDataSize + hashSize + 2;
+        if (version >= 3 && (flags & FlagExtended)) {
+            p += 2;
+        }
+
+        // version 4 compresses the path against the one of the previous entry
+        if (version == 4) {
+            if (p >= entriesEnd) {
+                return false;
+            }
+            quint64 strip = *p & 0x7f;
+            while (*p++ & 0x80) {
+                if (p >= entriesEnd || strip > quint64(path.size())) {
+                    return false;
+                }
+                strip = ((strip + 1) << 7) | (*p & 0x7f);
+            }
+            if (strip > quint64(path.size())) {
+                return false;
+            }
+            path.chop(int(strip));
+        } else {
+            path.clear();
+        }
+
+        const uchar *const name = p;
+        const uchar *const nul = p < entriesEnd ? static_cast<const uchar *>(std::memchr(name, 0, entriesEnd - name)) : nullptr;
+        if (!nul) {
+            return false;
+        }
+        path.append(reinterpret_cast<const char *>(name), int(nul - name));
+
+        // versions 2 and 3 pad the entries with 1 to 8 NULs to a multiple of 8 bytes
+        if (version == 4) {
+            p = nul + 1;
+        } else {
+            p = entry + ((name - entry + (nul - name) + 8) & ~7);
+            if (p > entriesEnd) {
+                return false;
+            }
+        }
+
+        // sparse indexes store directories instead of their files
+        const quint32 type = mode & ModeTypeMask;
+        if (type == ModeDirectory) {
+            return false;
+        }
+
+        // unmerged paths have one entry per stage
+        if (path == lastPath) {
+            continue;
+        }
+        lastPath = path;
+
+        if (type == ModeGitLink) {
+            submodules.append(path);
+            continue;
+        }
+        if (path.startsWith(prefix)) {
+            files.append(QString::fromUtf8(path.constData() + prefix.size(), path.size() - prefix.size()));
+        }
+    }
+
+    // a split index keeps most entries in a shared index, a sparse one directories
+    while (entriesEnd - p >= 8) {
+        if (std::memcmp(p, "link", 4) == 0 || std::memcmp(p, "sdir", 4) == 0) {
+            return false;
+        }
+        const quint32 size = readUInt32(p + 4);
+        if (quint64(entriesEnd - p - 8) < size) {
+            return false;
+        }
+        p += 8 + size;
+    }
+
+    return true;
+}
+
+/**
+ * Find the git directory of the work tree containing dir.
+ * @param dir directory to start at, its parents are searched, too
+ * @param workTree the root of the work tree is stored here
+ * @return the git directory or an empty string if there is none
+ */
+static QString findGitDir(const QString &dir, QString &workTree)
+{
+    QDir current(dir);
+    do {
+        const QString dotGit = current.absoluteFilePath(QStringLiteral(".git"));
+        const QFileInfo info(dotGit);
+        if (info.isDir()) {
+            workTree = current.absolutePath();
+            return dotGit;
+        }
+
+        // work trees and submodules point to their git directory
+        if (info.isFile()) {
+            QFile file(dotGit);
+            if (!file.open(QIODevice::ReadOnly)) {
+                return QString();
+            }
+            const QByteArray line = file.readLine().trimmed();
+            if (!line.startsWith("gitdir: ")) {
+                return QString();
+            }
+            workTree = current.absolutePath();
+            return QDir::cleanPath(current.absoluteFilePath(QFile::decodeName(line.mid(8))));
+        }
+    } while (current.cdUp());
+
+    return QString();
+}
+
+/**
+ * size of the object ids of the repository, configured in the common git directory
+ */
+static int hashSize(const QString &gitDir)
+{
+    QString commonDir = gitDir;
+    QFile commonDirFile(gitDir + QStringLiteral("/commondir"));
+    if (commonDirFile.open(QIODevice::ReadOnly)) {
+        commonDir = QDir(gitDir).absoluteFilePath(QFile::decodeName(commonDirFile.readLine().trimmed()));
+    }
+
+    QFile config(commonDir + QStringLiteral("/config"));
+    if (config.open(QIODevice::ReadOnly)) {
+        static const QRegularExpression sha256(QStringLiteral("^\\s*objectformat\\s*=\\s*sha256\\s*$"), QRegularExpression::CaseInsensitiveOption | QRegularExpression::MultilineOption);
+        if (sha256.match(QString::fromUtf8(config.readAll())).hasMatch()) {
+            return 32;
+        }
+    }
+    return 20;
+}
+
+/**
+ * List the files of the work tree containing dir, recursing into submodules.
+ * @param dir directory in the work tree, may be its root
+ * @param prefix only paths starting with this prefix are reported, without it
+ * @param outPrefix prepended to all reported paths
+ * @param files the paths are appended here
+ * @param timing time spent in the stages is added here
+ */
+static bool listWorkTree(const QString &dir, const QByteArray &prefix, const QString &outPrefix, QStringList &files, KateProjectGitIndex::Timing &timing)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    QString workTree;
+    const QString gitDir = findGitDir(dir, workTree);
+    if (gitDir.isEmpty()) {
+        return false;
+    }
+
+    // paths in the index are relative to the root of the work tree
+    QByteArray treePrefix = prefix;
+    const QString relativeDir = QDir(workTree).relativeFilePath(dir);
+    if (relativeDir.startsWith(QLatin1String(".."))) {
+        return false;
+    }
+    if (relativeDir != QLatin1String(".") && !relativeDir.isEmpty()) {
+        treePrefix.prepend(relativeDir.toUtf8() + '/');
+    }
+    const int ids = hashSize(gitDir);
+    timing.locate += timer.restart();
+
+    // map the index, it is only read once
+    QFile indexFile(gitDir + QStringLiteral("/index"));
+    if (!indexFile.open(QIODevice::ReadOnly)) {
+        // a fresh repository without any file added has no index
+        return !QFileInfo::exists(indexFile.fileName());
+    }
+    QByteArray index;
+    if (uchar *data = indexFile.map(0, indexFile.size())) {
+        index = QByteArray::fromRawData(reinterpret_cast<const char *>(data), int(indexFile.size()));
+    } else {
+        index = indexFile.readAll();
+    }
+    timing.read += timer.restart();
+
+    QStringList ownFiles;
+    QList<QByteArray> submodules;
+    const bool ok = KateProjectGitIndex::parseIndex(index, ids, treePrefix, ownFiles, submodules);
+    timing.parse += timer.restart();
+    if (!ok) {
+        return false;
+    }
+
+    if (outPrefix.isEmpty()) {
+        files.append(ownFiles);
+    } else {
+        for (const QString &file : qAsConst(ownFiles)) {
+            files.append(outPrefix + file);
+        }
+    }
+
+    // submodules below the prefix are listed entirely, one containing the prefix is listed below it
+    for (const QByteArray &submodule : qAsConst(submodules)) {
+        const QByteArray submoduleDir = submodule + '/';
+        const QString submodulePath = workTree + QLatin1Char('/') + QString::fromUtf8(submodule);
+
+        // not initialized submodules have no files, like for git
+        if (!QFileInfo::exists(submodulePath + QStringLiteral("/.git"))) {
+            continue;
+        }
+
+        if (submoduleDir.startsWith(treePrefix)) {
+            const QString subOutPrefix = outPrefix + QString::fromUtf8(submoduleDir.mid(treePrefix.size()));
+            if (!listWorkTree(submodulePath, QByteArray(), subOutPrefix, files, timing)) {
+                return false;
+            }
+        } else if (treePrefix.startsWith(submoduleDir)) {
+            if (!listWorkTree(submodulePath, treePrefix.mid(submoduleDir.size()), outPrefix, files, timing)) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+QString KateProjectGitIndex::indexFileName(const QString &dir)
+{
+    QString workTree;
+    const QString gitDir = findGitDir(QDir(dir).absolutePath(), workTree);
+    return gitDir.isEmpty() ? QString() : gitDir + QStringLiteral("/index");
+}
+
+bool KateProjectGitIndex::listFiles(const QString &dir, QStringList &files, Timing *timing)
+{
+    // git would use other files than the ones it finds itself
+    if (qEnvironmentVariableIsSet("GIT_DIR") || qEnvironmentVariableIsSet("GIT_INDEX_FILE") || qEnvironmentVariableIsSet("GIT_WORK_TREE")) {
+        return false;
+    }
+
+    Timing stages;
+    QStringList found;
+    if (!listWorkTree(QDir(dir).absolutePath(), QByteArray(), QString(), found, stages)) {
+        return false;
+    }
+
+    files.append(found);
+    if (timing) {
+        timing->locate += stages.locate;
+        timing->read += stages.read;
+        timing->parse += stages.parse;
+    }
+    return true;
+}
@@ -0,0 +1,76 @@
+/*  This file is part of the Kate project.
+ *
+ *  Copyright (C) 2020 by Kate Developers <kwrite-devel@kde.org>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Library General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public License
+ *  along with this library; see the file COPYING.LIB.  If not, write to
+ *  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KATE_PROJECT_GIT_INDEX_H
+#define KATE_PROJECT_GIT_INDEX_H
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+
+/**
+ * Reader for the index file of a git work tree.
+ *
+ * Lists the tracked files without starting git, the index formats 2 to 4 are
+ * supported, submodules are read recursively. Split and sparse indexes are not,
+ * for these and anything else unexpected the reader gives up and the caller has
+ * to ask git itself.
+ */
+class KateProjectGitIndex
+{
+public:
+    /**
+     * time spent in the stages of listFiles(), in milliseconds
+     */
+    struct Timing {
+        qint64 locate = 0;
+        qint64 read = 0;
+        qint64 parse = 0;
+    };
+
+    /**
+     * List the tracked files below \p dir like `git ls-files -z --recurse-submodules .`
+     * run in \p dir does.
+     * @param dir directory inside a git work tree
+     * @param files the file paths relative to \p dir are appended here
+     * @param timing if not nullptr, the time spent in each stage is added here
+     * @return false if the index could not be read, \p files is left alone then
+     */
+    static bool listFiles(const QString &dir, QStringList &files, Timing *timing = nullptr);
+
+    /**
+     * Find the index file of the work tree containing \p dir.
+     * @return the file name of the index or an empty string if \p dir is not in a work tree
+     */
+    static QString indexFileName(const QString &dir);
+
+    /**
+     * Parse the content of an index file.
+     * @param index content of the index file
+     * @param hashSize size of the object ids, 20 for SHA-1 and 32 for SHA-256 repositories
+     * @param prefix only paths starting with this prefix are reported, without it
+     * @param files the paths of the files are appended here, in index order
+     * @param submodules the paths of the submodules are appended here, relative to the work tree
+     * @return false if the index is malformed or uses a feature that is not supported
+     */
+    static bool parseIndex(const QByteArray &index, int hashSize, const QByteArray &prefix, QStringList &files, QList<QByteArray> &submodules);
+};
+
+#endif
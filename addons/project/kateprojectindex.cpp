@@ -20,16 +20,31 @@
 
 #include "kateprojectindex.h"
 
+#include <QDateTime>
 #include <QDir>
+#include <QFileInfo>
 #include <QProcess>
+#include <QSaveFile>
+#include <QSet>
+
+#include <algorithm>
 
 /**
  * include ctags reading
  */
 #include "ctags/readtags.c"
 
-KateProjectIndex::KateProjectIndex(const QString &baseDir, const QString &indexDir, const QStringList &files, const QVariantMap &ctagsMap, bool force)
+KateProjectIndex::KateProjectIndex(const QString &baseDir,
+                                   const QString &indexDir,
+                                   const QStringList &files,
+                                   const QVariantMap &ctagsMap,
+                                   bool force,
+                                   const KateProjectIndex *previous,
+                                   const QSet<QString> *changedDirectories)
     : m_ctagsIndexHandle(nullptr)
+    , m_files(files)
+    , m_ctagsMap(ctagsMap)
+    , m_ctagsTime(0)
 {
     // allow project to override and specify a (re-usable) indexfile
     // otherwise fall-back to a temporary file if nothing specified
@@ -48,7 +63,12 @@ KateProjectIndex::KateProjectIndex(const QString &baseDir, const QString &indexD
     /**
      * load ctags
      */
-    loadCtags(files, ctagsMap, force);
+    loadCtags(files, ctagsMap, force, previous, changedDirectories);
+
+    /**
+     * load or update the trigram index for searching
+     */
+    m_trigramIndex.reset(new KateProjectTrigramIndex(baseDir, indexDir, files, force, previous ? changedDirectories : nullptr));
 }
 
 KateProjectIndex::~KateProjectIndex()
@@ -62,13 +82,32 @@ KateProjectIndex::~KateProjectIndex()
     }
 }
 
-void KateProjectIndex::loadCtags(const QStringList &files, const QVariantMap &ctagsMap, bool force)
+void KateProjectIndex::loadCtags(const QStringList &files, const QVariantMap &ctagsMap, bool force, const KateProjectIndex *previous, const QSet<QString> *changedDirectories)
 {
+    /**
+     * files changed later than this are tagged again on the next update
+     */
+    m_ctagsTime = QDateTime::currentMSecsSinceEpoch();
+
+    /**
+     * on updates only tag what changed
+     */
+    if (previous && !force && updateCtags(*previous, files, ctagsMap, changedDirectories)) {
+        // the files not checked are compared to the time of the previous tags next time
+        if (changedDirectories) {
+            m_ctagsTime = previous->m_ctagsTime;
+        }
+        openCtags();
+        return;
+    }
+
     /**
      * only overwrite existing index upon reload
      * (a temporary index file will never exist)
+     * if it couldn't be updated, build it again
      */
-    if (m_ctagsIndexFile->exists() && !force) {
+    if (m_ctagsIndexFile->exists() && !force && !previous) {
+        m_ctagsTime = QFileInfo(m_ctagsIndexFile->fileName()).lastModified().toMSecsSinceEpoch();
         openCtags();
         return;
     }
@@ -90,16 +129,25 @@ void KateProjectIndex::loadCtags(const QStringList &files, const QVariantMap &ct
      * try to run ctags for all files in this project
      * output to our ctags index file
      */
+    if (!runCtags(files, m_ctagsIndexFile->fileName(), ctagsMap)) {
+        return;
+    }
+
+    openCtags();
+}
+
+bool KateProjectIndex::runCtags(const QStringList &files, const QString &fileName, const QVariantMap &ctagsMap)
+{
     QProcess ctags;
     QStringList args;
-    args << QStringLiteral("-L") << QStringLiteral("-") << QStringLiteral("-f") << m_ctagsIndexFile->fileName() << QStringLiteral("--fields=+K+n");
+    args << QStringLiteral("-L") << QStringLiteral("-") << QStringLiteral("-f") << fileName << QStringLiteral("--fields=+K+n");
     const QString keyOptions = QStringLiteral("options");
     for (const QVariant &optVariant : ctagsMap[keyOptions].toList()) {
         args << optVariant.toString();
     }
     ctags.start(QStringLiteral("ctags"), args);
     if (!ctags.waitForStarted()) {
-        return;
+        return false;
     }
 
     /**
@@ -111,11 +159,166 @@ void KateProjectIndex::loadCtags(const QStringList &files, const QVariantMap &ct
     /**
      * wait for done
      */
-    if (!ctags.waitForFinished(-1)) {
-        return;
+    return ctags.waitForFinished(-1);
+}
+
+/**
+ * file a ctags line belongs to, the second tab separated field
+ */
+static QByteArray tagFileName(const QByteArray &line)
+{
+    const int start = line.indexOf('\t') + 1;
+    const int end = start > 0 ? line.indexOf('\t', start) : -1;
+    return end < 0 ? QByteArray() : QByteArray::fromRawData(line.constData() + start, end - start);
+}
+
+bool KateProjectIndex::updateCtags(const KateProjectIndex &previous, const QStringList &files, const QVariantMap &ctagsMap, const QSet<QString> *changedDirectories)
+{
+    /**
+     * other options change all tags
+     */
+    if (!previous.m_ctagsIndexHandle || previous.m_ctagsMap != ctagsMap) {
+        return false;
     }
 
-    openCtags();
+    /**
+     * tag new files and the ones changed since the previous tags were built,
+     * drop the old tags of these and of the removed files
+     * if only some directories changed, the known files elsewhere are not checked
+     */
+    QSet<QString> previousFiles;
+    previousFiles.reserve(previous.m_files.size());
+    for (const QString &file : previous.m_files) {
+        previousFiles.insert(file);
+    }
+    QStringList tagFiles;
+    QSet<QByteArray> dropFiles;
+    const QString indexFileName = previous.m_ctagsIndexFile->fileName();
+    for (const QString &file : files) {
+        const bool known = previousFiles.remove(file);
+        if (file == indexFileName) {
+            // an index file inside the project is written after each update, it has no tags
+            continue;
+        }
+        if (known && changedDirectories && !changedDirectories->contains(file.left(file.lastIndexOf(QLatin1Char('/'))))) {
+            continue;
+        }
+        if (!known || QFileInfo(file).lastModified().toMSecsSinceEpoch() >= previous.m_ctagsTime) {
+            tagFiles.append(file);
+            if (known) {
+                dropFiles.insert(file.toLocal8Bit());
+            }
+        }
+    }
+    for (const QString &file : qAsConst(previousFiles)) {
+        dropFiles.insert(file.toLocal8Bit());
+    }
+
+    /**
+     * nothing changed, keep the previous tags file as it is, rewriting it
+     * would trigger the file watcher if it is inside the project
+     */
+    if (tagFiles.isEmpty() && dropFiles.isEmpty()) {
+        m_ctagsIndexFile = previous.m_ctagsIndexFile;
+        return true;
+    }
+
+    /**
+     * if most files changed, running ctags for all of them is cheaper
+     */
+    if (tagFiles.size() > files.size() / 2) {
+        return false;
+    }
+
+    QFile previousTags(previous.m_ctagsIndexFile->fileName());
+    if (!previousTags.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    /**
+     * the new tags, sorted like the previous ones for merging them in
+     */
+    QList<QByteArray> newTags;
+    if (!tagFiles.isEmpty()) {
+        QTemporaryFile newTagsFile(QDir::tempPath() + QStringLiteral("/kate.project.ctags"));
+        if (!newTagsFile.open()) {
+            return false;
+        }
+        newTagsFile.close();
+        if (!runCtags(tagFiles, newTagsFile.fileName(), ctagsMap) || !newTagsFile.open()) {
+            return false;
+        }
+        while (!newTagsFile.atEnd()) {
+            QByteArray line = newTagsFile.readLine();
+            if (!line.startsWith("!_")) {
+                if (!line.endsWith('\n')) {
+                    line.append('\n');
+                }
+                newTags.append(line);
+            }
+        }
+    }
+
+    /**
+     * create temporary file
+     * if not possible, fail
+     */
+    if (!m_ctagsIndexFile->open(QIODevice::ReadWrite)) {
+        return false;
+    }
+    m_ctagsIndexFile->close();
+    QSaveFile output(m_ctagsIndexFile->fileName());
+    if (!output.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+
+    mergeCtags(previousTags, newTags, dropFiles, output);
+    return output.commit();
+}
+
+void KateProjectIndex::mergeCtags(QIODevice &previousTags, QList<QByteArray> newTags, const QSet<QByteArray> &dropFiles, QIODevice &output)
+{
+    /**
+     * the previous tags are sorted by ctags, byte wise or case folded
+     */
+    bool foldCase = false;
+    auto lessThan = [&foldCase](const QByteArray &a, const QByteArray &b) {
+        return foldCase ? qstricmp(a.constData(), b.constData()) < 0 : a < b;
+    };
+    auto newTag = newTags.begin();
+    bool sorted = false;
+    while (!previousTags.atEnd()) {
+        QByteArray line = previousTags.readLine();
+        if (line.startsWith("!_")) {
+            if (line.startsWith("!_TAG_FILE_SORTED\t")) {
+                foldCase = line.startsWith("!_TAG_FILE_SORTED\t2");
+            }
+            output.write(line);
+            continue;
+        }
+        if (!sorted) {
+            std::sort(newTags.begin(), newTags.end(), lessThan);
+            newTag = newTags.begin();
+            sorted = true;
+        }
+        if (!dropFiles.isEmpty() && dropFiles.contains(tagFileName(line))) {
+            continue;
+        }
+        if (!line.endsWith('\n')) {
+            line.append('\n');
+        }
+        while (newTag != newTags.end() && lessThan(*newTag, line)) {
+            output.write(*newTag++);
+        }
+        output.write(line);
+    }
+    if (!sorted) {
+        std::sort(newTags.begin(), newTags.end(), lessThan);
+        newTag = newTags.begin();
+    }
+    while (newTag != newTags.end()) {
+        output.write(*newTag++);
+    }
 }
 
 void KateProjectIndex::openCtags()
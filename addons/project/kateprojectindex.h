@@ -24,6 +24,8 @@
 #include <ktexteditor/document.h>
 #include <ktexteditor/view.h>
 
+#include <QSet>
+#include <QSharedPointer>
 #include <QStandardItemModel>
 #include <QStringList>
 #include <QTemporaryFile>
@@ -33,6 +35,8 @@
  */
 #include "ctags/readtags.h"
 
+#include "kateprojecttrigramindex.h"
+
 /**
  * Class representing the index of a project.
  * This includes knowledge from ctags and Co.
@@ -47,8 +51,18 @@ public:
      * construct new index for given files
      * @param files files to index
      * @param ctagsMap ctags section for extra options
+     * @param previous index of the project built before, if not nullptr only the
+     *        changes against it are indexed again
+     * @param changedDirectories directories changed since \p previous was built, if not nullptr
+     *        only their files and new files are checked on disk, without trailing slash
      */
-    KateProjectIndex(const QString &baseDir, const QString &indexDir, const QStringList &files, const QVariantMap &ctagsMap, bool force);
+    KateProjectIndex(const QString &baseDir,
+                     const QString &indexDir,
+                     const QStringList &files,
+                     const QVariantMap &ctagsMap,
+                     bool force,
+                     const KateProjectIndex *previous = nullptr,
+                     const QSet<QString> *changedDirectories = nullptr);
 
     /**
      * deconstruct project
@@ -91,13 +105,52 @@ public:
         return m_ctagsIndexHandle;
     }
 
+    /**
+     * Merge tags into a tags file written by ctags.
+     * @param previousTags tags file to update, sorted by ctags
+     * @param newTags tag lines to add, ending with a newline, without pseudo tags, in any order
+     * @param dropFiles files whose tags are removed from \p previousTags
+     * @param output the merged tags, sorted like \p previousTags
+     */
+    static void mergeCtags(QIODevice &previousTags, QList<QByteArray> newTags, const QSet<QByteArray> &dropFiles, QIODevice &output);
+
+    /**
+     * Trigram index of the file contents, used to narrow down searches.
+     * @return trigram index, never null
+     */
+    KateProjectSharedTrigramIndex trigramIndex() const
+    {
+        return m_trigramIndex;
+    }
+
 private:
     /**
      * Load ctags tags.
      * @param files files to index
      * @param ctagsMap ctags section for extra options
      */
-    void loadCtags(const QStringList &files, const QVariantMap &ctagsMap, bool force);
+    void loadCtags(const QStringList &files, const QVariantMap &ctagsMap, bool force, const KateProjectIndex *previous, const QSet<QString> *changedDirectories);
+
+    /**
+     * Update the ctags tags of the previous index.
+     * Only new files and files changed since the previous index was built are
+     * passed to ctags, the result is merged with the previous tags.
+     * @param previous index to update
+     * @param files files to index
+     * @param ctagsMap ctags section for extra options
+     * @param changedDirectories if not nullptr only the known files in these are checked for changes
+     * @return false if the tags have to be built from scratch
+     */
+    bool updateCtags(const KateProjectIndex &previous, const QStringList &files, const QVariantMap &ctagsMap, const QSet<QString> *changedDirectories);
+
+    /**
+     * Run ctags.
+     * @param files files to index
+     * @param fileName file to write the tags to
+     * @param ctagsMap ctags section for extra options
+     * @return success
+     */
+    static bool runCtags(const QStringList &files, const QString &fileName, const QVariantMap &ctagsMap);
 
     /**
      * Open ctags tags.
@@ -106,14 +159,26 @@ private:
 
 private:
     /**
-     * ctags index file
+     * ctags index file, shared with the next index as long as no tags changed
      */
-    QScopedPointer<QFile> m_ctagsIndexFile;
+    QSharedPointer<QFile> m_ctagsIndexFile;
 
     /**
      * handle to ctags file for querying, if possible
      */
     tagFile *m_ctagsIndexHandle;
+
+    /**
+     * files and ctags options the tags were built for and when, in ms since the epoch
+     */
+    QStringList m_files;
+    QVariantMap m_ctagsMap;
+    qint64 m_ctagsTime;
+
+    /**
+     * trigram index of the file contents, shared with running searches
+     */
+    KateProjectSharedTrigramIndex m_trigramIndex;
 };
 
 #endif
@@ -54,6 +54,14 @@ public:
      */
     ~KateProjectItem() override;
 
+    /**
+     * item type, QStandardItem::UserType plus our Type
+     */
+    int type() const override
+    {
+        return QStandardItem::UserType + m_type;
+    }
+
     /**
      * Overwritten data method for on-demand icon creation and co.
      * @param role role to get data for
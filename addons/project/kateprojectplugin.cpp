@@ -22,6 +22,7 @@
 
 #include "kateproject.h"
 #include "kateprojectconfigpage.h"
+#include "kateprojectdebug.h"
 #include "kateprojectpluginview.h"
 
 #include <ktexteditor/application.h>
@@ -47,6 +48,8 @@
 #include <unistd.h>
 #endif
 
+Q_LOGGING_CATEGORY(KATEPROJECT, "kateproject", QtWarningMsg)
+
 namespace
 {
 const QString ProjectFileName = QStringLiteral(".kateproject");
@@ -72,6 +75,9 @@ KateProjectPlugin::KateProjectPlugin(QObject *parent, const QList<QVariant> &)
     qRegisterMetaType<KateProjectSharedQStandardItem>("KateProjectSharedQStandardItem");
     qRegisterMetaType<KateProjectSharedQMapStringItem>("KateProjectSharedQMapStringItem");
     qRegisterMetaType<KateProjectSharedProjectIndex>("KateProjectSharedProjectIndex");
+    qRegisterMetaType<KateProjectSharedFilesDiff>("KateProjectSharedFilesDiff");
+    qRegisterMetaType<KateProjectSnapshot::FilesEntries>("KateProjectSnapshot::FilesEntries");
+    qRegisterMetaType<PathStore>("PathStore");
 
     connect(KTextEditor::Editor::instance()->application(), &KTextEditor::Application::documentCreated, this, &KateProjectPlugin::slotDocumentCreated);
     connect(&m_fileWatcher, &QFileSystemWatcher::directoryChanged, this, &KateProjectPlugin::slotDirectoryChanged);
@@ -33,7 +33,6 @@
 #include <kaboutdata.h>
 #include <kactioncollection.h>
 #include <kactionmenu.h>
-#include <kpluginfactory.h>
 #include <kpluginloader.h>
 #include <kstringhandler.h>
 
@@ -43,8 +42,6 @@
 #include <QMenu>
 #include <QVBoxLayout>
 
-K_PLUGIN_FACTORY_WITH_JSON(KateProjectPluginFactory, "kateprojectplugin.json", registerPlugin<KateProjectPlugin>();)
-
 KateProjectPluginView::KateProjectPluginView(KateProjectPlugin *plugin, KTextEditor::MainWindow *mainWin)
     : QObject(mainWin)
     , m_plugin(plugin)
@@ -269,10 +266,15 @@ QVariantMap KateProjectPluginView::projectMap() const
 }
 
 QStringList KateProjectPluginView::projectFiles() const
+{
+    return projectFilesStore().toStringList();
+}
+
+PathStore KateProjectPluginView::projectFilesStore() const
 {
     KateProjectView *active = static_cast<KateProjectView *>(m_stackedProjectViews->currentWidget());
     if (!active) {
-        return QStringList();
+        return PathStore();
     }
 
     return active->project()->files();
@@ -301,14 +303,54 @@ QString KateProjectPluginView::allProjectsCommonBaseDir() const
 
 QStringList KateProjectPluginView::allProjectsFiles() const
 {
-    QStringList fileList;
+    return allProjectsFilesStore().toStringList();
+}
 
+PathStore KateProjectPluginView::allProjectsFilesStore() const
+{
+    QVector<PathStore> parts;
     const auto projectList = m_plugin->projects();
     for (auto project : projectList) {
-        fileList.append(project->files());
+        parts.append(project->files());
+    }
+
+    /**
+     * join again only if the files of a project changed
+     */
+    bool changed = parts.size() != m_allProjectsFilesParts.size();
+    for (int i = 0; !changed && i < parts.size(); ++i) {
+        changed = !parts.at(i).isSharedWith(m_allProjectsFilesParts.at(i));
+    }
+    if (changed) {
+        m_allProjectsFiles = PathStore::joined(parts);
+        m_allProjectsFilesParts = parts;
     }
 
-    return fileList;
+    return m_allProjectsFiles;
+}
+
+QObject *KateProjectPluginView::createSearchFilter(bool allProjects) const
+{
+    QList<KateProject *> projects;
+    if (allProjects) {
+        projects = m_plugin->projects();
+    } else if (KateProjectView *active = static_cast<KateProjectView *>(m_stackedProjectViews->currentWidget())) {
+        projects << active->project();
+    }
+
+    QVector<KateProjectSharedTrigramIndex> indices;
+    QSet<QString> staleDirectories;
+    for (auto project : qAsConst(projects)) {
+        if (project->projectIndex()) {
+            indices << project->projectIndex()->trigramIndex();
+            staleDirectories.unite(project->staleDirectories());
+        }
+    }
+
+    if (indices.isEmpty()) {
+        return nullptr;
+    }
+    return new KateProjectTrigramFilter(indices, staleDirectories);
 }
 
 void KateProjectPluginView::slotViewChanged()
@@ -522,5 +564,3 @@ void KateProjectPluginView::slotContextMenuAboutToShow()
     m_lookupAction->setText(i18n("Lookup: %1", squeezed));
     m_gotoSymbolAction->setText(i18n("Goto: %1", squeezed));
 }
-
-#include "kateprojectpluginview.moc"
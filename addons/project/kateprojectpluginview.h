@@ -44,9 +44,11 @@ class KateProjectPluginView : public QObject, public KXMLGUIClient
     Q_PROPERTY(QString projectBaseDir READ projectBaseDir)
     Q_PROPERTY(QVariantMap projectMap READ projectMap NOTIFY projectMapChanged)
     Q_PROPERTY(QStringList projectFiles READ projectFiles)
+    Q_PROPERTY(PathStore projectFilesStore READ projectFilesStore)
 
     Q_PROPERTY(QString allProjectsCommonBaseDir READ allProjectsCommonBaseDir)
     Q_PROPERTY(QStringList allProjectsFiles READ allProjectsFiles)
+    Q_PROPERTY(PathStore allProjectsFilesStore READ allProjectsFilesStore)
 
 public:
     KateProjectPluginView(KateProjectPlugin *plugin, KTextEditor::MainWindow *mainWindow);
@@ -80,6 +82,12 @@ public:
      */
     QStringList projectFiles() const;
 
+    /**
+     * files for the current active project, without copying them
+     * @return empty store if none, else the shared project files
+     */
+    PathStore projectFilesStore() const;
+
     /**
      * Example: Two projects are loaded with baseDir1="/home/dev/project1" and
      * baseDir2="/home/dev/project2". Then "/home/dev/" is returned.
@@ -93,6 +101,22 @@ public:
      */
     QStringList allProjectsFiles() const;
 
+    /**
+     * files for all open projects, without copying them (@see also projectFilesStore())
+     * Only joined again after the files of a project changed.
+     */
+    PathStore allProjectsFilesStore() const;
+
+    /**
+     * Candidate filter for searches in the current or all open projects, based on the
+     * trigram indices of the projects. The caller takes ownership.
+     * Used for the Search&Replace plugin to skip files that can't contain a match.
+     * @param allProjects use the indices of all open projects, not just the current one
+     * @return filter with a Q_INVOKABLE filterCandidates(QStringList files, QStringList literals),
+     *         nullptr if no project has an index
+     */
+    Q_INVOKABLE QObject *createSearchFilter(bool allProjects) const;
+
     /**
      * the main window we belong to
      * @return our main window
@@ -287,6 +311,12 @@ private:
      */
     QAction *m_gotoSymbolAction;
     QAction *m_gotoSymbolActionAppMenu;
+
+    /**
+     * files of all projects for allProjectsFilesStore() and the project files they were joined from
+     */
+    mutable PathStore m_allProjectsFiles;
+    mutable QVector<PathStore> m_allProjectsFilesParts;
 };
 
 #endif
@@ -0,0 +1,209 @@
+/*  This file is part of the Kate project.
+ *
+ *  Copyright (C) 2020 by Kate Developers <kwrite-devel@kde.org>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Library General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public License
+ *  along with this library; see the file COPYING.LIB.  If not, write to
+ *  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301, USA.
+ */
+
+#include "kateprojectsnapshot.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QtEndian>
+
+/**
+ * format of the snapshot file, bump the version if it changes
+ * all numbers are 32 bit little endian, strings are UTF-8 prefixed by their size:
+ * magic, version, key, number of files entries, then for each files entry
+ * the number of directories, the directories with trailing slash, the number
+ * of files and for each file the index of its directory and its name
+ */
+static const quint32 snapshotMagic = 0x4b50534e; // "KPSN"
+static const quint32 snapshotVersion = 1;
+
+KateProjectSnapshot::KateProjectSnapshot(const QString &baseDir)
+{
+    // one snapshot per project, name it after the base directory
+    const QByteArray baseDirHash = QCryptographicHash::hash(baseDir.toUtf8(), QCryptographicHash::Sha1).toHex().left(16);
+    m_fileName = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/projects/") + QString::fromLatin1(baseDirHash)
+        + QStringLiteral(".snapshot");
+}
+
+namespace
+{
+/**
+ * bounds checked reading of the mapped snapshot file
+ */
+class Reader
+{
+public:
+    Reader(const uchar *data, qint64 size)
+        : m_data(data)
+        , m_end(data + size)
+    {
+    }
+
+    bool readUInt32(quint32 &value)
+    {
+        if (m_end - m_data < 4) {
+            return false;
+        }
+        value = qFromLittleEndian<quint32>(m_data);
+        m_data += 4;
+        return true;
+    }
+
+    bool readBytes(const char *&bytes, int &size)
+    {
+        quint32 length = 0;
+        if (!readUInt32(length) || quint64(m_end - m_data) < length) {
+            return false;
+        }
+        bytes = reinterpret_cast<const char *>(m_data);
+        size = int(length);
+        m_data += length;
+        return true;
+    }
+
+private:
+    const uchar *m_data;
+    const uchar *const m_end;
+};
+}
+
+bool KateProjectSnapshot::read(const QByteArray &key, FilesEntries &entries) const
+{
+    QFile file(m_fileName);
+    if (!file.open(QIODevice::ReadOnly) || file.size() == 0) {
+        return false;
+    }
+    const uchar *data = file.map(0, file.size());
+    if (!data) {
+        return false;
+    }
+
+    Reader reader(data, file.size());
+    quint32 magic = 0;
+    quint32 version = 0;
+    const char *bytes = nullptr;
+    int size = 0;
+    if (!reader.readUInt32(magic) || !reader.readUInt32(version) || magic != snapshotMagic || version != snapshotVersion) {
+        return false;
+    }
+    if (!reader.readBytes(bytes, size) || QByteArray::fromRawData(bytes, size) != key) {
+        return false;
+    }
+
+    quint32 entryCount = 0;
+    if (!reader.readUInt32(entryCount)) {
+        return false;
+    }
+
+    FilesEntries result;
+    result.reserve(int(qMin(entryCount, quint32(1024))));
+    QVector<QString> dirs;
+    for (quint32 i = 0; i < entryCount; ++i) {
+        quint32 dirCount = 0;
+        if (!reader.readUInt32(dirCount)) {
+            return false;
+        }
+        dirs.clear();
+        dirs.reserve(int(qMin(dirCount, quint32(1 << 20))));
+        for (quint32 d = 0; d < dirCount; ++d) {
+            if (!reader.readBytes(bytes, size)) {
+                return false;
+            }
+            dirs.append(QString::fromUtf8(bytes, size));
+        }
+
+        quint32 fileCount = 0;
+        if (!reader.readUInt32(fileCount)) {
+            return false;
+        }
+        QStringList files;
+        files.reserve(int(qMin(fileCount, quint32(1 << 22))));
+        for (quint32 f = 0; f < fileCount; ++f) {
+            quint32 dirIndex = 0;
+            if (!reader.readUInt32(dirIndex) || dirIndex >= quint32(dirs.size()) || !reader.readBytes(bytes, size)) {
+                return false;
+            }
+            files.append(dirs.at(int(dirIndex)) + QString::fromUtf8(bytes, size));
+        }
+        result.append(files);
+    }
+
+    entries = result;
+    return true;
+}
+
+static void appendUInt32(QByteArray &data, quint32 value)
+{
+    const quint32 le = qToLittleEndian(value);
+    data.append(reinterpret_cast<const char *>(&le), 4);
+}
+
+static void appendBytes(QByteArray &data, const QByteArray &bytes)
+{
+    appendUInt32(data, quint32(bytes.size()));
+    data.append(bytes);
+}
+
+void KateProjectSnapshot::write(const QByteArray &key, const FilesEntries &entries) const
+{
+    QByteArray data;
+    appendUInt32(data, snapshotMagic);
+    appendUInt32(data, snapshotVersion);
+    appendBytes(data, key);
+    appendUInt32(data, quint32(entries.size()));
+
+    QHash<QString, quint32> dirIndexes;
+    QByteArray files;
+    for (const QStringList &entry : entries) {
+        // the directories are numbered per files entry
+        dirIndexes.clear();
+        QByteArray dirs;
+        files.clear();
+        for (const QString &file : entry) {
+            const int slash = file.lastIndexOf(QLatin1Char('/')) + 1;
+            const QString dir = file.left(slash);
+            auto it = dirIndexes.constFind(dir);
+            if (it == dirIndexes.constEnd()) {
+                it = dirIndexes.insert(dir, quint32(dirIndexes.size()));
+                appendBytes(dirs, dir.toUtf8());
+            }
+            appendUInt32(files, it.value());
+            appendBytes(files, file.midRef(slash).toUtf8());
+        }
+
+        appendUInt32(data, quint32(dirIndexes.size()));
+        data.append(dirs);
+        appendUInt32(data, quint32(entry.size()));
+        data.append(files);
+    }
+
+    QDir().mkpath(QFileInfo(m_fileName).absolutePath());
+    QSaveFile file(m_fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return;
+    }
+    file.write(data);
+    file.commit();
+}
@@ -0,0 +1,72 @@
+/*  This file is part of the Kate project.
+ *
+ *  Copyright (C) 2020 by Kate Developers <kwrite-devel@kde.org>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Library General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public License
+ *  along with this library; see the file COPYING.LIB.  If not, write to
+ *  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KATE_PROJECT_SNAPSHOT_H
+#define KATE_PROJECT_SNAPSHOT_H
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+/**
+ * Snapshot of the files of a project, stored in the cache directory.
+ *
+ * The worker stores the files it found for every files entry of the project,
+ * the next time the project is opened the tree is built from the snapshot at
+ * once and the files are only searched again in the background.
+ * Each file is stored as index into a table of its directories plus its name.
+ * The snapshot is only used if its key matches, the key covers the project
+ * map and the state of the git indexes of the project.
+ */
+class KateProjectSnapshot
+{
+public:
+    /**
+     * files of each files entry of the project, in the order the worker loads them
+     */
+    typedef QVector<QStringList> FilesEntries;
+
+    /**
+     * snapshot for the project in the given base directory
+     * @param baseDir project base directory, used to name the snapshot file
+     */
+    explicit KateProjectSnapshot(const QString &baseDir);
+
+    /**
+     * Read the snapshot.
+     * @param key key the snapshot has to be stored with
+     * @param entries the files of the files entries are stored here
+     * @return false if there is no snapshot for \p key
+     */
+    bool read(const QByteArray &key, FilesEntries &entries) const;
+
+    /**
+     * Store the snapshot, replacing the one stored before.
+     * @param key key to store the snapshot with
+     * @param entries the absolute paths of the files of the files entries
+     */
+    void write(const QByteArray &key, const FilesEntries &entries) const;
+
+private:
+    QString m_fileName;
+};
+
+#endif
@@ -0,0 +1,383 @@
+/*  This file is part of the Kate project.
+ *
+ *  Copyright (C) 2020 by Kate Developers <kwrite-devel@kde.org>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Library General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public License
+ *  along with this library; see the file COPYING.LIB.  If not, write to
+ *  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301, USA.
+ */
+
+#include "kateprojecttrigramindex.h"
+
+#include <QBitArray>
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+
+#include <algorithm>
+
+/**
+ * format of the index file, bump the version if it changes
+ */
+static const quint32 indexFileMagic = 0x4b545249; // "KTRI"
+static const quint32 indexFileVersion = 1;
+
+/**
+ * larger files are not indexed, they are always searched
+ */
+static const qint64 maxIndexedFileSize = 64 * 1024 * 1024;
+
+/**
+ * trigrams are built from 7 bit ASCII, so they fit into 21 bits
+ */
+static const quint32 trigramCount = 1 << 21;
+
+/**
+ * Add the next byte to the running trigram.
+ * @return false if the byte is not ASCII, the trigram has to start over
+ */
+static inline bool shiftTrigram(quint32 &trigram, uchar c)
+{
+    if (c >= 128) {
+        return false;
+    }
+    if (c >= 'A' && c <= 'Z') {
+        c += 'a' - 'A';
+    }
+    trigram = ((trigram << 7) | c) & (trigramCount - 1);
+    return true;
+}
+
+static void appendVarint(QByteArray &data, quint32 value)
+{
+    while (value >= 0x80) {
+        data.append(char((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    data.append(char(value));
+}
+
+static quint32 readVarint(const char *&pos)
+{
+    quint32 value = 0;
+    int shift = 0;
+    uchar c;
+    do {
+        c = uchar(*pos++);
+        value |= quint32(c & 0x7f) << shift;
+        shift += 7;
+    } while (c & 0x80);
+    return value;
+}
+
+/**
+ * Decode a delta encoded list of sorted numbers.
+ * @param value the number the first delta is relative to
+ */
+template<typename T> static QVector<T> decodeDeltas(const QByteArray &data, T value)
+{
+    QVector<T> values;
+    const char *pos = data.constData();
+    const char *end = pos + data.size();
+    while (pos < end) {
+        value += T(readVarint(pos));
+        values.append(value);
+    }
+    return values;
+}
+
+/**
+ * Byte order marks of encodings that are not ASCII compatible.
+ */
+static bool hasWideBom(const uchar *data, qint64 size)
+{
+    if (size >= 2 && ((data[0] == 0xff && data[1] == 0xfe) || (data[0] == 0xfe && data[1] == 0xff))) {
+        return true;
+    }
+    return size >= 4 && data[0] == 0 && data[1] == 0 && data[2] == 0xfe && data[3] == 0xff;
+}
+
+KateProjectTrigramIndex::KateProjectTrigramIndex(const QString &baseDir, const QString &indexDir, const QStringList &files, bool force, const QSet<QString> *changedDirectories)
+{
+    // one index per project, name it after the base directory
+    const QByteArray baseDirHash = QCryptographicHash::hash(baseDir.toUtf8(), QCryptographicHash::Sha1).toHex().left(16);
+    m_indexFileName = indexDir + QStringLiteral("/kate.project.") + QString::fromLatin1(baseDirHash) + QStringLiteral(".trigrams");
+
+    /**
+     * reuse what is stored for files that didn't change
+     */
+    QHash<QString, FileEntry> storedEntries;
+    if (!force) {
+        readIndexFile(baseDir, storedEntries);
+    }
+    bool changed = storedEntries.size() != files.size();
+
+    QVector<quint32> seenTrigrams(trigramCount / 32, 0);
+    m_files.reserve(files.size());
+    m_entries.reserve(files.size());
+    for (const QString &file : files) {
+        /**
+         * only the directories that changed are checked on disk, the files elsewhere are taken
+         * as stored, filterCandidates() still notices if they were written in place
+         */
+        auto stored = storedEntries.constFind(file);
+        if (stored != storedEntries.constEnd() && changedDirectories && !changedDirectories->contains(file.left(file.lastIndexOf(QLatin1Char('/'))))) {
+            m_entries.append(stored.value());
+            m_fileIds.insert(file, m_files.size());
+            m_files.append(file);
+            continue;
+        }
+
+        const QFileInfo info(file);
+        const qint64 mtime = info.lastModified().toMSecsSinceEpoch();
+        const qint64 size = info.size();
+
+        if (stored != storedEntries.constEnd() && stored->mtime == mtime && stored->size == size) {
+            m_entries.append(stored.value());
+        } else {
+            m_entries.append(indexFile(file, mtime, size, seenTrigrams));
+            changed = true;
+        }
+        m_fileIds.insert(file, m_files.size());
+        m_files.append(file);
+    }
+
+    if (changed) {
+        writeIndexFile(baseDir);
+    }
+
+    /**
+     * invert the per file trigram lists, the file ids are added in increasing order
+     */
+    for (int fileId = 0; fileId < m_entries.size(); ++fileId) {
+        FileEntry &entry = m_entries[fileId];
+        const QVector<quint32> trigrams = decodeDeltas<quint32>(entry.trigrams, 0);
+        for (quint32 trigram : trigrams) {
+            PostingList &postings = m_postings[trigram];
+            appendVarint(postings.fileIds, quint32(fileId - postings.lastFileId));
+            postings.lastFileId = fileId;
+        }
+        // only needed to write the index file
+        entry.trigrams = QByteArray();
+    }
+}
+
+KateProjectTrigramIndex::FileEntry KateProjectTrigramIndex::indexFile(const QString &fileName, qint64 mtime, qint64 size, QVector<quint32> &seenTrigrams)
+{
+    FileEntry entry;
+    entry.mtime = mtime;
+    entry.size = size;
+    if (size > maxIndexedFileSize) {
+        return entry;
+    }
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return entry;
+    }
+
+    // empty files can't be mapped, but are indexed just fine
+    QByteArray content;
+    const uchar *data = size > 0 ? file.map(0, size) : nullptr;
+    if (!data && size > 0) {
+        content = file.readAll();
+        data = reinterpret_cast<const uchar *>(content.constData());
+        size = content.size();
+    }
+    if (hasWideBom(data, size)) {
+        return entry;
+    }
+
+    QVector<quint32> trigrams;
+    quint32 trigram = 0;
+    int validBytes = 0;
+    for (qint64 i = 0; i < size; ++i) {
+        if (!shiftTrigram(trigram, data[i])) {
+            validBytes = 0;
+            continue;
+        }
+        if (++validBytes < 3) {
+            continue;
+        }
+        quint32 &seen = seenTrigrams[trigram >> 5];
+        const quint32 bit = 1u << (trigram & 31);
+        if (!(seen & bit)) {
+            seen |= bit;
+            trigrams.append(trigram);
+        }
+    }
+
+    std::sort(trigrams.begin(), trigrams.end());
+    quint32 previous = 0;
+    for (quint32 t : qAsConst(trigrams)) {
+        appendVarint(entry.trigrams, t - previous);
+        previous = t;
+        // leave the scratch bitmap clean for the next file
+        seenTrigrams[t >> 5] = 0;
+    }
+    entry.indexed = true;
+    return entry;
+}
+
+void KateProjectTrigramIndex::readIndexFile(const QString &baseDir, QHash<QString, FileEntry> &entries) const
+{
+    QFile file(m_indexFileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+    quint32 magic = 0;
+    quint32 version = 0;
+    QString storedBaseDir;
+    quint32 count = 0;
+    stream >> magic >> version;
+    if (magic != indexFileMagic || version != indexFileVersion) {
+        return;
+    }
+    stream >> storedBaseDir >> count;
+    if (storedBaseDir != baseDir) {
+        return;
+    }
+
+    entries.reserve(int(qMin(count, quint32(1 << 20))));
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        QString fileName;
+        FileEntry entry;
+        stream >> fileName >> entry.mtime >> entry.size >> entry.indexed >> entry.trigrams;
+        entries.insert(fileName, entry);
+    }
+
+    // a truncated file is no better than none
+    if (stream.status() != QDataStream::Ok) {
+        entries.clear();
+    }
+}
+
+void KateProjectTrigramIndex::writeIndexFile(const QString &baseDir) const
+{
+    QSaveFile file(m_indexFileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream << indexFileMagic << indexFileVersion << baseDir << quint32(m_files.size());
+    for (int i = 0; i < m_files.size(); ++i) {
+        const FileEntry &entry = m_entries.at(i);
+        stream << m_files.at(i) << entry.mtime << entry.size << entry.indexed << entry.trigrams;
+    }
+    file.commit();
+}
+
+QVector<int> KateProjectTrigramIndex::filesContaining(const QVector<quint32> &trigrams) const
+{
+    /**
+     * intersect the posting lists, starting with the shortest one
+     */
+    QVector<const PostingList *> lists;
+    lists.reserve(trigrams.size());
+    for (quint32 trigram : trigrams) {
+        auto it = m_postings.constFind(trigram);
+        if (it == m_postings.constEnd()) {
+            return QVector<int>();
+        }
+        lists.append(&it.value());
+    }
+    std::sort(lists.begin(), lists.end(), [](const PostingList *left, const PostingList *right) {
+        return left->fileIds.size() < right->fileIds.size();
+    });
+
+    QVector<int> fileIds = decodeDeltas<int>(lists.first()->fileIds, -1);
+    for (int i = 1; i < lists.size() && !fileIds.isEmpty(); ++i) {
+        const QVector<int> other = decodeDeltas<int>(lists.at(i)->fileIds, -1);
+        auto end = std::set_intersection(fileIds.begin(), fileIds.end(), other.constBegin(), other.constEnd(), fileIds.begin());
+        fileIds.resize(int(end - fileIds.begin()));
+    }
+    return fileIds;
+}
+
+QStringList KateProjectTrigramIndex::filterCandidates(const QStringList &files, const QStringList &literals, const QSet<QString> &staleDirectories) const
+{
+    /**
+     * collect the trigrams of all literals, each literal is required
+     */
+    QVector<quint32> trigrams;
+    for (const QString &literal : literals) {
+        const QByteArray bytes = literal.toLatin1();
+        quint32 trigram = 0;
+        int validBytes = 0;
+        for (char c : bytes) {
+            if (!shiftTrigram(trigram, uchar(c))) {
+                validBytes = 0;
+            } else if (++validBytes >= 3 && !trigrams.contains(trigram)) {
+                trigrams.append(trigram);
+            }
+        }
+    }
+
+    // nothing to narrow the search with, all files need to be searched
+    if (trigrams.isEmpty()) {
+        return files;
+    }
+
+    QBitArray candidates(m_files.size());
+    const QVector<int> fileIds = filesContaining(trigrams);
+    for (int fileId : fileIds) {
+        candidates.setBit(fileId);
+    }
+
+    QStringList result;
+    for (const QString &file : files) {
+        const int fileId = m_fileIds.value(file, -1);
+        if (fileId == -1 || candidates.testBit(fileId)) {
+            result.append(file);
+            continue;
+        }
+        if (!m_entries.at(fileId).indexed || (!staleDirectories.isEmpty() && staleDirectories.contains(file.left(file.lastIndexOf(QLatin1Char('/')))))) {
+            result.append(file);
+            continue;
+        }
+
+        // the watcher doesn't see files written in place, check the dropped ones
+        const FileEntry &entry = m_entries.at(fileId);
+        const QFileInfo info(file);
+        if (info.lastModified().toMSecsSinceEpoch() != entry.mtime || info.size() != entry.size) {
+            result.append(file);
+        }
+    }
+    return result;
+}
+
+KateProjectTrigramFilter::KateProjectTrigramFilter(const QVector<KateProjectSharedTrigramIndex> &indices, const QSet<QString> &staleDirectories, QObject *parent)
+    : QObject(parent)
+    , m_indices(indices)
+    , m_staleDirectories(staleDirectories)
+{
+}
+
+QStringList KateProjectTrigramFilter::filterCandidates(const QStringList &files, const QStringList &literals) const
+{
+    // every index only removes the files it knows about
+    QStringList result = files;
+    for (const KateProjectSharedTrigramIndex &index : m_indices) {
+        result = index->filterCandidates(result, literals, m_staleDirectories);
+    }
+    return result;
+}
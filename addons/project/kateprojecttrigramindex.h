@@ -0,0 +1,146 @@
+/*  This file is part of the Kate project.
+ *
+ *  Copyright (C) 2020 by Kate Developers <kwrite-devel@kde.org>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Library General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public License
+ *  along with this library; see the file COPYING.LIB.  If not, write to
+ *  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KATE_PROJECT_TRIGRAM_INDEX_H
+#define KATE_PROJECT_TRIGRAM_INDEX_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QObject>
+#include <QSet>
+#include <QSharedPointer>
+#include <QStringList>
+#include <QVector>
+
+/**
+ * Trigram index of the content of the project files.
+ *
+ * For every file the set of case folded ASCII trigrams it contains is
+ * recorded, inverted into one posting list per trigram. A search for text
+ * that has to contain some literal strings then only needs to look at the
+ * files containing all trigrams of these strings.
+ *
+ * The index is stored in the index directory and updated incrementally:
+ * files with unchanged modification time and size are not read again.
+ * Is created in Worker thread in the background together with the
+ * KateProjectIndex and never changed afterwards, so it can be queried
+ * from any thread.
+ */
+class KateProjectTrigramIndex
+{
+public:
+    /**
+     * construct new index for given files
+     * @param baseDir project base directory, used to name the index file
+     * @param indexDir directory the index file is stored in
+     * @param files files to index
+     * @param force ignore the stored index and read all files again
+     * @param changedDirectories if not nullptr only the files of these directories and the
+     *        ones not stored are checked on disk, without trailing slash
+     */
+    KateProjectTrigramIndex(const QString &baseDir, const QString &indexDir, const QStringList &files, bool force, const QSet<QString> *changedDirectories = nullptr);
+
+    /**
+     * Remove the files that can't contain all of the given strings.
+     * Files not known to the index, not indexed (too large, UTF-16, ...) or
+     * in a directory that changed since the index was built are always kept.
+     * Only the files the index would remove are checked on disk, the ones
+     * modified since they were indexed are kept as well.
+     * @param files files to filter
+     * @param literals strings every match has to contain
+     * @param staleDirectories directories with changes not in the index yet, without trailing slash
+     * @return files that might contain all literals, in the order of files
+     */
+    QStringList filterCandidates(const QStringList &files, const QStringList &literals, const QSet<QString> &staleDirectories = QSet<QString>()) const;
+
+private:
+    struct FileEntry {
+        qint64 mtime = -1;
+        qint64 size = -1;
+        /** false for files whose content is not part of the index */
+        bool indexed = false;
+        /** sorted trigrams of the file, delta encoded */
+        QByteArray trigrams;
+    };
+
+    struct PostingList {
+        /** ids of the files containing the trigram, delta encoded */
+        QByteArray fileIds;
+        int lastFileId = -1;
+    };
+
+    void readIndexFile(const QString &baseDir, QHash<QString, FileEntry> &entries) const;
+    void writeIndexFile(const QString &baseDir) const;
+    static FileEntry indexFile(const QString &fileName, qint64 mtime, qint64 size, QVector<quint32> &seenTrigrams);
+    QVector<int> filesContaining(const QVector<quint32> &trigrams) const;
+
+private:
+    /**
+     * index file, next to the ctags index
+     */
+    QString m_indexFileName;
+
+    /**
+     * indexed files, the position is the file id used in the posting lists
+     */
+    QStringList m_files;
+    QVector<FileEntry> m_entries;
+    QHash<QString, int> m_fileIds;
+
+    /**
+     * trigram -> files containing it
+     */
+    QHash<quint32, PostingList> m_postings;
+};
+
+/**
+ * Shared pointer, the index is shared between the project and the searches using it.
+ */
+typedef QSharedPointer<KateProjectTrigramIndex> KateProjectSharedTrigramIndex;
+
+/**
+ * Candidate filter handed out to the search plugin.
+ * Holds the trigram indices of one or more projects, filterCandidates() can be
+ * called from any thread.
+ */
+class KateProjectTrigramFilter : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @param indices trigram indices to filter with
+     * @param staleDirectories directories with changes not in the indices yet, their files are always kept
+     * @param parent parent object
+     */
+    KateProjectTrigramFilter(const QVector<KateProjectSharedTrigramIndex> &indices, const QSet<QString> &staleDirectories, QObject *parent = nullptr);
+
+    /**
+     * Remove the files that can't contain all of the given strings.
+     * @see KateProjectTrigramIndex::filterCandidates
+     */
+    Q_INVOKABLE QStringList filterCandidates(const QStringList &files, const QStringList &literals) const;
+
+private:
+    const QVector<KateProjectSharedTrigramIndex> m_indices;
+    const QSet<QString> m_staleDirectories;
+};
+
+#endif
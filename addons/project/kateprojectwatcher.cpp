@@ -0,0 +1,160 @@
+/*  This file is part of the Kate project.
+ *
+ *  Copyright (C) 2020 by Kate Developers <kwrite-devel@kde.org>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Library General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public License
+ *  along with this library; see the file COPYING.LIB.  If not, write to
+ *  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301, USA.
+ */
+
+#include "kateprojectwatcher.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+
+/**
+ * time without changes before they are reported and the maximal delay of
+ * the report during a burst of changes, in milliseconds
+ */
+static const int quietPeriod = 500;
+static const int maxDelay = 3000;
+
+KateProjectWatcher::KateProjectWatcher(QObject *parent)
+    : QObject(parent)
+    , m_fallback(false)
+{
+    m_quietTimer.setSingleShot(true);
+    connect(&m_quietTimer, &QTimer::timeout, this, &KateProjectWatcher::emitChanged);
+    connect(&m_watcher, &QFileSystemWatcher::directoryChanged, this, &KateProjectWatcher::pathChanged);
+    connect(&m_watcher, &QFileSystemWatcher::fileChanged, this, &KateProjectWatcher::pathChanged);
+}
+
+int KateProjectWatcher::maxDirectories()
+{
+    /**
+     * the watches are shared by all applications of the user, take only a part of them
+     */
+    static const int limit = []() {
+        int systemLimit = 8192;
+#ifdef Q_OS_LINUX
+        QFile maxWatches(QStringLiteral("/proc/sys/fs/inotify/max_user_watches"));
+        if (maxWatches.open(QIODevice::ReadOnly)) {
+            bool ok = false;
+            const int value = maxWatches.readAll().trimmed().toInt(&ok);
+            if (ok && value > 0) {
+                systemLimit = value;
+            }
+        }
+#endif
+        return systemLimit / 4;
+    }();
+    return limit;
+}
+
+void KateProjectWatcher::setPaths(const QStringList &directories, const QStringList &fallbackPaths, const QStringList &ignoredFiles)
+{
+    const QStringList watched = m_watcher.directories() + m_watcher.files();
+    if (!watched.isEmpty()) {
+        m_watcher.removePaths(watched);
+    }
+
+    /**
+     * watch all directories, if that fails only the fallback paths
+     */
+    m_fallback = directories.size() > maxDirectories();
+    if (!m_fallback && !directories.isEmpty()) {
+        m_fallback = !m_watcher.addPaths(directories).isEmpty();
+        if (m_fallback && !m_watcher.directories().isEmpty()) {
+            m_watcher.removePaths(m_watcher.directories());
+        }
+    }
+    if (m_fallback && !fallbackPaths.isEmpty()) {
+        m_watcher.addPaths(fallbackPaths);
+    }
+
+    /**
+     * remember how the watched directories with ignored files look like
+     */
+    m_ignoredNames.clear();
+    m_snapshots.clear();
+    for (const QString &file : ignoredFiles) {
+        const int slash = file.lastIndexOf(QLatin1Char('/'));
+        m_ignoredNames[file.left(slash)].append(file.mid(slash + 1));
+    }
+    const QStringList watchedDirectories = m_watcher.directories();
+    for (const QString &directory : watchedDirectories) {
+        if (m_ignoredNames.contains(directory)) {
+            m_snapshots.insert(directory, snapshot(directory));
+        }
+    }
+}
+
+KateProjectWatcher::DirectorySnapshot KateProjectWatcher::snapshot(const QString &directory) const
+{
+    const QStringList ignoredNames = m_ignoredNames.value(directory);
+    auto isIgnored = [&ignoredNames](const QString &name) {
+        for (const QString &ignoredName : ignoredNames) {
+            if (name.startsWith(ignoredName) && (name.size() == ignoredName.size() || name.at(ignoredName.size()) == QLatin1Char('.'))) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    DirectorySnapshot entries;
+    const QFileInfoList infos = QDir(directory).entryInfoList(QDir::AllEntries | QDir::NoDotAndDotDot | QDir::Hidden | QDir::System);
+    for (const QFileInfo &info : infos) {
+        if (!isIgnored(info.fileName())) {
+            entries.insert(info.fileName(), info.lastModified().toMSecsSinceEpoch());
+        }
+    }
+    return entries;
+}
+
+void KateProjectWatcher::pathChanged(const QString &path)
+{
+    /**
+     * only ignored files changed, e.g. the project wrote its index
+     */
+    const auto it = m_snapshots.find(path);
+    if (it != m_snapshots.end()) {
+        DirectorySnapshot entries = snapshot(path);
+        if (entries == it.value()) {
+            return;
+        }
+        it.value() = std::move(entries);
+    }
+
+    if (m_changedPaths.isEmpty()) {
+        m_burstTimer.start();
+    }
+    m_changedPaths.insert(path);
+
+    /**
+     * wait for the burst to end, but don't delay the report forever
+     */
+    if (!m_quietTimer.isActive() || m_burstTimer.elapsed() < maxDelay) {
+        m_quietTimer.start(qMax(0, qMin(quietPeriod, int(maxDelay - m_burstTimer.elapsed()))));
+    }
+}
+
+void KateProjectWatcher::emitChanged()
+{
+    QStringList paths = m_changedPaths.values();
+    m_changedPaths.clear();
+    paths.sort();
+    emit changed(paths);
+}
@@ -0,0 +1,115 @@
+/*  This file is part of the Kate project.
+ *
+ *  Copyright (C) 2020 by Kate Developers <kwrite-devel@kde.org>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Library General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public License
+ *  along with this library; see the file COPYING.LIB.  If not, write to
+ *  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KATE_PROJECT_WATCHER_H
+#define KATE_PROJECT_WATCHER_H
+
+#include <QElapsedTimer>
+#include <QFileSystemWatcher>
+#include <QHash>
+#include <QSet>
+#include <QStringList>
+#include <QTimer>
+
+/**
+ * Watcher for the directories of the files of a project.
+ *
+ * Bursts of changes, e.g. from a git checkout, are collected and reported
+ * at once after things calmed down a bit.
+ * If the project has too many directories or the system can't watch all of
+ * them, only the fallback paths are watched, e.g. the directories of the
+ * files entries and the git directories that change on checkouts.
+ * Changes of ignored files, e.g. the index files the project writes itself,
+ * are not reported.
+ */
+class KateProjectWatcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit KateProjectWatcher(QObject *parent = nullptr);
+
+    /**
+     * Watch the given paths instead of the ones watched before.
+     * @param directories directories to watch, all directories containing project files
+     * @param fallbackPaths paths to watch if not all directories can be watched
+     * @param ignoredFiles files whose changes are not reported, together with the
+     *        files named like them plus a suffix, e.g. their temporary files
+     */
+    void setPaths(const QStringList &directories, const QStringList &fallbackPaths, const QStringList &ignoredFiles = QStringList());
+
+    /**
+     * Are only the fallback paths watched?
+     * @return true if the directories couldn't be watched
+     */
+    bool isFallback() const
+    {
+        return m_fallback;
+    }
+
+    /**
+     * Maximal number of directories watched for one project.
+     * @return limit derived from the system limit for watches
+     */
+    static int maxDirectories();
+
+Q_SIGNALS:
+    /**
+     * Emitted once a burst of changes is over.
+     * @param paths the watched paths that changed
+     */
+    void changed(const QStringList &paths);
+
+private Q_SLOTS:
+    void pathChanged(const QString &path);
+    void emitChanged();
+
+private:
+    /**
+     * entries of a directory containing ignored files, by name with their modification time
+     */
+    typedef QHash<QString, qint64> DirectorySnapshot;
+    DirectorySnapshot snapshot(const QString &directory) const;
+
+private:
+    QFileSystemWatcher m_watcher;
+
+    /**
+     * ignored file names by directory and the last snapshot of these directories,
+     * a change of them is only reported if the snapshot changed
+     */
+    QHash<QString, QStringList> m_ignoredNames;
+    QHash<QString, DirectorySnapshot> m_snapshots;
+
+    /**
+     * restarted on each change, emits changed() once it runs out
+     */
+    QTimer m_quietTimer;
+
+    /**
+     * time since the first change not emitted yet, long bursts are split
+     */
+    QElapsedTimer m_burstTimer;
+
+    QSet<QString> m_changedPaths;
+    bool m_fallback;
+};
+
+#endif
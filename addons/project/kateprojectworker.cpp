@@ -20,11 +20,16 @@
 
 #include "kateprojectworker.h"
 #include "kateproject.h"
+#include "kateprojectdebug.h"
+#include "kateprojectgitindex.h"
 
+#include <QCryptographicHash>
 #include <QDir>
 #include <QDirIterator>
+#include <QElapsedTimer>
 #include <QFile>
 #include <QFileInfo>
+#include <QJsonDocument>
 #include <QProcess>
 #include <QRegularExpression>
 #include <QSet>
@@ -38,11 +43,132 @@ KateProjectWorker::KateProjectWorker(const QString &baseDir, const QString &inde
     , m_indexDir(indexDir)
     , m_projectMap(projectMap)
     , m_force(force)
+    , m_hasShownEntries(false)
+    , m_hasChangedDirectories(false)
 {
     Q_ASSERT(!m_baseDir.isEmpty());
 }
 
+void KateProjectWorker::setShownFiles(const KateProjectSnapshot::FilesEntries &entries)
+{
+    m_shownEntries = entries;
+    m_hasShownEntries = true;
+}
+
+void KateProjectWorker::setChangedDirectories(const QSet<QString> &directories)
+{
+    m_changedDirectories = directories;
+    m_hasChangedDirectories = true;
+}
+
+void KateProjectWorker::setPreviousIndex(const KateProjectSharedProjectIndex &index)
+{
+    m_previousIndex = index;
+}
+
 void KateProjectWorker::run(ThreadWeaver::JobPointer, ThreadWeaver::Thread *)
+{
+    for (const QString &directory : qAsConst(m_changedDirectories)) {
+        if (!QFileInfo(directory).isDir()) {
+            m_removedDirectories.insert(directory);
+        }
+    }
+
+    /**
+     * nothing shown yet: show the files of the last time at once,
+     * if the project and its git state are the same
+     */
+    KateProjectSnapshot snapshot(m_baseDir);
+    const QByteArray key = snapshotKey();
+    KateProjectSnapshot::FilesEntries shownEntries = m_shownEntries;
+    bool shown = m_hasShownEntries;
+    if (!shown && !m_force && snapshot.read(key, shownEntries)) {
+        emitLoadDone(shownEntries);
+        shown = true;
+    }
+
+    /**
+     * search the files again, if the project shows files already
+     * it only gets the changes, the model is only built if nothing is shown
+     */
+    KateProjectSnapshot::FilesEntries entries;
+    collectFiles(m_projectMap, entries);
+    if (!shown) {
+        emitLoadDone(entries);
+    } else if (entries != shownEntries) {
+        if (const KateProjectSharedFilesDiff diff = diffFiles(shownEntries, entries)) {
+            diff->projectMap = m_projectMap;
+            emit filesChanged(diff);
+        } else {
+            emitLoadDone(entries);
+        }
+    }
+
+    /**
+     * store what was found if it differs from what is shown, no matter whether that came
+     * from the snapshot, else the next start would show the same outdated files again
+     */
+    if (!shown || entries != shownEntries) {
+        snapshot.write(key, entries);
+    }
+
+    /**
+     * all files of the project, sorted like the keys of the file => item mapping
+     */
+    QStringList files;
+    for (const QStringList &entry : qAsConst(entries)) {
+        files.append(entry);
+    }
+    files.sort();
+    files.removeDuplicates();
+
+    // trigger index loading, will internally handle enable/disabled
+    loadIndex(files, m_force);
+}
+
+KateProjectSharedFilesDiff KateProjectWorker::diffFiles(const KateProjectSnapshot::FilesEntries &base, const KateProjectSnapshot::FilesEntries &entries)
+{
+    if (base.size() != entries.size()) {
+        return KateProjectSharedFilesDiff();
+    }
+
+    KateProjectSharedFilesDiff diff(new KateProjectFilesDiff());
+    diff->base = base;
+    diff->entries = entries;
+    diff->added.resize(entries.size());
+    diff->removed.resize(entries.size());
+    for (int i = 0; i < entries.size(); ++i) {
+        const QStringList &before = base.at(i);
+        const QStringList &after = entries.at(i);
+        if (before == after) {
+            continue;
+        }
+
+        QSet<QString> beforeSet;
+        beforeSet.reserve(before.size());
+        for (const QString &file : before) {
+            beforeSet.insert(file);
+        }
+        QSet<QString> afterSet;
+        afterSet.reserve(after.size());
+        for (const QString &file : after) {
+            afterSet.insert(file);
+        }
+        for (const QString &file : after) {
+            if (!beforeSet.contains(file)) {
+                diff->added[i].append(file);
+            }
+        }
+        for (const QString &file : before) {
+            if (!afterSet.contains(file)) {
+                diff->removed[i].append(file);
+            }
+        }
+    }
+    return diff;
+}
+
+void KateProjectWorker::emitLoadDone(const KateProjectSnapshot::FilesEntries &entries)
 {
     /**
      * Create dummy top level parent item and empty map inside shared pointers
@@ -50,20 +176,75 @@ void KateProjectWorker::run(ThreadWeaver::JobPointer, ThreadWeaver::Thread *)
      */
     KateProjectSharedQStandardItem topLevel(new QStandardItem());
     KateProjectSharedQMapStringItem file2Item(new QMap<QString, KateProjectItem *>());
-    loadProject(topLevel.data(), m_projectMap, file2Item.data());
+    int entryIndex = 0;
+    loadProject(topLevel.data(), m_projectMap, file2Item.data(), entries, entryIndex);
 
+    emit loadDone(topLevel, file2Item, entries);
+}
+
+QByteArray KateProjectWorker::snapshotKey() const
+{
     /**
-     * create some local backup of some data we need for further processing!
+     * the project map decides which files are searched, the git indexes what git lists
      */
-    QStringList files = file2Item->keys();
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(m_baseDir.toUtf8());
+    hash.addData(QJsonDocument::fromVariant(m_projectMap).toJson(QJsonDocument::Compact));
+
+    QStringList gitDirs;
+    collectGitDirs(m_projectMap, gitDirs);
+    for (const QString &gitDir : qAsConst(gitDirs)) {
+        const QFileInfo index(KateProjectGitIndex::indexFileName(gitDir));
+        hash.addData(index.filePath().toUtf8());
+        hash.addData(QByteArray::number(index.lastModified().toMSecsSinceEpoch()));
+        hash.addData(QByteArray::number(index.size()));
+    }
+    return hash.result();
+}
 
-    emit loadDone(topLevel, file2Item);
+void KateProjectWorker::collectGitDirs(const QVariantMap &project, QStringList &gitDirs) const
+{
+    const QVariantList subGroups = project[QStringLiteral("projects")].toList();
+    for (const QVariant &subGroupVariant : subGroups) {
+        collectGitDirs(subGroupVariant.toMap(), gitDirs);
+    }
 
-    // trigger index loading, will internally handle enable/disabled
-    loadIndex(files, m_force);
+    const QVariantList filesEntries = project[QStringLiteral("files")].toList();
+    for (const QVariant &fileVariant : filesEntries) {
+        const QVariantMap filesEntry = fileVariant.toMap();
+        QDir dir(m_baseDir);
+        if (filesEntry[QStringLiteral("git")].toBool() && dir.cd(filesEntry[QStringLiteral("directory")].toString())) {
+            gitDirs.append(dir.absolutePath());
+        }
+    }
+}
+
+void KateProjectWorker::collectFiles(const QVariantMap &project, KateProjectSnapshot::FilesEntries &entries)
+{
+    /**
+     * same order as loadProject(): sub-projects FIRST, skipping the ones without name
+     */
+    const QVariantList subGroups = project[QStringLiteral("projects")].toList();
+    for (const QVariant &subGroupVariant : subGroups) {
+        const QVariantMap subProject = subGroupVariant.toMap();
+        if (subProject[QStringLiteral("name")].toString().isEmpty()) {
+            continue;
+        }
+        collectFiles(subProject, entries);
+    }
+
+    /**
+     * if only some directories changed, update the shown files of the entry
+     */
+    const QVariantList filesEntries = project[QStringLiteral("files")].toList();
+    for (const QVariant &fileVariant : filesEntries) {
+        const int entryIndex = entries.size();
+        const bool update = m_hasShownEntries && m_hasChangedDirectories && entryIndex < m_shownEntries.size();
+        entries.append(filesForEntry(fileVariant.toMap(), update ? &m_shownEntries.at(entryIndex) : nullptr));
+    }
 }
 
-void KateProjectWorker::loadProject(QStandardItem *parent, const QVariantMap &project, QMap<QString, KateProjectItem *> *file2Item)
+void KateProjectWorker::loadProject(QStandardItem *parent, const QVariantMap &project, QMap<QString, KateProjectItem *> *file2Item, const KateProjectSnapshot::FilesEntries &entries, int &entryIndex)
 {
     /**
      * recurse to sub-projects FIRST
@@ -83,17 +264,20 @@ void KateProjectWorker::loadProject(QStandardItem *parent, const QVariantMap &pr
          * recurse
          */
         QStandardItem *subProjectItem = new KateProjectItem(KateProjectItem::Project, subProject[keyName].toString());
-        loadProject(subProjectItem, subProject, file2Item);
+        loadProject(subProjectItem, subProject, file2Item, entries, entryIndex);
         parent->appendRow(subProjectItem);
     }
 
     /**
-     * load all specified files
+     * load all specified files, the files of each entry were collected before
      */
     const QString keyFiles = QStringLiteral("files");
     QVariantList files = project[keyFiles].toList();
     for (const QVariant &fileVariant : files) {
-        loadFilesEntry(parent, fileVariant.toMap(), file2Item);
+        if (entryIndex < entries.size()) {
+            loadFilesEntry(parent, fileVariant.toMap(), entries.at(entryIndex), file2Item);
+        }
+        ++entryIndex;
     }
 }
 
@@ -155,20 +339,53 @@ static QStandardItem *directoryParent(QMap<QString, QStandardItem *> &dir2Item,
     return dir2Item[path];
 }
 
-void KateProjectWorker::loadFilesEntry(QStandardItem *parent, const QVariantMap &filesEntry, QMap<QString, KateProjectItem *> *file2Item)
+QStringList KateProjectWorker::filesForEntry(const QVariantMap &filesEntry, const QStringList *shownFiles)
 {
     QDir dir(m_baseDir);
     if (!dir.cd(filesEntry[QStringLiteral("directory")].toString())) {
-        return;
+        return QStringList();
     }
 
-    QStringList files = findFiles(dir, filesEntry);
+    /**
+     * plain directories are only listed again where they changed,
+     * version control listings don't need to stat the files
+     */
+    QStringList files;
+    const bool recursive = !filesEntry.contains(QLatin1String("recursive")) || filesEntry[QStringLiteral("recursive")].toBool();
+    if (shownFiles && !filesEntry[QStringLiteral("git")].toBool() && !filesEntry[QStringLiteral("hg")].toBool() && !filesEntry[QStringLiteral("svn")].toBool()
+        && !filesEntry[QStringLiteral("darcs")].toBool() && filesEntry[QStringLiteral("list")].toStringList().isEmpty()) {
+        files = updateFilesFromDirectory(dir, recursive, filesEntry[QStringLiteral("filters")].toStringList(), *shownFiles);
+    } else {
+        files = findFiles(dir, filesEntry);
+    }
+    files.sort(Qt::CaseInsensitive);
 
-    if (files.isEmpty()) {
-        return;
+    /**
+     * skip NON-files, shown files outside the changed directories are known to exist
+     */
+    QSet<QString> knownFiles;
+    if (shownFiles) {
+        knownFiles.reserve(shownFiles->size());
+        for (const QString &filePath : *shownFiles) {
+            knownFiles.insert(filePath);
+        }
+    }
+    QStringList existingFiles;
+    existingFiles.reserve(files.size());
+    for (const QString &filePath : qAsConst(files)) {
+        if ((knownFiles.contains(filePath) && !directoryChanged(filePath.left(filePath.lastIndexOf(QLatin1Char('/'))))) || QFileInfo(filePath).isFile()) {
+            existingFiles.append(filePath);
+        }
     }
+    return existingFiles;
+}
 
-    files.sort(Qt::CaseInsensitive);
+void KateProjectWorker::loadFilesEntry(QStandardItem *parent, const QVariantMap &filesEntry, const QStringList &files, QMap<QString, KateProjectItem *> *file2Item)
+{
+    QDir dir(m_baseDir);
+    if (files.isEmpty() || !dir.cd(filesEntry[QStringLiteral("directory")].toString())) {
+        return;
+    }
 
     /**
      * construct paths first in tree and items in a map
@@ -184,23 +401,16 @@ void KateProjectWorker::loadFilesEntry(QStandardItem *parent, const QVariantMap
             continue;
         }
 
-        /**
-         * get file info and skip NON-files
-         */
-        QFileInfo fileInfo(filePath);
-        if (!fileInfo.isFile()) {
-            continue;
-        }
-
         /**
          * construct the item with right directory prefix
          * already hang in directories in tree
          */
-        KateProjectItem *fileItem = new KateProjectItem(KateProjectItem::File, fileInfo.fileName());
+        const int slash = filePath.lastIndexOf(QLatin1Char('/'));
+        KateProjectItem *fileItem = new KateProjectItem(KateProjectItem::File, filePath.mid(slash + 1));
         fileItem->setData(filePath, Qt::ToolTipRole);
 
         // get the directory's relative path to the base directory
-        QString dirRelPath = dir.relativeFilePath(fileInfo.absolutePath());
+        QString dirRelPath = dir.relativeFilePath(filePath.left(slash));
         // if the relative path is ".", clean it up
         if (dirRelPath == QLatin1Char('.')) {
             dirRelPath = QString();
@@ -251,19 +461,36 @@ QStringList KateProjectWorker::filesFromGit(const QDir &dir, bool recursive)
      * query files via ls-files and make them absolute afterwards
      */
     const QStringList relFiles = gitLsFiles(dir);
+
+    QElapsedTimer timer;
+    timer.start();
+    const QString prefix = dir.absolutePath() + QLatin1Char('/');
     QStringList files;
+    files.reserve(relFiles.size());
     for (const QString &relFile : relFiles) {
         if (!recursive && (relFile.indexOf(QLatin1Char('/')) != -1)) {
             continue;
         }
 
-        files.append(dir.absolutePath() + QLatin1Char('/') + relFile);
+        files.append(prefix + relFile);
     }
+    qCDebug(KATEPROJECT) << "made" << files.size() << "git files absolute in" << timer.elapsed() << "ms";
     return files;
 }
 
 QStringList KateProjectWorker::gitLsFiles(const QDir &dir)
 {
+    /**
+     * read the index ourself, this avoids starting git and reading its output
+     */
+    QStringList files;
+    KateProjectGitIndex::Timing timing;
+    if (KateProjectGitIndex::listFiles(dir.absolutePath(), files, &timing)) {
+        qCDebug(KATEPROJECT) << "read" << files.size() << "files from the git index of" << dir.absolutePath() << "- locate:" << timing.locate
+                             << "ms, read:" << timing.read << "ms, parse:" << timing.parse << "ms";
+        return files;
+    }
+
     /**
      * git ls-files -z results a bytearray where each entry is \0-terminated.
      * NOTE: Without -z, Umlauts such as "Der Bäcker/Das Brötchen.txt" do not work (#389415)
@@ -274,19 +501,23 @@ QStringList KateProjectWorker::gitLsFiles(const QDir &dir)
     QStringList args;
     args << QStringLiteral("ls-files") << QStringLiteral("-z") << QStringLiteral("--recurse-submodules") << QStringLiteral(".");
 
+    QElapsedTimer timer;
+    timer.start();
     QProcess git;
     git.setWorkingDirectory(dir.absolutePath());
     git.start(QStringLiteral("git"), args);
-    QStringList files;
     if (!git.waitForStarted() || !git.waitForFinished(-1)) {
         return files;
     }
+    const qint64 processTime = timer.restart();
 
     const QList<QByteArray> byteArrayList = git.readAllStandardOutput().split('\0');
     for (const QByteArray &byteArray : byteArrayList) {
         files << QString::fromUtf8(byteArray);
     }
 
+    qCDebug(KATEPROJECT) << "git index of" << dir.absolutePath() << "not readable, listed" << files.size() << "files with git ls-files - process:" << processTime
+                         << "ms, convert:" << timer.elapsed() << "ms";
     return files;
 }
 
@@ -464,6 +695,71 @@ QStringList KateProjectWorker::filesFromDirectory(const QDir &_dir, bool recursi
     return files;
 }
 
+QStringList KateProjectWorker::updateFilesFromDirectory(const QDir &dir, bool recursive, const QStringList &filters, const QStringList &shownFiles)
+{
+    /**
+     * keep the files of unchanged directories, remember all directories
+     * with shown files to find the ones created since
+     */
+    const QString entryDir = dir.path();
+    QStringList files;
+    QSet<QString> knownDirectories;
+    knownDirectories.insert(entryDir);
+    for (const QString &file : shownFiles) {
+        QString directory = file.left(file.lastIndexOf(QLatin1Char('/')));
+        if (!directoryChanged(directory)) {
+            files.append(file);
+        }
+        while (directory.size() > entryDir.size() && !knownDirectories.contains(directory)) {
+            knownDirectories.insert(directory);
+            directory.truncate(directory.lastIndexOf(QLatin1Char('/')));
+        }
+    }
+
+    for (const QString &directory : qAsConst(m_changedDirectories)) {
+        if (directory != entryDir && (!recursive || !directory.startsWith(entryDir + QLatin1Char('/')))) {
+            continue;
+        }
+
+        files.append(filesFromDirectory(QDir(directory), false, filters));
+        if (!recursive) {
+            continue;
+        }
+
+        /**
+         * sub-directories created since are not watched, list them completely
+         */
+        const QStringList subDirs = QDir(directory).entryList(QDir::Dirs | QDir::NoDotAndDotDot | QDir::NoSymLinks);
+        for (const QString &subDir : subDirs) {
+            const QString path = directory + QLatin1Char('/') + subDir;
+            if (!knownDirectories.contains(path)) {
+                files.append(filesFromDirectory(QDir(path), true, filters));
+            }
+        }
+    }
+
+    files.removeDuplicates();
+    return files;
+}
+
+bool KateProjectWorker::directoryChanged(QString directory) const
+{
+    if (m_changedDirectories.contains(directory)) {
+        return true;
+    }
+
+    /**
+     * directories moved or removed with a parent don't report that themselves
+     */
+    while (!m_removedDirectories.isEmpty() && directory.lastIndexOf(QLatin1Char('/')) > 0) {
+        directory.truncate(directory.lastIndexOf(QLatin1Char('/')));
+        if (m_removedDirectories.contains(directory)) {
+            return true;
+        }
+    }
+    return false;
+}
+
 void KateProjectWorker::loadIndex(const QStringList &files, bool force)
 {
     const QString keyCtags = QStringLiteral("ctags");
@@ -487,7 +783,9 @@ void KateProjectWorker::loadIndex(const QStringList &files, bool force)
      * create new index, this will do the loading in the constructor
      * wrap it into shared pointer for transfer to main thread
      */
-    KateProjectSharedProjectIndex index(new KateProjectIndex(m_baseDir, m_indexDir, files, ctagsMap, force));
+    KateProjectSharedProjectIndex index(
+        new KateProjectIndex(m_baseDir, m_indexDir, files, ctagsMap, force, m_previousIndex.data(), m_hasChangedDirectories ? &m_changedDirectories : nullptr));
+    m_previousIndex.reset();
 
     emit loadIndexDone(index);
 }
@@ -23,6 +23,7 @@
 
 #include "kateproject.h"
 #include "kateprojectitem.h"
+#include "kateprojectsnapshot.h"
 
 #include <ThreadWeaver/Job>
 
@@ -49,27 +50,94 @@ public:
 
     void run(ThreadWeaver::JobPointer self, ThreadWeaver::Thread *thread) override;
 
+    /**
+     * Set the files the project shows at the moment.
+     * The worker then only sends the changes against these with filesChanged()
+     * instead of building a new model.
+     * @param entries files of each files entry, as sent with loadDone()
+     */
+    void setShownFiles(const KateProjectSnapshot::FilesEntries &entries);
+
+    /**
+     * Set the directories that changed since the shown files were searched, see setShownFiles().
+     * Only these directories are listed and indexed again, the shown files of the
+     * other directories are taken as they are.
+     * @param directories changed directories, without trailing slash
+     */
+    void setChangedDirectories(const QSet<QString> &directories);
+
+    /**
+     * Set the index the project has at the moment.
+     * Unless the loading is forced, only the changes against it are indexed.
+     * @param index current index of the project, may be null
+     */
+    void setPreviousIndex(const KateProjectSharedProjectIndex &index);
+
+    /**
+     * Compute the files added and removed for each files entry.
+     * @param base files of each files entry before
+     * @param entries files of each files entry now
+     * @return the changes or a null pointer if the files entries don't match
+     */
+    static KateProjectSharedFilesDiff diffFiles(const KateProjectSnapshot::FilesEntries &base, const KateProjectSnapshot::FilesEntries &entries);
+
 Q_SIGNALS:
-    void loadDone(KateProjectSharedQStandardItem topLevel, KateProjectSharedQMapStringItem file2Item);
+    void loadDone(KateProjectSharedQStandardItem topLevel, KateProjectSharedQMapStringItem file2Item, KateProjectSnapshot::FilesEntries entries);
+    void filesChanged(KateProjectSharedFilesDiff diff);
     void loadIndexDone(KateProjectSharedProjectIndex index);
 
 private:
+    /**
+     * Build the model from the files of all files entries and send it to the project.
+     * @param entries files of each files entry, in the order of loadProject()
+     */
+    void emitLoadDone(const KateProjectSnapshot::FilesEntries &entries);
+
+    /**
+     * Key of the snapshot for the current state of the project.
+     * Covers the project map and the git indexes of its files entries.
+     */
+    QByteArray snapshotKey() const;
+    void collectGitDirs(const QVariantMap &project, QStringList &gitDirs) const;
+
+    /**
+     * Search the files of all files entries of the project and its sub-projects.
+     * @param project variant map for this group
+     * @param entries the files of each files entry are appended here
+     */
+    void collectFiles(const QVariantMap &project, KateProjectSnapshot::FilesEntries &entries);
+
     /**
      * Load one project inside the project tree.
      * Fill data from JSON storage to model and recurse to sub-projects.
      * @param parent parent standard item in the model
      * @param project variant map for this group
      * @param file2Item mapping file => item, will be filled
+     * @param entries files of each files entry, see collectFiles()
+     * @param entryIndex index of the next files entry in \p entries
      */
-    void loadProject(QStandardItem *parent, const QVariantMap &project, QMap<QString, KateProjectItem *> *file2Item);
+    void loadProject(QStandardItem *parent,
+                     const QVariantMap &project,
+                     QMap<QString, KateProjectItem *> *file2Item,
+                     const KateProjectSnapshot::FilesEntries &entries,
+                     int &entryIndex);
+
+    /**
+     * Search the files of one files entry.
+     * @param filesEntry one files entry specification
+     * @param shownFiles files of the entry shown at the moment, nullptr to search all again
+     * @return existing files of the entry, sorted
+     */
+    QStringList filesForEntry(const QVariantMap &filesEntry, const QStringList *shownFiles);
 
     /**
      * Load one files entry in the current parent item.
      * @param parent parent standard item in the model
      * @param filesEntry one files entry specification to load
+     * @param files the files of the entry, see filesForEntry()
      * @param file2Item mapping file => item, will be filled
      */
-    void loadFilesEntry(QStandardItem *parent, const QVariantMap &filesEntry, QMap<QString, KateProjectItem *> *file2Item);
+    void loadFilesEntry(QStandardItem *parent, const QVariantMap &filesEntry, const QStringList &files, QMap<QString, KateProjectItem *> *file2Item);
 
     /**
      * Load index for whole project.
@@ -85,6 +153,25 @@ private:
     QStringList filesFromDarcs(const QDir &dir, bool recursive);
     QStringList filesFromDirectory(const QDir &dir, bool recursive, const QStringList &filters);
 
+    /**
+     * Update the shown files of a directory files entry with the changed directories.
+     * These are listed again, new sub-directories in them completely, the
+     * files of the other directories are kept.
+     * @param dir directory of the files entry
+     * @param recursive whether the files entry includes sub-directories
+     * @param filters name filters of the files entry
+     * @param shownFiles files of the entry shown at the moment
+     * @return files of the entry
+     */
+    QStringList updateFilesFromDirectory(const QDir &dir, bool recursive, const QStringList &filters, const QStringList &shownFiles);
+
+    /**
+     * Whether the files of a directory might have changed, see setChangedDirectories().
+     * @param directory directory, without trailing slash
+     * @return true if the directory or a removed parent directory changed
+     */
+    bool directoryChanged(QString directory) const;
+
     QStringList gitLsFiles(const QDir &dir);
 
 private:
@@ -105,6 +192,28 @@ private:
 
     const QVariantMap m_projectMap;
     const bool m_force;
+
+    /**
+     * files the project shows, see setShownFiles()
+     */
+    KateProjectSnapshot::FilesEntries m_shownEntries;
+    bool m_hasShownEntries;
+
+    /**
+     * directories changed since the shown files were searched, see setChangedDirectories()
+     */
+    QSet<QString> m_changedDirectories;
+    bool m_hasChangedDirectories;
+
+    /**
+     * the changed directories that don't exist anymore, their sub-directories are gone too
+     */
+    QSet<QString> m_removedDirectories;
+
+    /**
+     * index of the project, see setPreviousIndex()
+     */
+    KateProjectSharedProjectIndex m_previousIndex;
 };
 
 #endif
@@ -0,0 +1,92 @@
+/*   Kate search plugin
+ *
+ * Copyright (C) 2020 by Kate Developers <kwrite-devel@kde.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program in a file called COPYING; if not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#include "FileQueue.h"
+
+#include <QMutexLocker>
+
+FileQueue::FileQueue(int capacity)
+    : m_capacity(capacity)
+{
+}
+
+void FileQueue::reset()
+{
+    QMutexLocker locker(&m_mutex);
+    m_files.clear();
+    m_dequeuedCount = 0;
+    m_closed = false;
+    m_canceled = false;
+}
+
+bool FileQueue::enqueue(const QString &file)
+{
+    QMutexLocker locker(&m_mutex);
+    while (m_files.size() >= m_capacity && !m_canceled) {
+        m_notFull.wait(&m_mutex);
+    }
+    if (m_canceled) {
+        return false;
+    }
+    m_files.enqueue(file);
+    m_notEmpty.wakeOne();
+    return true;
+}
+
+void FileQueue::enqueueAll(const QStringList &files)
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_canceled) {
+        return;
+    }
+    m_files.append(files);
+    m_notEmpty.wakeAll();
+}
+
+void FileQueue::close()
+{
+    QMutexLocker locker(&m_mutex);
+    m_closed = true;
+    m_notEmpty.wakeAll();
+}
+
+void FileQueue::cancel()
+{
+    QMutexLocker locker(&m_mutex);
+    m_canceled = true;
+    m_files.clear();
+    m_notEmpty.wakeAll();
+    m_notFull.wakeAll();
+}
+
+bool FileQueue::dequeue(QString &file, int &fileIndex)
+{
+    QMutexLocker locker(&m_mutex);
+    while (m_files.isEmpty() && !m_closed && !m_canceled) {
+        m_notEmpty.wait(&m_mutex);
+    }
+    if (m_canceled || m_files.isEmpty()) {
+        return false;
+    }
+    file = m_files.dequeue();
+    fileIndex = m_dequeuedCount++;
+    m_notFull.wakeOne();
+    return true;
+}
@@ -0,0 +1,89 @@
+/*   Kate search plugin
+ *
+ * Copyright (C) 2020 by Kate Developers <kwrite-devel@kde.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program in a file called COPYING; if not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#ifndef FileQueue_h
+#define FileQueue_h
+
+#include <QMutex>
+#include <QQueue>
+#include <QString>
+#include <QStringList>
+#include <QWaitCondition>
+
+/**
+ * Thread safe queue of files to search, connecting the thread listing the
+ * files with the threads searching them.
+ *
+ * The queue is bounded: enqueue() blocks while it is full, so a fast producer
+ * can't run away from the searchers. Files are numbered in the order they are
+ * enqueued, the searchers use the number to deliver results in that order.
+ */
+class FileQueue
+{
+public:
+    explicit FileQueue(int capacity);
+
+    /**
+     * Empties the queue and opens it for a new search. Must not be called while
+     * other threads use the queue.
+     */
+    void reset();
+
+    /**
+     * Adds a file, waits while the queue is full.
+     * @return false if the queue was canceled, the file was not added
+     */
+    bool enqueue(const QString &file);
+
+    /**
+     * Adds all files at once, without regard to the capacity.
+     */
+    void enqueueAll(const QStringList &files);
+
+    /**
+     * No more files will be added, dequeue() returns false once the queue is empty.
+     */
+    void close();
+
+    /**
+     * Stops producer and consumers, the remaining files are dropped.
+     */
+    void cancel();
+
+    /**
+     * Takes the next file, waits while the queue is empty but not closed.
+     * @param file the file to search
+     * @param fileIndex position of the file in the order of enqueueing
+     * @return false if there are no more files or the queue was canceled
+     */
+    bool dequeue(QString &file, int &fileIndex);
+
+private:
+    const int m_capacity;
+    QMutex m_mutex;
+    QWaitCondition m_notEmpty;
+    QWaitCondition m_notFull;
+    QQueue<QString> m_files;
+    int m_dequeuedCount = 0;
+    bool m_closed = false;
+    bool m_canceled = false;
+};
+
+#endif
@@ -1,6 +1,7 @@
 /*   Kate search plugin
  *
  * Copyright (C) 2013 by Kåre Särs <kare.sars@iki.fi>
+ * Copyright (C) 2020 by Kate Developers <kwrite-devel@kde.org>
  *
  * This program is free software; you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
@@ -19,13 +20,23 @@
  */
 
 #include "FolderFilesList.h"
+#include "FileQueue.h"
 
-#include <QDebug>
 #include <QDir>
+#include <QFile>
 #include <QFileInfo>
 #include <QFileInfoList>
-#include <QMimeDatabase>
-#include <QMimeType>
+
+#include <algorithm>
+
+#ifdef Q_OS_UNIX
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#endif
+
+// that much of a file is looked at to tell text from binary
+static const int binarySniffSize = 4096;
 
 FolderFilesList::FolderFilesList(QObject *parent)
     : QThread(parent)
@@ -40,18 +51,40 @@ FolderFilesList::~FolderFilesList()
 
 void FolderFilesList::run()
 {
-    m_files.clear();
-
     QFileInfo folderInfo(m_folder);
-    checkNextItem(folderInfo);
+    if (folderInfo.isFile()) {
+        addFile(folderInfo.canonicalFilePath());
+    } else if (folderInfo.isDir()) {
+        listDirectory(QDir(m_folder).absolutePath(), folderInfo.canonicalFilePath(), QString());
+    }
+    m_gitIgnores.clear();
+
+    // the searchers stop once they are through with the queued files
+    m_queue->close();
 
     if (m_cancelSearch)
-        m_files.clear();
+        m_openFilesFound.clear();
 }
 
-void FolderFilesList::generateList(const QString &folder, bool recursive, bool hidden, bool symlinks, bool binary, const QString &types, const QString &excludes)
+void FolderFilesList::generateList(const QString &folder,
+                                   bool recursive,
+                                   bool hidden,
+                                   bool symlinks,
+                                   bool binary,
+                                   bool gitIgnore,
+                                   const QString &types,
+                                   const QString &excludes,
+                                   FileQueue *queue,
+                                   const QSet<QString> &openFiles)
 {
+    // a canceled listing might still be winding down
+    wait();
+
     m_cancelSearch = false;
+    m_queue = queue;
+    m_openFiles = openFiles;
+    m_openFilesFound.clear();
+    m_fileCount = 0;
     m_folder = folder;
     if (!m_folder.endsWith(QLatin1Char('/'))) {
         m_folder += QLatin1Char('/');
@@ -60,90 +93,217 @@ void FolderFilesList::generateList(const QString &folder, bool recursive, bool h
     m_hidden = hidden;
     m_symlinks = symlinks;
     m_binary = binary;
+    m_gitIgnore = gitIgnore;
 
-    m_types.clear();
-    const auto typesList = types.split(QLatin1Char(','), QString::SkipEmptyParts);
-    for (const QString &type : typesList) {
-        m_types << type.trimmed();
-    }
-    if (m_types.isEmpty()) {
-        m_types << QStringLiteral("*");
-    }
-
-    QStringList tmpExcludes = excludes.split(QLatin1Char(','));
-    m_excludeList.clear();
-    for (int i = 0; i < tmpExcludes.size(); i++) {
-        QRegExp rx(tmpExcludes[i].trimmed());
-        rx.setPatternSyntax(QRegExp::Wildcard);
-        m_excludeList << rx;
-    }
+    // like QDir name filters, the file types are case insensitive
+    m_types = GlobMatcher::fromFilter(types, Qt::CaseInsensitive);
+    m_excludes = GlobMatcher::fromFilter(excludes);
 
     m_time.restart();
     start();
 }
 
-QStringList FolderFilesList::fileList()
+QStringList FolderFilesList::openFiles()
 {
-    return m_files;
+    return m_openFilesFound;
 }
 
 void FolderFilesList::cancelSearch()
 {
     m_cancelSearch = true;
+    if (m_queue) {
+        m_queue->cancel();
+    }
 }
 
-void FolderFilesList::checkNextItem(const QFileInfo &item)
+void FolderFilesList::addFile(const QString &file)
+{
+    m_fileCount.fetchAndAddRelaxed(1);
+    if (m_openFiles.contains(file)) {
+        m_openFilesFound << file;
+        return;
+    }
+    // only fails if the search was canceled
+    if (!m_queue->enqueue(file)) {
+        m_cancelSearch = true;
+    }
+}
+
+void FolderFilesList::listDirectory(const QString &dirPath, const QString &canonicalDir, const QString &relativeDir)
 {
     if (m_cancelSearch) {
         return;
     }
     if (m_time.elapsed() > 100) {
         m_time.restart();
-        emit searching(item.absoluteFilePath());
+        emit searching(dirPath);
+    }
+
+    QVector<DirEntry> entries;
+    if (!readDirectory(dirPath, entries)) {
+        return;
+    }
+
+    // sort the items to have an deterministic order!
+    std::sort(entries.begin(), entries.end(), [](const DirEntry &left, const DirEntry &right) {
+        return left.name < right.name;
+    });
+
+    bool hasGitIgnore = false;
+    if (m_gitIgnore) {
+        GitIgnore gitIgnore;
+        gitIgnore.relativeDir = relativeDir;
+        gitIgnore.matcher.reset(new GitIgnoreMatcher(dirPath));
+        if (!gitIgnore.matcher->isEmpty()) {
+            m_gitIgnores << gitIgnore;
+            hasGitIgnore = true;
+        }
     }
-    if (item.isFile()) {
-        if (!m_binary) {
-            QMimeType mimeType = QMimeDatabase().mimeTypeForFile(item);
-            if (!mimeType.inherits(QStringLiteral("text/plain"))) {
-                return;
+
+    for (const DirEntry &entry : qAsConst(entries)) {
+        if (m_cancelSearch) {
+            break;
+        }
+        if ((entry.isHidden && !m_hidden) || (entry.isSymLink && !m_symlinks) || (entry.isDir && !m_recursive)) {
+            continue;
+        }
+        const QString relativePath = relativeDir + entry.name;
+        if (isExcluded(relativePath, entry.name, entry.isDir)) {
+            continue;
+        }
+
+        const QString path = dirPath + QLatin1Char('/') + entry.name;
+        QString canonicalPath = canonicalDir + QLatin1Char('/') + entry.name;
+        if (entry.isSymLink) {
+            canonicalPath = QFileInfo(path).canonicalFilePath();
+        }
+
+        if (entry.isDir) {
+            // a link to a directory we are in would never end
+            if (entry.isSymLink && (canonicalPath == canonicalDir || canonicalDir.startsWith(canonicalPath + QLatin1Char('/')))) {
+                continue;
             }
+            listDirectory(path, canonicalPath, relativePath + QLatin1Char('/'));
+            continue;
         }
-        m_files << item.canonicalFilePath();
-    } else {
-        QDir currentDir(item.absoluteFilePath());
 
-        if (!currentDir.isReadable()) {
-            // qDebug() << currentDir.absolutePath() << "Not readable";
-            return;
+        if (!m_types.isEmpty() && !m_types.matches(entry.name)) {
+            continue;
         }
+        if (!m_binary && isBinary(path)) {
+            continue;
+        }
+        addFile(canonicalPath);
+    }
+
+    if (hasGitIgnore) {
+        m_gitIgnores.removeLast();
+    }
+}
+
+bool FolderFilesList::readDirectory(const QString &dirPath, QVector<DirEntry> &entries) const
+{
+#ifdef Q_OS_UNIX
+    const QByteArray encodedDir = QFile::encodeName(dirPath);
+    DIR *dir = opendir(encodedDir.constData());
+    if (!dir) {
+        return false;
+    }
 
-        QDir::Filters filter = QDir::Files | QDir::NoDotAndDotDot | QDir::Readable;
-        if (m_hidden)
-            filter |= QDir::Hidden;
-        if (m_recursive)
-            filter |= QDir::AllDirs;
-        if (!m_symlinks)
-            filter |= QDir::NoSymLinks;
-
-        // sort the items to have an deterministic order!
-        const QFileInfoList currentItems = currentDir.entryInfoList(m_types, filter, QDir::Name | QDir::LocaleAware);
-
-        bool skip;
-        for (const auto &currentItem : currentItems) {
-            skip = false;
-            for (const auto &regex : qAsConst(m_excludeList)) {
-                QString matchString = currentItem.filePath();
-                if (currentItem.filePath().startsWith(m_folder)) {
-                    matchString = currentItem.filePath().mid(m_folder.size());
-                }
-                if (regex.exactMatch(matchString)) {
-                    skip = true;
-                    break;
-                }
+    while (dirent *dirEntry = readdir(dir)) {
+        const char *name = dirEntry->d_name;
+        if (name[0] == '.' && (name[1] == 0 || (name[1] == '.' && name[2] == 0))) {
+            continue;
+        }
+
+        DirEntry entry;
+        entry.isHidden = name[0] == '.';
+        entry.isSymLink = false;
+
+        // only links and file systems not telling the type need a stat()
+        unsigned char type = DT_UNKNOWN;
+#if defined(_DIRENT_HAVE_D_TYPE) || defined(Q_OS_BSD4)
+        type = dirEntry->d_type;
+#endif
+        if (type == DT_UNKNOWN || type == DT_LNK) {
+            const QByteArray path = encodedDir + '/' + name;
+            struct stat st;
+            if (type == DT_UNKNOWN && lstat(path.constData(), &st) == 0 && S_ISLNK(st.st_mode)) {
+                type = DT_LNK;
             }
-            if (!skip) {
-                checkNextItem(currentItem);
+            entry.isSymLink = type == DT_LNK;
+            if (stat(path.constData(), &st) != 0) {
+                continue;
             }
+            type = S_ISDIR(st.st_mode) ? DT_DIR : S_ISREG(st.st_mode) ? DT_REG : DT_UNKNOWN;
+        }
+
+        // no fifos, sockets or devices
+        if (type != DT_DIR && type != DT_REG) {
+            continue;
+        }
+        entry.isDir = type == DT_DIR;
+        entry.name = QFile::decodeName(name);
+        entries << entry;
+    }
+
+    closedir(dir);
+    return true;
+#else
+    QDir dir(dirPath);
+    if (!dir.isReadable()) {
+        return false;
+    }
+    const QFileInfoList items = dir.entryInfoList(QDir::Files | QDir::AllDirs | QDir::NoDotAndDotDot | QDir::Hidden | QDir::Readable, QDir::Unsorted);
+    for (const QFileInfo &item : items) {
+        DirEntry entry;
+        entry.name = item.fileName();
+        entry.isDir = item.isDir();
+        entry.isSymLink = item.isSymLink();
+        entry.isHidden = item.isHidden();
+        entries << entry;
+    }
+    return true;
+#endif
+}
+
+bool FolderFilesList::isExcluded(const QString &relativePath, const QString &name, bool isDir) const
+{
+    if (m_excludes.matches(relativePath)) {
+        return true;
+    }
+    if (!m_gitIgnore) {
+        return false;
+    }
+
+    // git never looks into its own directory
+    if (isDir && name == QLatin1String(".git")) {
+        return true;
+    }
+
+    // the .gitignore closest to the file decides
+    for (int i = m_gitIgnores.size() - 1; i >= 0; --i) {
+        const GitIgnore &gitIgnore = m_gitIgnores.at(i);
+        const GitIgnoreMatcher::Result result = gitIgnore.matcher->match(relativePath.mid(gitIgnore.relativeDir.size()), name, isDir);
+        if (result != GitIgnoreMatcher::NoMatch) {
+            return result == GitIgnoreMatcher::Ignored;
         }
     }
+    return false;
+}
+
+bool FolderFilesList::isBinary(const QString &filePath) const
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        // can't be searched anyway
+        return true;
+    }
+    const QByteArray start = file.read(binarySniffSize);
+
+    // UTF-16 and UTF-32 text is full of NUL bytes, but has a byte order mark
+    if (start.startsWith("\xff\xfe") || start.startsWith("\xfe\xff") || start.startsWith(QByteArray("\x00\x00\xfe\xff", 4))) {
+        return false;
+    }
+    return start.contains('\0');
 }
@@ -1,6 +1,7 @@
 /*   Kate search plugin
  *
  * Copyright (C) 2013 by Kåre Särs <kare.sars@iki.fi>
+ * Copyright (C) 2020 by Kate Developers <kwrite-devel@kde.org>
  *
  * This program is free software; you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
@@ -21,13 +22,31 @@
 #ifndef FolderFilesList_h
 #define FolderFilesList_h
 
+#include <QAtomicInt>
 #include <QElapsedTimer>
-#include <QFileInfo>
-#include <QRegExp>
+#include <QSet>
+#include <QSharedPointer>
 #include <QStringList>
 #include <QThread>
 #include <QVector>
 
+#include "GlobMatcher.h"
+
+class FileQueue;
+
+/**
+ * Lists the files of a folder for searching.
+ *
+ * The files are handed to the searcher through a FileQueue as soon as they
+ * are found, the queue is closed when the listing is done. Files that are
+ * open in the editor are not queued, they are collected in openFiles() to be
+ * searched in their documents.
+ *
+ * Directories are read with the plain system calls where available, the type
+ * of an entry is taken from the directory listing instead of a stat() per
+ * file. The file type and exclude patterns are compiled once per listing and
+ * binary files are recognized by NUL bytes in their first few KB.
+ */
 class FolderFilesList : public QThread
 {
     Q_OBJECT
@@ -38,9 +57,29 @@ public:
 
     void run() override;
 
-    void generateList(const QString &folder, bool recursive, bool hidden, bool symlinks, bool binary, const QString &types, const QString &excludes);
+    void generateList(const QString &folder,
+                      bool recursive,
+                      bool hidden,
+                      bool symlinks,
+                      bool binary,
+                      bool gitIgnore,
+                      const QString &types,
+                      const QString &excludes,
+                      FileQueue *queue,
+                      const QSet<QString> &openFiles);
+
+    /**
+     * @return the files found that are open in the editor, in the order they were found
+     */
+    QStringList openFiles();
 
-    QStringList fileList();
+    /**
+     * @return number of files listed so far, can be called while the listing runs
+     */
+    int fileCount() const
+    {
+        return m_fileCount.loadAcquire();
+    }
 
 public Q_SLOTS:
     void cancelSearch();
@@ -49,19 +88,42 @@ Q_SIGNALS:
     void searching(const QString &path);
 
 private:
-    void checkNextItem(const QFileInfo &item);
+    struct DirEntry {
+        QString name;
+        bool isDir;
+        bool isSymLink;
+        bool isHidden;
+    };
+
+    struct GitIgnore {
+        /** directory of the .gitignore file, relative to the searched folder */
+        QString relativeDir;
+        QSharedPointer<GitIgnoreMatcher> matcher;
+    };
+
+    void listDirectory(const QString &dirPath, const QString &canonicalDir, const QString &relativeDir);
+    bool readDirectory(const QString &dirPath, QVector<DirEntry> &entries) const;
+    bool isExcluded(const QString &relativePath, const QString &name, bool isDir) const;
+    bool isBinary(const QString &filePath) const;
+    void addFile(const QString &file);
 
 private:
     QString m_folder;
-    QStringList m_files;
+    FileQueue *m_queue = nullptr;
+    QSet<QString> m_openFiles;
+    QStringList m_openFilesFound;
     bool m_cancelSearch;
 
     bool m_recursive;
     bool m_hidden;
     bool m_symlinks;
     bool m_binary;
-    QStringList m_types;
-    QVector<QRegExp> m_excludeList;
+    bool m_gitIgnore;
+    /** empty if all file types are searched */
+    GlobMatcher m_types;
+    GlobMatcher m_excludes;
+    QVector<GitIgnore> m_gitIgnores;
+    QAtomicInt m_fileCount;
     QElapsedTimer m_time;
 };
 
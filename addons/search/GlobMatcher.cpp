@@ -0,0 +1,227 @@
+/*   Kate search plugin
+ *
+ * Copyright (C) 2020 by Kate Developers <kwrite-devel@kde.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program in a file called COPYING; if not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#include "GlobMatcher.h"
+
+#include <QFile>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QPair>
+
+static bool hasWildcards(const QString &pattern, int from)
+{
+    for (int i = from; i < pattern.size(); ++i) {
+        const QChar c = pattern.at(i);
+        if (c == QLatin1Char('*') || c == QLatin1Char('?') || c == QLatin1Char('[')) {
+            return true;
+        }
+    }
+    return false;
+}
+
+GlobMatcher::GlobMatcher(const QStringList &patterns, Qt::CaseSensitivity caseSensitivity)
+    : m_caseSensitivity(caseSensitivity)
+{
+    QStringList alternatives;
+    for (const QString &pattern : patterns) {
+        if (pattern.isEmpty()) {
+            continue;
+        }
+        if (pattern == QLatin1String("*")) {
+            m_matchesAll = true;
+        } else if (pattern.startsWith(QLatin1String("*.")) && pattern.lastIndexOf(QLatin1Char('.')) == 1 && !pattern.contains(QLatin1Char('/')) && !hasWildcards(pattern, 1)) {
+            const QString extension = pattern.mid(1);
+            m_extensions.insert(caseSensitivity == Qt::CaseInsensitive ? extension.toLower() : extension);
+        } else if (!hasWildcards(pattern, 0)) {
+            m_names.insert(caseSensitivity == Qt::CaseInsensitive ? pattern.toLower() : pattern);
+        } else {
+            alternatives << globToRegExp(pattern, false);
+        }
+    }
+    if (alternatives.isEmpty()) {
+        return;
+    }
+
+    QRegularExpression::PatternOptions options = QRegularExpression::DotMatchesEverythingOption;
+    if (caseSensitivity == Qt::CaseInsensitive) {
+        options |= QRegularExpression::CaseInsensitiveOption;
+    }
+    m_regExp = QRegularExpression(QStringLiteral("\\A(?:") + alternatives.join(QLatin1Char('|')) + QStringLiteral(")\\z"), options);
+    m_regExp.optimize();
+    m_hasRegExp = true;
+}
+
+GlobMatcher GlobMatcher::fromFilter(const QString &filter, Qt::CaseSensitivity caseSensitivity)
+{
+    // the filters come from the short history of the filter combo boxes
+    static QMutex cacheMutex;
+    static QHash<QPair<QString, int>, GlobMatcher> cache;
+
+    QMutexLocker locker(&cacheMutex);
+    const QPair<QString, int> key(filter, int(caseSensitivity));
+    auto it = cache.constFind(key);
+    if (it != cache.constEnd()) {
+        return it.value();
+    }
+
+    QStringList patterns;
+    const auto parts = filter.split(QLatin1Char(','), QString::SkipEmptyParts);
+    for (const QString &part : parts) {
+        patterns << part.trimmed();
+    }
+
+    const GlobMatcher matcher(patterns, caseSensitivity);
+    if (cache.size() >= 32) {
+        cache.clear();
+    }
+    cache.insert(key, matcher);
+    return matcher;
+}
+
+bool GlobMatcher::matches(const QString &text) const
+{
+    if (m_matchesAll) {
+        return true;
+    }
+    const bool caseInsensitive = m_caseSensitivity == Qt::CaseInsensitive;
+    if (!m_extensions.isEmpty()) {
+        const int dot = text.lastIndexOf(QLatin1Char('.'));
+        if (dot != -1) {
+            const QString extension = text.mid(dot);
+            if (m_extensions.contains(caseInsensitive ? extension.toLower() : extension)) {
+                return true;
+            }
+        }
+    }
+    if (!m_names.isEmpty() && m_names.contains(caseInsensitive ? text.toLower() : text)) {
+        return true;
+    }
+    return m_hasRegExp && m_regExp.match(text).hasMatch();
+}
+
+QString GlobMatcher::globToRegExp(const QString &glob, bool pathAware)
+{
+    QString regExp;
+    regExp.reserve(glob.size() * 2);
+    for (int i = 0; i < glob.size(); ++i) {
+        const QChar c = glob.at(i);
+        switch (c.unicode()) {
+        case '*':
+            if (pathAware && i + 1 < glob.size() && glob.at(i + 1) == QLatin1Char('*')) {
+                ++i;
+                // "**/" also matches no directory at all
+                if (i + 1 < glob.size() && glob.at(i + 1) == QLatin1Char('/')) {
+                    ++i;
+                    regExp += QStringLiteral("(?:.*/)?");
+                } else {
+                    regExp += QStringLiteral(".*");
+                }
+            } else {
+                regExp += pathAware ? QStringLiteral("[^/]*") : QStringLiteral(".*");
+            }
+            break;
+        case '?':
+            regExp += pathAware ? QStringLiteral("[^/]") : QStringLiteral(".");
+            break;
+        case '[': {
+            // copy character classes, everything else is taken literally
+            const int end = glob.indexOf(QLatin1Char(']'), i + 2);
+            if (end == -1) {
+                regExp += QStringLiteral("\\[");
+                break;
+            }
+            QString set = glob.mid(i + 1, end - i - 1);
+            set.replace(QLatin1Char('\\'), QStringLiteral("\\\\"));
+            if (set.startsWith(QLatin1Char('!'))) {
+                set[0] = QLatin1Char('^');
+            }
+            regExp += QLatin1Char('[') + set + QLatin1Char(']');
+            i = end;
+            break;
+        }
+        default:
+            regExp += QRegularExpression::escape(QString(c));
+            break;
+        }
+    }
+    return regExp;
+}
+
+GitIgnoreMatcher::GitIgnoreMatcher(const QString &dirPath)
+{
+    QFile file(dirPath + QStringLiteral("/.gitignore"));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    while (!file.atEnd()) {
+        QString line = QString::fromUtf8(file.readLine());
+        while (line.endsWith(QLatin1Char('\n')) || line.endsWith(QLatin1Char('\r'))) {
+            line.chop(1);
+        }
+        // trailing spaces are ignored unless escaped
+        while (line.endsWith(QLatin1Char(' ')) && !line.endsWith(QLatin1String("\\ "))) {
+            line.chop(1);
+        }
+        if (line.isEmpty() || line.startsWith(QLatin1Char('#'))) {
+            continue;
+        }
+
+        Rule rule;
+        rule.negated = line.startsWith(QLatin1Char('!'));
+        if (rule.negated) {
+            line.remove(0, 1);
+        } else if (line.startsWith(QLatin1String("\\#")) || line.startsWith(QLatin1String("\\!"))) {
+            line.remove(0, 1);
+        }
+        rule.dirOnly = line.endsWith(QLatin1Char('/'));
+        if (rule.dirOnly) {
+            line.chop(1);
+        }
+        rule.matchPath = line.contains(QLatin1Char('/'));
+        if (line.startsWith(QLatin1Char('/'))) {
+            line.remove(0, 1);
+        }
+        if (line.isEmpty()) {
+            continue;
+        }
+        line.replace(QLatin1String("\\ "), QLatin1String(" "));
+
+        rule.regExp = QRegularExpression(QStringLiteral("\\A") + GlobMatcher::globToRegExp(line, true) + QStringLiteral("\\z"));
+        if (rule.regExp.isValid()) {
+            m_rules << rule;
+        }
+    }
+}
+
+GitIgnoreMatcher::Result GitIgnoreMatcher::match(const QString &relativePath, const QString &name, bool isDir) const
+{
+    for (int i = m_rules.size() - 1; i >= 0; --i) {
+        const Rule &rule = m_rules.at(i);
+        if (rule.dirOnly && !isDir) {
+            continue;
+        }
+        if (rule.regExp.match(rule.matchPath ? relativePath : name).hasMatch()) {
+            return rule.negated ? Included : Ignored;
+        }
+    }
+    return NoMatch;
+}
@@ -0,0 +1,135 @@
+/*   Kate search plugin
+ *
+ * Copyright (C) 2020 by Kate Developers <kwrite-devel@kde.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program in a file called COPYING; if not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#ifndef GlobMatcher_h
+#define GlobMatcher_h
+
+#include <QRegularExpression>
+#include <QSet>
+#include <QStringList>
+#include <QVector>
+
+/**
+ * A list of wildcard patterns like "*.cpp, *.h" compiled for matching many
+ * names against all of them in one go.
+ *
+ * The common patterns are looked up in hashes: "*.ext" by the extension of the
+ * name and patterns without wildcards by the whole name. All other patterns are
+ * combined into one regular expression.
+ *
+ * '*' and '?' match any character, including '/', like QRegExp::Wildcard.
+ * Copies share the compiled patterns.
+ */
+class GlobMatcher
+{
+public:
+    GlobMatcher() = default;
+    explicit GlobMatcher(const QStringList &patterns, Qt::CaseSensitivity caseSensitivity = Qt::CaseSensitive);
+
+    /**
+     * Matcher for a comma separated filter like "*.cpp, *.h", as entered in the
+     * search options. The matchers are cached, the same filter is compiled once.
+     */
+    static GlobMatcher fromFilter(const QString &filter, Qt::CaseSensitivity caseSensitivity = Qt::CaseSensitive);
+
+    /**
+     * @return true if there are no patterns, nothing matches then
+     */
+    bool isEmpty() const
+    {
+        return !m_matchesAll && m_extensions.isEmpty() && m_names.isEmpty() && !m_hasRegExp;
+    }
+
+    /**
+     * @return true if one of the patterns is "*"
+     */
+    bool matchesAll() const
+    {
+        return m_matchesAll;
+    }
+
+    /**
+     * @return true if text matches one of the patterns completely
+     */
+    bool matches(const QString &text) const;
+
+    /**
+     * Converts one wildcard pattern to a regular expression.
+     * @param glob the wildcard pattern
+     * @param pathAware '*' and '?' don't match '/', "**" matches any number of directories
+     */
+    static QString globToRegExp(const QString &glob, bool pathAware);
+
+private:
+    Qt::CaseSensitivity m_caseSensitivity = Qt::CaseSensitive;
+    bool m_matchesAll = false;
+    /** extensions of the "*.ext" patterns, including the dot */
+    QSet<QString> m_extensions;
+    /** patterns without wildcards */
+    QSet<QString> m_names;
+    /** all other patterns */
+    bool m_hasRegExp = false;
+    QRegularExpression m_regExp;
+};
+
+/**
+ * The rules of one .gitignore file.
+ *
+ * Supported are the usual gitignore patterns: comments, negation with '!',
+ * directory only patterns ending in '/', patterns anchored to the directory of
+ * the .gitignore file if they contain a '/' and "**" for any number of
+ * directories.
+ */
+class GitIgnoreMatcher
+{
+public:
+    enum Result { NoMatch, Ignored, Included };
+
+    /**
+     * Reads the .gitignore file in dirPath, if there is one.
+     */
+    explicit GitIgnoreMatcher(const QString &dirPath);
+
+    bool isEmpty() const
+    {
+        return m_rules.isEmpty();
+    }
+
+    /**
+     * Checks a path against the rules, the last matching rule wins.
+     * @param relativePath path relative to the directory of the .gitignore file
+     * @param name the file name part of relativePath
+     * @param isDir true for directories
+     * @return NoMatch if no rule matches, otherwise whether the last matching rule ignores the path
+     */
+    Result match(const QString &relativePath, const QString &name, bool isDir) const;
+
+private:
+    struct Rule {
+        QRegularExpression regExp;
+        bool negated;
+        bool dirOnly;
+        /** anchored patterns match the relative path, the others just the name */
+        bool matchPath;
+    };
+    QVector<Rule> m_rules;
+};
+
+#endif
@@ -0,0 +1,310 @@
+/*   Kate search plugin
+ *
+ * Copyright (C) 2020 by Kate Developers <kwrite-devel@kde.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program in a file called COPYING; if not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#include "LiteralPrefilter.h"
+
+#include <cstring>
+
+static char asciiLower(char c)
+{
+    return (c >= 'A' && c <= 'Z') ? char(c + ('a' - 'A')) : c;
+}
+
+static char asciiUpper(char c)
+{
+    return (c >= 'a' && c <= 'z') ? char(c - ('a' - 'A')) : c;
+}
+
+/**
+ * Rough guess how often a character shows up in text, lower is rarer.
+ * Used to pick the character memchr() looks for.
+ */
+static int anchorCost(char c)
+{
+    if (c == ' ') {
+        return 3;
+    }
+    if (c >= 'a' && c <= 'z') {
+        return 2;
+    }
+    return 1;
+}
+
+LiteralPrefilter::LiteralPrefilter(const QRegularExpression &regExp)
+    : m_caseSensitive(!(regExp.patternOptions() & QRegularExpression::CaseInsensitiveOption))
+{
+    // comments and white space have a meaning in extended patterns, don't bother
+    if (regExp.patternOptions() & QRegularExpression::ExtendedPatternSyntaxOption) {
+        return;
+    }
+
+    if (!extractLiterals(regExp.pattern())) {
+        m_literals.clear();
+        return;
+    }
+
+    for (const QString &literal : qAsConst(m_literals)) {
+        if (literal.size() > m_needle.size()) {
+            m_needle = literal.toLatin1();
+        }
+    }
+    if (m_needle.isEmpty()) {
+        return;
+    }
+
+    if (!m_caseSensitive) {
+        m_needle = m_needle.toLower();
+    }
+    for (int i = 1; i < m_needle.size(); ++i) {
+        if (anchorCost(m_needle.at(i)) < anchorCost(m_needle.at(m_anchorOffset))) {
+            m_anchorOffset = i;
+        }
+    }
+    m_anchorLower = m_needle.at(m_anchorOffset);
+    m_anchorUpper = m_caseSensitive ? m_anchorLower : asciiUpper(m_anchorLower);
+}
+
+bool LiteralPrefilter::extractLiterals(const QString &pattern)
+{
+    // escapes that match something, but don't consume any following characters
+    static const QString simpleEscapes = QStringLiteral("bBdDwWsShHvVnrtfeaAzZGRXK");
+
+    QString run;
+    int i = 0;
+    while (i < pattern.size()) {
+        const QChar c = pattern.at(i);
+        switch (c.unicode()) {
+        case '\\': {
+            if (i + 1 >= pattern.size()) {
+                return false;
+            }
+            const QChar escaped = pattern.at(i + 1);
+            i += 2;
+            if (escaped.unicode() < 128 && escaped.isLetterOrNumber()) {
+                if (!simpleEscapes.contains(escaped)) {
+                    return false;
+                }
+                endRun(run);
+            } else {
+                appendChar(run, escaped);
+            }
+            break;
+        }
+        case '[':
+            if (!skipClass(pattern, i)) {
+                return false;
+            }
+            endRun(run);
+            break;
+        case '(':
+            if (!skipGroup(pattern, i)) {
+                return false;
+            }
+            endRun(run);
+            break;
+        case ')':
+        case '|':
+            // top level alternatives make every literal optional
+            return false;
+        case '?':
+        case '*':
+            // the previous character is optional
+            run.chop(1);
+            endRun(run);
+            ++i;
+            break;
+        case '+':
+            // the previous character is required, but might repeat
+            endRun(run);
+            ++i;
+            break;
+        case '{': {
+            int end = i + 1;
+            while (end < pattern.size() && (pattern.at(end).isDigit() || pattern.at(end) == QLatin1Char(','))) {
+                ++end;
+            }
+            if (end > i + 1 && end < pattern.size() && pattern.at(end) == QLatin1Char('}')) {
+                run.chop(1);
+                endRun(run);
+                i = end + 1;
+            } else {
+                // not a quantifier, just a brace
+                appendChar(run, c);
+                ++i;
+            }
+            break;
+        }
+        case '.':
+        case '^':
+        case '$':
+            endRun(run);
+            ++i;
+            break;
+        default:
+            appendChar(run, c);
+            ++i;
+            break;
+        }
+    }
+    endRun(run);
+    return true;
+}
+
+bool LiteralPrefilter::skipClass(const QString &pattern, int &pos) const
+{
+    int i = pos + 1;
+    if (i < pattern.size() && pattern.at(i) == QLatin1Char('^')) {
+        ++i;
+    }
+    if (i < pattern.size() && pattern.at(i) == QLatin1Char(']')) {
+        ++i;
+    }
+    while (i < pattern.size()) {
+        const QChar c = pattern.at(i);
+        if (c == QLatin1Char('\\')) {
+            if (i + 1 < pattern.size() && (pattern.at(i + 1) == QLatin1Char('Q') || pattern.at(i + 1) == QLatin1Char('E'))) {
+                return false;
+            }
+            i += 2;
+        } else if (c == QLatin1Char('[')) {
+            // POSIX classes like [:alpha:], not worth the trouble
+            return false;
+        } else if (c == QLatin1Char(']')) {
+            pos = i + 1;
+            return true;
+        } else {
+            ++i;
+        }
+    }
+    return false;
+}
+
+bool LiteralPrefilter::skipGroup(const QString &pattern, int &pos) const
+{
+    int i = pos + 1;
+    if (i + 1 < pattern.size() && pattern.at(i) == QLatin1Char('?')) {
+        // inline options like (?i) change the meaning of the rest of the pattern
+        const QChar c = pattern.at(i + 1);
+        if ((c.isLetter() && c != QLatin1Char('P')) || c == QLatin1Char('-') || c == QLatin1Char('^')) {
+            return false;
+        }
+    }
+
+    int depth = 1;
+    while (i < pattern.size()) {
+        const QChar c = pattern.at(i);
+        if (c == QLatin1Char('\\')) {
+            if (i + 1 < pattern.size() && pattern.at(i + 1) == QLatin1Char('Q')) {
+                return false;
+            }
+            i += 2;
+        } else if (c == QLatin1Char('[')) {
+            if (!skipClass(pattern, i)) {
+                return false;
+            }
+        } else if (c == QLatin1Char('(')) {
+            ++depth;
+            ++i;
+        } else if (c == QLatin1Char(')')) {
+            if (--depth == 0) {
+                pos = i + 1;
+                return true;
+            }
+            ++i;
+        } else {
+            ++i;
+        }
+    }
+    return false;
+}
+
+void LiteralPrefilter::appendChar(QString &run, QChar c) const
+{
+    // Only ASCII is searched in the raw bytes. Case insensitive matching also folds
+    // the Kelvin sign to 'k' and the long s to 's', so these can't be searched bytewise.
+    const ushort u = c.unicode();
+    if (u >= 128 || (!m_caseSensitive && (u == 'k' || u == 'K' || u == 's' || u == 'S'))) {
+        endRun(run);
+        return;
+    }
+    run += c;
+}
+
+void LiteralPrefilter::endRun(QString &run)
+{
+    if (!run.isEmpty()) {
+        m_literals << run;
+        run.clear();
+    }
+}
+
+bool LiteralPrefilter::matchesAt(const char *data) const
+{
+    if (m_caseSensitive) {
+        return memcmp(data, m_needle.constData(), m_needle.size()) == 0;
+    }
+    for (int i = 0; i < m_needle.size(); ++i) {
+        if (asciiLower(data[i]) != m_needle.at(i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+qint64 LiteralPrefilter::find(const char *data, qint64 size, qint64 from) const
+{
+    if (m_needle.isEmpty() || size - from < m_needle.size()) {
+        return -1;
+    }
+
+    // the anchor can only be found in this range if the needle fits around it
+    const char *p = data + from + m_anchorOffset;
+    const char *end = data + size - m_needle.size() + m_anchorOffset + 1;
+
+    // for case insensitive searches both variants are looked for, remember the
+    // next position of each so neither range is scanned twice
+    const char *nextLower = nullptr;
+    const char *nextUpper = m_anchorLower == m_anchorUpper ? end : nullptr;
+
+    while (p < end) {
+        if (!nextLower || nextLower < p) {
+            nextLower = static_cast<const char *>(memchr(p, m_anchorLower, end - p));
+            if (!nextLower) {
+                nextLower = end;
+            }
+        }
+        if (!nextUpper || nextUpper < p) {
+            nextUpper = static_cast<const char *>(memchr(p, m_anchorUpper, end - p));
+            if (!nextUpper) {
+                nextUpper = end;
+            }
+        }
+
+        const char *hit = qMin(nextLower, nextUpper);
+        if (hit == end) {
+            return -1;
+        }
+        if (matchesAt(hit - m_anchorOffset)) {
+            return (hit - m_anchorOffset) - data;
+        }
+        p = hit + 1;
+    }
+    return -1;
+}
@@ -0,0 +1,95 @@
+/*   Kate search plugin
+ *
+ * Copyright (C) 2020 by Kate Developers <kwrite-devel@kde.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program in a file called COPYING; if not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#ifndef LiteralPrefilter_h
+#define LiteralPrefilter_h
+
+#include <QByteArray>
+#include <QRegularExpression>
+#include <QStringList>
+
+/**
+ * Byte level prefilter for a regular expression.
+ *
+ * The constructor collects the ASCII strings every match of the expression has
+ * to contain. The extraction is conservative: if the pattern contains anything
+ * that is not understood (top level alternatives, inline options, unusual
+ * escapes, ...) no literal is extracted and the prefilter can not be used.
+ *
+ * find() looks for the longest of these literals in raw file data, so text that
+ * can not contain a match never needs to be decoded or run through the regular
+ * expression.
+ */
+class LiteralPrefilter
+{
+public:
+    explicit LiteralPrefilter(const QRegularExpression &regExp);
+
+    /**
+     * @return true if no required literal could be determined
+     */
+    bool isEmpty() const
+    {
+        return m_needle.isEmpty();
+    }
+
+    /**
+     * @return all strings every match has to contain, in pattern order
+     */
+    const QStringList &literals() const
+    {
+        return m_literals;
+    }
+
+    bool caseSensitive() const
+    {
+        return m_caseSensitive;
+    }
+
+    /**
+     * Searches the longest required literal in ASCII compatible data.
+     * @param data the data to search
+     * @param size size of data in bytes
+     * @param from offset to start searching at
+     * @return offset of the next occurrence at or after from, -1 if there is none
+     */
+    qint64 find(const char *data, qint64 size, qint64 from) const;
+
+private:
+    bool extractLiterals(const QString &pattern);
+    bool skipClass(const QString &pattern, int &pos) const;
+    bool skipGroup(const QString &pattern, int &pos) const;
+    void appendChar(QString &run, QChar c) const;
+    void endRun(QString &run);
+    bool matchesAt(const char *data) const;
+
+private:
+    QStringList m_literals;
+    bool m_caseSensitive = true;
+
+    /** longest literal, lower case for case insensitive searches */
+    QByteArray m_needle;
+    /** the needle character that is searched with memchr */
+    int m_anchorOffset = 0;
+    char m_anchorLower = 0;
+    char m_anchorUpper = 0;
+};
+
+#endif
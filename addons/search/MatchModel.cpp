@@ -0,0 +1,567 @@
+/*   Kate search plugin
+ *
+ * Copyright (C) 2020 by Kate Developers <kwrite-devel@kde.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program in a file called COPYING; if not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#include "MatchModel.h"
+
+#include "replace_matches.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QUrl>
+#include <klocalizedstring.h>
+
+#include <algorithm>
+#include <limits>
+
+static const int contextLen = 70;
+
+// internal ids: matches store the row of their file, so these can't collide with a row
+static const quintptr RootItemId = std::numeric_limits<quintptr>::max();
+static const quintptr FileItemId = RootItemId - 1;
+
+static bool lessThanFile(const QString &url, const QString &otherUrl)
+{
+    const int sepCount = url.count(QDir::separator());
+    const int oSepCount = otherUrl.count(QDir::separator());
+    if (sepCount != oSepCount) {
+        return sepCount < oSepCount;
+    }
+    return url.toLower() < otherUrl.toLower();
+}
+
+MatchModel::MatchModel(QObject *parent)
+    : QAbstractItemModel(parent)
+{
+}
+
+void MatchModel::clear()
+{
+    beginResetModel();
+    m_hasRoot = false;
+    m_flat = false;
+    m_infoText.clear();
+    m_files.clear();
+    m_fileRows.clear();
+    m_contextBuffer.clear();
+    m_matchCount = 0;
+    m_checkedCount = 0;
+    m_uncheckedCount = 0;
+    endResetModel();
+}
+
+void MatchModel::addRootItem()
+{
+    if (m_hasRoot) {
+        return;
+    }
+    beginInsertRows(QModelIndex(), 0, 0);
+    m_hasRoot = true;
+    endInsertRows();
+}
+
+void MatchModel::addFlatRootItem(const QString &url, const QString &docName)
+{
+    clear();
+
+    beginInsertRows(QModelIndex(), 0, 0);
+    m_hasRoot = true;
+    m_flat = true;
+    MatchFile file;
+    file.url = url;
+    file.docName = docName;
+    m_files.append(file);
+    m_fileRows.insert(fileKey(url, docName), 0);
+    endInsertRows();
+}
+
+void MatchModel::setBaseSearchPath(const QString &baseDir)
+{
+    m_baseSearchPath = baseDir;
+}
+
+void MatchModel::setInfoText(const QString &text)
+{
+    if (!m_hasRoot || text == m_infoText) {
+        return;
+    }
+    m_infoText = text;
+    const QModelIndex root = rootIndex();
+    emit dataChanged(root, root, {Qt::DisplayRole});
+}
+
+QString MatchModel::fileKey(const QString &url, const QString &docName)
+{
+    return url + QLatin1Char('\n') + docName;
+}
+
+int MatchModel::findFile(const QString &url, const QString &docName) const
+{
+    return m_fileRows.value(fileKey(url, docName), -1);
+}
+
+void MatchModel::addMatches(const QString &url, const QString &docName, const QVector<KateSearchMatch> &searchMatches)
+{
+    if (searchMatches.isEmpty()) {
+        return;
+    }
+    addRootItem();
+
+    // search-as-you-type shows only one document, whatever it is called
+    int fileRow = m_flat ? 0 : findFile(url, docName);
+    if (fileRow == -1) {
+        MatchFile file;
+        file.url = url;
+        file.docName = docName;
+
+        QUrl fullUrl = QUrl::fromUserInput(url);
+        if (fullUrl.isLocalFile()) {
+            file.path = QFileInfo(fullUrl.toLocalFile()).dir().absolutePath();
+        } else {
+            file.path = fullUrl.url();
+        }
+        if (!file.path.isEmpty() && !file.path.endsWith(QLatin1Char('/'))) {
+            file.path += QLatin1Char('/');
+        }
+        file.path.remove(m_baseSearchPath);
+        file.name = url.isEmpty() ? docName : fullUrl.fileName();
+
+        fileRow = m_files.size();
+        beginInsertRows(rootIndex(), fileRow, fileRow);
+        m_files.append(file);
+        m_fileRows.insert(fileKey(url, docName), fileRow);
+        endInsertRows();
+    }
+
+    MatchFile &file = m_files[fileRow];
+    const int first = file.matches.size();
+    const QModelIndex parentIndex = m_flat ? rootIndex() : fileIndex(fileRow);
+
+    beginInsertRows(parentIndex, first, first + searchMatches.size() - 1);
+    file.matches.reserve(first + searchMatches.size());
+    for (const KateSearchMatch &searchMatch : searchMatches) {
+        const QString &lineContent = searchMatch.lineContent;
+        int preLen = contextLen;
+        int preStart = searchMatch.startColumn - preLen;
+        if (preStart < 0) {
+            preLen += preStart;
+            preStart = 0;
+        }
+        const QStringRef pre = lineContent.midRef(preStart, preLen);
+        const QStringRef matchText = lineContent.midRef(searchMatch.startColumn, searchMatch.matchLen);
+        const QStringRef post = lineContent.midRef(searchMatch.startColumn + searchMatch.matchLen, contextLen);
+
+        Match match;
+        match.range = KTextEditor::Range(searchMatch.startLine, searchMatch.startColumn, searchMatch.endLine, searchMatch.endColumn);
+        match.matchLen = searchMatch.matchLen;
+        match.contextStart = m_contextBuffer.size();
+        match.preLen = pre.size();
+        match.matchTextLen = matchText.size();
+        match.postLen = post.size();
+        match.checkState = Qt::Checked;
+        match.replaced = false;
+        m_contextBuffer.append(pre);
+        m_contextBuffer.append(matchText);
+        m_contextBuffer.append(post);
+        file.matches.append(match);
+    }
+    file.checkedCount += searchMatches.size();
+    m_checkedCount += searchMatches.size();
+    m_matchCount += searchMatches.size();
+    endInsertRows();
+
+    // the match count of the file and the check states might have changed
+    if (!m_flat) {
+        const QModelIndex index = fileIndex(fileRow);
+        emit dataChanged(index, index, {Qt::DisplayRole, Qt::CheckStateRole});
+    }
+    const QModelIndex root = rootIndex();
+    emit dataChanged(root, root, {Qt::CheckStateRole});
+}
+
+void MatchModel::sortResults()
+{
+    beginResetModel();
+    if (!m_flat) {
+        std::stable_sort(m_files.begin(), m_files.end(), [](const MatchFile &left, const MatchFile &right) {
+            return lessThanFile(left.url, right.url);
+        });
+        m_fileRows.clear();
+        for (int i = 0; i < m_files.size(); ++i) {
+            m_fileRows.insert(fileKey(m_files.at(i).url, m_files.at(i).docName), i);
+        }
+    }
+    for (MatchFile &file : m_files) {
+        std::stable_sort(file.matches.begin(), file.matches.end(), [](const Match &left, const Match &right) {
+            return left.range.start() < right.range.start();
+        });
+    }
+    endResetModel();
+}
+
+QString MatchModel::fileUrl(int fileRow) const
+{
+    return m_files.at(fileRow).url;
+}
+
+QString MatchModel::fileName(int fileRow) const
+{
+    return m_files.at(fileRow).docName;
+}
+
+Qt::CheckState MatchModel::fileCheckState(int fileRow) const
+{
+    const MatchFile &file = m_files.at(fileRow);
+    return checkState(file.checkedCount, file.uncheckedCount, file.matches.size());
+}
+
+const QVector<MatchModel::Match> &MatchModel::fileMatches(int fileRow) const
+{
+    return m_files.at(fileRow).matches;
+}
+
+Qt::CheckState MatchModel::checkState(int checked, int unchecked, int count)
+{
+    if (checked == count) {
+        return Qt::Checked;
+    }
+    if (unchecked == count) {
+        return Qt::Unchecked;
+    }
+    return Qt::PartiallyChecked;
+}
+
+QModelIndex MatchModel::rootIndex() const
+{
+    if (!m_hasRoot) {
+        return QModelIndex();
+    }
+    return createIndex(0, 0, RootItemId);
+}
+
+QModelIndex MatchModel::fileIndex(int fileRow) const
+{
+    if (m_flat) {
+        return rootIndex();
+    }
+    return createIndex(fileRow, 0, FileItemId);
+}
+
+QModelIndex MatchModel::matchIndex(int fileRow, int matchRow) const
+{
+    return createIndex(matchRow, 0, quintptr(fileRow));
+}
+
+bool MatchModel::isMatch(const QModelIndex &index) const
+{
+    return index.isValid() && index.internalId() != RootItemId && index.internalId() != FileItemId;
+}
+
+int MatchModel::fileRow(const QModelIndex &index) const
+{
+    if (!index.isValid()) {
+        return -1;
+    }
+    if (index.internalId() == RootItemId) {
+        return m_flat && !m_files.isEmpty() ? 0 : -1;
+    }
+    if (index.internalId() == FileItemId) {
+        return index.row();
+    }
+    return int(index.internalId());
+}
+
+void MatchModel::changeMatchCheckState(MatchFile &file, Match &match, Qt::CheckState state)
+{
+    if (match.checkState == state) {
+        return;
+    }
+    if (match.checkState == Qt::Checked) {
+        file.checkedCount--;
+        m_checkedCount--;
+    } else if (match.checkState == Qt::Unchecked) {
+        file.uncheckedCount--;
+        m_uncheckedCount--;
+    }
+    match.checkState = state;
+    if (state == Qt::Checked) {
+        file.checkedCount++;
+        m_checkedCount++;
+    } else if (state == Qt::Unchecked) {
+        file.uncheckedCount++;
+        m_uncheckedCount++;
+    }
+}
+
+void MatchModel::checkStateChanged(int fileRow, int firstMatch, int lastMatch)
+{
+    const QVector<int> roles{Qt::CheckStateRole};
+    if (firstMatch <= lastMatch) {
+        emit dataChanged(matchIndex(fileRow, firstMatch), matchIndex(fileRow, lastMatch), roles);
+    }
+    const QModelIndex file = fileIndex(fileRow);
+    emit dataChanged(file, file, roles);
+    if (!m_flat) {
+        const QModelIndex root = rootIndex();
+        emit dataChanged(root, root, roles);
+    }
+}
+
+void MatchModel::setMatchCheckState(int fileRow, int matchRow, Qt::CheckState state)
+{
+    MatchFile &file = m_files[fileRow];
+    changeMatchCheckState(file, file.matches[matchRow], state);
+    checkStateChanged(fileRow, matchRow, matchRow);
+}
+
+void MatchModel::setMatchRange(int fileRow, int matchRow, const KTextEditor::Range &range)
+{
+    Match &match = m_files[fileRow].matches[matchRow];
+    if (match.range == range) {
+        return;
+    }
+    match.range = range;
+    const QModelIndex index = matchIndex(fileRow, matchRow);
+    emit dataChanged(index, index);
+}
+
+void MatchModel::setMatchReplaced(int fileRow, int matchRow, const KTextEditor::Range &range, const QString &replaceText)
+{
+    Match &match = m_files[fileRow].matches[matchRow];
+    match.range = range;
+    match.replaced = true;
+    match.replaceText = replaceText;
+    const QModelIndex index = matchIndex(fileRow, matchRow);
+    emit dataChanged(index, index);
+}
+
+QModelIndex MatchModel::index(int row, int column, const QModelIndex &parent) const
+{
+    if (column != 0 || row < 0 || row >= rowCount(parent)) {
+        return QModelIndex();
+    }
+    if (!parent.isValid()) {
+        return rootIndex();
+    }
+    if (parent.internalId() == RootItemId) {
+        return m_flat ? matchIndex(0, row) : createIndex(row, 0, FileItemId);
+    }
+    if (parent.internalId() == FileItemId) {
+        return matchIndex(parent.row(), row);
+    }
+    return QModelIndex();
+}
+
+QModelIndex MatchModel::parent(const QModelIndex &child) const
+{
+    if (!child.isValid() || child.internalId() == RootItemId) {
+        return QModelIndex();
+    }
+    if (child.internalId() == FileItemId) {
+        return rootIndex();
+    }
+    return fileIndex(int(child.internalId()));
+}
+
+int MatchModel::rowCount(const QModelIndex &parent) const
+{
+    if (!parent.isValid()) {
+        return m_hasRoot ? 1 : 0;
+    }
+    if (parent.internalId() == RootItemId) {
+        if (m_flat) {
+            return m_files.isEmpty() ? 0 : m_files.at(0).matches.size();
+        }
+        return m_files.size();
+    }
+    if (parent.internalId() == FileItemId) {
+        return m_files.at(parent.row()).matches.size();
+    }
+    return 0;
+}
+
+int MatchModel::columnCount(const QModelIndex &) const
+{
+    return 1;
+}
+
+QVariant MatchModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid()) {
+        return QVariant();
+    }
+
+    if (index.internalId() == RootItemId) {
+        if (role == Qt::DisplayRole) {
+            return m_infoText;
+        }
+        if (role == Qt::CheckStateRole) {
+            return checkState(m_checkedCount, m_uncheckedCount, m_matchCount);
+        }
+        // search-as-you-type: the root is the file item too
+        if (m_flat && !m_files.isEmpty()) {
+            return fileData(0, role);
+        }
+        return QVariant();
+    }
+
+    if (index.internalId() == FileItemId) {
+        return fileData(index.row(), role);
+    }
+
+    const MatchFile &file = m_files.at(int(index.internalId()));
+    return matchData(file, file.matches.at(index.row()), role);
+}
+
+QVariant MatchModel::fileData(int fileRow, int role) const
+{
+    const MatchFile &file = m_files.at(fileRow);
+    switch (role) {
+    case Qt::DisplayRole:
+        return QStringLiteral("%1<b>%2</b>: <b>%3</b>").arg(file.path, file.name).arg(file.matches.size());
+    case Qt::CheckStateRole:
+        return checkState(file.checkedCount, file.uncheckedCount, file.matches.size());
+    case ReplaceMatches::FileUrlRole:
+        return file.url;
+    case ReplaceMatches::FileNameRole:
+        return file.docName;
+    default:
+        return QVariant();
+    }
+}
+
+QVariant MatchModel::matchData(const MatchFile &file, const Match &match, int role) const
+{
+    switch (role) {
+    case Qt::DisplayRole:
+    case ReplaceMatches::PreMatchRole:
+    case ReplaceMatches::MatchRole:
+    case ReplaceMatches::PostMatchRole:
+        break;
+    case Qt::CheckStateRole:
+        return match.checkState;
+    case Qt::ToolTipRole:
+    case ReplaceMatches::FileUrlRole:
+        return file.url;
+    case ReplaceMatches::FileNameRole:
+        return file.docName;
+    case ReplaceMatches::StartLineRole:
+        return match.range.start().line();
+    case ReplaceMatches::StartColumnRole:
+        return match.range.start().column();
+    case ReplaceMatches::EndLineRole:
+        return match.range.end().line();
+    case ReplaceMatches::EndColumnRole:
+        return match.range.end().column();
+    case ReplaceMatches::MatchLenRole:
+        return match.matchLen;
+    case ReplaceMatches::ReplacedRole:
+        return match.replaced;
+    case ReplaceMatches::ReplacedTextRole:
+        return match.replaceText;
+    default:
+        return QVariant();
+    }
+
+    // the html is only created when needed
+    QString pre;
+    if (match.preLen == contextLen) {
+        pre = QStringLiteral("...");
+    }
+    pre += m_contextBuffer.mid(match.contextStart, match.preLen).toHtmlEscaped();
+    if (role == ReplaceMatches::PreMatchRole) {
+        return pre;
+    }
+
+    QString matchText = m_contextBuffer.mid(match.contextStart + match.preLen, match.matchTextLen).toHtmlEscaped();
+    matchText.replace(QLatin1Char('\n'), QStringLiteral("\\n"));
+    if (role == ReplaceMatches::MatchRole) {
+        return matchText;
+    }
+
+    QString post = m_contextBuffer.mid(match.contextStart + match.preLen + match.matchTextLen, match.postLen);
+    if (match.postLen >= contextLen) {
+        post += QStringLiteral("...");
+    }
+    post = post.toHtmlEscaped();
+    if (role == ReplaceMatches::PostMatchRole) {
+        return post;
+    }
+
+    if (match.replaced) {
+        QString replaceText = match.replaceText;
+        replaceText.replace(QLatin1Char('\n'), QStringLiteral("\\n"));
+        replaceText.replace(QLatin1Char('\t'), QStringLiteral("\\t"));
+        QString html = pre;
+        html += QLatin1String("<i><s>") + matchText + QLatin1String("</s></i> ");
+        html += QLatin1String("<b>") + replaceText + QLatin1String("</b>");
+        html += post;
+        return i18n("Line: <b>%1</b>: %2", match.range.start().line() + 1, html);
+    }
+
+    return i18n("Line: <b>%1</b> Column: <b>%2</b>: %3", match.range.start().line() + 1, match.range.start().column() + 1, pre + QStringLiteral("<b>") + matchText + QStringLiteral("</b>") + post);
+}
+
+bool MatchModel::setData(const QModelIndex &index, const QVariant &value, int role)
+{
+    if (!index.isValid() || role != Qt::CheckStateRole) {
+        return false;
+    }
+
+    // only matches can be partially checked, for files and the root this means "all"
+    Qt::CheckState state = static_cast<Qt::CheckState>(value.toInt());
+    if (index.internalId() == RootItemId) {
+        if (state == Qt::PartiallyChecked) {
+            state = Qt::Checked;
+        }
+        for (int fileRow = 0; fileRow < m_files.size(); ++fileRow) {
+            MatchFile &file = m_files[fileRow];
+            for (Match &match : file.matches) {
+                changeMatchCheckState(file, match, state);
+            }
+            checkStateChanged(fileRow, 0, file.matches.size() - 1);
+        }
+        const QModelIndex root = rootIndex();
+        emit dataChanged(root, root, {Qt::CheckStateRole});
+        return true;
+    }
+
+    if (index.internalId() == FileItemId) {
+        if (state == Qt::PartiallyChecked) {
+            state = Qt::Checked;
+        }
+        MatchFile &file = m_files[index.row()];
+        for (Match &match : file.matches) {
+            changeMatchCheckState(file, match, state);
+        }
+        checkStateChanged(index.row(), 0, file.matches.size() - 1);
+        return true;
+    }
+
+    setMatchCheckState(int(index.internalId()), index.row(), state);
+    return true;
+}
+
+Qt::ItemFlags MatchModel::flags(const QModelIndex &index) const
+{
+    if (!index.isValid()) {
+        return Qt::NoItemFlags;
+    }
+    return Qt::ItemIsEnabled | Qt::ItemIsSelectable | Qt::ItemIsUserCheckable;
+}
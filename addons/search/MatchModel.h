@@ -0,0 +1,170 @@
+/*   Kate search plugin
+ *
+ * Copyright (C) 2020 by Kate Developers <kwrite-devel@kde.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program in a file called COPYING; if not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#ifndef MatchModel_h
+#define MatchModel_h
+
+#include <QAbstractItemModel>
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+#include <ktexteditor/range.h>
+
+#include "KateSearchMatch.h"
+
+/**
+ * Model holding the results of one search.
+ *
+ * The tree has one root item with the summary text. Its children are the
+ * files and their children the matches. For search-as-you-type the model
+ * is flat: the matches of the one searched document are direct children
+ * of the root item.
+ *
+ * Matches are stored compactly. The context text around a match lives in
+ * one buffer shared by all matches, and the html shown in the view is only
+ * created when data() is asked for it. The data roles are the ones from
+ * ReplaceMatches::MatchData.
+ */
+class MatchModel : public QAbstractItemModel
+{
+    Q_OBJECT
+
+public:
+    struct Match {
+        KTextEditor::Range range;
+        int matchLen;
+        /** context shown around the match, as offset into m_contextBuffer */
+        int contextStart;
+        int preLen;
+        int matchTextLen;
+        int postLen;
+        Qt::CheckState checkState;
+        bool replaced;
+        QString replaceText;
+    };
+
+    explicit MatchModel(QObject *parent = nullptr);
+
+    /**
+     * Removes all results including the root item.
+     */
+    void clear();
+
+    /**
+     * Adds the root item, files will be shown as its children.
+     */
+    void addRootItem();
+
+    /**
+     * Adds the root item for search-as-you-type, the matches of this document will be shown
+     * directly under the root item.
+     */
+    void addFlatRootItem(const QString &url, const QString &docName);
+
+    /**
+     * Directory that is left out of the file names shown.
+     */
+    void setBaseSearchPath(const QString &baseDir);
+
+    void setInfoText(const QString &text);
+    QString infoText() const
+    {
+        return m_infoText;
+    }
+
+    void addMatches(const QString &url, const QString &docName, const QVector<KateSearchMatch> &searchMatches);
+
+    /**
+     * Sorts the files by path depth and name, the matches by position.
+     */
+    void sortResults();
+
+    int fileCount() const
+    {
+        return m_files.size();
+    }
+    /** @return the row of the file in the file table or -1 */
+    int findFile(const QString &url, const QString &docName) const;
+    QString fileUrl(int fileRow) const;
+    QString fileName(int fileRow) const;
+    Qt::CheckState fileCheckState(int fileRow) const;
+    const QVector<Match> &fileMatches(int fileRow) const;
+
+    int checkedMatchCount() const
+    {
+        return m_checkedCount;
+    }
+
+    QModelIndex rootIndex() const;
+    QModelIndex matchIndex(int fileRow, int matchRow) const;
+    bool isMatch(const QModelIndex &index) const;
+    /** @return the file table row of a file or match index, -1 for the root */
+    int fileRow(const QModelIndex &index) const;
+
+    void setMatchCheckState(int fileRow, int matchRow, Qt::CheckState state);
+    void setMatchRange(int fileRow, int matchRow, const KTextEditor::Range &range);
+    void setMatchReplaced(int fileRow, int matchRow, const KTextEditor::Range &range, const QString &replaceText);
+
+    QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const override;
+    QModelIndex parent(const QModelIndex &child) const override;
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    bool setData(const QModelIndex &index, const QVariant &value, int role = Qt::EditRole) override;
+    Qt::ItemFlags flags(const QModelIndex &index) const override;
+
+private:
+    struct MatchFile {
+        QString url;
+        QString docName;
+        /** directory part shown in front of the file name */
+        QString path;
+        QString name;
+        QVector<Match> matches;
+        int checkedCount = 0;
+        int uncheckedCount = 0;
+    };
+
+    QModelIndex fileIndex(int fileRow) const;
+    QVariant fileData(int fileRow, int role) const;
+    QVariant matchData(const MatchFile &file, const Match &match, int role) const;
+    void changeMatchCheckState(MatchFile &file, Match &match, Qt::CheckState state);
+    void checkStateChanged(int fileRow, int firstMatch, int lastMatch);
+
+    static Qt::CheckState checkState(int checked, int unchecked, int count);
+    static QString fileKey(const QString &url, const QString &docName);
+
+    bool m_hasRoot = false;
+    bool m_flat = false;
+    QString m_infoText;
+    QString m_baseSearchPath;
+
+    QVector<MatchFile> m_files;
+    /** file key -> row in m_files */
+    QHash<QString, int> m_fileRows;
+    QString m_contextBuffer;
+
+    int m_matchCount = 0;
+    int m_checkedCount = 0;
+    int m_uncheckedCount = 0;
+};
+
+#endif
@@ -0,0 +1,100 @@
+/*   Kate search plugin
+ *
+ * Copyright (C) 2020 by Kate Developers <kwrite-devel@kde.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program in a file called COPYING; if not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#include "MultiLineText.h"
+
+#include <algorithm>
+
+void MultiLineText::clear()
+{
+    m_text.clear();
+    m_lineStarts.clear();
+}
+
+void MultiLineText::appendLine(const QString &line)
+{
+    if (!m_lineStarts.isEmpty()) {
+        m_text += QLatin1Char('\n');
+    }
+    m_lineStarts << m_text.size();
+    m_text += line;
+}
+
+void MultiLineText::setText(QString &&text)
+{
+    m_text = std::move(text);
+    m_lineStarts.clear();
+    m_lineStarts << 0;
+
+    // one pass: drop the '\r' and note where the lines start
+    QChar *data = m_text.data();
+    const int size = m_text.size();
+    int out = 0;
+    for (int in = 0; in < size; ++in) {
+        const QChar c = data[in];
+        if (c == QLatin1Char('\r')) {
+            continue;
+        }
+        data[out++] = c;
+        if (c == QLatin1Char('\n') && in + 1 < size) {
+            m_lineStarts << out;
+        }
+    }
+    m_text.truncate(out);
+}
+
+void MultiLineText::appendFinalNewLine(const QRegularExpression &regExp)
+{
+    if (regExp.pattern().endsWith(QLatin1Char('$'))) {
+        m_text += QLatin1Char('\n');
+    }
+}
+
+int MultiLineText::lineAt(int offset, int fromLine) const
+{
+    auto it = std::upper_bound(m_lineStarts.constBegin() + fromLine, m_lineStarts.constEnd(), offset);
+    return int(it - m_lineStarts.constBegin()) - 1;
+}
+
+KateSearchMatch MultiLineText::toSearchMatch(const QRegularExpressionMatch &match, int &lineHint) const
+{
+    const int start = match.capturedStart();
+    const int length = match.capturedLength();
+    const int line = lineAt(start, lineHint);
+    lineHint = line;
+
+    const int startColumn = start - m_lineStarts.at(line);
+    const QStringRef matchText = m_text.midRef(start, length);
+    const int lastNL = matchText.lastIndexOf(QLatin1Char('\n'));
+    const int endLine = line + matchText.count(QLatin1Char('\n'));
+    const int endColumn = lastNL == -1 ? startColumn + length : length - lastNL - 1;
+
+    return {m_text.mid(m_lineStarts.at(line), startColumn + length), length, line, startColumn, endLine, endColumn};
+}
+
+QRegularExpression MultiLineText::regExp(const QRegularExpression &regExp)
+{
+    if (!regExp.pattern().endsWith(QLatin1Char('$'))) {
+        return regExp;
+    }
+    QString pattern = regExp.pattern();
+    pattern.replace(QStringLiteral("$"), QStringLiteral("(?=\\n)"));
+    return QRegularExpression(pattern, regExp.patternOptions());
+}
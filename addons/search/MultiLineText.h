@@ -0,0 +1,93 @@
+/*   Kate search plugin
+ *
+ * Copyright (C) 2020 by Kate Developers <kwrite-devel@kde.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program in a file called COPYING; if not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#ifndef MultiLineText_h
+#define MultiLineText_h
+
+#include <QRegularExpression>
+#include <QString>
+#include <QVector>
+
+#include "KateSearchMatch.h"
+
+/**
+ * Text of a whole document for patterns matching over several lines.
+ *
+ * The lines are joined with '\n'. The start offset of every line is recorded
+ * while the text is built, so a match offset is mapped back to its line with
+ * a binary search. Matches are found in increasing order, toSearchMatch()
+ * takes the line of the previous match as hint and only searches from there.
+ */
+class MultiLineText
+{
+public:
+    void clear();
+
+    void appendLine(const QString &line);
+
+    /**
+     * Takes over decoded file content, removes the '\r' of the line ends in place.
+     */
+    void setText(QString &&text);
+
+    /**
+     * Patterns ending in '$' need a '\n' after the last line, see regExp().
+     */
+    void appendFinalNewLine(const QRegularExpression &regExp);
+
+    const QString &text() const
+    {
+        return m_text;
+    }
+
+    int lineCount() const
+    {
+        return m_lineStarts.size();
+    }
+
+    int lineStart(int line) const
+    {
+        return m_lineStarts.at(line);
+    }
+
+    /**
+     * @param offset position in text()
+     * @param fromLine a line known to start at or before offset
+     * @return the line containing offset
+     */
+    int lineAt(int offset, int fromLine = 0) const;
+
+    /**
+     * Converts a match in text() to a search result.
+     * @param lineHint line to start looking for the match line, updated to the match line
+     */
+    KateSearchMatch toSearchMatch(const QRegularExpressionMatch &match, int &lineHint) const;
+
+    /**
+     * '$' only matches at the end of the subject string, change it to match at line ends.
+     */
+    static QRegularExpression regExp(const QRegularExpression &regExp);
+
+private:
+    QString m_text;
+    QVector<int> m_lineStarts;
+};
+
+#endif
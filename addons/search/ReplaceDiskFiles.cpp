@@ -0,0 +1,250 @@
+/*   Kate search plugin
+ *
+ * Copyright (C) 2020 by Kate Developers <kwrite-devel@kde.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program in a file called COPYING; if not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#include "ReplaceDiskFiles.h"
+#include "replace_matches.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QRunnable>
+#include <QSaveFile>
+#include <QTextCodec>
+#include <QThread>
+
+class ReplaceDiskFiles::ReplaceWorker : public QRunnable
+{
+public:
+    ReplaceWorker(ReplaceDiskFiles *replacer, const FileJob &job, const QRegularExpression &regExp, const QString &replaceText)
+        : m_replacer(replacer)
+        , m_job(job)
+        // every worker uses its own regular expression object, they are not shared between threads
+        , m_regExp(regExp.pattern(), regExp.patternOptions())
+        , m_replaceText(replaceText)
+    {
+    }
+
+    void run() override
+    {
+        const FileResult result = ReplaceDiskFiles::replaceFile(m_job, m_regExp, m_replaceText, m_replacer->m_cancel);
+        ReplaceDiskFiles *replacer = m_replacer;
+        QMetaObject::invokeMethod(replacer, [replacer, result]() { replacer->fileDone(result); }, Qt::QueuedConnection);
+    }
+
+private:
+    ReplaceDiskFiles *m_replacer;
+    const FileJob m_job;
+    const QRegularExpression m_regExp;
+    const QString m_replaceText;
+};
+
+ReplaceDiskFiles::ReplaceDiskFiles(QObject *parent)
+    : QObject(parent)
+{
+    m_workerPool.setMaxThreadCount(qMax(1, QThread::idealThreadCount()));
+}
+
+ReplaceDiskFiles::~ReplaceDiskFiles()
+{
+    cancel();
+    m_workerPool.waitForDone();
+}
+
+void ReplaceDiskFiles::replaceInFile(const FileJob &job, const QRegularExpression &regExp, const QString &replaceText)
+{
+    // a new replace starts, the cancel of the last one is done
+    if (m_pendingFiles == 0) {
+        m_cancel = 0;
+    }
+    m_pendingFiles++;
+    m_workerPool.start(new ReplaceWorker(this, job, regExp, replaceText));
+}
+
+void ReplaceDiskFiles::cancel()
+{
+    m_cancel = 1;
+}
+
+void ReplaceDiskFiles::fileDone(const FileResult &result)
+{
+    m_pendingFiles--;
+    emit fileReplaced(result);
+}
+
+/**
+ * Length of the byte order mark QTextStream would skip.
+ */
+static int byteOrderMarkLength(const QByteArray &data)
+{
+    if (data.startsWith("\xEF\xBB\xBF")) {
+        return 3;
+    }
+    if (data.startsWith(QByteArray("\xFF\xFE\x00\x00", 4)) || data.startsWith(QByteArray("\x00\x00\xFE\xFF", 4))) {
+        return 4;
+    }
+    if (data.startsWith("\xFF\xFE") || data.startsWith("\xFE\xFF")) {
+        return 2;
+    }
+    return 0;
+}
+
+ReplaceDiskFiles::FileResult ReplaceDiskFiles::replaceFile(const FileJob &job, const QRegularExpression &regExp, const QString &replaceText, const QAtomicInt &cancel)
+{
+    FileResult result;
+    result.fileRow = job.fileRow;
+    result.fileName = job.fileName;
+    result.ranges = job.ranges;
+    result.replaced.fill(false, job.ranges.size());
+    result.replaceTexts.resize(job.ranges.size());
+
+    if (cancel) {
+        return result;
+    }
+
+    // the match positions are from the search, they are only valid for the file content at that time
+    const QDateTime readTime = QFileInfo(job.fileName).lastModified();
+    if (!readTime.isValid() || readTime > job.snapshotTime) {
+        return result;
+    }
+
+    QFile file(job.fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return result;
+    }
+    const QByteArray data = file.readAll();
+    file.close();
+
+    // decode like the search did, a file that doesn't decode cleanly would be damaged by writing it back
+    QTextCodec *codec = QTextCodec::codecForUtfText(data, QTextCodec::codecForLocale());
+    const int bomLength = byteOrderMarkLength(data);
+    QTextCodec::ConverterState decodeState(QTextCodec::IgnoreHeader);
+    const QString text = codec->toUnicode(data.constData() + bomLength, data.size() - bomLength, &decodeState);
+    if (decodeState.invalidChars > 0 || decodeState.remainingChars > 0) {
+        return result;
+    }
+
+    // the search results don't contain the line ends, inserted lines get the ones of the file
+    QVector<int> lineStarts{0};
+    for (int i = text.indexOf(QLatin1Char('\n')); i != -1; i = text.indexOf(QLatin1Char('\n'), i + 1)) {
+        lineStarts.append(i + 1);
+    }
+    const bool windowsLineEnds = lineStarts.size() > 1 && lineStarts.at(1) >= 2 && text.at(lineStarts.at(1) - 2) == QLatin1Char('\r');
+
+    auto offset = [&text, &lineStarts](const KTextEditor::Cursor &cursor) {
+        if (cursor.line() < 0 || cursor.line() >= lineStarts.size() || cursor.column() < 0) {
+            return -1;
+        }
+        int lineEnd = text.size();
+        if (cursor.line() + 1 < lineStarts.size()) {
+            lineEnd = lineStarts.at(cursor.line() + 1) - 1;
+            if (lineEnd > lineStarts.at(cursor.line()) && text.at(lineEnd - 1) == QLatin1Char('\r')) {
+                lineEnd--;
+            }
+        }
+        const int pos = lineStarts.at(cursor.line()) + cursor.column();
+        return pos <= lineEnd ? pos : -1;
+    };
+
+    /**
+     * Build the new text front to back. The matches after a replaced one move by
+     * the lines it added or removed, the ones on its last line also by columns.
+     */
+    QString newText;
+    newText.reserve(text.size());
+    int copied = 0;
+    int lineShift = 0;
+    int shiftedLine = -1;
+    int columnShift = 0;
+    auto shifted = [&lineShift, &shiftedLine, &columnShift](const KTextEditor::Cursor &cursor) {
+        return KTextEditor::Cursor(cursor.line() + lineShift, cursor.column() + (cursor.line() == shiftedLine ? columnShift : 0));
+    };
+
+    bool changed = false;
+    for (int i = 0; i < job.ranges.size(); ++i) {
+        const KTextEditor::Range &range = job.ranges.at(i);
+        const KTextEditor::Cursor newStart = shifted(range.start());
+        result.ranges[i] = KTextEditor::Range(newStart, shifted(range.end()));
+        if (!job.replace.value(i)) {
+            continue;
+        }
+
+        const int start = offset(range.start());
+        const int end = offset(range.end());
+        if (start < copied || end < start) {
+            continue;
+        }
+
+        // Check that the text still matches + get captures for the replace
+        QString matchText = text.mid(start, end - start);
+        matchText.replace(QLatin1String("\r\n"), QLatin1String("\n"));
+        const QRegularExpressionMatch match = regExp.match(matchText);
+        if (match.capturedStart() != 0) {
+            continue;
+        }
+
+        const QString replacement = ReplaceMatches::generateReplaceText(match, replaceText);
+        newText.append(text.midRef(copied, start - copied));
+        if (windowsLineEnds) {
+            newText.append(QString(replacement).replace(QLatin1Char('\n'), QLatin1String("\r\n")));
+        } else {
+            newText.append(replacement);
+        }
+        copied = end;
+        changed = true;
+
+        const int lastNL = replacement.lastIndexOf(QLatin1Char('\n'));
+        const KTextEditor::Cursor newEnd(newStart.line() + replacement.count(QLatin1Char('\n')),
+                                         lastNL == -1 ? newStart.column() + replacement.length() : replacement.length() - lastNL - 1);
+        lineShift = newEnd.line() - range.end().line();
+        shiftedLine = range.end().line();
+        columnShift = newEnd.column() - range.end().column();
+
+        result.ranges[i] = KTextEditor::Range(newStart, newEnd);
+        result.replaced[i] = true;
+        result.replaceTexts[i] = replacement;
+    }
+
+    FileResult unchanged = result;
+    unchanged.ranges = job.ranges;
+    unchanged.replaced.fill(false);
+    unchanged.replaceTexts.fill(QString());
+    if (!changed) {
+        return unchanged;
+    }
+    newText.append(text.midRef(copied));
+
+    QTextCodec::ConverterState encodeState(QTextCodec::IgnoreHeader);
+    const QByteArray newData = data.left(bomLength) + codec->fromUnicode(newText.constData(), newText.size(), &encodeState);
+    if (encodeState.invalidChars > 0) {
+        // the replacement can't be stored in the encoding of the file
+        return unchanged;
+    }
+
+    // written to a temporary file first, renamed over the original on commit
+    QSaveFile saveFile(job.fileName);
+    if (!saveFile.open(QIODevice::WriteOnly) || saveFile.write(newData) != newData.size()) {
+        return unchanged;
+    }
+    if (QFileInfo(job.fileName).lastModified() != readTime || !saveFile.commit()) {
+        return unchanged;
+    }
+
+    result.writtenTime = QFileInfo(job.fileName).lastModified();
+    return result;
+}
@@ -0,0 +1,119 @@
+/*   Kate search plugin
+ *
+ * Copyright (C) 2020 by Kate Developers <kwrite-devel@kde.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program in a file called COPYING; if not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#ifndef ReplaceDiskFiles_h
+#define ReplaceDiskFiles_h
+
+#include <QAtomicInt>
+#include <QDateTime>
+#include <QObject>
+#include <QRegularExpression>
+#include <QString>
+#include <QThreadPool>
+#include <QVector>
+
+#include <ktexteditor/range.h>
+
+/**
+ * Replaces matches directly in files on disk, for the files that are not open
+ * in the editor.
+ *
+ * Every file is read, changed and written by a worker of a thread pool. The
+ * file is written to a temporary file that is renamed over the original, so
+ * it is either completely replaced or not at all. The encoding, byte order
+ * mark and line endings of the file are kept.
+ *
+ * A file modified after the search was started is left alone, its match
+ * positions can't be trusted anymore. Each match is also checked to still
+ * match before it is replaced, like it is done for open documents.
+ */
+class ReplaceDiskFiles : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct FileJob {
+        int fileRow = -1;
+        QString fileName;
+        /** all matches of the file, in document order */
+        QVector<KTextEditor::Range> ranges;
+        /** the matches to replace */
+        QVector<bool> replace;
+        /** files changed later than this are not touched */
+        QDateTime snapshotTime;
+    };
+
+    struct FileResult {
+        int fileRow = -1;
+        QString fileName;
+        /** the match positions after the replace, also of the matches not replaced */
+        QVector<KTextEditor::Range> ranges;
+        QVector<bool> replaced;
+        QVector<QString> replaceTexts;
+        /** modification time of the written file, invalid if it was not written */
+        QDateTime writtenTime;
+    };
+
+    explicit ReplaceDiskFiles(QObject *parent = nullptr);
+    ~ReplaceDiskFiles() override;
+
+    /**
+     * Starts the replace in one file, fileReplaced() is emitted when it is done.
+     */
+    void replaceInFile(const FileJob &job, const QRegularExpression &regExp, const QString &replaceText);
+
+    /**
+     * Replaces the matches of one file, in the calling thread.
+     * @param job file and matches to replace
+     * @param regExp expression every match has to still match
+     * @param replaceText replacement, with the captures and escapes of the search
+     * @param cancel nothing is done once this is set
+     * @return the new match positions, writtenTime is invalid if the file was not written
+     */
+    static FileResult replaceFile(const FileJob &job, const QRegularExpression &regExp, const QString &replaceText, const QAtomicInt &cancel);
+
+    /**
+     * @return number of files not finished yet
+     */
+    int pendingFiles() const
+    {
+        return m_pendingFiles;
+    }
+
+public Q_SLOTS:
+    /**
+     * Files not started yet are skipped, fileReplaced() is still emitted for them.
+     */
+    void cancel();
+
+Q_SIGNALS:
+    void fileReplaced(const ReplaceDiskFiles::FileResult &result);
+
+private:
+    class ReplaceWorker;
+
+    void fileDone(const FileResult &result);
+
+    QThreadPool m_workerPool;
+    QAtomicInt m_cancel {0};
+    int m_pendingFiles = 0;
+};
+
+#endif
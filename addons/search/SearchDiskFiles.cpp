@@ -19,61 +19,153 @@
  */
 
 #include "SearchDiskFiles.h"
+#include "MultiLineText.h"
 
 #include <QDir>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QTextCodec>
 #include <QTextStream>
 #include <QUrl>
 
+#include <cstring>
+
+// files listed in front of the searchers, enough to keep them busy
+static const int maxQueuedFiles = 1000;
+
+class SearchDiskFiles::SearchWorker : public QRunnable
+{
+public:
+    explicit SearchWorker(SearchDiskFiles *searcher)
+        : m_searcher(searcher)
+    {
+    }
+
+    void run() override
+    {
+        m_searcher->searchFiles();
+    }
+
+private:
+    SearchDiskFiles *m_searcher;
+};
+
 SearchDiskFiles::SearchDiskFiles(QObject *parent)
     : QThread(parent)
+    , m_fileQueue(maxQueuedFiles)
 {
+    m_workerPool.setMaxThreadCount(qMax(1, QThread::idealThreadCount() - 1));
+    qRegisterMetaType<QVector<KateSearchMatch>>();
 }
 
 SearchDiskFiles::~SearchDiskFiles()
 {
-    m_cancelSearch = true;
+    cancelSearch();
     wait();
 }
 
-void SearchDiskFiles::startSearch(const QStringList &files, const QRegularExpression &regexp)
+void SearchDiskFiles::startSearch(const QStringList &files, const QRegularExpression &regexp, QObject *candidateFilter)
 {
+    // a canceled search might still be winding down and use the filter, queue and results
+    cancelSearch();
+    wait();
+
+    m_candidateFilter.reset(candidateFilter);
     if (files.empty()) {
         emit searchDone();
         return;
     }
-    m_cancelSearch = false;
     m_files = files;
+    m_queuedSearch = false;
+    beginSearch(regexp);
+}
+
+void SearchDiskFiles::startQueuedSearch(const QRegularExpression &regexp)
+{
+    // a canceled search might still be winding down and use the filter, queue and results
+    cancelSearch();
+    wait();
+
+    m_candidateFilter.reset();
+    m_files.clear();
+    m_queuedSearch = true;
+    beginSearch(regexp);
+}
+
+void SearchDiskFiles::beginSearch(const QRegularExpression &regexp)
+{
+    m_cancelSearch = false;
     m_regExp = regexp;
-    m_matchCount = 0;
+    m_fileQueue.reset();
+    m_nextResultIndex = 0;
+    m_finishedFiles.clear();
+    m_newResults.clear();
+    m_cacheHits = 0;
+    m_cacheMisses = 0;
+    if (m_resultCache) {
+        m_cacheKey = SearchResultCache::key(regexp);
+        m_cachedResults = m_resultCache->find(m_cacheKey);
+    }
     m_statusTime.restart();
     start();
 }
 
 void SearchDiskFiles::run()
 {
-    for (const QString &fileName : qAsConst(m_files)) {
-        if (m_cancelSearch) {
-            break;
-        }
-
-        if (m_statusTime.elapsed() > 100) {
-            m_statusTime.restart();
-            emit searching(fileName);
-        }
+    // this thread searches too, the pool only provides the additional workers
+    int helpers = m_workerPool.maxThreadCount();
+    if (!m_queuedSearch) {
+        filterCandidates();
+        m_fileQueue.enqueueAll(m_files);
+        m_fileQueue.close();
+        helpers = qMin(helpers, m_files.size() - 1);
+    }
+    for (int i = 0; i < helpers; ++i) {
+        m_workerPool.start(new SearchWorker(this));
+    }
+    searchFiles();
+    m_workerPool.waitForDone();
 
-        if (m_regExp.pattern().contains(QLatin1String("\\n"))) {
-            searchMultiLineRegExp(fileName);
-        } else {
-            searchSingleLineRegExp(fileName);
-        }
+    // results of a canceled search are incomplete, the files not searched would look like having no matches
+    if (m_resultCache && !m_cancelSearch) {
+        m_resultCache->insert(m_cacheKey, m_newResults, m_cacheHits.load(), m_cacheMisses.load());
     }
+    m_cachedResults.reset();
+    m_newResults.clear();
+
+    m_finishedFiles.clear();
     emit searchDone();
     m_cancelSearch = true;
 }
 
+void SearchDiskFiles::filterCandidates()
+{
+    if (!m_candidateFilter) {
+        return;
+    }
+
+    // without literal text the filter can't rule out any file
+    const LiteralPrefilter prefilter(m_regExp);
+    if (prefilter.isEmpty()) {
+        return;
+    }
+
+    QStringList candidates;
+    const bool ok = QMetaObject::invokeMethod(m_candidateFilter.data(),
+                                              "filterCandidates",
+                                              Qt::DirectConnection,
+                                              Q_RETURN_ARG(QStringList, candidates),
+                                              Q_ARG(QStringList, m_files),
+                                              Q_ARG(QStringList, prefilter.literals()));
+    if (ok) {
+        m_files = candidates;
+    }
+}
+
 void SearchDiskFiles::cancelSearch()
 {
     m_cancelSearch = true;
+    m_fileQueue.cancel();
 }
 
 bool SearchDiskFiles::searching()
@@ -81,7 +173,135 @@ bool SearchDiskFiles::searching()
     return !m_cancelSearch;
 }
 
-void SearchDiskFiles::searchSingleLineRegExp(const QString &fileName)
+void SearchDiskFiles::searchFiles()
+{
+    // every worker uses its own regular expression object, they are not shared between threads
+    const QRegularExpression regExp(m_regExp.pattern(), m_regExp.patternOptions());
+    const bool multiLine = regExp.pattern().contains(QLatin1String("\\n"));
+    const LiteralPrefilter prefilter(regExp);
+
+    FileMatches matches;
+    QString fileName;
+    int fileIndex;
+    while (!m_cancelSearch && m_fileQueue.dequeue(fileName, fileIndex)) {
+        if (!m_resultCache) {
+            searchFile(fileName, regExp, multiLine, prefilter, matches);
+            fileSearched(fileIndex, fileName, matches, SearchResultCache::Fingerprint());
+            matches.clear();
+            continue;
+        }
+
+        // taken before reading, a change while the file is searched is noticed next time
+        const SearchResultCache::Fingerprint fingerprint = SearchResultCache::fingerprint(fileName);
+        bool cached = false;
+        if (fingerprint.isValid() && m_cachedResults) {
+            auto it = m_cachedResults->constFind(fileName);
+            if (it != m_cachedResults->constEnd() && it->fingerprint == fingerprint) {
+                matches = it->matches;
+                cached = true;
+            }
+        }
+        if (cached) {
+            m_cacheHits.ref();
+        } else {
+            m_cacheMisses.ref();
+            searchFile(fileName, regExp, multiLine, prefilter, matches);
+        }
+        fileSearched(fileIndex, fileName, matches, cached ? SearchResultCache::Fingerprint() : fingerprint);
+        matches.clear();
+    }
+}
+
+void SearchDiskFiles::searchFile(const QString &fileName, const QRegularExpression &regExp, bool multiLine, const LiteralPrefilter &prefilter, FileMatches &matches)
+{
+    if (multiLine) {
+        searchMultiLineRegExp(fileName, regExp, prefilter, matches);
+    } else {
+        searchSingleLineRegExp(fileName, regExp, prefilter, matches);
+    }
+}
+
+void SearchDiskFiles::fileSearched(int fileIndex, const QString &fileName, FileMatches &matches, const SearchResultCache::Fingerprint &fingerprint)
+{
+    QMutexLocker locker(&m_resultMutex);
+
+    // files taken from the cache are already stored there
+    if (fingerprint.isValid()) {
+        m_newResults.insert(fileName, {fingerprint, matches});
+    }
+
+    if (fileIndex != m_nextResultIndex) {
+        // some file in front of this one is still being searched, keep the result for later
+        m_finishedFiles.insert(fileIndex, {fileName, matches});
+        return;
+    }
+
+    emitMatches(fileName, matches);
+    m_nextResultIndex++;
+
+    // deliver the files that were waiting for this one
+    QString lastFileName = fileName;
+    auto it = m_finishedFiles.find(m_nextResultIndex);
+    while (it != m_finishedFiles.end()) {
+        emitMatches(it->fileName, it->matches);
+        lastFileName = it->fileName;
+        m_finishedFiles.erase(it);
+        m_nextResultIndex++;
+        it = m_finishedFiles.find(m_nextResultIndex);
+    }
+
+    if (m_statusTime.elapsed() > 100) {
+        m_statusTime.restart();
+        emit searching(lastFileName);
+    }
+}
+
+void SearchDiskFiles::emitMatches(const QString &fileName, const FileMatches &matches)
+{
+    if (matches.isEmpty() || m_cancelSearch) {
+        return;
+    }
+
+    // all matches of a file are sent at once, the receiver gets one event per file and not per match
+    const QUrl fileUrl = QUrl::fromUserInput(fileName);
+    emit matchesFound(fileUrl.toString(), fileUrl.fileName(), matches);
+}
+
+/**
+ * Returns the codec QTextStream would decode the data with, if single lines can be
+ * decoded independently and ASCII is stored as plain bytes. A UTF-8 byte order mark
+ * is skipped. Returns nullptr for everything else, like UTF-16 files.
+ */
+static QTextCodec *byteScannableCodec(const char *&data, qint64 &size)
+{
+    if (size >= 2) {
+        const uchar first = uchar(data[0]);
+        const uchar second = uchar(data[1]);
+        if ((first == 0xFE && second == 0xFF) || (first == 0xFF && second == 0xFE) || (first == 0 && second == 0)) {
+            return nullptr;
+        }
+    }
+    if (size >= 3 && uchar(data[0]) == 0xEF && uchar(data[1]) == 0xBB && uchar(data[2]) == 0xBF) {
+        data += 3;
+        size -= 3;
+        return QTextCodec::codecForMib(106);
+    }
+
+    // UTF-8 and the single byte latin encodings
+    QTextCodec *codec = QTextCodec::codecForLocale();
+    switch (codec->mibEnum()) {
+    case 3:
+    case 4:
+    case 106:
+    case 111:
+    case 2252:
+        return codec;
+    default:
+        return nullptr;
+    }
+}
+
+void SearchDiskFiles::searchSingleLineRegExp(const QString &fileName, const QRegularExpression &regExp, const LiteralPrefilter &prefilter, FileMatches &matches)
 {
     QFile file(fileName);
 
@@ -89,96 +309,121 @@ void SearchDiskFiles::searchSingleLineRegExp(const QString &fileName)
         return;
     }
 
+    if (!prefilter.isEmpty() && file.size() > 0) {
+        if (uchar *mapped = file.map(0, file.size())) {
+            const bool done = searchMappedFile(reinterpret_cast<const char *>(mapped), file.size(), regExp, prefilter, matches);
+            file.unmap(mapped);
+            if (done) {
+                return;
+            }
+        }
+    }
+
     QTextStream stream(&file);
     QString line;
     int i = 0;
-    int column;
-    QRegularExpressionMatch match;
     while (!(line = stream.readLine()).isNull()) {
         if (m_cancelSearch)
             break;
-        match = m_regExp.match(line);
-        column = match.capturedStart();
-        while (column != -1 && !match.captured().isEmpty()) {
-            // limit line length
-            if (line.length() > 1024)
-                line = line.left(1024);
-            QUrl fileUrl = QUrl::fromUserInput(fileName);
-            emit matchFound(fileUrl.toString(), fileUrl.fileName(), line, match.capturedLength(), i, column, i, column + match.capturedLength());
-
-            match = m_regExp.match(line, column + match.capturedLength());
-            column = match.capturedStart();
-            m_matchCount++;
-            // NOTE: This sleep is here so that the main thread will get a chance to
-            // handle any stop button clicks if there are a lot of matches
-            if (m_matchCount % 50)
-                msleep(1);
-        }
+        searchLine(line, i, regExp, matches);
         i++;
     }
 }
 
-void SearchDiskFiles::searchMultiLineRegExp(const QString &fileName)
+bool SearchDiskFiles::searchMappedFile(const char *data, qint64 size, const QRegularExpression &regExp, const LiteralPrefilter &prefilter, FileMatches &matches)
 {
-    QFile file(fileName);
-    int column = 0;
+    QTextCodec *codec = byteScannableCodec(data, size);
+    if (!codec) {
+        return false;
+    }
+
+    // only the lines containing the literal get decoded and matched
+    qint64 pos = 0;
     int line = 0;
-    static QString fullDoc;
-    static QVector<int> lineStart;
-    QRegularExpression tmpRegExp = m_regExp;
+    qint64 hit;
+    while ((hit = prefilter.find(data, size, pos)) != -1) {
+        if (m_cancelSearch)
+            break;
+
+        // count the lines up to the one with the hit, pos is always at a line start
+        qint64 lineBegin = pos;
+        while (const char *newLine = static_cast<const char *>(memchr(data + lineBegin, '\n', hit - lineBegin))) {
+            lineBegin = newLine - data + 1;
+            line++;
+        }
+        const char *newLine = static_cast<const char *>(memchr(data + hit, '\n', size - hit));
+        const qint64 lineEnd = newLine ? newLine - data : size;
+
+        // QTextStream::readLine() strips "\r\n" line endings
+        qint64 lineLength = lineEnd - lineBegin;
+        if (newLine && lineLength > 0 && data[lineEnd - 1] == '\r') {
+            lineLength--;
+        }
+
+        QString lineText = codec->toUnicode(data + lineBegin, int(lineLength));
+        searchLine(lineText, line, regExp, matches);
+
+        pos = lineEnd + 1;
+        line++;
+    }
+    return true;
+}
+
+void SearchDiskFiles::searchLine(QString &line, int lineNumber, const QRegularExpression &regExp, FileMatches &matches)
+{
+    QRegularExpressionMatch match = regExp.match(line);
+    int column = match.capturedStart();
+    while (column != -1 && !match.captured().isEmpty()) {
+        // limit line length
+        if (line.length() > 1024)
+            line = line.left(1024);
+        matches.append({line, match.capturedLength(), lineNumber, column, lineNumber, column + match.capturedLength()});
+
+        match = regExp.match(line, column + match.capturedLength());
+        column = match.capturedStart();
+    }
+}
 
+void SearchDiskFiles::searchMultiLineRegExp(const QString &fileName, const QRegularExpression &regExp, const LiteralPrefilter &prefilter, FileMatches &matches)
+{
+    QFile file(fileName);
     if (!file.open(QFile::ReadOnly)) {
         return;
     }
 
-    QTextStream stream(&file);
-    fullDoc = stream.readAll();
-    fullDoc.remove(QLatin1Char('\r'));
-
-    lineStart.clear();
-    lineStart << 0;
-    for (int i = 0; i < fullDoc.size() - 1; i++) {
-        if (fullDoc[i] == QLatin1Char('\n')) {
-            lineStart << i + 1;
+    // decode the mapped file directly, falling back to a stream for unusual encodings
+    MultiLineText text;
+    bool decoded = false;
+    if (file.size() > 0) {
+        if (uchar *mapped = file.map(0, file.size())) {
+            const char *data = reinterpret_cast<const char *>(mapped);
+            qint64 size = file.size();
+            QTextCodec *codec = byteScannableCodec(data, size);
+            if (codec) {
+                // skip files that don't contain the required literal at all
+                if (!prefilter.isEmpty() && prefilter.find(data, size, 0) == -1) {
+                    return;
+                }
+                text.setText(codec->toUnicode(data, int(size)));
+                decoded = true;
+            }
+            file.unmap(mapped);
         }
     }
-    if (tmpRegExp.pattern().endsWith(QLatin1Char('$'))) {
-        fullDoc += QLatin1Char('\n');
-        QString newPatern = tmpRegExp.pattern();
-        newPatern.replace(QStringLiteral("$"), QStringLiteral("(?=\\n)"));
-        tmpRegExp.setPattern(newPatern);
+    if (!decoded) {
+        QTextStream stream(&file);
+        text.setText(stream.readAll());
     }
 
-    QRegularExpressionMatch match;
-    match = tmpRegExp.match(fullDoc);
-    column = match.capturedStart();
-    while (column != -1 && !match.captured().isEmpty()) {
+    const QRegularExpression lineEndRegExp = MultiLineText::regExp(regExp);
+    text.appendFinalNewLine(regExp);
+
+    int line = 0;
+    QRegularExpressionMatch match = lineEndRegExp.match(text.text());
+    while (match.hasMatch() && match.capturedLength() > 0) {
         if (m_cancelSearch)
             break;
-        // search for the line number of the match
-        int i;
-        line = -1;
-        for (i = 1; i < lineStart.size(); i++) {
-            if (lineStart[i] > column) {
-                line = i - 1;
-                break;
-            }
-        }
-        if (line == -1) {
-            break;
-        }
-        QUrl fileUrl = QUrl::fromUserInput(fileName);
-        int startColumn = (column - lineStart[line]);
-        int endLine = line + match.captured().count(QLatin1Char('\n'));
-        int lastNL = match.captured().lastIndexOf(QLatin1Char('\n'));
-        int endColumn = lastNL == -1 ? startColumn + match.captured().length() : match.captured().length() - lastNL - 1;
-        emit matchFound(fileUrl.toString(), fileUrl.fileName(), fullDoc.mid(lineStart[line], column - lineStart[line]) + match.captured(), match.capturedLength(), line, startColumn, endLine, endColumn);
-        match = tmpRegExp.match(fullDoc, column + match.capturedLength());
-        column = match.capturedStart();
-        m_matchCount++;
-        // NOTE: This sleep is here so that the main thread will get a chance to
-        // handle any stop button clicks if there are a lot of matches
-        if (m_matchCount % 50)
-            msleep(1);
+        matches.append(text.toSearchMatch(match, line));
+        match = lineEndRegExp.match(text.text(), match.capturedEnd());
     }
 }
@@ -21,14 +21,47 @@
 #ifndef SearchDiskFiles_h
 #define SearchDiskFiles_h
 
+#include <QAtomicInt>
 #include <QElapsedTimer>
 #include <QFileInfo>
+#include <QHash>
 #include <QMutex>
 #include <QRegularExpression>
+#include <QScopedPointer>
 #include <QStringList>
 #include <QThread>
+#include <QThreadPool>
 #include <QVector>
 
+#include "FileQueue.h"
+#include "KateSearchMatch.h"
+#include "LiteralPrefilter.h"
+#include "SearchResultCache.h"
+
+/**
+ * Searches a list of files on disk.
+ *
+ * The files are handed out one by one to a pool of worker threads sized to the
+ * machine. Each worker claims the next unsearched file, so a thread that got a
+ * couple of small files simply takes more of them while another one is still
+ * busy with a big file. The matches of a file are collected by the worker and
+ * delivered in the order of the file list, so the result is the same as for a
+ * sequential search.
+ *
+ * Files are memory mapped and scanned for the literal text the pattern requires
+ * first, only the lines containing it are decoded and matched.
+ *
+ * Optionally a candidate filter can be passed, e.g. the project trigram index.
+ * It is asked once before the search which of the files can contain the literal
+ * text at all, the others are skipped.
+ *
+ * The files can also be added while the search is already running, see
+ * startQueuedSearch(). This way the search of a folder starts with the first
+ * file found and doesn't wait for the whole folder to be listed.
+ *
+ * With a result cache set, files unchanged since the last search for the same
+ * pattern are not read again, their stored matches are delivered instead.
+ */
 class SearchDiskFiles : public QThread
 {
     Q_OBJECT
@@ -37,29 +70,99 @@ public:
     SearchDiskFiles(QObject *parent = nullptr);
     ~SearchDiskFiles() override;
 
-    void startSearch(const QStringList &iles, const QRegularExpression &regexp);
+    /**
+     * @param files files to search
+     * @param regexp pattern to search for
+     * @param candidateFilter optional object with a Q_INVOKABLE
+     *        QStringList filterCandidates(QStringList files, QStringList literals),
+     *        ownership is taken
+     */
+    void startSearch(const QStringList &files, const QRegularExpression &regexp, QObject *candidateFilter = nullptr);
+
+    /**
+     * Starts a search of the files added to fileQueue() while it runs.
+     * The search is done once the queue is closed and all files in it are searched.
+     * @param regexp pattern to search for
+     */
+    void startQueuedSearch(const QRegularExpression &regexp);
+
+    FileQueue *fileQueue()
+    {
+        return &m_fileQueue;
+    }
+
+    /**
+     * Cache used by the following searches, not owned, nullptr disables caching.
+     */
+    void setResultCache(SearchResultCache *cache)
+    {
+        m_resultCache = cache;
+    }
+
     void run() override;
 
     bool searching();
 
 private:
-    void searchSingleLineRegExp(const QString &fileName);
-    void searchMultiLineRegExp(const QString &fileName);
+    typedef QVector<KateSearchMatch> FileMatches;
+
+    struct SearchedFile {
+        QString fileName;
+        FileMatches matches;
+    };
+
+    class SearchWorker;
+
+    void beginSearch(const QRegularExpression &regexp);
+    void filterCandidates();
+    void searchFiles();
+    void searchFile(const QString &fileName, const QRegularExpression &regExp, bool multiLine, const LiteralPrefilter &prefilter, FileMatches &matches);
+    void searchSingleLineRegExp(const QString &fileName, const QRegularExpression &regExp, const LiteralPrefilter &prefilter, FileMatches &matches);
+    void searchMultiLineRegExp(const QString &fileName, const QRegularExpression &regExp, const LiteralPrefilter &prefilter, FileMatches &matches);
+    bool searchMappedFile(const char *data, qint64 size, const QRegularExpression &regExp, const LiteralPrefilter &prefilter, FileMatches &matches);
+    void searchLine(QString &line, int lineNumber, const QRegularExpression &regExp, FileMatches &matches);
+    void fileSearched(int fileIndex, const QString &fileName, FileMatches &matches, const SearchResultCache::Fingerprint &fingerprint);
+    void emitMatches(const QString &fileName, const FileMatches &matches);
 
 public Q_SLOTS:
     void cancelSearch();
 
 Q_SIGNALS:
-    void matchFound(const QString &url, const QString &docName, const QString &lineContent, int matchLen, int line, int column, int endLine, int endColumn);
+    void matchesFound(const QString &url, const QString &docName, const QVector<KateSearchMatch> &searchMatches);
     void searchDone();
     void searching(const QString &file);
 
 private:
     QRegularExpression m_regExp;
+    /** files of startSearch(), they are queued once the candidate filter is done */
     QStringList m_files;
-    bool m_cancelSearch = true;
-    int m_matchCount = 0;
+    bool m_queuedSearch = false;
+    QScopedPointer<QObject> m_candidateFilter;
+    QAtomicInt m_cancelSearch {1};
     QElapsedTimer m_statusTime;
+
+    QThreadPool m_workerPool;
+    FileQueue m_fileQueue;
+
+    /**
+     * Results of files that were searched before all files queued in front of
+     * them were done. Guarded by m_resultMutex.
+     */
+    QMutex m_resultMutex;
+    QHash<int, SearchedFile> m_finishedFiles;
+    int m_nextResultIndex = 0;
+
+    /**
+     * Results of the last search for the pattern and the ones of this search,
+     * stored in the cache once the search is done. m_newResults is guarded by
+     * m_resultMutex.
+     */
+    SearchResultCache *m_resultCache = nullptr;
+    QString m_cacheKey;
+    SearchResultCache::SharedResultSet m_cachedResults;
+    SearchResultCache::ResultSet m_newResults;
+    QAtomicInt m_cacheHits;
+    QAtomicInt m_cacheMisses;
 };
 
 #endif
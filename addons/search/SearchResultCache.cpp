@@ -0,0 +1,153 @@
+/*   Kate search plugin
+ *
+ * Copyright (C) 2020 by Kate Developers <kwrite-devel@kde.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program in a file called COPYING; if not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#include "SearchResultCache.h"
+
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+
+#ifdef Q_OS_UNIX
+#include <sys/stat.h>
+#include <sys/types.h>
+#endif
+
+SearchResultCache::SearchResultCache(int maxResultSets, qint64 maxMemoryUsage)
+    : m_maxResultSets(maxResultSets)
+    , m_maxMemoryUsage(maxMemoryUsage)
+{
+}
+
+QString SearchResultCache::key(const QRegularExpression &regExp)
+{
+    return QString::number(regExp.patternOptions()) + QLatin1Char(':') + regExp.pattern();
+}
+
+SearchResultCache::Fingerprint SearchResultCache::fingerprint(const QString &fileName)
+{
+    Fingerprint result;
+#ifdef Q_OS_UNIX
+    struct stat info;
+    if (::stat(QFile::encodeName(fileName).constData(), &info) != 0) {
+        return result;
+    }
+    qint64 nanoseconds = 0;
+#if defined(Q_OS_LINUX)
+    nanoseconds = info.st_mtim.tv_nsec;
+#elif defined(Q_OS_DARWIN)
+    nanoseconds = info.st_mtimespec.tv_nsec;
+#endif
+    result.mtime = qint64(info.st_mtime) * 1000000000 + nanoseconds;
+    result.size = qint64(info.st_size);
+    result.inode = quint64(info.st_ino);
+#else
+    const QFileInfo info(fileName);
+    if (!info.exists()) {
+        return result;
+    }
+    result.mtime = info.lastModified().toMSecsSinceEpoch();
+    result.size = info.size();
+#endif
+    return result;
+}
+
+SearchResultCache::SharedResultSet SearchResultCache::find(const QString &key)
+{
+    QMutexLocker locker(&m_mutex);
+    for (int i = 0; i < m_entries.size(); ++i) {
+        if (m_entries.at(i).key == key) {
+            const Entry entry = m_entries.takeAt(i);
+            m_entries.prepend(entry);
+            return entry.results;
+        }
+    }
+    return SharedResultSet();
+}
+
+void SearchResultCache::insert(const QString &key, const ResultSet &results, int hits, int misses)
+{
+    QMutexLocker locker(&m_mutex);
+    m_fileHits += hits;
+    m_fileMisses += misses;
+
+    // the files of earlier searches for the pattern stay, e.g. of another folder
+    ResultSet merged;
+    for (int i = 0; i < m_entries.size(); ++i) {
+        if (m_entries.at(i).key == key) {
+            merged = *m_entries.at(i).results;
+            m_memoryUsage -= m_entries.at(i).memoryUsage;
+            m_entries.removeAt(i);
+            break;
+        }
+    }
+    for (auto it = results.constBegin(); it != results.constEnd(); ++it) {
+        merged.insert(it.key(), it.value());
+    }
+
+    const qint64 memoryUsage = estimateMemoryUsage(merged);
+    if (memoryUsage > m_maxMemoryUsage) {
+        return;
+    }
+
+    m_entries.prepend({key, SharedResultSet(new ResultSet(merged)), memoryUsage});
+    m_memoryUsage += memoryUsage;
+    while (m_entries.size() > m_maxResultSets || m_memoryUsage > m_maxMemoryUsage) {
+        m_memoryUsage -= m_entries.last().memoryUsage;
+        m_entries.removeLast();
+    }
+}
+
+void SearchResultCache::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    m_entries.clear();
+    m_memoryUsage = 0;
+}
+
+SearchResultCache::Statistics SearchResultCache::statistics() const
+{
+    QMutexLocker locker(&m_mutex);
+    Statistics statistics;
+    statistics.resultSets = m_entries.size();
+    statistics.memoryUsage = m_memoryUsage;
+    statistics.fileHits = m_fileHits;
+    statistics.fileMisses = m_fileMisses;
+    return statistics;
+}
+
+qint64 SearchResultCache::estimateMemoryUsage(const ResultSet &results)
+{
+    qint64 usage = 0;
+    for (auto it = results.constBegin(); it != results.constEnd(); ++it) {
+        usage += qint64(sizeof(FileResult)) + it.key().size() * 2;
+        const QVector<KateSearchMatch> &matches = it->matches;
+        usage += matches.size() * qint64(sizeof(KateSearchMatch));
+        // the matches of one line share the line text
+        const QChar *lastLine = nullptr;
+        for (const KateSearchMatch &match : matches) {
+            if (match.lineContent.constData() != lastLine) {
+                lastLine = match.lineContent.constData();
+                usage += match.lineContent.size() * 2;
+            }
+        }
+    }
+    return usage;
+}
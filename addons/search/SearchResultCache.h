@@ -0,0 +1,131 @@
+/*   Kate search plugin
+ *
+ * Copyright (C) 2020 by Kate Developers <kwrite-devel@kde.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program in a file called COPYING; if not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#ifndef SearchResultCache_h
+#define SearchResultCache_h
+
+#include <QHash>
+#include <QMutex>
+#include <QRegularExpression>
+#include <QSharedPointer>
+#include <QString>
+#include <QVector>
+
+#include "KateSearchMatch.h"
+
+/**
+ * Results of recent searches on disk, to avoid reading unchanged files again
+ * when the same pattern is searched another time.
+ *
+ * One result set is kept per pattern and pattern options. It holds the matches
+ * of every file searched for the pattern together with the fingerprint of the
+ * file at that time, modification time, size and inode. A file with the same
+ * fingerprint is not searched again, its stored matches are used instead.
+ *
+ * The cache is bounded by the number of result sets and their estimated memory
+ * use, the least recently used sets are dropped first. All methods are thread
+ * safe, the result sets handed out are never changed.
+ */
+class SearchResultCache
+{
+public:
+    struct Fingerprint {
+        qint64 mtime = -1;
+        qint64 size = -1;
+        quint64 inode = 0;
+
+        bool isValid() const
+        {
+            return mtime != -1;
+        }
+        bool operator==(const Fingerprint &other) const
+        {
+            return mtime == other.mtime && size == other.size && inode == other.inode;
+        }
+    };
+
+    struct FileResult {
+        Fingerprint fingerprint;
+        QVector<KateSearchMatch> matches;
+    };
+
+    typedef QHash<QString, FileResult> ResultSet;
+    typedef QSharedPointer<const ResultSet> SharedResultSet;
+
+    struct Statistics {
+        int resultSets = 0;
+        /** estimated bytes used by the stored matches */
+        qint64 memoryUsage = 0;
+        /** files whose stored matches were used */
+        qint64 fileHits = 0;
+        /** files that had to be searched */
+        qint64 fileMisses = 0;
+    };
+
+    explicit SearchResultCache(int maxResultSets = 8, qint64 maxMemoryUsage = 64 * 1024 * 1024);
+
+    /**
+     * @return the key of the result set for the pattern
+     */
+    static QString key(const QRegularExpression &regExp);
+
+    /**
+     * @return the current fingerprint of the file, invalid if it doesn't exist
+     */
+    static Fingerprint fingerprint(const QString &fileName);
+
+    /**
+     * @return the stored results for the key or null, the set becomes the most recently used one
+     */
+    SharedResultSet find(const QString &key);
+
+    /**
+     * Adds the results of a finished search to the set of the key.
+     * @param results the searched files, replacing the stored ones
+     * @param hits number of files whose stored matches were used
+     * @param misses number of files that were searched
+     */
+    void insert(const QString &key, const ResultSet &results, int hits, int misses);
+
+    void clear();
+
+    Statistics statistics() const;
+
+private:
+    struct Entry {
+        QString key;
+        SharedResultSet results;
+        qint64 memoryUsage;
+    };
+
+    static qint64 estimateMemoryUsage(const ResultSet &results);
+
+    const int m_maxResultSets;
+    const qint64 m_maxMemoryUsage;
+
+    mutable QMutex m_mutex;
+    /** most recently used first */
+    QVector<Entry> m_entries;
+    qint64 m_memoryUsage = 0;
+    qint64 m_fileHits = 0;
+    qint64 m_fileMisses = 0;
+};
+
+#endif
@@ -0,0 +1,198 @@
+/*   Kate search plugin
+ *
+ * Copyright (C) 2020 by Kate Developers <kwrite-devel@kde.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program in a file called COPYING; if not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#include "replacediskfiles_test.h"
+#include "ReplaceDiskFiles.h"
+
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTextCodec>
+#include <QtTest>
+
+QTEST_MAIN(ReplaceDiskFilesTest)
+
+using KTextEditor::Range;
+
+/**
+ * replace the matches of a file searched just now
+ */
+static ReplaceDiskFiles::FileResult
+replaceFile(const QString &fileName, const QVector<Range> &ranges, const QVector<bool> &replace, const QString &pattern, const QString &replaceText)
+{
+    ReplaceDiskFiles::FileJob job;
+    job.fileName = fileName;
+    job.ranges = ranges;
+    job.replace = replace;
+    job.snapshotTime = QDateTime::currentDateTime();
+    return ReplaceDiskFiles::replaceFile(job, QRegularExpression(pattern), replaceText, QAtomicInt());
+}
+
+/**
+ * UTF-16 little endian with byte order mark
+ */
+static QByteArray utf16(const QString &text)
+{
+    QByteArray data("\xFF\xFE");
+    for (const QChar c : text) {
+        data.append(char(c.unicode() & 0xff));
+        data.append(char(c.unicode() >> 8));
+    }
+    return data;
+}
+
+void ReplaceDiskFilesTest::initTestCase()
+{
+    // files without byte order mark are read with the locale codec, use one that decodes everything
+    m_localeCodec = QTextCodec::codecForLocale();
+    QTextCodec::setCodecForLocale(QTextCodec::codecForName("ISO-8859-1"));
+}
+
+void ReplaceDiskFilesTest::cleanupTestCase()
+{
+    QTextCodec::setCodecForLocale(m_localeCodec);
+}
+
+void ReplaceDiskFilesTest::init()
+{
+    m_tmpdir = new QTemporaryDir;
+    QVERIFY(m_tmpdir->isValid());
+}
+
+void ReplaceDiskFilesTest::cleanup()
+{
+    delete m_tmpdir;
+    m_tmpdir = nullptr;
+}
+
+QString ReplaceDiskFilesTest::writeFile(const QByteArray &content)
+{
+    const QString fileName = m_tmpdir->filePath(QStringLiteral("file.txt"));
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly) || file.write(content) != content.size()) {
+        return QString();
+    }
+    return fileName;
+}
+
+QByteArray ReplaceDiskFilesTest::readFile(const QString &fileName)
+{
+    QFile file(fileName);
+    return file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+}
+
+void ReplaceDiskFilesTest::utf8ByteOrderMark()
+{
+    // the columns don't count the byte order mark
+    const QString fileName = writeFile("\xEF\xBB\xBF" "foo b\xC3\xA4r foo\n");
+    const auto result = replaceFile(fileName, {Range(0, 0, 0, 3), Range(0, 8, 0, 11)}, {true, true}, QStringLiteral("foo"), QString::fromUtf8("\xC3\xB6\xC3\xB6"));
+    QCOMPARE(readFile(fileName), QByteArray("\xEF\xBB\xBF" "\xC3\xB6\xC3\xB6 b\xC3\xA4r \xC3\xB6\xC3\xB6\n"));
+    QCOMPARE(result.ranges, QVector<Range>({Range(0, 0, 0, 2), Range(0, 7, 0, 9)}));
+    QCOMPARE(result.replaced, QVector<bool>({true, true}));
+    QVERIFY(result.writtenTime.isValid());
+}
+
+void ReplaceDiskFilesTest::utf16ByteOrderMark()
+{
+    const QString fileName = writeFile(utf16(QStringLiteral("hello world\n")));
+    const auto result = replaceFile(fileName, {Range(0, 6, 0, 11)}, {true}, QStringLiteral("w(or)ld"), QStringLiteral("\\U\\1"));
+    QCOMPARE(readFile(fileName), utf16(QStringLiteral("hello OR\n")));
+    QCOMPARE(result.ranges, QVector<Range>({Range(0, 6, 0, 8)}));
+    QCOMPARE(result.replaceTexts, QVector<QString>({QStringLiteral("OR")}));
+}
+
+void ReplaceDiskFilesTest::windowsLineEnds()
+{
+    // inserted lines get the line ends of the file
+    const QString fileName = writeFile("a foo\r\nfoo b\r\n");
+    const auto result = replaceFile(fileName, {Range(0, 2, 0, 5), Range(1, 0, 1, 3)}, {true, true}, QStringLiteral("foo"), QStringLiteral("x\\ny"));
+    QCOMPARE(readFile(fileName), QByteArray("a x\r\ny\r\nx\r\ny b\r\n"));
+    QCOMPARE(result.ranges, QVector<Range>({Range(0, 2, 1, 1), Range(2, 0, 3, 1)}));
+}
+
+void ReplaceDiskFilesTest::shiftOnSameLine()
+{
+    // the match left alone moves with the replacement before it
+    const QString fileName = writeFile("foo foo foo\n");
+    const auto result =
+        replaceFile(fileName, {Range(0, 0, 0, 3), Range(0, 4, 0, 7), Range(0, 8, 0, 11)}, {true, false, true}, QStringLiteral("foo"), QStringLiteral("longer"));
+    QCOMPARE(readFile(fileName), QByteArray("longer foo longer\n"));
+    QCOMPARE(result.ranges, QVector<Range>({Range(0, 0, 0, 6), Range(0, 7, 0, 10), Range(0, 11, 0, 17)}));
+    QCOMPARE(result.replaced, QVector<bool>({true, false, true}));
+}
+
+void ReplaceDiskFilesTest::shiftOnFollowingLines()
+{
+    // a match over two lines is replaced by one line, the matches behind it move up
+    const QString fileName = writeFile("one\ntwo x\nthree\n");
+    const auto result = replaceFile(fileName,
+                                    {Range(0, 0, 1, 3), Range(1, 4, 1, 5), Range(2, 0, 2, 5)},
+                                    {true, false, false},
+                                    QStringLiteral("one\\ntwo|x|three"),
+                                    QStringLiteral("1"));
+    QCOMPARE(readFile(fileName), QByteArray("1 x\nthree\n"));
+    QCOMPARE(result.ranges, QVector<Range>({Range(0, 0, 0, 1), Range(0, 2, 0, 3), Range(1, 0, 1, 5)}));
+}
+
+void ReplaceDiskFilesTest::noLongerMatching()
+{
+    // the range doesn't hold the match anymore, nothing is written
+    const QString fileName = writeFile("foo bar\n");
+    const auto result = replaceFile(fileName, {Range(0, 4, 0, 7)}, {true}, QStringLiteral("foo"), QStringLiteral("baz"));
+    QCOMPARE(readFile(fileName), QByteArray("foo bar\n"));
+    QCOMPARE(result.replaced, QVector<bool>({false}));
+    QVERIFY(!result.writtenTime.isValid());
+}
+
+void ReplaceDiskFilesTest::modifiedAfterSearch()
+{
+    const QString fileName = writeFile("foo\n");
+    ReplaceDiskFiles::FileJob job;
+    job.fileName = fileName;
+    job.ranges = {Range(0, 0, 0, 3)};
+    job.replace = {true};
+    job.snapshotTime = QDateTime::currentDateTime().addSecs(-60);
+    const auto result = ReplaceDiskFiles::replaceFile(job, QRegularExpression(QStringLiteral("foo")), QStringLiteral("bar"), QAtomicInt());
+    QCOMPARE(readFile(fileName), QByteArray("foo\n"));
+    QCOMPARE(result.ranges, job.ranges);
+    QCOMPARE(result.replaced, QVector<bool>({false}));
+    QVERIFY(!result.writtenTime.isValid());
+}
+
+void ReplaceDiskFilesTest::decodingFails()
+{
+    // not valid UTF-8 behind the byte order mark, writing it back would damage it
+    const QByteArray content("\xEF\xBB\xBF" "foo \xFF\n");
+    const QString fileName = writeFile(content);
+    const auto result = replaceFile(fileName, {Range(0, 0, 0, 3)}, {true}, QStringLiteral("foo"), QStringLiteral("bar"));
+    QCOMPARE(readFile(fileName), content);
+    QCOMPARE(result.replaced, QVector<bool>({false}));
+    QVERIFY(!result.writtenTime.isValid());
+}
+
+void ReplaceDiskFilesTest::encodingFails()
+{
+    // the euro sign is not part of the locale codec
+    const QString fileName = writeFile("price: EUR\n");
+    const auto result = replaceFile(fileName, {Range(0, 7, 0, 10)}, {true}, QStringLiteral("EUR"), QString(QChar(0x20ac)));
+    QCOMPARE(readFile(fileName), QByteArray("price: EUR\n"));
+    QCOMPARE(result.ranges, QVector<Range>({Range(0, 7, 0, 10)}));
+    QCOMPARE(result.replaced, QVector<bool>({false}));
+    QVERIFY(!result.writtenTime.isValid());
+}
@@ -0,0 +1,57 @@
+/*   Kate search plugin
+ *
+ * Copyright (C) 2020 by Kate Developers <kwrite-devel@kde.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program in a file called COPYING; if not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#ifndef KATE_REPLACEDISKFILES_TEST_H
+#define KATE_REPLACEDISKFILES_TEST_H
+
+#include <QObject>
+
+class QTemporaryDir;
+class QTextCodec;
+
+class ReplaceDiskFilesTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void cleanupTestCase();
+    void init();
+    void cleanup();
+
+    void utf8ByteOrderMark();
+    void utf16ByteOrderMark();
+    void windowsLineEnds();
+    void shiftOnSameLine();
+    void shiftOnFollowingLines();
+    void noLongerMatching();
+    void modifiedAfterSearch();
+    void decodingFails();
+    void encodingFails();
+
+private:
+    QString writeFile(const QByteArray &content);
+    static QByteArray readFile(const QString &fileName);
+
+    QTemporaryDir *m_tmpdir = nullptr;
+    QTextCodec *m_localeCodec = nullptr;
+};
+
+#endif
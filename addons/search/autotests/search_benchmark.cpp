@@ -0,0 +1,406 @@
+/*   Kate search plugin
+ *
+ * Copyright (C) 2020 by Kate Developers <kwrite-devel@kde.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program in a file called COPYING; if not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#include "search_benchmark.h"
+
+#include "FileQueue.h"
+#include "FolderFilesList.h"
+#include "GlobMatcher.h"
+#include "SearchDiskFiles.h"
+#include "search_open_files.h"
+
+#include <QtTest>
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <ktexteditor/document.h>
+#include <ktexteditor/editor.h>
+
+#include <cmath>
+
+QTEST_MAIN(SearchBenchmark)
+
+namespace
+{
+/**
+ * xorshift generator, gives the same sequence on every platform unlike the
+ * distributions of <random>
+ */
+class CorpusRandom
+{
+public:
+    explicit CorpusRandom(quint64 seed)
+        : m_state(seed * 0x9E3779B97F4A7C15ull + 1)
+    {
+    }
+
+    quint64 next()
+    {
+        m_state ^= m_state << 13;
+        m_state ^= m_state >> 7;
+        m_state ^= m_state << 17;
+        return m_state;
+    }
+
+    int bounded(int limit)
+    {
+        return int(next() % quint64(limit));
+    }
+
+    /** exponentially distributed, many small values and a few large ones */
+    int exponential(int mean)
+    {
+        const double uniform = double(next() >> 11) / double(1ull << 53);
+        return int(-mean * std::log(1.0 - uniform));
+    }
+
+private:
+    quint64 m_state;
+};
+
+/**
+ * deletes the documents however the benchmark function is left, e.g. by a failed QVERIFY
+ */
+class DocumentsGuard
+{
+public:
+    explicit DocumentsGuard(QList<KTextEditor::Document *> &documents)
+        : m_documents(documents)
+    {
+    }
+
+    ~DocumentsGuard()
+    {
+        qDeleteAll(m_documents);
+    }
+
+private:
+    QList<KTextEditor::Document *> &m_documents;
+};
+
+const char *const corpusWords[] = {"int", "return", "value", "search", "document", "const", "QString", "match", "line", "{", "}", "(", ")", "=", "+", "if", "for", "while", "auto", "result", "file", "view", "cursor", "range", "text"};
+const char *const corpusExtensions[] = {"cpp", "h", "txt", "md", "py"};
+
+int envValue(const char *name, int defaultValue)
+{
+    bool ok = false;
+    const int value = qEnvironmentVariableIntValue(name, &ok);
+    return ok ? value : defaultValue;
+}
+
+QByteArray textContent(CorpusRandom &random, int size, int lineLength)
+{
+    QByteArray content;
+    content.reserve(size + lineLength * 2);
+    while (content.size() < size) {
+        const int length = random.bounded(lineLength * 2 + 1);
+        const int lineStart = content.size();
+        while (content.size() - lineStart < length) {
+            content += corpusWords[random.bounded(int(sizeof(corpusWords) / sizeof(corpusWords[0])))];
+            content += ' ';
+        }
+
+        // the things the benchmark patterns look for
+        const int special = random.bounded(100);
+        if (special < 2) {
+            content += "// TODO: check this";
+        } else if (special < 3) {
+            content += "deprecatedCall(value);";
+        } else if (special < 6) {
+            content += "{\n    return value;";
+        }
+        content += '\n';
+    }
+    return content;
+}
+
+QByteArray binaryContent(CorpusRandom &random, int size)
+{
+    QByteArray content(size, 0);
+    for (int i = 0; i < size; ++i) {
+        content[i] = char(random.bounded(256));
+    }
+    // make sure it is recognized as binary
+    if (size > 0) {
+        content[0] = 0;
+    }
+    return content;
+}
+}
+
+void SearchBenchmark::initTestCase()
+{
+    const int fileCount = envValue("KATE_SEARCH_BENCH_FILES", 1000);
+    const int fileSize = envValue("KATE_SEARCH_BENCH_FILE_SIZE", 8192);
+    const int lineLength = qMax(1, envValue("KATE_SEARCH_BENCH_LINE_LENGTH", 60));
+    const int binaryPercent = envValue("KATE_SEARCH_BENCH_BINARY_PERCENT", 5);
+    const int maxDepth = envValue("KATE_SEARCH_BENCH_DEPTH", 8);
+    CorpusRandom random(quint64(envValue("KATE_SEARCH_BENCH_SEED", 1)));
+
+    m_corpusDir.reset(new QTemporaryDir());
+    QVERIFY(m_corpusDir->isValid());
+    const QDir root(m_corpusDir->path());
+
+    for (int i = 0; i < fileCount; ++i) {
+        QString dirPath;
+        const int depth = random.bounded(maxDepth + 1);
+        for (int level = 0; level < depth; ++level) {
+            dirPath += QStringLiteral("dir%1/").arg(random.bounded(4));
+        }
+        QVERIFY(root.mkpath(dirPath.isEmpty() ? QStringLiteral(".") : dirPath));
+
+        const bool binary = random.bounded(100) < binaryPercent;
+        const int size = random.exponential(fileSize);
+        const QString extension = binary ? QStringLiteral("bin") : QString::fromLatin1(corpusExtensions[random.bounded(int(sizeof(corpusExtensions) / sizeof(corpusExtensions[0])))]);
+        const QString fileName = root.absoluteFilePath(dirPath + QStringLiteral("file%1.%2").arg(i).arg(extension));
+
+        const QByteArray content = binary ? binaryContent(random, size) : textContent(random, size, lineLength);
+        QFile file(fileName);
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        QCOMPARE(file.write(content), qint64(content.size()));
+
+        m_files << fileName;
+        m_totalBytes += content.size();
+        if (!binary) {
+            m_textFiles << fileName;
+            m_textBytes += content.size();
+        }
+    }
+}
+
+void SearchBenchmark::cleanupTestCase()
+{
+    m_corpusDir.reset();
+}
+
+void SearchBenchmark::addPatternRows()
+{
+    QTest::addColumn<QString>("pattern");
+    QTest::addColumn<bool>("caseSensitive");
+
+    QTest::newRow("literal") << QStringLiteral("todo") << false;
+    QTest::newRow("regexp") << QStringLiteral("\\bdeprecated\\w*\\(") << true;
+    QTest::newRow("multi-line") << QStringLiteral("\\{\\n\\s*return") << true;
+}
+
+void SearchBenchmark::benchSearchDiskFiles_data()
+{
+    addPatternRows();
+}
+
+void SearchBenchmark::benchSearchDiskFiles()
+{
+    QFETCH(QString, pattern);
+    QFETCH(bool, caseSensitive);
+    const QRegularExpression regExp(pattern, caseSensitive ? QRegularExpression::NoPatternOption : QRegularExpression::CaseInsensitiveOption);
+
+    SearchDiskFiles searcher;
+    QElapsedTimer timer;
+    int matches = 0;
+    qint64 firstResult = -1;
+    qint64 elapsed = 0;
+    connect(&searcher, &SearchDiskFiles::matchesFound, this, [&](const QString &, const QString &, const QVector<KateSearchMatch> &searchMatches) {
+        if (firstResult == -1) {
+            firstResult = timer.nsecsElapsed();
+        }
+        matches += searchMatches.size();
+    });
+
+    QBENCHMARK {
+        matches = 0;
+        firstResult = -1;
+        QEventLoop loop;
+        connect(&searcher, &SearchDiskFiles::searchDone, &loop, &QEventLoop::quit);
+        timer.start();
+        searcher.startSearch(m_files, regExp);
+        loop.exec();
+        elapsed = timer.nsecsElapsed();
+        // the search thread finishes right after searchDone
+        searcher.wait();
+    }
+
+    QVERIFY(matches > 0);
+    report("SearchDiskFiles", pattern, elapsed, m_files.size(), m_totalBytes, matches, firstResult);
+}
+
+void SearchBenchmark::benchSearchOpenFiles_data()
+{
+    addPatternRows();
+}
+
+void SearchBenchmark::benchSearchOpenFiles()
+{
+    QFETCH(QString, pattern);
+    QFETCH(bool, caseSensitive);
+    const QRegularExpression regExp(pattern, caseSensitive ? QRegularExpression::NoPatternOption : QRegularExpression::CaseInsensitiveOption);
+
+    // a realistic number of open documents
+    QList<KTextEditor::Document *> documents;
+    const DocumentsGuard documentsGuard(documents);
+    qint64 bytes = 0;
+    for (int i = 0; i < m_textFiles.size() && i < 200; ++i) {
+        QFile file(m_textFiles.at(i));
+        QVERIFY(file.open(QIODevice::ReadOnly));
+        const QByteArray content = file.readAll();
+        KTextEditor::Document *doc = KTextEditor::Editor::instance()->createDocument(this);
+        doc->setText(QString::fromUtf8(content));
+        documents << doc;
+        bytes += content.size();
+    }
+    if (documents.isEmpty()) {
+        QSKIP("no text files generated");
+    }
+
+    SearchOpenFiles searcher;
+    QElapsedTimer timer;
+    int matches = 0;
+    qint64 firstResult = -1;
+    qint64 elapsed = 0;
+    connect(&searcher, &SearchOpenFiles::matchesFound, this, [&](const QString &, const QString &, const QVector<KateSearchMatch> &searchMatches) {
+        if (firstResult == -1) {
+            firstResult = timer.nsecsElapsed();
+        }
+        matches += searchMatches.size();
+    });
+
+    QBENCHMARK {
+        matches = 0;
+        firstResult = -1;
+        QEventLoop loop;
+        connect(&searcher, &SearchOpenFiles::searchDone, &loop, &QEventLoop::quit);
+        timer.start();
+        searcher.startSearch(documents, regExp);
+        loop.exec();
+        elapsed = timer.nsecsElapsed();
+    }
+
+    QVERIFY(matches > 0);
+    report("SearchOpenFiles", pattern, elapsed, documents.size(), bytes, matches, firstResult);
+}
+
+void SearchBenchmark::benchFolderFilesList()
+{
+    FolderFilesList lister;
+    FileQueue queue(1000);
+    QElapsedTimer timer;
+    int files = 0;
+    qint64 firstResult = -1;
+    qint64 elapsed = 0;
+
+    QBENCHMARK {
+        files = 0;
+        firstResult = -1;
+        queue.reset();
+        timer.start();
+        lister.generateList(m_corpusDir->path(), true, false, false, false, false, QStringLiteral("*"), QString(), &queue, QSet<QString>());
+
+        // take the files like the searcher does, the queue is closed when the listing is done
+        QString file;
+        int fileIndex;
+        while (queue.dequeue(file, fileIndex)) {
+            if (firstResult == -1) {
+                firstResult = timer.nsecsElapsed();
+            }
+            files++;
+        }
+        elapsed = timer.nsecsElapsed();
+        lister.wait();
+    }
+
+    // binary files are left out
+    QCOMPARE(files, m_textFiles.size());
+    report("FolderFilesList", QString(), elapsed, files, 0, 0, firstResult);
+}
+
+void SearchBenchmark::benchFilterFiles()
+{
+    // the file list of a big project, the file filter is applied to all of them
+    CorpusRandom random(quint64(envValue("KATE_SEARCH_BENCH_SEED", 1)));
+    const QString baseDir = QStringLiteral("/home/user/project/");
+    QStringList paths;
+    const int pathCount = 300000;
+    paths.reserve(pathCount);
+    for (int i = 0; i < pathCount; ++i) {
+        QString path = baseDir;
+        const int depth = random.bounded(6) + 1;
+        for (int level = 0; level < depth; ++level) {
+            path += QStringLiteral("dir%1/").arg(random.bounded(20));
+        }
+        path += QStringLiteral("file%1.%2").arg(i).arg(QLatin1String(corpusExtensions[random.bounded(int(sizeof(corpusExtensions) / sizeof(corpusExtensions[0])))]));
+        paths << path;
+    }
+
+    // what KatePluginSearchView::filterFiles() does for a search in the project
+    const QString types = QStringLiteral("*.cpp, *.h, CMakeLists.txt, *_test.*");
+    const QString excludes = QStringLiteral("dir1?/*, *.orig");
+    QElapsedTimer timer;
+    int filtered = 0;
+    qint64 elapsed = 0;
+
+    QBENCHMARK {
+        timer.start();
+        const GlobMatcher typeMatcher = GlobMatcher::fromFilter(types);
+        const GlobMatcher excludeMatcher = GlobMatcher::fromFilter(excludes);
+        filtered = 0;
+        for (const QString &path : qAsConst(paths)) {
+            const QString nameToCheck = path.mid(baseDir.size());
+            if (!excludeMatcher.matches(nameToCheck) && typeMatcher.matches(nameToCheck)) {
+                filtered++;
+            }
+        }
+        elapsed = timer.nsecsElapsed();
+    }
+
+    QVERIFY(filtered > 0);
+    report("filterFiles", types, elapsed, paths.size(), 0, filtered, -1);
+}
+
+void SearchBenchmark::report(const char *benchmark, const QString &pattern, qint64 nanoseconds, int files, qint64 bytes, int matches, qint64 firstResultNanoseconds)
+{
+    const double seconds = double(qMax<qint64>(1, nanoseconds)) / 1e9;
+
+    QJsonObject result;
+    result.insert(QStringLiteral("benchmark"), QLatin1String(benchmark));
+    result.insert(QStringLiteral("pattern"), pattern);
+    result.insert(QStringLiteral("files"), files);
+    result.insert(QStringLiteral("bytes"), double(bytes));
+    result.insert(QStringLiteral("matches"), matches);
+    result.insert(QStringLiteral("seconds"), seconds);
+    result.insert(QStringLiteral("filesPerSecond"), files / seconds);
+    result.insert(QStringLiteral("megabytesPerSecond"), bytes / (1024.0 * 1024.0) / seconds);
+    result.insert(QStringLiteral("matchesPerSecond"), matches / seconds);
+    result.insert(QStringLiteral("firstResultMs"), firstResultNanoseconds < 0 ? -1.0 : firstResultNanoseconds / 1e6);
+
+    const QByteArray line = QJsonDocument(result).toJson(QJsonDocument::Compact);
+    qInfo().noquote() << QString::fromUtf8(line);
+
+    const QString outputFile = qEnvironmentVariable("KATE_SEARCH_BENCH_OUTPUT");
+    if (!outputFile.isEmpty()) {
+        QFile file(outputFile);
+        if (file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+            file.write(line + '\n');
+        }
+    }
+}
@@ -0,0 +1,75 @@
+/*   Kate search plugin
+ *
+ * Copyright (C) 2020 by Kate Developers <kwrite-devel@kde.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program in a file called COPYING; if not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#ifndef KATE_SEARCH_BENCHMARK_H
+#define KATE_SEARCH_BENCHMARK_H
+
+#include <QObject>
+#include <QRegularExpression>
+#include <QStringList>
+#include <QTemporaryDir>
+
+#include <memory>
+
+/**
+ * Throughput of the search plugin on a generated file tree.
+ *
+ * The tree is created from a fixed seed, so every run searches the same
+ * content. Its shape is configured with environment variables:
+ *
+ * - KATE_SEARCH_BENCH_FILES: number of files (1000)
+ * - KATE_SEARCH_BENCH_FILE_SIZE: mean file size in bytes (8192)
+ * - KATE_SEARCH_BENCH_LINE_LENGTH: mean line length (60)
+ * - KATE_SEARCH_BENCH_BINARY_PERCENT: share of binary files (5)
+ * - KATE_SEARCH_BENCH_DEPTH: deepest directory nesting (8)
+ * - KATE_SEARCH_BENCH_SEED: seed of the generator (1)
+ *
+ * Besides the QBENCHMARK result, every measurement is printed as one JSON
+ * object per line and appended to KATE_SEARCH_BENCH_OUTPUT if that is set.
+ */
+class SearchBenchmark : public QObject
+{
+    Q_OBJECT
+
+public Q_SLOTS:
+    void initTestCase();
+    void cleanupTestCase();
+
+private Q_SLOTS:
+    void benchSearchDiskFiles_data();
+    void benchSearchDiskFiles();
+    void benchSearchOpenFiles_data();
+    void benchSearchOpenFiles();
+    void benchFolderFilesList();
+    void benchFilterFiles();
+
+private:
+    void addPatternRows();
+    void report(const char *benchmark, const QString &pattern, qint64 nanoseconds, int files, qint64 bytes, int matches, qint64 firstResultNanoseconds);
+
+    std::unique_ptr<QTemporaryDir> m_corpusDir;
+    QStringList m_files;
+    /** files that are text, the others are binary */
+    QStringList m_textFiles;
+    qint64 m_totalBytes = 0;
+    qint64 m_textBytes = 0;
+};
+
+#endif
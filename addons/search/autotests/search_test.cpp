@@ -0,0 +1,561 @@
+/*   Kate search plugin
+ *
+ * Copyright (C) 2020 by Kate Developers <kwrite-devel@kde.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program in a file called COPYING; if not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#include "search_test.h"
+#include "GlobMatcher.h"
+#include "LiteralPrefilter.h"
+#include "MatchModel.h"
+#include "MultiLineText.h"
+#include "SearchResultCache.h"
+#include "replace_matches.h"
+
+#include <QFile>
+#include <QTemporaryDir>
+#include <QtTest>
+
+QTEST_MAIN(SearchTest)
+
+void SearchTest::literalExtraction_data()
+{
+    QTest::addColumn<QString>("pattern");
+    QTest::addColumn<bool>("caseSensitive");
+    QTest::addColumn<QStringList>("literals");
+
+    QTest::newRow("plain") << QStringLiteral("hello") << true << QStringList{QStringLiteral("hello")};
+    QTest::newRow("wildcard") << QStringLiteral("foo.*bar") << true << QStringList{QStringLiteral("foo"), QStringLiteral("bar")};
+    QTest::newRow("optional") << QStringLiteral("colou?r") << true << QStringList{QStringLiteral("colo"), QStringLiteral("r")};
+    QTest::newRow("repeated") << QStringLiteral("ab+c") << true << QStringList{QStringLiteral("ab"), QStringLiteral("c")};
+    QTest::newRow("counted") << QStringLiteral("ab{2,3}c") << true << QStringList{QStringLiteral("a"), QStringLiteral("c")};
+    QTest::newRow("brace") << QStringLiteral("a{b") << true << QStringList{QStringLiteral("a{b")};
+    QTest::newRow("anchors") << QStringLiteral("^int main$") << true << QStringList{QStringLiteral("int main")};
+
+    // alternatives are only skipped inside groups
+    QTest::newRow("alternation") << QStringLiteral("foo|bar") << true << QStringList();
+    QTest::newRow("group alternation") << QStringLiteral("(foo|bar)baz") << true << QStringList{QStringLiteral("baz")};
+    QTest::newRow("unbalanced") << QStringLiteral("foo)") << true << QStringList();
+    QTest::newRow("inline option") << QStringLiteral("(?i)foo") << true << QStringList();
+    QTest::newRow("class") << QStringLiteral("foo[a-z]bar") << true << QStringList{QStringLiteral("foo"), QStringLiteral("bar")};
+    QTest::newRow("posix class") << QStringLiteral("foo[[:alpha:]]") << true << QStringList();
+
+    // escaped characters are part of the literal, class escapes end it, others are not understood
+    QTest::newRow("escaped dot") << QStringLiteral("a\\.b") << true << QStringList{QStringLiteral("a.b")};
+    QTest::newRow("class escape") << QStringLiteral("\\d+px") << true << QStringList{QStringLiteral("px")};
+    QTest::newRow("word boundary") << QStringLiteral("\\bfoo\\b") << true << QStringList{QStringLiteral("foo")};
+    QTest::newRow("hex escape") << QStringLiteral("foo\\x41") << true << QStringList();
+    QTest::newRow("quoting") << QStringLiteral("\\Qfoo\\E") << true << QStringList();
+    QTest::newRow("trailing backslash") << QStringLiteral("foo\\") << true << QStringList();
+
+    // case folding maps the Kelvin sign to k and the long s to s, these are never searched bytewise
+    QTest::newRow("k and s") << QStringLiteral("task") << true << QStringList{QStringLiteral("task")};
+    QTest::newRow("k and s insensitive") << QStringLiteral("task") << false << QStringList{QStringLiteral("ta")};
+    QTest::newRow("kiss insensitive") << QStringLiteral("Kiss") << false << QStringList{QStringLiteral("i")};
+    QTest::newRow("non ascii") << QString::fromUtf8("gr\xC3\xBC\xC3\x9F" "e") << true << QStringList{QStringLiteral("gr"), QStringLiteral("e")};
+}
+
+void SearchTest::literalExtraction()
+{
+    QFETCH(QString, pattern);
+    QFETCH(bool, caseSensitive);
+    QFETCH(QStringList, literals);
+
+    const QRegularExpression regExp(pattern, caseSensitive ? QRegularExpression::NoPatternOption : QRegularExpression::CaseInsensitiveOption);
+    const LiteralPrefilter prefilter(regExp);
+    QCOMPARE(prefilter.literals(), literals);
+    QCOMPARE(prefilter.caseSensitive(), caseSensitive);
+    QCOMPARE(prefilter.isEmpty(), literals.isEmpty());
+
+    // extended patterns are never understood
+    QVERIFY(LiteralPrefilter(QRegularExpression(pattern, QRegularExpression::ExtendedPatternSyntaxOption)).isEmpty());
+}
+
+void SearchTest::literalFind()
+{
+    const QByteArray data("Hello world, hello WORLD");
+
+    // the longest literal is searched
+    const LiteralPrefilter sensitive(QRegularExpression(QStringLiteral("he.*world")));
+    QCOMPARE(sensitive.literals(), QStringList({QStringLiteral("he"), QStringLiteral("world")}));
+    QCOMPARE(sensitive.find(data.constData(), data.size(), 0), qint64(6));
+    QCOMPARE(sensitive.find(data.constData(), data.size(), 7), qint64(-1));
+
+    const LiteralPrefilter insensitive(QRegularExpression(QStringLiteral("world"), QRegularExpression::CaseInsensitiveOption));
+    QCOMPARE(insensitive.find(data.constData(), data.size(), 0), qint64(6));
+    QCOMPARE(insensitive.find(data.constData(), data.size(), 7), qint64(19));
+    QCOMPARE(insensitive.find(data.constData(), data.size(), 20), qint64(-1));
+
+    // a match at the very end, but not past it
+    QCOMPARE(insensitive.find(data.constData(), data.size() - 1, 7), qint64(-1));
+    QCOMPARE(LiteralPrefilter(QRegularExpression(QStringLiteral("foo|bar"))).find(data.constData(), data.size(), 0), qint64(-1));
+}
+
+/**
+ * a match of len characters on one line
+ */
+static KateSearchMatch searchMatch(int line, int column, int len, const QString &lineContent = QStringLiteral("some text with a match in it"))
+{
+    return KateSearchMatch{lineContent, len, line, column, line, column + len};
+}
+
+void SearchTest::matchModelMapping()
+{
+    MatchModel model;
+    QCOMPARE(model.rowCount(), 0);
+    QVERIFY(!model.rootIndex().isValid());
+
+    model.addMatches(QStringLiteral("/tmp/b.txt"), QString(), {searchMatch(0, 5, 4), searchMatch(3, 1, 2)});
+    model.addMatches(QStringLiteral("/tmp/a.txt"), QString(), {searchMatch(7, 0, 3)});
+    model.addMatches(QStringLiteral("/tmp/b.txt"), QString(), {searchMatch(9, 2, 1)});
+    QCOMPARE(model.rowCount(), 1);
+    QCOMPARE(model.fileCount(), 2);
+    QCOMPARE(model.findFile(QStringLiteral("/tmp/a.txt"), QString()), 1);
+    QCOMPARE(model.findFile(QStringLiteral("/tmp/c.txt"), QString()), -1);
+
+    const QModelIndex root = model.index(0, 0);
+    QCOMPARE(root, model.rootIndex());
+    QVERIFY(!model.parent(root).isValid());
+    QVERIFY(!model.isMatch(root));
+    QCOMPARE(model.fileRow(root), -1);
+    QCOMPARE(model.rowCount(root), 2);
+
+    // matches only remember the row of their file, the parent is found from it
+    const QVector<int> matchCounts{3, 1};
+    for (int fileRow = 0; fileRow < model.fileCount(); ++fileRow) {
+        const QModelIndex file = model.index(fileRow, 0, root);
+        QCOMPARE(model.parent(file), root);
+        QVERIFY(!model.isMatch(file));
+        QCOMPARE(model.fileRow(file), fileRow);
+        QCOMPARE(model.rowCount(file), matchCounts.at(fileRow));
+        QCOMPARE(file.data(ReplaceMatches::FileUrlRole).toString(), model.fileUrl(fileRow));
+
+        for (int matchRow = 0; matchRow < model.rowCount(file); ++matchRow) {
+            const QModelIndex match = model.index(matchRow, 0, file);
+            QCOMPARE(match, model.matchIndex(fileRow, matchRow));
+            QCOMPARE(model.parent(match), file);
+            QVERIFY(model.isMatch(match));
+            QCOMPARE(model.fileRow(match), fileRow);
+            QCOMPARE(model.rowCount(match), 0);
+            QCOMPARE(match.data(ReplaceMatches::StartLineRole).toInt(), model.fileMatches(fileRow).at(matchRow).range.start().line());
+        }
+    }
+    QCOMPARE(model.index(2, 0, model.index(0, 0, root)).data(ReplaceMatches::StartLineRole).toInt(), 9);
+
+    // nothing outside the rows and columns
+    QVERIFY(!model.index(1, 0).isValid());
+    QVERIFY(!model.index(2, 0, root).isValid());
+    QVERIFY(!model.index(0, 1, root).isValid());
+    QVERIFY(!model.index(0, 0, model.matchIndex(0, 0)).isValid());
+
+    // checking a file changes its matches and the root
+    QVERIFY(model.setData(model.index(0, 0, root), Qt::Unchecked, Qt::CheckStateRole));
+    QCOMPARE(model.checkedMatchCount(), 1);
+    QCOMPARE(model.matchIndex(0, 2).data(Qt::CheckStateRole).toInt(), int(Qt::Unchecked));
+    QCOMPARE(root.data(Qt::CheckStateRole).toInt(), int(Qt::PartiallyChecked));
+    model.setMatchCheckState(0, 1, Qt::Checked);
+    QCOMPARE(model.fileCheckState(0), Qt::PartiallyChecked);
+
+    model.clear();
+    QCOMPARE(model.rowCount(), 0);
+    QCOMPARE(model.fileCount(), 0);
+}
+
+void SearchTest::matchModelSorting()
+{
+    MatchModel model;
+    model.addMatches(QStringLiteral("/tmp/sub/a.txt"), QString(), {searchMatch(4, 0, 1)});
+    model.addMatches(QStringLiteral("/tmp/B.txt"), QString(), {searchMatch(2, 3, 1), searchMatch(2, 1, 1), searchMatch(0, 9, 1)});
+    model.addMatches(QStringLiteral("/tmp/a.txt"), QString(), {searchMatch(1, 0, 1)});
+
+    // files by depth and name ignoring the case, matches by position
+    model.sortResults();
+    QCOMPARE(model.fileUrl(0), QStringLiteral("/tmp/a.txt"));
+    QCOMPARE(model.fileUrl(1), QStringLiteral("/tmp/B.txt"));
+    QCOMPARE(model.fileUrl(2), QStringLiteral("/tmp/sub/a.txt"));
+    QCOMPARE(model.findFile(QStringLiteral("/tmp/sub/a.txt"), QString()), 2);
+
+    const QVector<MatchModel::Match> &matches = model.fileMatches(1);
+    QCOMPARE(matches.at(0).range.start(), KTextEditor::Cursor(0, 9));
+    QCOMPARE(matches.at(1).range.start(), KTextEditor::Cursor(2, 1));
+    QCOMPARE(matches.at(2).range.start(), KTextEditor::Cursor(2, 3));
+    QCOMPARE(model.matchIndex(1, 1).data(ReplaceMatches::StartColumnRole).toInt(), 1);
+    QCOMPARE(model.parent(model.matchIndex(2, 0)), model.index(2, 0, model.rootIndex()));
+}
+
+void SearchTest::matchModelFlat()
+{
+    // search-as-you-type: the matches of the document are the children of the root
+    MatchModel model;
+    model.addFlatRootItem(QStringLiteral("/tmp/a.txt"), QStringLiteral("a.txt"));
+    model.addMatches(QStringLiteral("/tmp/renamed.txt"), QStringLiteral("renamed.txt"), {searchMatch(0, 0, 4), searchMatch(1, 2, 4)});
+    QCOMPARE(model.fileCount(), 1);
+
+    const QModelIndex root = model.rootIndex();
+    QCOMPARE(model.rowCount(), 1);
+    QCOMPARE(model.rowCount(root), 2);
+    QCOMPARE(model.fileRow(root), 0);
+    QCOMPARE(root.data(ReplaceMatches::FileUrlRole).toString(), QStringLiteral("/tmp/a.txt"));
+
+    const QModelIndex match = model.index(1, 0, root);
+    QVERIFY(model.isMatch(match));
+    QCOMPARE(match, model.matchIndex(0, 1));
+    QCOMPARE(model.parent(match), root);
+    QCOMPARE(model.fileRow(match), 0);
+    QCOMPARE(match.data(ReplaceMatches::StartColumnRole).toInt(), 2);
+    QCOMPARE(match.data(ReplaceMatches::MatchRole).toString(), QStringLiteral("me t"));
+}
+
+void SearchTest::multiLineLookup()
+{
+    MultiLineText text;
+    text.appendLine(QStringLiteral("ab"));
+    text.appendLine(QString());
+    text.appendLine(QStringLiteral("cde"));
+    QCOMPARE(text.text(), QStringLiteral("ab\n\ncde"));
+    QCOMPARE(text.lineCount(), 3);
+    QCOMPARE(text.lineStart(1), 3);
+    QCOMPARE(text.lineStart(2), 4);
+
+    // the '\n' belongs to the line it ends, the last line runs to the end
+    const QVector<int> lines{0, 0, 0, 1, 2, 2, 2, 2};
+    for (int offset = 0; offset < lines.size(); ++offset) {
+        QCOMPARE(text.lineAt(offset), lines.at(offset));
+    }
+    QCOMPARE(text.lineAt(5, 2), 2);
+    QCOMPARE(text.lineAt(3, 1), 1);
+
+    text.clear();
+    QCOMPARE(text.lineCount(), 0);
+    text.appendLine(QStringLiteral("x"));
+    QCOMPARE(text.text(), QStringLiteral("x"));
+    QCOMPARE(text.lineAt(0), 0);
+}
+
+void SearchTest::multiLineWindowsText()
+{
+    MultiLineText text;
+    text.setText(QStringLiteral("one\r\ntwo\r\n\r\nthree\n"));
+    QCOMPARE(text.text(), QStringLiteral("one\ntwo\n\nthree\n"));
+
+    // the final line end doesn't start another line
+    QCOMPARE(text.lineCount(), 4);
+    QCOMPARE(text.lineStart(1), 4);
+    QCOMPARE(text.lineStart(2), 8);
+    QCOMPARE(text.lineStart(3), 9);
+    QCOMPARE(text.lineAt(14), 3);
+}
+
+void SearchTest::multiLineMatches()
+{
+    MultiLineText text;
+    text.appendLine(QStringLiteral("first line"));
+    text.appendLine(QStringLiteral("second line"));
+    text.appendLine(QStringLiteral("third"));
+
+    // a match over a line end
+    int lineHint = 0;
+    KateSearchMatch match = text.toSearchMatch(QRegularExpression(QStringLiteral("line\\nsecond")).match(text.text()), lineHint);
+    QCOMPARE(match.startLine, 0);
+    QCOMPARE(match.startColumn, 6);
+    QCOMPARE(match.endLine, 1);
+    QCOMPARE(match.endColumn, 6);
+    QCOMPARE(match.matchLen, 11);
+    QCOMPARE(match.lineContent, QStringLiteral("first line\nsecond"));
+
+    // '$' matches at every line end, the hint follows the matches
+    const QRegularExpression regExp(QStringLiteral("(line|third)$"));
+    text.appendFinalNewLine(regExp);
+    QVector<int> lines;
+    QVector<int> columns;
+    lineHint = 0;
+    QRegularExpressionMatchIterator it = MultiLineText::regExp(regExp).globalMatch(text.text());
+    while (it.hasNext()) {
+        match = text.toSearchMatch(it.next(), lineHint);
+        QCOMPARE(lineHint, match.startLine);
+        QCOMPARE(match.endLine, match.startLine);
+        lines << match.startLine;
+        columns << match.startColumn;
+    }
+    QCOMPARE(lines, QVector<int>({0, 1, 2}));
+    QCOMPARE(columns, QVector<int>({6, 7, 0}));
+}
+
+/**
+ * results of one file with a match on each of its lines
+ */
+static SearchResultCache::ResultSet resultSet(const QString &fileName, int lineCount, const QString &lineText = QStringLiteral("match"))
+{
+    SearchResultCache::FileResult result;
+    result.fingerprint.mtime = 1;
+    result.fingerprint.size = lineCount;
+    for (int line = 0; line < lineCount; ++line) {
+        result.matches << searchMatch(line, 0, 5, lineText + QString::number(line));
+    }
+    SearchResultCache::ResultSet results;
+    results.insert(fileName, result);
+    return results;
+}
+
+void SearchTest::cacheLeastRecentlyUsed()
+{
+    SearchResultCache cache(2);
+    cache.insert(QStringLiteral("a"), resultSet(QStringLiteral("/a"), 1), 0, 1);
+    cache.insert(QStringLiteral("b"), resultSet(QStringLiteral("/b"), 1), 0, 1);
+    QVERIFY(cache.find(QStringLiteral("a")));
+
+    // b is the least recently used one now
+    cache.insert(QStringLiteral("c"), resultSet(QStringLiteral("/c"), 1), 1, 2);
+    QVERIFY(!cache.find(QStringLiteral("b")));
+    QVERIFY(cache.find(QStringLiteral("a")));
+    QVERIFY(cache.find(QStringLiteral("c")));
+
+    SearchResultCache::Statistics statistics = cache.statistics();
+    QCOMPARE(statistics.resultSets, 2);
+    QCOMPARE(statistics.fileHits, qint64(1));
+    QCOMPARE(statistics.fileMisses, qint64(4));
+
+    // the statistics stay, only the results are dropped
+    cache.clear();
+    statistics = cache.statistics();
+    QCOMPARE(statistics.resultSets, 0);
+    QCOMPARE(statistics.memoryUsage, qint64(0));
+    QCOMPARE(statistics.fileMisses, qint64(4));
+    QVERIFY(!cache.find(QStringLiteral("a")));
+}
+
+void SearchTest::cacheMemoryBound()
+{
+    // the memory use of one result set
+    SearchResultCache unbounded;
+    unbounded.insert(QStringLiteral("a"), resultSet(QStringLiteral("/a"), 10), 0, 1);
+    const qint64 setUsage = unbounded.statistics().memoryUsage;
+    QVERIFY(setUsage > 0);
+
+    // memory for two sets of the same size, the oldest is dropped for the third one
+    SearchResultCache cache(8, 2 * setUsage + setUsage / 2);
+    cache.insert(QStringLiteral("a"), resultSet(QStringLiteral("/a"), 10), 0, 1);
+    cache.insert(QStringLiteral("b"), resultSet(QStringLiteral("/b"), 10), 0, 1);
+    cache.insert(QStringLiteral("c"), resultSet(QStringLiteral("/c"), 10), 0, 1);
+    QCOMPARE(cache.statistics().resultSets, 2);
+    QCOMPARE(cache.statistics().memoryUsage, 2 * setUsage);
+    QVERIFY(!cache.find(QStringLiteral("a")));
+
+    // a set larger than the bound is not stored, the old results of its key are gone
+    cache.insert(QStringLiteral("b"), resultSet(QStringLiteral("/b2"), 30), 0, 1);
+    QVERIFY(!cache.find(QStringLiteral("b")));
+    QVERIFY(cache.find(QStringLiteral("c")));
+    QCOMPARE(cache.statistics().memoryUsage, setUsage);
+}
+
+void SearchTest::cacheMergeOnInsert()
+{
+    SearchResultCache cache;
+    SearchResultCache::ResultSet first = resultSet(QStringLiteral("/one"), 1);
+    first.insert(QStringLiteral("/two"), resultSet(QStringLiteral("/two"), 1).value(QStringLiteral("/two")));
+    cache.insert(QStringLiteral("key"), first, 0, 2);
+    const SearchResultCache::SharedResultSet before = cache.find(QStringLiteral("key"));
+    QVERIFY(before);
+
+    // another folder searched for the same pattern, one file again with other matches
+    SearchResultCache::ResultSet second = resultSet(QStringLiteral("/two"), 3);
+    second.insert(QStringLiteral("/three"), resultSet(QStringLiteral("/three"), 1).value(QStringLiteral("/three")));
+    cache.insert(QStringLiteral("key"), second, 0, 2);
+    QCOMPARE(cache.statistics().resultSets, 1);
+
+    const SearchResultCache::SharedResultSet after = cache.find(QStringLiteral("key"));
+    QVERIFY(after);
+    QCOMPARE(after->size(), 3);
+    QVERIFY(after->contains(QStringLiteral("/one")));
+    QVERIFY(after->contains(QStringLiteral("/three")));
+    QCOMPARE(after->value(QStringLiteral("/two")).matches.size(), 3);
+
+    // the sets handed out before are not changed
+    QCOMPARE(before->size(), 2);
+    QCOMPARE(before->value(QStringLiteral("/two")).matches.size(), 1);
+}
+
+void SearchTest::cacheKeyAndFingerprint()
+{
+    const QString pattern = QStringLiteral("foo");
+    QCOMPARE(SearchResultCache::key(QRegularExpression(pattern)), SearchResultCache::key(QRegularExpression(pattern)));
+    QVERIFY(SearchResultCache::key(QRegularExpression(pattern)) != SearchResultCache::key(QRegularExpression(pattern, QRegularExpression::CaseInsensitiveOption)));
+    QVERIFY(SearchResultCache::key(QRegularExpression(pattern)) != SearchResultCache::key(QRegularExpression(QStringLiteral("fo"))));
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString fileName = dir.path() + QStringLiteral("/file.txt");
+    QVERIFY(!SearchResultCache::fingerprint(fileName).isValid());
+
+    QFile file(fileName);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write("foo");
+    file.close();
+    const SearchResultCache::Fingerprint fingerprint = SearchResultCache::fingerprint(fileName);
+    QVERIFY(fingerprint.isValid());
+    QCOMPARE(fingerprint.size, qint64(3));
+    QVERIFY(SearchResultCache::fingerprint(fileName) == fingerprint);
+
+    QVERIFY(file.open(QIODevice::Append));
+    file.write("bar");
+    file.close();
+    QVERIFY(!(SearchResultCache::fingerprint(fileName) == fingerprint));
+}
+
+void SearchTest::globMatching_data()
+{
+    QTest::addColumn<QStringList>("patterns");
+    QTest::addColumn<bool>("caseSensitive");
+    QTest::addColumn<QString>("text");
+    QTest::addColumn<bool>("matches");
+
+    const QStringList sources{QStringLiteral("*.cpp"), QStringLiteral("*.h")};
+    QTest::newRow("extension") << sources << true << QStringLiteral("main.cpp") << true;
+    QTest::newRow("other extension") << sources << true << QStringLiteral("main.c") << false;
+    QTest::newRow("last extension") << sources << true << QStringLiteral("main.cpp.orig") << false;
+    QTest::newRow("path") << sources << true << QStringLiteral("src/main.h") << true;
+    QTest::newRow("extension case") << sources << true << QStringLiteral("MAIN.CPP") << false;
+    QTest::newRow("extension no case") << sources << false << QStringLiteral("MAIN.CPP") << true;
+    QTest::newRow("no extension") << sources << true << QStringLiteral("cpp") << false;
+
+    const QStringList names{QStringLiteral("Makefile"), QStringLiteral("*.tar.gz")};
+    QTest::newRow("name") << names << true << QStringLiteral("Makefile") << true;
+    QTest::newRow("name part") << names << true << QStringLiteral("Makefile.am") << false;
+    QTest::newRow("name no case") << names << false << QStringLiteral("makefile") << true;
+    QTest::newRow("double extension") << names << true << QStringLiteral("kate.tar.gz") << true;
+    QTest::newRow("double extension part") << names << true << QStringLiteral("kate.gz") << false;
+
+    const QStringList wildcards{QStringLiteral("test?.c[px]*"), QStringLiteral("*_[!a-z].txt")};
+    QTest::newRow("question mark") << wildcards << true << QStringLiteral("test1.cpp") << true;
+    QTest::newRow("question mark missing") << wildcards << true << QStringLiteral("test.cpp") << false;
+    QTest::newRow("class") << wildcards << true << QStringLiteral("test1.cxx") << true;
+    QTest::newRow("class other") << wildcards << true << QStringLiteral("test1.cc") << false;
+    QTest::newRow("negated class") << wildcards << true << QStringLiteral("notes_1.txt") << true;
+    QTest::newRow("negated class other") << wildcards << true << QStringLiteral("notes_a.txt") << false;
+    QTest::newRow("star over slash") << wildcards << true << QStringLiteral("a/b_1.txt") << true;
+
+    QTest::newRow("all") << QStringList{QStringLiteral("*.cpp"), QStringLiteral("*")} << true << QStringLiteral("anything") << true;
+    QTest::newRow("empty") << QStringList{QString()} << true << QStringLiteral("anything") << false;
+}
+
+void SearchTest::globMatching()
+{
+    QFETCH(QStringList, patterns);
+    QFETCH(bool, caseSensitive);
+    QFETCH(QString, text);
+    QFETCH(bool, matches);
+
+    const GlobMatcher matcher(patterns, caseSensitive ? Qt::CaseSensitive : Qt::CaseInsensitive);
+    QCOMPARE(matcher.matches(text), matches);
+
+    // the hashed extensions and names match like the regular expression of the patterns
+    QStringList alternatives;
+    for (const QString &pattern : qAsConst(patterns)) {
+        if (!pattern.isEmpty()) {
+            alternatives << GlobMatcher::globToRegExp(pattern, false);
+        }
+    }
+    if (!alternatives.isEmpty()) {
+        QRegularExpression::PatternOptions options = QRegularExpression::DotMatchesEverythingOption;
+        if (!caseSensitive) {
+            options |= QRegularExpression::CaseInsensitiveOption;
+        }
+        const QRegularExpression regExp(QStringLiteral("\\A(?:") + alternatives.join(QLatin1Char('|')) + QStringLiteral(")\\z"), options);
+        QCOMPARE(regExp.match(text).hasMatch(), matches);
+    }
+}
+
+void SearchTest::globFromFilter()
+{
+    const GlobMatcher matcher = GlobMatcher::fromFilter(QStringLiteral(" *.cpp, ,Makefile ,"));
+    QVERIFY(!matcher.isEmpty());
+    QVERIFY(!matcher.matchesAll());
+    QVERIFY(matcher.matches(QStringLiteral("a.cpp")));
+    QVERIFY(matcher.matches(QStringLiteral("Makefile")));
+    QVERIFY(!matcher.matches(QStringLiteral(" Makefile")));
+
+    QVERIFY(GlobMatcher::fromFilter(QStringLiteral("*")).matchesAll());
+    QVERIFY(GlobMatcher::fromFilter(QString()).isEmpty());
+    QVERIFY(!GlobMatcher::fromFilter(QString()).matches(QStringLiteral("a.cpp")));
+
+    // path aware patterns as used for .gitignore
+    QCOMPARE(GlobMatcher::globToRegExp(QStringLiteral("a*/?"), true), QStringLiteral("a[^/]*\\/[^/]"));
+    QCOMPARE(GlobMatcher::globToRegExp(QStringLiteral("**/b/**"), true), QStringLiteral("(?:.*/)?b\\/.*"));
+    QCOMPARE(GlobMatcher::globToRegExp(QStringLiteral("a[b"), false), QStringLiteral("a\\[b"));
+}
+
+void SearchTest::gitIgnoreMatching_data()
+{
+    QTest::addColumn<QString>("path");
+    QTest::addColumn<bool>("isDir");
+    QTest::addColumn<int>("result");
+
+    QTest::newRow("extension") << QStringLiteral("a.o") << false << int(GitIgnoreMatcher::Ignored);
+    QTest::newRow("extension below") << QStringLiteral("sub/a.o") << false << int(GitIgnoreMatcher::Ignored);
+    QTest::newRow("negated") << QStringLiteral("keep.o") << false << int(GitIgnoreMatcher::Included);
+    QTest::newRow("negated below") << QStringLiteral("sub/keep.o") << false << int(GitIgnoreMatcher::Included);
+    QTest::newRow("other") << QStringLiteral("a.c") << false << int(GitIgnoreMatcher::NoMatch);
+
+    QTest::newRow("directory") << QStringLiteral("build") << true << int(GitIgnoreMatcher::Ignored);
+    QTest::newRow("directory below") << QStringLiteral("sub/build") << true << int(GitIgnoreMatcher::Ignored);
+    QTest::newRow("directory as file") << QStringLiteral("build") << false << int(GitIgnoreMatcher::NoMatch);
+
+    QTest::newRow("anchored") << QStringLiteral("root.txt") << false << int(GitIgnoreMatcher::Ignored);
+    QTest::newRow("anchored below") << QStringLiteral("sub/root.txt") << false << int(GitIgnoreMatcher::NoMatch);
+    QTest::newRow("star in path") << QStringLiteral("doc/a.txt") << false << int(GitIgnoreMatcher::Ignored);
+    QTest::newRow("star not over slash") << QStringLiteral("doc/sub/a.txt") << false << int(GitIgnoreMatcher::NoMatch);
+
+    QTest::newRow("double star no directory") << QStringLiteral("doc/a.html") << false << int(GitIgnoreMatcher::Ignored);
+    QTest::newRow("double star directories") << QStringLiteral("doc/a/b/c.html") << false << int(GitIgnoreMatcher::Ignored);
+    QTest::newRow("double star elsewhere") << QStringLiteral("src/doc/a.html") << false << int(GitIgnoreMatcher::NoMatch);
+    QTest::newRow("leading double star") << QStringLiteral("generated") << true << int(GitIgnoreMatcher::Ignored);
+    QTest::newRow("leading double star below") << QStringLiteral("a/b/generated") << false << int(GitIgnoreMatcher::Ignored);
+
+    QTest::newRow("comment") << QStringLiteral("# comment") << false << int(GitIgnoreMatcher::NoMatch);
+    QTest::newRow("escaped hash") << QStringLiteral("#hash") << false << int(GitIgnoreMatcher::Ignored);
+    QTest::newRow("trailing spaces") << QStringLiteral("trailing") << false << int(GitIgnoreMatcher::Ignored);
+}
+
+void SearchTest::gitIgnoreMatching()
+{
+    QFETCH(QString, path);
+    QFETCH(bool, isDir);
+    QFETCH(int, result);
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QVERIFY(GitIgnoreMatcher(dir.path()).isEmpty());
+
+    QFile file(dir.path() + QStringLiteral("/.gitignore"));
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write(
+        "# comment\n"
+        "*.o\n"
+        "!keep.o\n"
+        "build/\n"
+        "/root.txt\n"
+        "doc/*.txt\r\n"
+        "doc/**/*.html\n"
+        "**/generated\n"
+        "\\#hash\n"
+        "trailing   \n");
+    file.close();
+
+    const GitIgnoreMatcher matcher(dir.path());
+    QVERIFY(!matcher.isEmpty());
+    QCOMPARE(int(matcher.match(path, path.mid(path.lastIndexOf(QLatin1Char('/')) + 1), isDir)), result);
+}
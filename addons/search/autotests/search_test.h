@@ -0,0 +1,55 @@
+/*   Kate search plugin
+ *
+ * Copyright (C) 2020 by Kate Developers <kwrite-devel@kde.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program in a file called COPYING; if not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#ifndef KATE_SEARCH_TEST_H
+#define KATE_SEARCH_TEST_H
+
+#include <QObject>
+
+class SearchTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void literalExtraction_data();
+    void literalExtraction();
+    void literalFind();
+
+    void matchModelMapping();
+    void matchModelSorting();
+    void matchModelFlat();
+
+    void multiLineLookup();
+    void multiLineWindowsText();
+    void multiLineMatches();
+
+    void cacheLeastRecentlyUsed();
+    void cacheMemoryBound();
+    void cacheMergeOnInsert();
+    void cacheKeyAndFingerprint();
+
+    void globMatching_data();
+    void globMatching();
+    void globFromFilter();
+    void gitIgnoreMatching_data();
+    void gitIgnoreMatching();
+};
+
+#endif
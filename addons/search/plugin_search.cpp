@@ -20,8 +20,11 @@
 
 #include "plugin_search.h"
 
+#include "GlobMatcher.h"
 #include "htmldelegate.h"
 
+#include "documentplaceholder.h"
+
 #include <ktexteditor/application.h>
 #include <ktexteditor/configinterface.h>
 #include <ktexteditor/document.h>
@@ -50,6 +53,7 @@
 #include <QDir>
 #include <QFileInfo>
 #include <QKeyEvent>
+#include <QLocale>
 #include <QMenu>
 #include <QMetaObject>
 #include <QScrollBar>
@@ -171,53 +175,12 @@ static void regexHelperActOnAction(QAction *resultAction, const QSet<QAction *>
     }
 }
 
-class TreeWidgetItem : public QTreeWidgetItem
-{
-public:
-    TreeWidgetItem(QTreeWidget *parent)
-        : QTreeWidgetItem(parent)
-    {
-    }
-    TreeWidgetItem(QTreeWidget *parent, const QStringList &list)
-        : QTreeWidgetItem(parent, list)
-    {
-    }
-    TreeWidgetItem(QTreeWidgetItem *parent, const QStringList &list)
-        : QTreeWidgetItem(parent, list)
-    {
-    }
-
-private:
-    bool operator<(const QTreeWidgetItem &other) const override
-    {
-        if (childCount() == 0) {
-            int line = data(0, ReplaceMatches::StartLineRole).toInt();
-            int column = data(0, ReplaceMatches::StartColumnRole).toInt();
-            int oLine = other.data(0, ReplaceMatches::StartLineRole).toInt();
-            int oColumn = other.data(0, ReplaceMatches::StartColumnRole).toInt();
-            if (line < oLine) {
-                return true;
-            }
-            if ((line == oLine) && (column < oColumn)) {
-                return true;
-            }
-            return false;
-        }
-        int sepCount = data(0, ReplaceMatches::FileUrlRole).toString().count(QDir::separator());
-        int oSepCount = other.data(0, ReplaceMatches::FileUrlRole).toString().count(QDir::separator());
-        if (sepCount < oSepCount)
-            return true;
-        if (sepCount > oSepCount)
-            return false;
-        return data(0, ReplaceMatches::FileUrlRole).toString().toLower() < other.data(0, ReplaceMatches::FileUrlRole).toString().toLower();
-    }
-};
-
 Results::Results(QWidget *parent)
     : QWidget(parent)
 {
     setupUi(this);
 
+    tree->setModel(&matchModel);
     tree->setItemDelegate(new SPHtmlDelegate(tree));
 }
 
@@ -267,7 +230,7 @@ void KatePluginSearchView::nextFocus(QWidget *currentWidget, bool *found, bool n
 
     // we use the object names here because there can be multiple replaceButtons (on multiple result tabs)
     if (next) {
-        if (currentWidget->objectName() == QLatin1String("tree") || currentWidget == m_ui.binaryCheckBox) {
+        if (currentWidget->objectName() == QLatin1String("tree") || currentWidget == m_ui.gitIgnoreCheckBox) {
             m_ui.newTabButton->setFocus();
             *found = true;
             return;
@@ -290,7 +253,7 @@ void KatePluginSearchView::nextFocus(QWidget *currentWidget, bool *found, bool n
     } else {
         if (currentWidget == m_ui.newTabButton) {
             if (m_ui.displayOptions->isChecked()) {
-                m_ui.binaryCheckBox->setFocus();
+                m_ui.gitIgnoreCheckBox->setFocus();
             } else {
                 Results *res = qobject_cast<Results *>(m_ui.resultTabWidget->currentWidget());
                 if (!res) {
@@ -446,18 +409,17 @@ KatePluginSearchView::KatePluginSearchView(KTextEditor::Plugin *plugin, KTextEdi
 
     m_ui.displayOptions->setChecked(true);
 
-    connect(&m_searchOpenFiles, &SearchOpenFiles::matchFound, this, &KatePluginSearchView::matchFound);
+    connect(&m_searchOpenFiles, &SearchOpenFiles::matchesFound, this, &KatePluginSearchView::matchesFound);
     connect(&m_searchOpenFiles, &SearchOpenFiles::searchDone, this, &KatePluginSearchView::searchDone);
     connect(&m_searchOpenFiles, static_cast<void (SearchOpenFiles::*)(const QString &)>(&SearchOpenFiles::searching), this, &KatePluginSearchView::searching);
 
     connect(&m_folderFilesList, &FolderFilesList::finished, this, &KatePluginSearchView::folderFileListChanged);
     connect(&m_folderFilesList, &FolderFilesList::searching, this, &KatePluginSearchView::searching);
 
-    connect(&m_searchDiskFiles, &SearchDiskFiles::matchFound, this, &KatePluginSearchView::matchFound);
+    connect(&m_searchDiskFiles, &SearchDiskFiles::matchesFound, this, &KatePluginSearchView::matchesFound);
     connect(&m_searchDiskFiles, &SearchDiskFiles::searchDone, this, &KatePluginSearchView::searchDone);
     connect(&m_searchDiskFiles, static_cast<void (SearchDiskFiles::*)(const QString &)>(&SearchDiskFiles::searching), this, &KatePluginSearchView::searching);
-
-    connect(m_kateApp, &KTextEditor::Application::documentWillBeDeleted, &m_searchOpenFiles, &SearchOpenFiles::cancelSearch);
+    m_searchDiskFiles.setResultCache(&m_resultCache);
 
     connect(m_kateApp, &KTextEditor::Application::documentWillBeDeleted, &m_replacer, &ReplaceMatches::cancelReplace);
 
@@ -549,6 +511,10 @@ KatePluginSearchView::KatePluginSearchView(KTextEditor::Plugin *plugin, KTextEdi
     m_updateSumaryTimer.setInterval(1);
     m_updateSumaryTimer.setSingleShot(true);
     connect(&m_updateSumaryTimer, &QTimer::timeout, this, &KatePluginSearchView::updateResultsRootItem);
+
+    m_highlightTimer.setInterval(50);
+    m_highlightTimer.setSingleShot(true);
+    connect(&m_highlightTimer, &QTimer::timeout, this, &KatePluginSearchView::updateViewHighlights);
 }
 
 KatePluginSearchView::~KatePluginSearchView()
@@ -634,7 +600,7 @@ void KatePluginSearchView::handleEsc(QEvent *e)
             return;
         }
         lastTimeStamp = k->timestamp();
-        if (!m_matchRanges.isEmpty()) {
+        if (!m_matchHighlights.isEmpty()) {
             clearMarks();
         } else if (m_toolView->isVisible()) {
             m_mainWindow->hideToolView(m_toolView);
@@ -646,10 +612,9 @@ void KatePluginSearchView::handleEsc(QEvent *e)
             qWarning() << "This is a bug";
             return;
         }
-        QTreeWidgetItemIterator it(curResults->tree);
-        while (*it) {
-            (*it)->setCheckState(0, Qt::Unchecked);
-            ++it;
+        const QModelIndex root = curResults->matchModel.rootIndex();
+        if (root.isValid()) {
+            curResults->matchModel.setData(root, Qt::Unchecked, Qt::CheckStateRole);
         }
     }
 }
@@ -669,93 +634,96 @@ void KatePluginSearchView::setSearchPlace(int place)
     m_ui.searchPlaceCombo->setCurrentIndex(place);
 }
 
-QStringList KatePluginSearchView::filterFiles(const QStringList &files) const
+QStringList KatePluginSearchView::filterFiles(const PathStore &files) const
 {
     QString types = m_ui.filterCombo->currentText();
     QString excludes = m_ui.excludeCombo->currentText();
     if (((types.isEmpty() || types == QLatin1String("*"))) && (excludes.isEmpty())) {
         // shortcut for use all files
-        return files;
+        return files.toStringList();
     }
 
-    QStringList tmpTypes = types.split(QLatin1Char(','));
-    QVector<QRegExp> typeList(tmpTypes.size());
-    for (int i = 0; i < tmpTypes.size(); i++) {
-        QRegExp rx(tmpTypes[i].trimmed());
-        rx.setPatternSyntax(QRegExp::Wildcard);
-        typeList << rx;
-    }
-
-    QStringList tmpExcludes = excludes.split(QLatin1Char(','));
-    QVector<QRegExp> excludeList(tmpExcludes.size());
-    for (int i = 0; i < tmpExcludes.size(); i++) {
-        QRegExp rx(tmpExcludes[i].trimmed());
-        rx.setPatternSyntax(QRegExp::Wildcard);
-        excludeList << rx;
-    }
+    // compiled once per filter, the same filters are used for every search
+    const GlobMatcher typeMatcher = GlobMatcher::fromFilter(types);
+    const GlobMatcher excludeMatcher = GlobMatcher::fromFilter(excludes);
 
     QStringList filteredFiles;
-    for (const QString &fileName : files) {
-        bool isInSubDir = fileName.startsWith(m_resultBaseDir);
-        QString nameToCheck = fileName;
-        if (isInSubDir) {
-            nameToCheck = fileName.mid(m_resultBaseDir.size());
+    filteredFiles.reserve(files.size());
+    for (int i = 0; i < files.size(); ++i) {
+        const QString fileName = files.at(i);
+        const QString nameToCheck = fileName.startsWith(m_resultBaseDir) ? fileName.mid(m_resultBaseDir.size()) : fileName;
+        if (excludeMatcher.matches(nameToCheck)) {
+            continue;
+        }
+        if (typeMatcher.isEmpty() || typeMatcher.matches(nameToCheck)) {
+            filteredFiles << fileName;
         }
+    }
+    return filteredFiles;
+}
 
-        bool skip = false;
-        for (const auto &regex : qAsConst(excludeList)) {
-            if (regex.exactMatch(nameToCheck)) {
-                skip = true;
-                break;
+QList<KTextEditor::Document *> KatePluginSearchView::takeOpenFiles(QStringList &files) const
+{
+    // Kate looks the files up in its url index, elsewhere index the documents here
+    QList<KTextEditor::Document *> fileDocs;
+    if (!m_kateApp->parent()
+        || !QMetaObject::invokeMethod(m_kateApp->parent(),
+                                      "documentsForLocalFiles",
+                                      Qt::DirectConnection,
+                                      Q_RETURN_ARG(QList<KTextEditor::Document *>, fileDocs),
+                                      Q_ARG(QStringList, files))
+        || fileDocs.size() != files.size()) {
+        QHash<QString, KTextEditor::Document *> openFiles;
+        const auto docs = m_kateApp->documents();
+        for (const auto doc : docs) {
+            if (doc->url().isLocalFile()) {
+                openFiles.insert(doc->url().toLocalFile(), doc);
             }
         }
-        if (skip) {
-            continue;
+        fileDocs.clear();
+        fileDocs.reserve(files.size());
+        for (const QString &file : qAsConst(files)) {
+            fileDocs.append(openFiles.value(file));
         }
+    }
 
-        for (const auto &regex : qAsConst(typeList)) {
-            if (regex.exactMatch(nameToCheck)) {
-                filteredFiles << fileName;
-                break;
-            }
+    QList<KTextEditor::Document *> openList;
+    QSet<KTextEditor::Document *> seenDocs;
+    QStringList diskFiles;
+    diskFiles.reserve(files.size());
+    for (int i = 0; i < files.size(); ++i) {
+        KTextEditor::Document *doc = fileDocs.at(i);
+        // the same document is searched only once
+        if (!doc) {
+            diskFiles.append(files.at(i));
+        } else if (!seenDocs.contains(doc)) {
+            seenDocs.insert(doc);
+            openList.append(doc);
         }
     }
-    return filteredFiles;
+    files = diskFiles;
+    return openList;
 }
 
 void KatePluginSearchView::folderFileListChanged()
 {
-    m_searchDiskFilesDone = false;
-    m_searchOpenFilesDone = false;
-
     if (!m_curResults) {
         qWarning() << "This is a bug";
-        m_searchDiskFilesDone = true;
         m_searchOpenFilesDone = true;
         searchDone();
         return;
     }
-    QStringList fileList = m_folderFilesList.fileList();
 
-    QList<KTextEditor::Document *> openList;
-    for (int i = 0; i < m_kateApp->documents().size(); i++) {
-        int index = fileList.indexOf(m_kateApp->documents()[i]->url().toLocalFile());
-        if (index != -1) {
-            openList << m_kateApp->documents()[i];
-            fileList.removeAt(index);
-        }
-    }
+    // the disk files are already searched while the folder was listed
+    QStringList openFiles = m_folderFilesList.openFiles();
+    const QList<KTextEditor::Document *> openList = takeOpenFiles(openFiles);
 
-    // search order is important: Open files starts immediately and should finish
-    // earliest after first event loop.
-    // The DiskFile might finish immediately
     if (!openList.empty()) {
         m_searchOpenFiles.startSearch(openList, m_curResults->regExp);
     } else {
         m_searchOpenFilesDone = true;
+        searchDone();
     }
-
-    m_searchDiskFiles.startSearch(fileList, m_curResults->regExp);
 }
 
 void KatePluginSearchView::searchPlaceChanged()
@@ -772,6 +740,7 @@ void KatePluginSearchView::searchPlaceChanged()
     m_ui.hiddenCheckBox->setEnabled(inFolder);
     m_ui.symLinkCheckBox->setEnabled(inFolder);
     m_ui.binaryCheckBox->setEnabled(inFolder);
+    m_ui.gitIgnoreCheckBox->setEnabled(inFolder);
 
     if (inFolder && sender() == m_ui.searchPlaceCombo) {
         setCurrentFolder();
@@ -790,186 +759,129 @@ void KatePluginSearchView::searchPlaceChanged()
 
 void KatePluginSearchView::addHeaderItem()
 {
-    QTreeWidgetItem *item = new QTreeWidgetItem(m_curResults->tree, QStringList());
-    item->setCheckState(0, Qt::Checked);
-    item->setFlags(item->flags() | Qt::ItemIsAutoTristate);
-    m_curResults->tree->expandItem(item);
+    m_curResults->matchModel.setBaseSearchPath(m_resultBaseDir);
+    m_curResults->matchModel.addRootItem();
+    m_curResults->tree->expand(m_curResults->matchModel.rootIndex());
 }
 
-QTreeWidgetItem *KatePluginSearchView::rootFileItem(const QString &url, const QString &fName)
+void KatePluginSearchView::updateHighlights(KTextEditor::Document *doc)
 {
-    if (!m_curResults) {
-        return nullptr;
-    }
-
-    QUrl fullUrl = QUrl::fromUserInput(url);
-    QString path = fullUrl.isLocalFile() ? localFileDirUp(fullUrl).path() : fullUrl.url();
-    if (!path.isEmpty() && !path.endsWith(QLatin1Char('/'))) {
-        path += QLatin1Char('/');
-    }
-    path.remove(m_resultBaseDir);
-    QString name = fullUrl.fileName();
-    if (url.isEmpty()) {
-        name = fName;
-    }
-
-    // make sure we have a root item
-    if (m_curResults->tree->topLevelItemCount() == 0) {
-        addHeaderItem();
-    }
-    QTreeWidgetItem *root = m_curResults->tree->topLevelItem(0);
-
-    if (m_isSearchAsYouType) {
-        return root;
+    auto it = m_matchHighlights.find(doc);
+    if (it == m_matchHighlights.end()) {
+        return;
     }
+    DocumentHighlights &highlights = it.value();
+    KTextEditor::MovingInterface *miface = qobject_cast<KTextEditor::MovingInterface *>(doc);
 
-    for (int i = 0; i < root->childCount(); i++) {
-        // qDebug() << root->child(i)->data(0, ReplaceMatches::FileNameRole).toString() << fName;
-        if ((root->child(i)->data(0, ReplaceMatches::FileUrlRole).toString() == url) && (root->child(i)->data(0, ReplaceMatches::FileNameRole).toString() == fName)) {
-            int matches = root->child(i)->data(0, ReplaceMatches::StartLineRole).toInt() + 1;
-            QString tmpUrl = QStringLiteral("%1<b>%2</b>: <b>%3</b>").arg(path, name).arg(matches);
-            root->child(i)->setData(0, Qt::DisplayRole, tmpUrl);
-            root->child(i)->setData(0, ReplaceMatches::StartLineRole, matches);
-            return root->child(i);
+    // bring the matches that are not highlighted to the current revision
+    const qint64 revision = miface->revision();
+    if (revision != highlights.revision) {
+        for (HighlightedMatch &match : highlights.matches) {
+            if (!match.movingRange) {
+                miface->transformRange(match.range, KTextEditor::MovingRange::DoNotExpand, KTextEditor::MovingRange::AllowEmpty, highlights.revision, revision);
+            }
         }
+        miface->lockRevision(revision);
+        miface->unlockRevision(highlights.revision);
+        highlights.revision = revision;
     }
 
-    // file item not found create a new one
-    QString tmpUrl = QStringLiteral("%1<b>%2</b>: <b>%3</b>").arg(path, name).arg(1);
-
-    TreeWidgetItem *item = new TreeWidgetItem(root, QStringList(tmpUrl));
-    item->setData(0, ReplaceMatches::FileUrlRole, url);
-    item->setData(0, ReplaceMatches::FileNameRole, fName);
-    item->setData(0, ReplaceMatches::StartLineRole, 1);
-    item->setCheckState(0, Qt::Checked);
-    item->setFlags(item->flags() | Qt::ItemIsAutoTristate);
-    return item;
-}
-
-void KatePluginSearchView::addMatchMark(KTextEditor::Document *doc, QTreeWidgetItem *item)
-{
-    if (!doc || !item) {
-        return;
+    // the lines shown in the views of the document
+    QVector<QPair<int, int>> visibleLines;
+    const auto views = doc->views();
+    for (KTextEditor::View *view : views) {
+        if (view->isVisible()) {
+            visibleLines.append(qMakePair(view->firstDisplayedLine(), view->lastDisplayedLine()));
+        }
     }
 
     KTextEditor::View *activeView = m_mainWindow->activeView();
-    KTextEditor::MovingInterface *miface = qobject_cast<KTextEditor::MovingInterface *>(doc);
     KTextEditor::ConfigInterface *ciface = qobject_cast<KTextEditor::ConfigInterface *>(activeView);
-    KTextEditor::Attribute::Ptr attr(new KTextEditor::Attribute());
-
-    int line = item->data(0, ReplaceMatches::StartLineRole).toInt();
-    int column = item->data(0, ReplaceMatches::StartColumnRole).toInt();
-    int endLine = item->data(0, ReplaceMatches::EndLineRole).toInt();
-    int endColumn = item->data(0, ReplaceMatches::EndColumnRole).toInt();
-    bool isReplaced = item->data(0, ReplaceMatches::ReplacedRole).toBool();
-
-    if (isReplaced) {
-        QColor replaceColor(Qt::green);
-        if (ciface)
-            replaceColor = ciface->configValue(QStringLiteral("replace-highlight-color")).value<QColor>();
-        attr->setBackground(replaceColor);
+    KTextEditor::Attribute::Ptr searchAttr(new KTextEditor::Attribute());
+    KTextEditor::Attribute::Ptr replaceAttr(new KTextEditor::Attribute());
+    QColor searchColor(Qt::yellow);
+    QColor replaceColor(Qt::green);
+    if (ciface) {
+        searchColor = ciface->configValue(QStringLiteral("search-highlight-color")).value<QColor>();
+        replaceColor = ciface->configValue(QStringLiteral("replace-highlight-color")).value<QColor>();
+    }
+    searchAttr->setBackground(searchColor);
+    replaceAttr->setBackground(replaceColor);
+    if (activeView) {
+        const QColor foreground = activeView->defaultStyleAttribute(KTextEditor::dsNormal)->foreground().color();
+        searchAttr->setForeground(foreground);
+        replaceAttr->setForeground(foreground);
+    }
+
+    for (HighlightedMatch &match : highlights.matches) {
+        bool visible = false;
+        for (const auto &lines : qAsConst(visibleLines)) {
+            if (match.range.start().line() <= lines.second && match.range.end().line() >= lines.first) {
+                visible = true;
+                break;
+            }
+        }
 
-        if (activeView) {
-            attr->setForeground(activeView->defaultStyleAttribute(KTextEditor::dsNormal)->foreground().color());
+        // scrolled out of view, no need to track it with every edit anymore
+        if (!visible) {
+            if (match.movingRange) {
+                match.range = match.movingRange->toRange();
+                delete match.movingRange;
+                match.movingRange = nullptr;
+            }
+            continue;
+        }
+        if (match.movingRange || match.invalid) {
+            continue;
         }
-    } else {
-        QColor searchColor(Qt::yellow);
-        if (ciface)
-            searchColor = ciface->configValue(QStringLiteral("search-highlight-color")).value<QColor>();
-        attr->setBackground(searchColor);
 
-        if (activeView) {
-            attr->setForeground(activeView->defaultStyleAttribute(KTextEditor::dsNormal)->foreground().color());
+        // Check that the match still matches ;)
+        const QString text = doc->text(match.range);
+        if (match.replaced ? text != match.replaceText : highlights.regExp.match(text).capturedStart() != 0) {
+            match.invalid = true;
+            continue;
         }
-    }
 
-    KTextEditor::Range range(line, column, endLine, endColumn);
+        // Highlight the match
+        KTextEditor::MovingRange *mr = miface->newMovingRange(match.range);
+        mr->setAttribute(match.replaced ? replaceAttr : searchAttr);
+        mr->setZDepth(-90000.0); // Set the z-depth to slightly worse than the selection
+        mr->setAttributeOnlyForViews(true);
+        match.movingRange = mr;
+    }
+}
 
-    // Check that the match still matches
-    if (m_curResults) {
-        if (!isReplaced) {
-            // special handling for "(?=\\n)" in multi-line search
-            QRegularExpression tmpReg = m_curResults->regExp;
-            if (m_curResults->regExp.pattern().endsWith(QLatin1String("(?=\\n)"))) {
-                QString newPatern = tmpReg.pattern();
-                newPatern.replace(QStringLiteral("(?=\\n)"), QStringLiteral("$"));
-                tmpReg.setPattern(newPatern);
-            }
+void KatePluginSearchView::updateViewHighlights()
+{
+    if (m_mainWindow->activeView()) {
+        updateHighlights(m_mainWindow->activeView()->document());
+    }
+}
 
-            // Check that the match still matches ;)
-            if (tmpReg.match(doc->text(range)).capturedStart() != 0) {
-                // qDebug() << doc->text(range) << "Does not match" << m_curResults->regExp.pattern();
-                return;
-            }
-        } else {
-            if (doc->text(range) != item->data(0, ReplaceMatches::ReplacedTextRole).toString()) {
-                // qDebug() << doc->text(range) << "Does not match" << item->data(0, ReplaceMatches::ReplacedTextRole).toString();
-                return;
-            }
+bool KatePluginSearchView::isHighlightedMatch(KTextEditor::Document *doc, const KTextEditor::Cursor &start)
+{
+    updateHighlights(doc);
+    auto it = m_matchHighlights.constFind(doc);
+    if (it == m_matchHighlights.constEnd()) {
+        return false;
+    }
+    for (const HighlightedMatch &match : it->matches) {
+        const KTextEditor::Cursor matchStart = match.movingRange ? match.movingRange->start().toCursor() : match.range.start();
+        if (!match.invalid && matchStart == start) {
+            return true;
         }
     }
-
-    // Highlight the match
-    KTextEditor::MovingRange *mr = miface->newMovingRange(range);
-    mr->setAttribute(attr);
-    mr->setZDepth(-90000.0); // Set the z-depth to slightly worse than the selection
-    mr->setAttributeOnlyForViews(true);
-    m_matchRanges.append(mr);
-
-    // Add a match mark
-    KTextEditor::MarkInterface *iface = qobject_cast<KTextEditor::MarkInterface *>(doc);
-    if (!iface)
-        return;
-    iface->setMarkDescription(KTextEditor::MarkInterface::markType32, i18n("SearchHighLight"));
-    iface->setMarkPixmap(KTextEditor::MarkInterface::markType32, QIcon().pixmap(0, 0));
-    iface->addMark(line, KTextEditor::MarkInterface::markType32);
-
-    connect(doc, SIGNAL(aboutToInvalidateMovingInterfaceContent(KTextEditor::Document *)), this, SLOT(clearMarks()), Qt::UniqueConnection);
+    return false;
 }
 
-static const int contextLen = 70;
-
-void KatePluginSearchView::matchFound(const QString &url, const QString &fName, const QString &lineContent, int matchLen, int startLine, int startColumn, int endLine, int endColumn)
+void KatePluginSearchView::matchesFound(const QString &url, const QString &fName, const QVector<KateSearchMatch> &searchMatches)
 {
     if (!m_curResults) {
         return;
     }
-    int preLen = contextLen;
-    int preStart = startColumn - preLen;
-    if (preStart < 0) {
-        preLen += preStart;
-        preStart = 0;
-    }
-    QString pre;
-    if (preLen == contextLen) {
-        pre = QStringLiteral("...");
-    }
-    pre += lineContent.mid(preStart, preLen).toHtmlEscaped();
-    QString match = lineContent.mid(startColumn, matchLen).toHtmlEscaped();
-    match.replace(QLatin1Char('\n'), QStringLiteral("\\n"));
-    QString post = lineContent.mid(startColumn + matchLen, contextLen);
-    if (post.size() >= contextLen) {
-        post += QStringLiteral("...");
-    }
-    post = post.toHtmlEscaped();
-    QStringList row;
-    row << i18n("Line: <b>%1</b> Column: <b>%2</b>: %3", startLine + 1, startColumn + 1, pre + QStringLiteral("<b>") + match + QStringLiteral("</b>") + post);
-
-    TreeWidgetItem *item = new TreeWidgetItem(rootFileItem(url, fName), row);
-    item->setData(0, ReplaceMatches::FileUrlRole, url);
-    item->setData(0, Qt::ToolTipRole, url);
-    item->setData(0, ReplaceMatches::FileNameRole, fName);
-    item->setData(0, ReplaceMatches::StartLineRole, startLine);
-    item->setData(0, ReplaceMatches::StartColumnRole, startColumn);
-    item->setData(0, ReplaceMatches::MatchLenRole, matchLen);
-    item->setData(0, ReplaceMatches::PreMatchRole, pre);
-    item->setData(0, ReplaceMatches::MatchRole, match);
-    item->setData(0, ReplaceMatches::PostMatchRole, post);
-    item->setData(0, ReplaceMatches::EndLineRole, endLine);
-    item->setData(0, ReplaceMatches::EndColumnRole, endColumn);
-    item->setCheckState(0, Qt::Checked);
-
-    m_curResults->matches++;
+
+    m_curResults->matchModel.addMatches(url, fName, searchMatches);
+    m_curResults->matches += searchMatches.size();
 }
 
 void KatePluginSearchView::clearMarks()
@@ -978,8 +890,7 @@ void KatePluginSearchView::clearMarks()
     for (KTextEditor::Document *doc : docs) {
         clearDocMarks(doc);
     }
-    qDeleteAll(m_matchRanges);
-    m_matchRanges.clear();
+    m_matchHighlights.clear();
 }
 
 void KatePluginSearchView::clearDocMarks(KTextEditor::Document *doc)
@@ -997,14 +908,16 @@ void KatePluginSearchView::clearDocMarks(KTextEditor::Document *doc)
         }
     }
 
-    int i = 0;
-    while (i < m_matchRanges.size()) {
-        if (m_matchRanges.at(i)->document() == doc) {
-            delete m_matchRanges.at(i);
-            m_matchRanges.removeAt(i);
-        } else {
-            i++;
+    auto it = m_matchHighlights.find(doc);
+    if (it != m_matchHighlights.end()) {
+        for (const HighlightedMatch &match : qAsConst(it->matches)) {
+            delete match.movingRange;
+        }
+        KTextEditor::MovingInterface *miface = qobject_cast<KTextEditor::MovingInterface *>(doc);
+        if (miface) {
+            miface->unlockRevision(it->revision);
         }
+        m_matchHighlights.erase(it);
     }
 
     m_curResults = qobject_cast<Results *>(m_ui.resultTabWidget->currentWidget());
@@ -1085,16 +998,17 @@ void KatePluginSearchView::startSearch()
     m_ui.currentFolderButton->setDisabled(true);
 
     clearMarks();
-    m_curResults->tree->clear();
-    m_curResults->tree->setCurrentItem(nullptr);
+    m_curResults->matchModel.clear();
     m_curResults->matches = 0;
-    disconnect(m_curResults->tree, &QTreeWidget::itemChanged, &m_updateSumaryTimer, nullptr);
+    disconnect(&m_curResults->matchModel, &MatchModel::dataChanged, &m_updateSumaryTimer, nullptr);
 
     m_ui.resultTabWidget->setTabText(m_ui.resultTabWidget->currentIndex(), m_ui.searchCombo->currentText());
 
     m_toolView->setCursor(Qt::WaitCursor);
     m_searchDiskFilesDone = false;
     m_searchOpenFilesDone = false;
+    m_searchTime.start();
+    m_curResults->searchStarted = QDateTime::currentDateTime();
 
     const bool inCurrentProject = m_ui.searchPlaceCombo->currentIndex() == Project;
     const bool inAllOpenProjects = m_ui.searchPlaceCombo->currentIndex() == AllProjects;
@@ -1110,24 +1024,53 @@ void KatePluginSearchView::startSearch()
         addHeaderItem();
         m_searchOpenFiles.startSearch(documents, reg);
     } else if (m_ui.searchPlaceCombo->currentIndex() == OpenFiles) {
-        m_searchDiskFilesDone = true;
         m_resultBaseDir.clear();
-        const QList<KTextEditor::Document *> documents = m_kateApp->documents();
+        // documents that are not loaded yet have the content on disk
+        QList<KTextEditor::Document *> documents;
+        QStringList diskFiles;
+        const auto docs = m_kateApp->documents();
+        for (const auto doc : docs) {
+            const QUrl url = DocumentPlaceholder::placeholderUrl(doc);
+            if (url.isEmpty()) {
+                documents << doc;
+            } else if (url.isLocalFile()) {
+                diskFiles << url.toLocalFile();
+            }
+        }
         addHeaderItem();
         m_searchOpenFiles.startSearch(documents, reg);
+        m_searchDiskFiles.startSearch(diskFiles, reg);
     } else if (m_ui.searchPlaceCombo->currentIndex() == Folder) {
         m_resultBaseDir = m_ui.folderRequester->url().path();
         if (!m_resultBaseDir.isEmpty() && !m_resultBaseDir.endsWith(QLatin1Char('/')))
             m_resultBaseDir += QLatin1Char('/');
         addHeaderItem();
+
+        // open documents are searched in the editor, not on disk
+        QSet<QString> openFiles;
+        const auto docs = m_kateApp->documents();
+        for (const auto doc : docs) {
+            if (doc->url().isLocalFile()) {
+                openFiles.insert(doc->url().toLocalFile());
+            }
+        }
+
+        // the files are searched while the folder is listed, the open ones
+        // once the listing is done (connected to folderFileListChanged)
+        // the queue is reset for the new search, the previous listing must not fill it anymore
+        m_folderFilesList.cancelSearch();
+        m_folderFilesList.wait();
+        m_searchDiskFiles.startQueuedSearch(reg);
         m_folderFilesList.generateList(m_ui.folderRequester->text(),
                                        m_ui.recursiveCheckBox->isChecked(),
                                        m_ui.hiddenCheckBox->isChecked(),
                                        m_ui.symLinkCheckBox->isChecked(),
                                        m_ui.binaryCheckBox->isChecked(),
+                                       m_ui.gitIgnoreCheckBox->isChecked(),
                                        m_ui.filterCombo->currentText(),
-                                       m_ui.excludeCombo->currentText());
-        // the file list will be ready when the thread returns (connected to folderFileListChanged)
+                                       m_ui.excludeCombo->currentText(),
+                                       m_searchDiskFiles.fileQueue(),
+                                       openFiles);
     } else if (inCurrentProject || inAllOpenProjects) {
         /**
          * init search with file list from current project, if any
@@ -1144,27 +1087,19 @@ void KatePluginSearchView::startSearch()
             if (!m_resultBaseDir.endsWith(QLatin1Char('/')))
                 m_resultBaseDir += QLatin1Char('/');
 
-            QStringList projectFiles;
+            PathStore projectFiles;
             if (inCurrentProject) {
-                projectFiles = m_projectPluginView->property("projectFiles").toStringList();
+                projectFiles = m_projectPluginView->property("projectFilesStore").value<PathStore>();
             } else {
-                projectFiles = m_projectPluginView->property("allProjectsFiles").toStringList();
+                projectFiles = m_projectPluginView->property("allProjectsFilesStore").value<PathStore>();
             }
 
             files = filterFiles(projectFiles);
         }
         addHeaderItem();
 
-        QList<KTextEditor::Document *> openList;
-        const auto docs = m_kateApp->documents();
-        for (const auto doc : docs) {
-            // match project file's list toLocalFile()
-            int index = files.indexOf(doc->url().toLocalFile());
-            if (index != -1) {
-                openList << doc;
-                files.removeAt(index);
-            }
-        }
+        // match project file's list toLocalFile()
+        const QList<KTextEditor::Document *> openList = takeOpenFiles(files);
         // search order is important: Open files starts immediately and should finish
         // earliest after first event loop.
         // The DiskFile might finish immediately
@@ -1173,7 +1108,12 @@ void KatePluginSearchView::startSearch()
         } else {
             m_searchOpenFilesDone = true;
         }
-        m_searchDiskFiles.startSearch(files, reg);
+        // let the project index rule out files that can't contain a match
+        QObject *candidateFilter = nullptr;
+        if (m_projectPluginView) {
+            QMetaObject::invokeMethod(m_projectPluginView, "createSearchFilter", Qt::DirectConnection, Q_RETURN_ARG(QObject *, candidateFilter), Q_ARG(bool, inAllOpenProjects));
+        }
+        m_searchDiskFiles.startSearch(files, reg, candidateFilter);
     } else {
         Q_ASSERT_X(false, "KatePluginSearchView::startSearch", "case not handled");
     }
@@ -1225,7 +1165,7 @@ void KatePluginSearchView::startSearchWhileTyping()
         return;
     }
 
-    disconnect(m_curResults->tree, &QTreeWidget::itemChanged, &m_updateSumaryTimer, nullptr);
+    disconnect(&m_curResults->matchModel, &MatchModel::dataChanged, &m_updateSumaryTimer, nullptr);
 
     m_curResults->regExp = reg;
     m_curResults->useRegExp = m_ui.useRegExp->isChecked();
@@ -1250,20 +1190,15 @@ void KatePluginSearchView::startSearchWhileTyping()
     // Prepare for the new search content
     clearMarks();
     m_resultBaseDir.clear();
-    m_curResults->tree->clear();
-    m_curResults->tree->setCurrentItem(nullptr);
     m_curResults->matches = 0;
+    m_searchTime.start();
+    m_curResults->searchStarted = QDateTime::currentDateTime();
 
     // Add the search-as-you-type header item
-    TreeWidgetItem *item = new TreeWidgetItem(m_curResults->tree, QStringList());
-    item->setData(0, ReplaceMatches::FileUrlRole, doc->url().toString());
-    item->setData(0, ReplaceMatches::FileNameRole, doc->documentName());
-    item->setData(0, ReplaceMatches::StartLineRole, 0);
-    item->setCheckState(0, Qt::Checked);
-    item->setFlags(item->flags() | Qt::ItemIsAutoTristate);
+    m_curResults->matchModel.addFlatRootItem(doc->url().toString(), doc->documentName());
 
     // Do the search
-    int searchStoppedAt = m_searchOpenFiles.searchOpenFile(doc, reg, 0);
+    int searchStoppedAt = m_searchOpenFiles.searchWhileTyping(doc, reg, !m_ui.useRegExp->isChecked());
     searchWhileTypingDone();
 
     if (searchStoppedAt != 0) {
@@ -1316,7 +1251,7 @@ void KatePluginSearchView::searchDone()
     m_ui.replaceButton->setDisabled(m_curResults->matches < 1);
     m_ui.nextButton->setDisabled(m_curResults->matches < 1);
 
-    m_curResults->tree->sortItems(0, Qt::AscendingOrder);
+    m_curResults->matchModel.sortResults();
 
     m_curResults->tree->expandAll();
     m_curResults->tree->resizeColumnToContents(0);
@@ -1328,7 +1263,19 @@ void KatePluginSearchView::searchDone()
     expandResults();
 
     updateResultsRootItem();
-    connect(m_curResults->tree, &QTreeWidget::itemChanged, &m_updateSumaryTimer, static_cast<void (QTimer::*)()>(&QTimer::start));
+    connect(&m_curResults->matchModel, &MatchModel::dataChanged, &m_updateSumaryTimer, static_cast<void (QTimer::*)()>(&QTimer::start));
+
+    // how much the result cache helps
+    const SearchResultCache::Statistics cacheStatistics = m_resultCache.statistics();
+    const qint64 cacheLookups = cacheStatistics.fileHits + cacheStatistics.fileMisses;
+    const int tabIndex = m_ui.resultTabWidget->indexOf(m_curResults);
+    if (cacheLookups > 0 && tabIndex != -1) {
+        m_ui.resultTabWidget->setTabToolTip(tabIndex,
+                                            i18n("Result cache: %1% of the searched files reused, %2 used by %3 searches",
+                                                 cacheStatistics.fileHits * 100 / cacheLookups,
+                                                 QLocale().formattedDataSize(cacheStatistics.memoryUsage),
+                                                 cacheStatistics.resultSets));
+    }
 
     indicateMatch(m_curResults->matches > 0);
     m_curResults = nullptr;
@@ -1360,16 +1307,16 @@ void KatePluginSearchView::searchWhileTypingDone()
     }
 
     QWidget *focusObject = nullptr;
-    QTreeWidgetItem *root = m_curResults->tree->topLevelItem(0);
-    if (root) {
-        QTreeWidgetItem *child = root->child(0);
+    const QModelIndex root = m_curResults->matchModel.rootIndex();
+    if (root.isValid()) {
+        const QModelIndex child = m_curResults->matchModel.index(0, 0, root);
         if (!m_searchJustOpened) {
             focusObject = qobject_cast<QWidget *>(QGuiApplication::focusObject());
         }
-        indicateMatch(child);
+        indicateMatch(child.isValid());
 
         updateResultsRootItem();
-        connect(m_curResults->tree, &QTreeWidget::itemChanged, &m_updateSumaryTimer, static_cast<void (QTimer::*)()>(&QTimer::start));
+        connect(&m_curResults->matchModel, &MatchModel::dataChanged, &m_updateSumaryTimer, static_cast<void (QTimer::*)()>(&QTimer::start));
     }
 
     m_curResults = nullptr;
@@ -1389,13 +1336,21 @@ void KatePluginSearchView::searching(const QString &file)
         return;
     }
 
-    QTreeWidgetItem *root = m_curResults->tree->topLevelItem(0);
-    if (root) {
-        if (file.size() > 70) {
-            root->setData(0, Qt::DisplayRole, i18n("<b>Searching: ...%1</b>", file.right(70)));
-        } else {
-            root->setData(0, Qt::DisplayRole, i18n("<b>Searching: %1</b>", file));
-        }
+    const qint64 elapsed = qMax<qint64>(1, m_searchTime.elapsed());
+    const qint64 matchesPerSecond = m_curResults->matches * 1000 / elapsed;
+
+    // while a folder is listed, show how fast that goes
+    if (m_folderFilesList.isRunning()) {
+        const qint64 filesPerSecond = qint64(m_folderFilesList.fileCount()) * 1000 / elapsed;
+        const QString shownFile = file.size() > 70 ? QStringLiteral("...") + file.right(70) : file;
+        m_curResults->matchModel.setInfoText(i18n("<b>Searching: %1 (%2 matches/s, %3 files/s)</b>", shownFile, matchesPerSecond, filesPerSecond));
+        return;
+    }
+
+    if (file.size() > 70) {
+        m_curResults->matchModel.setInfoText(i18n("<b>Searching: ...%1 (%2 matches/s)</b>", file.right(70), matchesPerSecond));
+    } else {
+        m_curResults->matchModel.setInfoText(i18n("<b>Searching: %1 (%2 matches/s)</b>", file, matchesPerSecond));
     }
 }
 
@@ -1438,8 +1393,8 @@ void KatePluginSearchView::replaceSingleMatch()
     if (!res) {
         return; // Security measure
     }
-    QTreeWidgetItem *item = res->tree->currentItem();
-    if (!item || !item->parent()) {
+    const QModelIndex item = res->tree->currentIndex();
+    if (!item.isValid() || !item.parent().isValid()) {
         // Nothing was selected
         goToNextMatch();
         return;
@@ -1453,8 +1408,8 @@ void KatePluginSearchView::replaceSingleMatch()
     int cursorLine = m_mainWindow->activeView()->cursorPosition().line();
     int cursorColumn = m_mainWindow->activeView()->cursorPosition().column();
 
-    int startLine = item->data(0, ReplaceMatches::StartLineRole).toInt();
-    int startColumn = item->data(0, ReplaceMatches::StartColumnRole).toInt();
+    int startLine = item.data(ReplaceMatches::StartLineRole).toInt();
+    int startColumn = item.data(ReplaceMatches::StartColumnRole).toInt();
 
     if ((cursorLine != startLine) || (cursorColumn != startColumn)) {
         itemSelected(item);
@@ -1462,24 +1417,13 @@ void KatePluginSearchView::replaceSingleMatch()
     }
 
     KTextEditor::Document *doc = m_mainWindow->activeView()->document();
-    // Find the corresponding range
-    int i;
-    for (i = 0; i < m_matchRanges.size(); i++) {
-        if (m_matchRanges[i]->document() != doc)
-            continue;
-        if (m_matchRanges[i]->start().line() != startLine)
-            continue;
-        if (m_matchRanges[i]->start().column() != startColumn)
-            continue;
-        break;
-    }
-
-    if (i >= m_matchRanges.size()) {
+    // Check that the match is still there
+    if (!isHighlightedMatch(doc, KTextEditor::Cursor(startLine, startColumn))) {
         goToNextMatch();
         return;
     }
 
-    m_replacer.replaceSingleMatch(doc, item, res->regExp, m_ui.replaceCombo->currentText());
+    m_replacer.replaceSingleMatch(doc, &res->matchModel, item, res->regExp, m_ui.replaceCombo->currentText());
 
     goToNextMatch();
 }
@@ -1519,12 +1463,8 @@ void KatePluginSearchView::replaceChecked()
 
     m_curResults->replaceStr = m_ui.replaceCombo->currentText();
 
-    QTreeWidgetItem *root = m_curResults->tree->topLevelItem(0);
-
-    if (root) {
-        m_curResults->treeRootText = root->data(0, Qt::DisplayRole).toString();
-    }
-    m_replacer.replaceChecked(m_curResults->tree, m_curResults->regExp, m_curResults->replaceStr);
+    m_curResults->treeRootText = m_curResults->matchModel.infoText();
+    m_replacer.replaceChecked(&m_curResults->matchModel, m_curResults->regExp, m_curResults->replaceStr, m_curResults->searchStarted);
 }
 
 void KatePluginSearchView::replaceStatus(const QUrl &url, int replacedInFile, int matchesInFile)
@@ -1533,14 +1473,11 @@ void KatePluginSearchView::replaceStatus(const QUrl &url, int replacedInFile, in
         // qDebug() << "m_curResults == nullptr";
         return;
     }
-    QTreeWidgetItem *root = m_curResults->tree->topLevelItem(0);
-    if (root) {
-        QString file = url.toString(QUrl::PreferLocalFile);
-        if (file.size() > 70) {
-            root->setData(0, Qt::DisplayRole, i18n("<b>Processed %1 of %2 matches in: ...%3</b>", replacedInFile, matchesInFile, file.right(70)));
-        } else {
-            root->setData(0, Qt::DisplayRole, i18n("<b>Processed %1 of %2 matches in: %3</b>", replacedInFile, matchesInFile, file));
-        }
+    QString file = url.toString(QUrl::PreferLocalFile);
+    if (file.size() > 70) {
+        m_curResults->matchModel.setInfoText(i18n("<b>Processed %1 of %2 matches in: ...%3</b>", replacedInFile, matchesInFile, file.right(70)));
+    } else {
+        m_curResults->matchModel.setInfoText(i18n("<b>Processed %1 of %2 matches in: %3</b>", replacedInFile, matchesInFile, file));
     }
 }
 
@@ -1564,10 +1501,7 @@ void KatePluginSearchView::replaceDone()
         // qDebug() << "m_curResults == nullptr";
         return;
     }
-    QTreeWidgetItem *root = m_curResults->tree->topLevelItem(0);
-    if (root) {
-        root->setData(0, Qt::DisplayRole, m_curResults->treeRootText);
-    }
+    m_curResults->matchModel.setInfoText(m_curResults->treeRootText);
 }
 
 void KatePluginSearchView::docViewChanged()
@@ -1586,36 +1520,60 @@ void KatePluginSearchView::docViewChanged()
 
     // add the marks if it is not already open
     KTextEditor::Document *doc = m_mainWindow->activeView()->document();
-    if (doc && res->tree->topLevelItemCount() > 0) {
+    if (doc && res->matchModel.rootIndex().isValid()) {
         // There is always one root item with match count
         // and X children with files or matches in case of search while typing
-        QTreeWidgetItem *rootItem = res->tree->topLevelItem(0);
-        QTreeWidgetItem *fileItem = nullptr;
-        for (int i = 0; i < rootItem->childCount(); i++) {
-            QString url = rootItem->child(i)->data(0, ReplaceMatches::FileUrlRole).toString();
-            QString fName = rootItem->child(i)->data(0, ReplaceMatches::FileNameRole).toString();
-            if (url == doc->url().toString() && fName == doc->documentName()) {
-                fileItem = rootItem->child(i);
-                break;
-            }
-        }
-        if (fileItem) {
+        const int fileRow = res->matchModel.findFile(doc->url().toString(), doc->documentName());
+        if (fileRow != -1) {
             clearDocMarks(doc);
 
-            if (m_isSearchAsYouType) {
-                fileItem = fileItem->parent();
+            // special handling for "(?=\\n)" in multi-line search
+            QRegularExpression regExp = res->regExp;
+            if (regExp.pattern().endsWith(QLatin1String("(?=\\n)"))) {
+                QString newPatern = regExp.pattern();
+                newPatern.replace(QStringLiteral("(?=\\n)"), QStringLiteral("$"));
+                regExp.setPattern(newPatern);
+            }
+
+            // the matches are only highlighted once they are scrolled into view
+            KTextEditor::MovingInterface *miface = qobject_cast<KTextEditor::MovingInterface *>(doc);
+            DocumentHighlights &highlights = m_matchHighlights[doc];
+            highlights.revision = miface->revision();
+            highlights.regExp = regExp;
+            miface->lockRevision(highlights.revision);
+
+            // Add a match mark per line
+            KTextEditor::MarkInterface *iface = qobject_cast<KTextEditor::MarkInterface *>(doc);
+            if (iface) {
+                iface->setMarkDescription(KTextEditor::MarkInterface::markType32, i18n("SearchHighLight"));
+                iface->setMarkPixmap(KTextEditor::MarkInterface::markType32, QIcon().pixmap(0, 0));
             }
 
-            for (int i = 0; i < fileItem->childCount(); i++) {
-                if (fileItem->child(i)->checkState(0) == Qt::Unchecked) {
+            const QVector<MatchModel::Match> &matches = res->matchModel.fileMatches(fileRow);
+            highlights.matches.reserve(matches.size());
+            for (const MatchModel::Match &match : matches) {
+                if (match.checkState == Qt::Unchecked) {
                     continue;
                 }
-                addMatchMark(doc, fileItem->child(i));
+                HighlightedMatch highlight;
+                highlight.range = match.range;
+                highlight.replaced = match.replaced;
+                highlight.replaceText = match.replaceText;
+                highlights.matches.append(highlight);
+                if (iface) {
+                    iface->addMark(match.range.start().line(), KTextEditor::MarkInterface::markType32);
+                }
             }
+
+            connect(doc, SIGNAL(aboutToInvalidateMovingInterfaceContent(KTextEditor::Document *)), this, SLOT(clearMarks()), Qt::UniqueConnection);
+            updateHighlights(doc);
         }
         // Re-add the highlighting on document reload
         connect(doc, &KTextEditor::Document::reloaded, this, &KatePluginSearchView::docViewChanged, Qt::UniqueConnection);
     }
+
+    // highlight the matches scrolled into view
+    connect(m_mainWindow->activeView(), &KTextEditor::View::verticalScrollPositionChanged, &m_highlightTimer, static_cast<void (QTimer::*)()>(&QTimer::start), Qt::UniqueConnection);
 }
 
 void KatePluginSearchView::expandResults()
@@ -1629,11 +1587,12 @@ void KatePluginSearchView::expandResults()
     if (m_ui.expandResults->isChecked()) {
         m_curResults->tree->expandAll();
     } else {
-        QTreeWidgetItem *root = m_curResults->tree->topLevelItem(0);
-        m_curResults->tree->expandItem(root);
-        if (root && (root->childCount() > 1)) {
-            for (int i = 0; i < root->childCount(); i++) {
-                m_curResults->tree->collapseItem(root->child(i));
+        const QModelIndex root = m_curResults->matchModel.rootIndex();
+        m_curResults->tree->expand(root);
+        const int rootChildren = m_curResults->matchModel.rowCount(root);
+        if (root.isValid() && (rootChildren > 1)) {
+            for (int i = 0; i < rootChildren; i++) {
+                m_curResults->tree->collapse(m_curResults->matchModel.index(i, 0, root));
             }
         }
     }
@@ -1646,18 +1605,12 @@ void KatePluginSearchView::updateResultsRootItem()
         return;
     }
 
-    QTreeWidgetItem *root = m_curResults->tree->topLevelItem(0);
-
-    if (!root) {
+    MatchModel &model = m_curResults->matchModel;
+    if (!model.rootIndex().isValid()) {
         // nothing to update
         return;
     }
-    int checkedItemCount = 0;
-    if (m_curResults->matches > 0) {
-        for (QTreeWidgetItemIterator it(m_curResults->tree, QTreeWidgetItemIterator::Checked | QTreeWidgetItemIterator::NoChildren); *it; ++it) {
-            checkedItemCount++;
-        }
-    }
+    int checkedItemCount = model.checkedMatchCount();
 
     QString checkedStr = i18np("One checked", "%1 checked", checkedItemCount);
 
@@ -1668,35 +1621,34 @@ void KatePluginSearchView::updateResultsRootItem()
 
     switch (searchPlace) {
     case CurrentFile:
-        root->setData(0, Qt::DisplayRole, i18np("<b><i>One match (%2) found in file</i></b>", "<b><i>%1 matches (%2) found in file</i></b>", m_curResults->matches, checkedStr));
+        model.setInfoText(i18np("<b><i>One match (%2) found in file</i></b>", "<b><i>%1 matches (%2) found in file</i></b>", m_curResults->matches, checkedStr));
         break;
     case OpenFiles:
-        root->setData(0, Qt::DisplayRole, i18np("<b><i>One match (%2) found in open files</i></b>", "<b><i>%1 matches (%2) found in open files</i></b>", m_curResults->matches, checkedStr));
+        model.setInfoText(i18np("<b><i>One match (%2) found in open files</i></b>", "<b><i>%1 matches (%2) found in open files</i></b>", m_curResults->matches, checkedStr));
         break;
     case Folder:
-        root->setData(0, Qt::DisplayRole, i18np("<b><i>One match (%3) found in folder %2</i></b>", "<b><i>%1 matches (%3) found in folder %2</i></b>", m_curResults->matches, m_resultBaseDir, checkedStr));
+        model.setInfoText(i18np("<b><i>One match (%3) found in folder %2</i></b>", "<b><i>%1 matches (%3) found in folder %2</i></b>", m_curResults->matches, m_resultBaseDir, checkedStr));
         break;
     case Project: {
         QString projectName;
         if (m_projectPluginView) {
             projectName = m_projectPluginView->property("projectName").toString();
         }
-        root->setData(0, Qt::DisplayRole, i18np("<b><i>One match (%4) found in project %2 (%3)</i></b>", "<b><i>%1 matches (%4) found in project %2 (%3)</i></b>", m_curResults->matches, projectName, m_resultBaseDir, checkedStr));
+        model.setInfoText(i18np("<b><i>One match (%4) found in project %2 (%3)</i></b>", "<b><i>%1 matches (%4) found in project %2 (%3)</i></b>", m_curResults->matches, projectName, m_resultBaseDir, checkedStr));
         break;
     }
     case AllProjects: // "in Open Projects"
-        root->setData(0,
-                      Qt::DisplayRole,
-                      i18np("<b><i>One match (%3) found in all open projects (common parent: %2)</i></b>", "<b><i>%1 matches (%3) found in all open projects (common parent: %2)</i></b>", m_curResults->matches, m_resultBaseDir, checkedStr));
+        model.setInfoText(i18np("<b><i>One match (%3) found in all open projects (common parent: %2)</i></b>", "<b><i>%1 matches (%3) found in all open projects (common parent: %2)</i></b>", m_curResults->matches, m_resultBaseDir, checkedStr));
         break;
     }
 
     docViewChanged();
 }
 
-void KatePluginSearchView::itemSelected(QTreeWidgetItem *item)
+void KatePluginSearchView::itemSelected(const QModelIndex &index)
 {
-    if (!item)
+    QModelIndex item = index;
+    if (!item.isValid())
         return;
 
     m_curResults = qobject_cast<Results *>(m_ui.resultTabWidget->currentWidget());
@@ -1704,24 +1656,24 @@ void KatePluginSearchView::itemSelected(QTreeWidgetItem *item)
         return;
     }
 
-    while (item->data(0, ReplaceMatches::StartColumnRole).toString().isEmpty()) {
-        item->treeWidget()->expandItem(item);
-        item = item->child(0);
-        if (!item)
+    while (item.data(ReplaceMatches::StartColumnRole).toString().isEmpty()) {
+        m_curResults->tree->expand(item);
+        item = item.model()->index(0, 0, item);
+        if (!item.isValid())
             return;
     }
-    item->treeWidget()->setCurrentItem(item);
+    m_curResults->tree->setCurrentIndex(item);
 
     // get stuff
-    int toLine = item->data(0, ReplaceMatches::StartLineRole).toInt();
-    int toColumn = item->data(0, ReplaceMatches::StartColumnRole).toInt();
+    int toLine = item.data(ReplaceMatches::StartLineRole).toInt();
+    int toColumn = item.data(ReplaceMatches::StartColumnRole).toInt();
 
     KTextEditor::Document *doc;
-    QString url = item->data(0, ReplaceMatches::FileUrlRole).toString();
+    QString url = item.data(ReplaceMatches::FileUrlRole).toString();
     if (!url.isEmpty()) {
         doc = m_kateApp->findUrl(QUrl::fromUserInput(url));
     } else {
-        doc = m_replacer.findNamed(item->data(0, ReplaceMatches::FileNameRole).toString());
+        doc = m_replacer.findNamed(item.data(ReplaceMatches::FileNameRole).toString());
     }
 
     // add the marks to the document if it is not already open
@@ -1753,23 +1705,23 @@ void KatePluginSearchView::goToNextMatch()
     if (!res) {
         return;
     }
-    QTreeWidgetItem *curr = res->tree->currentItem();
+    QModelIndex curr = res->tree->currentIndex();
 
     bool focusInView = m_mainWindow->activeView() && m_mainWindow->activeView()->hasFocus();
 
-    if (!curr && focusInView) {
+    if (!curr.isValid() && focusInView) {
         // no item has been visited && focus is not in searchCombo (probably in the view) ->
         // jump to the closest match after current cursor position
 
         // check if current file is in the file list
-        curr = res->tree->topLevelItem(0);
-        while (curr && curr->data(0, ReplaceMatches::FileUrlRole).toString() != m_mainWindow->activeView()->document()->url().toString()) {
-            curr = res->tree->itemBelow(curr);
+        curr = res->matchModel.rootIndex();
+        while (curr.isValid() && curr.data(ReplaceMatches::FileUrlRole).toString() != m_mainWindow->activeView()->document()->url().toString()) {
+            curr = res->tree->indexBelow(curr);
         }
         // now we are either in this file or !curr
-        if (curr) {
-            QTreeWidgetItem *fileBefore = curr;
-            res->tree->expandItem(curr);
+        if (curr.isValid()) {
+            QModelIndex fileBefore = curr;
+            res->tree->expand(curr);
 
             int lineNr = 0;
             int columnNr = 0;
@@ -1778,33 +1730,33 @@ void KatePluginSearchView::goToNextMatch()
                 columnNr = m_mainWindow->activeView()->cursorPosition().column();
             }
 
-            if (!curr->data(0, ReplaceMatches::StartColumnRole).isValid()) {
-                curr = res->tree->itemBelow(curr);
+            if (!curr.data(ReplaceMatches::StartColumnRole).isValid()) {
+                curr = res->tree->indexBelow(curr);
             };
 
-            while (curr && curr->data(0, ReplaceMatches::StartLineRole).toInt() <= lineNr && curr->data(0, ReplaceMatches::FileUrlRole).toString() == m_mainWindow->activeView()->document()->url().toString()) {
-                if (curr->data(0, ReplaceMatches::StartLineRole).toInt() == lineNr && curr->data(0, ReplaceMatches::StartColumnRole).toInt() >= columnNr - curr->data(0, ReplaceMatches::MatchLenRole).toInt()) {
+            while (curr.isValid() && curr.data(ReplaceMatches::StartLineRole).toInt() <= lineNr && curr.data(ReplaceMatches::FileUrlRole).toString() == m_mainWindow->activeView()->document()->url().toString()) {
+                if (curr.data(ReplaceMatches::StartLineRole).toInt() == lineNr && curr.data(ReplaceMatches::StartColumnRole).toInt() >= columnNr - curr.data(ReplaceMatches::MatchLenRole).toInt()) {
                     break;
                 }
                 fileBefore = curr;
-                curr = res->tree->itemBelow(curr);
+                curr = res->tree->indexBelow(curr);
             }
             curr = fileBefore;
             startFromCursor = true;
         }
     }
-    if (!curr) {
-        curr = res->tree->topLevelItem(0);
+    if (!curr.isValid()) {
+        curr = res->matchModel.rootIndex();
         startFromFirst = true;
     }
-    if (!curr)
+    if (!curr.isValid())
         return;
 
-    if (!curr->data(0, ReplaceMatches::StartColumnRole).toString().isEmpty()) {
-        curr = res->tree->itemBelow(curr);
-        if (!curr) {
+    if (!curr.data(ReplaceMatches::StartColumnRole).toString().isEmpty()) {
+        curr = res->tree->indexBelow(curr);
+        if (!curr.isValid()) {
             wrapFromFirst = true;
-            curr = res->tree->topLevelItem(0);
+            curr = res->matchModel.rootIndex();
         }
     }
 
@@ -1847,21 +1799,21 @@ void KatePluginSearchView::goToPreviousMatch()
     if (!res) {
         return;
     }
-    if (res->tree->topLevelItemCount() == 0) {
+    if (!res->matchModel.rootIndex().isValid()) {
         return;
     }
-    QTreeWidgetItem *curr = res->tree->currentItem();
+    QModelIndex curr = res->tree->currentIndex();
 
-    if (!curr) {
+    if (!curr.isValid()) {
         // no item has been visited -> jump to the closest match before current cursor position
         // check if current file is in the file
-        curr = res->tree->topLevelItem(0);
-        while (curr && curr->data(0, ReplaceMatches::FileUrlRole).toString() != m_mainWindow->activeView()->document()->url().toString()) {
-            curr = res->tree->itemBelow(curr);
+        curr = res->matchModel.rootIndex();
+        while (curr.isValid() && curr.data(ReplaceMatches::FileUrlRole).toString() != m_mainWindow->activeView()->document()->url().toString()) {
+            curr = res->tree->indexBelow(curr);
         }
         // now we are either in this file or !curr
-        if (curr) {
-            res->tree->expandItem(curr);
+        if (curr.isValid()) {
+            res->tree->expand(curr);
 
             int lineNr = 0;
             int columnNr = 0;
@@ -1870,52 +1822,52 @@ void KatePluginSearchView::goToPreviousMatch()
                 columnNr = m_mainWindow->activeView()->cursorPosition().column() - 1;
             }
 
-            if (!curr->data(0, ReplaceMatches::StartColumnRole).isValid()) {
-                curr = res->tree->itemBelow(curr);
+            if (!curr.data(ReplaceMatches::StartColumnRole).isValid()) {
+                curr = res->tree->indexBelow(curr);
             };
 
-            while (curr && curr->data(0, ReplaceMatches::StartLineRole).toInt() <= lineNr && curr->data(0, ReplaceMatches::FileUrlRole).toString() == m_mainWindow->activeView()->document()->url().toString()) {
-                if (curr->data(0, ReplaceMatches::StartLineRole).toInt() == lineNr && curr->data(0, ReplaceMatches::StartColumnRole).toInt() > columnNr) {
+            while (curr.isValid() && curr.data(ReplaceMatches::StartLineRole).toInt() <= lineNr && curr.data(ReplaceMatches::FileUrlRole).toString() == m_mainWindow->activeView()->document()->url().toString()) {
+                if (curr.data(ReplaceMatches::StartLineRole).toInt() == lineNr && curr.data(ReplaceMatches::StartColumnRole).toInt() > columnNr) {
                     break;
                 }
-                curr = res->tree->itemBelow(curr);
+                curr = res->tree->indexBelow(curr);
             }
         }
     }
 
-    QTreeWidgetItem *startChild = curr;
+    QModelIndex startChild = curr;
 
     // go to the item above. (curr == null is not a problem)
-    curr = res->tree->itemAbove(curr);
+    curr = res->tree->indexAbove(curr);
 
     // expand the items above if needed
-    if (curr && curr->data(0, ReplaceMatches::StartColumnRole).toString().isEmpty()) {
-        res->tree->expandItem(curr); // probably this file item
-        curr = res->tree->itemAbove(curr);
-        if (curr && curr->data(0, ReplaceMatches::StartColumnRole).toString().isEmpty()) {
-            res->tree->expandItem(curr); // probably file above if this is reached
+    if (curr.isValid() && curr.data(ReplaceMatches::StartColumnRole).toString().isEmpty()) {
+        res->tree->expand(curr); // probably this file item
+        curr = res->tree->indexAbove(curr);
+        if (curr.isValid() && curr.data(ReplaceMatches::StartColumnRole).toString().isEmpty()) {
+            res->tree->expand(curr); // probably file above if this is reached
         }
-        curr = res->tree->itemAbove(startChild);
+        curr = res->tree->indexAbove(startChild);
     }
 
     // skip file name items and the root item
-    while (curr && curr->data(0, ReplaceMatches::StartColumnRole).toString().isEmpty()) {
-        curr = res->tree->itemAbove(curr);
+    while (curr.isValid() && curr.data(ReplaceMatches::StartColumnRole).toString().isEmpty()) {
+        curr = res->tree->indexAbove(curr);
     }
 
-    if (!curr) {
+    if (!curr.isValid()) {
         // select the last child of the last next-to-top-level item
-        QTreeWidgetItem *root = res->tree->topLevelItem(0);
+        QModelIndex root = res->matchModel.rootIndex();
 
         // select the last "root item"
-        if (!root || (root->childCount() < 1))
+        if (!root.isValid() || (res->matchModel.rowCount(root) < 1))
             return;
-        root = root->child(root->childCount() - 1);
+        root = res->matchModel.index(res->matchModel.rowCount(root) - 1, 0, root);
 
         // select the last match of the "root item"
-        if (!root || (root->childCount() < 1))
+        if (!root.isValid() || (res->matchModel.rowCount(root) < 1))
             return;
-        curr = root->child(root->childCount() - 1);
+        curr = res->matchModel.index(res->matchModel.rowCount(root) - 1, 0, root);
 
         fromLast = true;
     }
@@ -1960,6 +1912,7 @@ void KatePluginSearchView::readSessionConfig(const KConfigGroup &cg)
     m_ui.hiddenCheckBox->setChecked(cg.readEntry("HiddenFiles", false));
     m_ui.symLinkCheckBox->setChecked(cg.readEntry("FollowSymLink", false));
     m_ui.binaryCheckBox->setChecked(cg.readEntry("BinaryFiles", false));
+    m_ui.gitIgnoreCheckBox->setChecked(cg.readEntry("GitIgnore", false));
     m_ui.folderRequester->comboBox()->clear();
     m_ui.folderRequester->comboBox()->addItems(cg.readEntry("SearchDiskFiless", QStringList()));
     m_ui.folderRequester->setText(cg.readEntry("SearchDiskFiles", QString()));
@@ -1994,6 +1947,7 @@ void KatePluginSearchView::writeSessionConfig(KConfigGroup &cg)
     cg.writeEntry("HiddenFiles", m_ui.hiddenCheckBox->isChecked());
     cg.writeEntry("FollowSymLink", m_ui.symLinkCheckBox->isChecked());
     cg.writeEntry("BinaryFiles", m_ui.binaryCheckBox->isChecked());
+    cg.writeEntry("GitIgnore", m_ui.gitIgnoreCheckBox->isChecked());
     QStringList folders;
     for (int i = 0; i < qMin(m_ui.folderRequester->comboBox()->count(), 10); i++) {
         folders << m_ui.folderRequester->comboBox()->itemText(i);
@@ -2025,7 +1979,7 @@ void KatePluginSearchView::addTab()
 
     res->tree->setRootIsDecorated(false);
 
-    connect(res->tree, &QTreeWidget::itemDoubleClicked, this, &KatePluginSearchView::itemSelected, Qt::UniqueConnection);
+    connect(res->tree, &QTreeView::doubleClicked, this, &KatePluginSearchView::itemSelected, Qt::UniqueConnection);
 
     res->searchPlaceIndex = m_ui.searchPlaceCombo->currentIndex();
     res->useRegExp = m_ui.useRegExp->isChecked();
@@ -2137,18 +2091,18 @@ bool KatePluginSearchView::eventFilter(QObject *obj, QEvent *event)
 {
     if (event->type() == QEvent::KeyPress) {
         QKeyEvent *ke = static_cast<QKeyEvent *>(event);
-        QTreeWidget *tree = qobject_cast<QTreeWidget *>(obj);
+        QTreeView *tree = qobject_cast<QTreeView *>(obj);
         if (tree) {
             if (ke->matches(QKeySequence::Copy)) {
                 // user pressed ctrl+c -> copy full URL to the clipboard
-                QVariant variant = tree->currentItem()->data(0, ReplaceMatches::FileUrlRole);
+                QVariant variant = tree->currentIndex().data(ReplaceMatches::FileUrlRole);
                 QApplication::clipboard()->setText(variant.toString());
                 event->accept();
                 return true;
             }
             if (ke->key() == Qt::Key_Enter || ke->key() == Qt::Key_Return) {
-                if (tree->currentItem()) {
-                    itemSelected(tree->currentItem());
+                if (tree->currentIndex().isValid()) {
+                    itemSelected(tree->currentIndex());
                     event->accept();
                     return true;
                 }
@@ -29,8 +29,12 @@
 #include <ktexteditor/mainwindow.h>
 #include <ktexteditor/sessionconfiginterface.h>
 
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QHash>
 #include <QTimer>
-#include <QTreeWidget>
+#include <QTreeView>
+#include <QVector>
 
 #include <KXMLGUIClient>
 
@@ -38,10 +42,15 @@
 #include "ui_search.h"
 
 #include "FolderFilesList.h"
+#include "KateSearchMatch.h"
+#include "MatchModel.h"
 #include "SearchDiskFiles.h"
+#include "SearchResultCache.h"
 #include "replace_matches.h"
 #include "search_open_files.h"
 
+#include "pathstore.h"
+
 class KateSearchCommand;
 namespace KTextEditor
 {
@@ -60,6 +69,9 @@ public:
     QString replaceStr;
     int searchPlaceIndex = 0;
     QString treeRootText;
+    /** files changed after this don't match the results anymore */
+    QDateTime searchStarted;
+    MatchModel matchModel;
 };
 
 // This class keeps the focus inside the S&R plugin when pressing tab/shift+tab by overriding focusNextPrevChild()
@@ -133,9 +145,7 @@ private Q_SLOTS:
 
     void folderFileListChanged();
 
-    void matchFound(const QString &url, const QString &fileName, const QString &lineContent, int matchLen, int startLine, int startColumn, int endLine, int endColumn);
-
-    void addMatchMark(KTextEditor::Document *doc, QTreeWidgetItem *item);
+    void matchesFound(const QString &url, const QString &fileName, const QVector<KateSearchMatch> &searchMatches);
 
     void searchDone();
     void searchWhileTypingDone();
@@ -143,7 +153,7 @@ private Q_SLOTS:
 
     void searching(const QString &file);
 
-    void itemSelected(QTreeWidgetItem *item);
+    void itemSelected(const QModelIndex &item);
 
     void clearMarks();
     void clearDocMarks(KTextEditor::Document *doc);
@@ -155,6 +165,7 @@ private Q_SLOTS:
     void replaceDone();
 
     void docViewChanged();
+    void updateViewHighlights();
 
     void resultTabChanged(int index);
 
@@ -174,8 +185,35 @@ protected:
     void addHeaderItem();
 
 private:
-    QTreeWidgetItem *rootFileItem(const QString &url, const QString &fName);
-    QStringList filterFiles(const QStringList &files) const;
+    /**
+     * A match shown in a document. Only the matches in the visible lines of the
+     * views are highlighted with a moving range, the others are plain ranges of
+     * the revision locked in DocumentHighlights.
+     */
+    struct HighlightedMatch {
+        KTextEditor::Range range;
+        bool replaced = false;
+        QString replaceText;
+        /** the text doesn't match anymore, it is not highlighted */
+        bool invalid = false;
+        KTextEditor::MovingRange *movingRange = nullptr;
+    };
+
+    struct DocumentHighlights {
+        qint64 revision = -1;
+        QRegularExpression regExp;
+        QVector<HighlightedMatch> matches;
+    };
+
+    QStringList filterFiles(const PathStore &files) const;
+    /**
+     * Removes the files open as documents from \p files, the rest keeps its order.
+     * @return the documents of the removed files
+     */
+    QList<KTextEditor::Document *> takeOpenFiles(QStringList &files) const;
+
+    void updateHighlights(KTextEditor::Document *doc);
+    bool isHighlightedMatch(KTextEditor::Document *doc, const KTextEditor::Cursor &start);
 
     void onResize(const QSize &size);
 
@@ -184,6 +222,7 @@ private:
     KTextEditor::Application *m_kateApp;
     SearchOpenFiles m_searchOpenFiles;
     FolderFilesList m_folderFilesList;
+    SearchResultCache m_resultCache;
     SearchDiskFiles m_searchDiskFiles;
     ReplaceMatches m_replacer;
     QAction *m_matchCase;
@@ -196,9 +235,11 @@ private:
     bool m_isSearchAsYouType;
     bool m_isLeftRight;
     QString m_resultBaseDir;
-    QList<KTextEditor::MovingRange *> m_matchRanges;
+    QHash<KTextEditor::Document *, DocumentHighlights> m_matchHighlights;
+    QTimer m_highlightTimer;
     QTimer m_changeTimer;
     QTimer m_updateSumaryTimer;
+    QElapsedTimer m_searchTime;
     QPointer<KTextEditor::Message> m_infoMessage;
 
     /**
@@ -20,27 +20,29 @@
 
 #include "replace_matches.h"
 
+#include "MatchModel.h"
+
 #include <QTimer>
-#include <QTreeWidgetItem>
-#include <klocalizedstring.h>
 
 ReplaceMatches::ReplaceMatches(QObject *parent)
     : QObject(parent)
 {
+    connect(&m_diskReplacer, &ReplaceDiskFiles::fileReplaced, this, &ReplaceMatches::diskFileReplaced);
 }
 
-void ReplaceMatches::replaceChecked(QTreeWidget *tree, const QRegularExpression &regexp, const QString &replace)
+void ReplaceMatches::replaceChecked(MatchModel *model, const QRegularExpression &regexp, const QString &replace, const QDateTime &searchTime)
 {
     if (m_manager == nullptr)
         return;
-    if (m_rootIndex != -1)
+    if (m_rootIndex != -1 || m_diskReplacer.pendingFiles() > 0)
         return; // already replacing
 
-    m_tree = tree;
+    m_model = model;
     m_rootIndex = 0;
     m_childStartIndex = 0;
     m_regExp = regexp;
     m_replaceText = replace;
+    m_searchTime = searchTime;
     m_cancelReplace = false;
     m_progressTime.restart();
     doReplaceNextMatch();
@@ -54,6 +56,7 @@ void ReplaceMatches::setDocumentManager(KTextEditor::Application *manager)
 void ReplaceMatches::cancelReplace()
 {
     m_cancelReplace = true;
+    m_diskReplacer.cancel();
 }
 
 KTextEditor::Document *ReplaceMatches::findNamed(const QString &name)
@@ -68,27 +71,8 @@ KTextEditor::Document *ReplaceMatches::findNamed(const QString &name)
     return nullptr;
 }
 
-bool ReplaceMatches::replaceMatch(KTextEditor::Document *doc, QTreeWidgetItem *item, const KTextEditor::Range &range, const QRegularExpression &regExp, const QString &replaceTxt)
+QString ReplaceMatches::generateReplaceText(const QRegularExpressionMatch &match, const QString &replaceTxt)
 {
-    if (!doc || !item) {
-        return false;
-    }
-
-    // don't replace an already replaced item
-    if (item->data(0, ReplaceMatches::ReplacedRole).toBool()) {
-        // qDebug() << "not replacing already replaced item";
-        return false;
-    }
-
-    // Check that the text has not been modified and still matches + get captures for the replace
-    QString matchLines = doc->text(range);
-    QRegularExpressionMatch match = regExp.match(matchLines);
-    if (match.capturedStart() != 0) {
-        // qDebug() << matchLines << "Does not match" << regExp.pattern();
-        return false;
-    }
-
-    // Modify the replace string according to this match
     QString replaceText = replaceTxt;
     replaceText.replace(QLatin1String("\\\\"), QLatin1String("¤Search&Replace¤"));
 
@@ -116,62 +100,58 @@ bool ReplaceMatches::replaceMatch(KTextEditor::Document *doc, QTreeWidgetItem *i
     replaceText.replace(QLatin1String("\\t"), QLatin1String("\t"));
     replaceText.replace(QLatin1String("¤Search&Replace¤"), QLatin1String("\\"));
 
+    return replaceText;
+}
+
+bool ReplaceMatches::replaceMatch(KTextEditor::Document *doc, MatchModel *model, int fileRow, int matchRow, const KTextEditor::Range &range, const QRegularExpression &regExp, const QString &replaceTxt)
+{
+    if (!doc || !model) {
+        return false;
+    }
+
+    // don't replace an already replaced item
+    if (model->fileMatches(fileRow).at(matchRow).replaced) {
+        // qDebug() << "not replacing already replaced item";
+        return false;
+    }
+
+    // Check that the text has not been modified and still matches + get captures for the replace
+    QString matchLines = doc->text(range);
+    QRegularExpressionMatch match = regExp.match(matchLines);
+    if (match.capturedStart() != 0) {
+        // qDebug() << matchLines << "Does not match" << regExp.pattern();
+        return false;
+    }
+
+    QString replaceText = generateReplaceText(match, replaceTxt);
     doc->replaceText(range, replaceText);
 
     int newEndLine = range.start().line() + replaceText.count(QLatin1Char('\n'));
     int lastNL = replaceText.lastIndexOf(QLatin1Char('\n'));
     int newEndColumn = lastNL == -1 ? range.start().column() + replaceText.length() : replaceText.length() - lastNL - 1;
 
-    item->setData(0, ReplaceMatches::ReplacedRole, true);
-    item->setData(0, ReplaceMatches::StartLineRole, range.start().line());
-    item->setData(0, ReplaceMatches::StartColumnRole, range.start().column());
-    item->setData(0, ReplaceMatches::EndLineRole, newEndLine);
-    item->setData(0, ReplaceMatches::EndColumnRole, newEndColumn);
-    item->setData(0, ReplaceMatches::ReplacedTextRole, replaceText);
-
-    // Convert replace text back to "html"
-    replaceText.replace(QLatin1Char('\n'), QStringLiteral("\\n"));
-    replaceText.replace(QLatin1Char('\t'), QStringLiteral("\\t"));
-    QString html = item->data(0, ReplaceMatches::PreMatchRole).toString();
-    html += QLatin1String("<i><s>") + item->data(0, ReplaceMatches::MatchRole).toString() + QLatin1String("</s></i> ");
-    html += QLatin1String("<b>") + replaceText + QLatin1String("</b>");
-    html += item->data(0, ReplaceMatches::PostMatchRole).toString();
-    item->setData(0, Qt::DisplayRole, i18n("Line: <b>%1</b>: %2", range.start().line() + 1, html));
+    model->setMatchReplaced(fileRow, matchRow, KTextEditor::Range(range.start().line(), range.start().column(), newEndLine, newEndColumn), replaceText);
 
     return true;
 }
 
-bool ReplaceMatches::replaceSingleMatch(KTextEditor::Document *doc, QTreeWidgetItem *item, const QRegularExpression &regExp, const QString &replaceTxt)
+bool ReplaceMatches::replaceSingleMatch(KTextEditor::Document *doc, MatchModel *model, const QModelIndex &matchIndex, const QRegularExpression &regExp, const QString &replaceTxt)
 {
-    if (!doc || !item) {
+    if (!doc || !model || !model->isMatch(matchIndex)) {
         return false;
     }
 
-    QTreeWidgetItem *rootItem = item->parent();
-    if (!rootItem) {
-        return false;
-    }
+    const int fileRow = model->fileRow(matchIndex);
+    const QVector<MatchModel::Match> &fileMatches = model->fileMatches(fileRow);
 
     // Create a vector of moving ranges for updating the tree-view after replace
     QVector<KTextEditor::MovingRange *> matches;
-    QVector<bool> replaced;
     KTextEditor::MovingInterface *miface = qobject_cast<KTextEditor::MovingInterface *>(doc);
 
-    int i = 0;
-
     // Only add items after "item"
-    for (; i < rootItem->childCount(); i++) {
-        if (item == rootItem->child(i))
-            break;
-    }
-    for (int j = i; j < rootItem->childCount(); j++) {
-        QTreeWidgetItem *tmp = rootItem->child(j);
-        int startLine = tmp->data(0, ReplaceMatches::StartLineRole).toInt();
-        int startColumn = tmp->data(0, ReplaceMatches::StartColumnRole).toInt();
-        int endLine = tmp->data(0, ReplaceMatches::EndLineRole).toInt();
-        int endColumn = tmp->data(0, ReplaceMatches::EndColumnRole).toInt();
-        KTextEditor::Range range(startLine, startColumn, endLine, endColumn);
-        KTextEditor::MovingRange *mr = miface->newMovingRange(range);
+    const int i = matchIndex.row();
+    for (int j = i; j < fileMatches.size(); j++) {
+        KTextEditor::MovingRange *mr = miface->newMovingRange(fileMatches.at(j).range);
         matches.append(mr);
     }
 
@@ -180,19 +160,16 @@ bool ReplaceMatches::replaceSingleMatch(KTextEditor::Document *doc, QTreeWidgetI
     }
 
     // The first range in the vector is for this match
-    if (!replaceMatch(doc, item, matches[0]->toRange(), regExp, replaceTxt)) {
+    if (!replaceMatch(doc, model, fileRow, i, matches[0]->toRange(), regExp, replaceTxt)) {
+        qDeleteAll(matches);
         return false;
     }
 
     delete matches.takeFirst();
 
     // Update the remaining tree-view-items
-    for (int j = i + 1; j < rootItem->childCount() && !matches.isEmpty(); j++) {
-        QTreeWidgetItem *tmp = rootItem->child(j);
-        tmp->setData(0, ReplaceMatches::StartLineRole, matches.first()->start().line());
-        tmp->setData(0, ReplaceMatches::StartColumnRole, matches.first()->start().column());
-        tmp->setData(0, ReplaceMatches::EndLineRole, matches.first()->end().line());
-        tmp->setData(0, ReplaceMatches::EndColumnRole, matches.first()->end().column());
+    for (int j = i + 1; j < fileMatches.size() && !matches.isEmpty(); j++) {
+        model->setMatchRange(fileRow, j, matches.first()->toRange());
         delete matches.takeFirst();
     }
     qDeleteAll(matches);
@@ -201,10 +178,9 @@ bool ReplaceMatches::replaceSingleMatch(KTextEditor::Document *doc, QTreeWidgetI
 
 void ReplaceMatches::doReplaceNextMatch()
 {
-    if (!m_manager || m_tree->topLevelItemCount() != 1) {
-        updateTreeViewItems(nullptr);
-        m_rootIndex = -1;
-        emit replaceDone();
+    if (!m_manager || !m_model || m_rootIndex >= m_model->fileCount()) {
+        updateTreeViewItems(-1);
+        documentsDone();
         return;
     }
 
@@ -212,47 +188,41 @@ void ReplaceMatches::doReplaceNextMatch()
     // cancelReplace(). A closed file could lead to a crash if it is not handled.
 
     // Open the file
-    QTreeWidgetItem *fileItem = m_tree->topLevelItem(0)->child(m_rootIndex);
-    if (!fileItem) {
-        updateTreeViewItems(nullptr);
-        m_rootIndex = -1;
-        emit replaceDone();
-        return;
-    }
-
-    bool isSearchAsYouType = false;
-    if (!fileItem->data(0, StartColumnRole).toString().isEmpty()) {
-        // this is a search as you type replace
-        fileItem = m_tree->topLevelItem(0);
-        isSearchAsYouType = true;
-    }
+    const int fileRow = m_rootIndex;
 
     if (m_cancelReplace) {
-        updateTreeViewItems(fileItem);
-        m_rootIndex = -1;
-        emit replaceDone();
+        updateTreeViewItems(fileRow);
+        documentsDone();
         return;
     }
 
-    if (fileItem->checkState(0) == Qt::Unchecked) {
-        updateTreeViewItems(fileItem);
+    if (m_model->fileCheckState(fileRow) == Qt::Unchecked) {
+        updateTreeViewItems(fileRow);
         QTimer::singleShot(0, this, &ReplaceMatches::doReplaceNextMatch);
         return;
     }
 
     KTextEditor::Document *doc;
-    QString docUrl = fileItem->data(0, FileUrlRole).toString();
+    QString docUrl = m_model->fileUrl(fileRow);
     if (docUrl.isEmpty()) {
-        doc = findNamed(fileItem->data(0, FileNameRole).toString());
+        doc = findNamed(m_model->fileName(fileRow));
     } else {
-        doc = m_manager->findUrl(QUrl::fromUserInput(docUrl));
+        const QUrl url = QUrl::fromUserInput(docUrl);
+        doc = m_manager->findUrl(url);
+        if (!doc && url.isLocalFile()) {
+            // don't open a document per file, change it on disk
+            replaceOnDisk(fileRow, url.toLocalFile());
+            updateTreeViewItems(fileRow);
+            QTimer::singleShot(0, this, &ReplaceMatches::doReplaceNextMatch);
+            return;
+        }
         if (!doc) {
-            doc = m_manager->openUrl(QUrl::fromUserInput(fileItem->data(0, FileUrlRole).toString()));
+            doc = m_manager->openUrl(url);
         }
     }
 
     if (!doc) {
-        updateTreeViewItems(fileItem);
+        updateTreeViewItems(fileRow);
         QTimer::singleShot(0, this, &ReplaceMatches::doReplaceNextMatch);
         return;
     }
@@ -266,19 +236,14 @@ void ReplaceMatches::doReplaceNextMatch()
         }
     }
 
+    const QVector<MatchModel::Match> &fileMatches = m_model->fileMatches(fileRow);
+
     if (m_childStartIndex == 0) {
         // Create a vector of moving ranges for updating the tree-view after replace
-        QVector<bool> replaced;
         KTextEditor::MovingInterface *miface = qobject_cast<KTextEditor::MovingInterface *>(doc);
 
-        for (int j = 0; j < fileItem->childCount(); ++j) {
-            QTreeWidgetItem *item = fileItem->child(j);
-            int startLine = item->data(0, ReplaceMatches::StartLineRole).toInt();
-            int startColumn = item->data(0, ReplaceMatches::StartColumnRole).toInt();
-            int endLine = item->data(0, ReplaceMatches::EndLineRole).toInt();
-            int endColumn = item->data(0, ReplaceMatches::EndColumnRole).toInt();
-            KTextEditor::Range range(startLine, startColumn, endLine, endColumn);
-            KTextEditor::MovingRange *mr = miface->newMovingRange(range);
+        for (const MatchModel::Match &match : fileMatches) {
+            KTextEditor::MovingRange *mr = miface->newMovingRange(match.range);
             m_currentMatches.append(mr);
             m_currentReplaced << false;
         }
@@ -290,42 +255,32 @@ void ReplaceMatches::doReplaceNextMatch()
 
     // now do the replaces
     int i = m_childStartIndex;
-    for (; i < fileItem->childCount(); ++i) {
+    for (; i < fileMatches.size(); ++i) {
         if (m_progressTime.elapsed() > 100) {
             break;
         }
-        QTreeWidgetItem *item = fileItem->child(i);
 
-        if (item->checkState(0) == Qt::Checked) {
-            m_currentReplaced[i] = replaceMatch(doc, item, m_currentMatches[i]->toRange(), m_regExp, m_replaceText);
-            item->setCheckState(0, Qt::PartiallyChecked);
+        if (fileMatches.at(i).checkState == Qt::Checked) {
+            m_currentReplaced[i] = replaceMatch(doc, m_model, fileRow, i, m_currentMatches[i]->toRange(), m_regExp, m_replaceText);
+            m_model->setMatchCheckState(fileRow, i, Qt::PartiallyChecked);
         }
     }
 
-    if (i == fileItem->childCount()) {
-        updateTreeViewItems(fileItem);
-        if (isSearchAsYouType) {
-            m_rootIndex = -1;
-            emit replaceDone();
-            return;
-        }
+    if (i == fileMatches.size()) {
+        updateTreeViewItems(fileRow);
     } else {
         m_childStartIndex = i;
     }
     QTimer::singleShot(0, this, &ReplaceMatches::doReplaceNextMatch);
 }
 
-void ReplaceMatches::updateTreeViewItems(QTreeWidgetItem *fileItem)
+void ReplaceMatches::updateTreeViewItems(int fileRow)
 {
-    if (fileItem && m_currentReplaced.size() == m_currentMatches.size() && m_currentReplaced.size() == fileItem->childCount()) {
+    if (fileRow >= 0 && m_model && fileRow < m_model->fileCount() && m_currentReplaced.size() == m_currentMatches.size()
+        && m_currentReplaced.size() == m_model->fileMatches(fileRow).size()) {
         for (int j = 0; j < m_currentReplaced.size() && j < m_currentMatches.size(); ++j) {
-            QTreeWidgetItem *item = fileItem->child(j);
-
-            if (!m_currentReplaced[j] && item) {
-                item->setData(0, ReplaceMatches::StartLineRole, m_currentMatches[j]->start().line());
-                item->setData(0, ReplaceMatches::StartColumnRole, m_currentMatches[j]->start().column());
-                item->setData(0, ReplaceMatches::EndLineRole, m_currentMatches[j]->end().line());
-                item->setData(0, ReplaceMatches::EndColumnRole, m_currentMatches[j]->end().column());
+            if (!m_currentReplaced[j]) {
+                m_model->setMatchRange(fileRow, j, m_currentMatches[j]->toRange());
             }
         }
     }
@@ -337,3 +292,66 @@ void ReplaceMatches::updateTreeViewItems(QTreeWidgetItem *fileItem)
     m_currentMatches.clear();
     m_currentReplaced.clear();
 }
+
+void ReplaceMatches::documentsDone()
+{
+    m_rootIndex = -1;
+    if (m_diskReplacer.pendingFiles() == 0) {
+        emit replaceDone();
+    }
+}
+
+void ReplaceMatches::replaceOnDisk(int fileRow, const QString &fileName)
+{
+    ReplaceDiskFiles::FileJob job;
+    job.fileRow = fileRow;
+    job.fileName = fileName;
+    job.snapshotTime = qMax(m_searchTime, m_writtenTimes.value(fileName));
+
+    bool replaceAny = false;
+    const QVector<MatchModel::Match> &fileMatches = m_model->fileMatches(fileRow);
+    job.ranges.reserve(fileMatches.size());
+    job.replace.reserve(fileMatches.size());
+    for (const MatchModel::Match &match : fileMatches) {
+        const bool replace = match.checkState == Qt::Checked && !match.replaced;
+        job.ranges.append(match.range);
+        job.replace.append(replace);
+        replaceAny = replaceAny || replace;
+    }
+
+    if (replaceAny) {
+        m_diskReplacer.replaceInFile(job, m_regExp, m_replaceText);
+    }
+}
+
+void ReplaceMatches::diskFileReplaced(const ReplaceDiskFiles::FileResult &result)
+{
+    if (result.writtenTime.isValid()) {
+        m_writtenTimes.insert(result.fileName, result.writtenTime);
+    }
+
+    // the results might be gone or be the ones of another search by now
+    const int fileRow = result.fileRow;
+    if (m_model && fileRow < m_model->fileCount() && QUrl::fromUserInput(m_model->fileUrl(fileRow)).toLocalFile() == result.fileName
+        && m_model->fileMatches(fileRow).size() == result.ranges.size()) {
+        int replacedCount = 0;
+        for (int i = 0; i < result.ranges.size(); ++i) {
+            if (result.replaced.at(i)) {
+                m_model->setMatchReplaced(fileRow, i, result.ranges.at(i), result.replaceTexts.at(i));
+                m_model->setMatchCheckState(fileRow, i, Qt::PartiallyChecked);
+                replacedCount++;
+            } else if (result.writtenTime.isValid()) {
+                m_model->setMatchRange(fileRow, i, result.ranges.at(i));
+            }
+        }
+
+        if (m_progressTime.elapsed() > 100) {
+            m_progressTime.restart();
+            emit replaceStatus(QUrl::fromLocalFile(result.fileName), replacedCount, result.ranges.size());
+        }
+    }
+
+    if (m_rootIndex == -1 && m_diskReplacer.pendingFiles() == 0) {
+        emit replaceDone();
+    }
+}
@@ -21,15 +21,22 @@
 #ifndef _REPLACE_MATCHES_H_
 #define _REPLACE_MATCHES_H_
 
+#include <QDateTime>
 #include <QElapsedTimer>
+#include <QHash>
 #include <QObject>
+#include <QModelIndex>
+#include <QPointer>
 #include <QRegularExpression>
-#include <QTreeWidget>
 #include <ktexteditor/application.h>
 #include <ktexteditor/document.h>
 #include <ktexteditor/movinginterface.h>
 #include <ktexteditor/movingrange.h>
 
+#include "ReplaceDiskFiles.h"
+
+class MatchModel;
+
 class ReplaceMatches : public QObject
 {
     Q_OBJECT
@@ -53,9 +60,20 @@ public:
     ReplaceMatches(QObject *parent = nullptr);
     void setDocumentManager(KTextEditor::Application *manager);
 
-    bool replaceMatch(KTextEditor::Document *doc, QTreeWidgetItem *item, const KTextEditor::Range &range, const QRegularExpression &regExp, const QString &replaceTxt);
-    bool replaceSingleMatch(KTextEditor::Document *doc, QTreeWidgetItem *item, const QRegularExpression &regExp, const QString &replaceTxt);
-    void replaceChecked(QTreeWidget *tree, const QRegularExpression &regexp, const QString &replace);
+    bool replaceMatch(KTextEditor::Document *doc, MatchModel *model, int fileRow, int matchRow, const KTextEditor::Range &range, const QRegularExpression &regExp, const QString &replaceTxt);
+    bool replaceSingleMatch(KTextEditor::Document *doc, MatchModel *model, const QModelIndex &matchIndex, const QRegularExpression &regExp, const QString &replaceTxt);
+
+    /**
+     * Replaces all checked matches. Open documents are changed in the editor, the
+     * other local files directly on disk.
+     * @param searchTime when the search was started, files changed later are not replaced on disk
+     */
+    void replaceChecked(MatchModel *model, const QRegularExpression &regexp, const QString &replace, const QDateTime &searchTime);
+
+    /**
+     * @return the replace string with the captures of match filled in
+     */
+    static QString generateReplaceText(const QRegularExpressionMatch &match, const QString &replaceTxt);
 
     KTextEditor::Document *findNamed(const QString &name);
 
@@ -64,16 +82,19 @@ public Q_SLOTS:
 
 private Q_SLOTS:
     void doReplaceNextMatch();
+    void diskFileReplaced(const ReplaceDiskFiles::FileResult &result);
 
 Q_SIGNALS:
     void replaceStatus(const QUrl &url, int replacedInFile, int matchesInFile);
     void replaceDone();
 
 private:
-    void updateTreeViewItems(QTreeWidgetItem *fileItem);
+    void updateTreeViewItems(int fileRow);
+    void replaceOnDisk(int fileRow, const QString &fileName);
+    void documentsDone();
 
     KTextEditor::Application *m_manager = nullptr;
-    QTreeWidget *m_tree = nullptr;
+    QPointer<MatchModel> m_model;
     int m_rootIndex = -1;
     int m_childStartIndex = -1;
     QVector<KTextEditor::MovingRange *> m_currentMatches;
@@ -83,6 +104,11 @@ private:
     QString m_replaceText;
     bool m_cancelReplace;
     QElapsedTimer m_progressTime;
+
+    ReplaceDiskFiles m_diskReplacer;
+    QDateTime m_searchTime;
+    /** files written by the disk replace, they are newer than the search but still match the results */
+    QHash<QString, QDateTime> m_writtenTimes;
 };
 
 #endif
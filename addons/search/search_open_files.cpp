@@ -19,13 +19,42 @@
  */
 
 #include "search_open_files.h"
+#include "MultiLineText.h"
 
-#include <QElapsedTimer>
+#include <QRunnable>
+
+#include <ktexteditor/movinginterface.h>
+
+class SearchOpenFiles::SearchTask : public QRunnable
+{
+public:
+    SearchTask(SearchOpenFiles *searcher, int index)
+        : m_searcher(searcher)
+        , m_index(index)
+    {
+    }
+
+    void run() override
+    {
+        m_searcher->searchSnapshot(m_index);
+    }
+
+private:
+    SearchOpenFiles *m_searcher;
+    int m_index;
+};
 
 SearchOpenFiles::SearchOpenFiles(QObject *parent)
     : QObject(parent)
 {
-    connect(this, &SearchOpenFiles::searchNextFile, this, &SearchOpenFiles::doSearchNextFile, Qt::QueuedConnection);
+    qRegisterMetaType<QVector<KateSearchMatch>>();
+}
+
+SearchOpenFiles::~SearchOpenFiles()
+{
+    m_cancelSearch = true;
+    m_workerPool.waitForDone();
+    releaseSnapshots();
 }
 
 bool SearchOpenFiles::searching()
@@ -33,17 +62,57 @@ bool SearchOpenFiles::searching()
     return !m_cancelSearch;
 }
 
+QStringList SearchOpenFiles::takeLines(KTextEditor::Document *doc)
+{
+    // the lines are implicitly shared with the document, no text is copied here
+    QStringList lines;
+    const int lineCount = doc->lines();
+    lines.reserve(lineCount);
+    for (int line = 0; line < lineCount; ++line) {
+        lines << doc->line(line);
+    }
+    return lines;
+}
+
 void SearchOpenFiles::startSearch(const QList<KTextEditor::Document *> &list, const QRegularExpression &regexp)
 {
-    if (m_nextIndex != -1)
+    if (m_pendingCount > 0)
         return;
 
-    m_docList = list;
-    m_nextIndex = 0;
     m_regExp = regexp;
     m_cancelSearch = false;
     m_statusTime.restart();
-    emit searchNextFile(0);
+
+    m_snapshots.clear();
+    m_snapshots.reserve(list.size());
+    for (KTextEditor::Document *doc : list) {
+        Snapshot snapshot;
+        snapshot.doc = doc;
+        snapshot.url = doc->url().toString();
+        snapshot.docName = doc->documentName();
+        snapshot.lines = takeLines(doc);
+        // keep the revision around, the matches are transformed from it when they arrive
+        if (auto *movingInterface = qobject_cast<KTextEditor::MovingInterface *>(doc)) {
+            snapshot.revision = movingInterface->revision();
+            movingInterface->lockRevision(snapshot.revision);
+        }
+        m_snapshots << snapshot;
+    }
+
+    m_pendingCount = m_snapshots.size();
+    m_nextResultIndex = 0;
+    m_results = QVector<QVector<KateSearchMatch>>(m_snapshots.size());
+    m_resultReady = QVector<bool>(m_snapshots.size(), false);
+
+    if (m_snapshots.isEmpty()) {
+        m_cancelSearch = true;
+        emit searchDone();
+        return;
+    }
+
+    for (int i = 0; i < m_snapshots.size(); ++i) {
+        m_workerPool.start(new SearchTask(this, i));
+    }
 }
 
 void SearchOpenFiles::cancelSearch()
@@ -51,137 +120,181 @@ void SearchOpenFiles::cancelSearch()
     m_cancelSearch = true;
 }
 
-void SearchOpenFiles::doSearchNextFile(int startLine)
+void SearchOpenFiles::searchSnapshot(int index)
+{
+    // runs in a worker thread, the snapshots are not changed while tasks run
+    QVector<KateSearchMatch> matches;
+    if (!m_cancelSearch) {
+        const QRegularExpression regExp(m_regExp.pattern(), m_regExp.patternOptions());
+        searchLines(m_snapshots.at(index).lines, regExp, matches, -1);
+    }
+    QMetaObject::invokeMethod(this, "snapshotSearched", Qt::QueuedConnection, Q_ARG(int, index), Q_ARG(QVector<KateSearchMatch>, matches));
+}
+
+void SearchOpenFiles::snapshotSearched(int index, const QVector<KateSearchMatch> &matches)
 {
-    if (m_cancelSearch || m_nextIndex >= m_docList.size()) {
-        m_nextIndex = -1;
+    m_results[index] = matches;
+    m_resultReady[index] = true;
+    m_pendingCount--;
+
+    // deliver in document order, as far as the documents are done
+    while (m_nextResultIndex < m_snapshots.size() && m_resultReady.at(m_nextResultIndex)) {
+        const Snapshot &snapshot = m_snapshots.at(m_nextResultIndex);
+        QVector<KateSearchMatch> &result = m_results[m_nextResultIndex];
+        if (!m_cancelSearch && !result.isEmpty() && snapshot.doc) {
+            transformToCurrentRevision(snapshot, result);
+            emit matchesFound(snapshot.url, snapshot.docName, result);
+        }
+        result.clear();
+        m_nextResultIndex++;
+
+        if (m_statusTime.elapsed() > 100) {
+            m_statusTime.restart();
+            emit searching(snapshot.url);
+        }
+    }
+
+    if (m_pendingCount == 0) {
+        releaseSnapshots();
         m_cancelSearch = true;
         emit searchDone();
+    }
+}
+
+void SearchOpenFiles::transformToCurrentRevision(const Snapshot &snapshot, QVector<KateSearchMatch> &matches) const
+{
+    auto *movingInterface = qobject_cast<KTextEditor::MovingInterface *>(snapshot.doc.data());
+    if (!movingInterface || snapshot.revision == -1 || movingInterface->revision() == snapshot.revision) {
         return;
     }
 
-    // NOTE The document managers signal documentWillBeDeleted() must be connected to
-    // cancelSearch(). A closed file could lead to a crash if it is not handled.
-    int line = searchOpenFile(m_docList[m_nextIndex], m_regExp, startLine);
-    if (line == 0) {
-        // file searched go to next
-        m_nextIndex++;
-        if (m_nextIndex == m_docList.size()) {
-            m_nextIndex = -1;
-            m_cancelSearch = true;
-            emit searchDone();
-        } else {
-            emit searchNextFile(0);
+    // text inserted at the match start goes in front of it, at the end behind it
+    for (KateSearchMatch &match : matches) {
+        KTextEditor::Cursor start(match.startLine, match.startColumn);
+        KTextEditor::Cursor end(match.endLine, match.endColumn);
+        movingInterface->transformCursor(start, KTextEditor::MovingCursor::MoveOnInsert, snapshot.revision);
+        movingInterface->transformCursor(end, KTextEditor::MovingCursor::StayOnInsert, snapshot.revision);
+        match.startLine = start.line();
+        match.startColumn = start.column();
+        match.endLine = end.line();
+        match.endColumn = end.column();
+    }
+}
+
+void SearchOpenFiles::releaseSnapshots()
+{
+    for (const Snapshot &snapshot : qAsConst(m_snapshots)) {
+        auto *movingInterface = qobject_cast<KTextEditor::MovingInterface *>(snapshot.doc.data());
+        if (movingInterface && snapshot.revision != -1) {
+            movingInterface->unlockRevision(snapshot.revision);
         }
-    } else {
-        emit searchNextFile(line);
     }
+    m_snapshots.clear();
+    m_results.clear();
+    m_resultReady.clear();
 }
 
-int SearchOpenFiles::searchOpenFile(KTextEditor::Document *doc, const QRegularExpression &regExp, int startLine)
+int SearchOpenFiles::searchWhileTyping(KTextEditor::Document *doc, const QRegularExpression &regExp, bool plainText)
 {
-    if (m_statusTime.elapsed() > 100) {
-        m_statusTime.restart();
-        emit searching(doc->url().toString());
+    auto *movingInterface = qobject_cast<KTextEditor::MovingInterface *>(doc);
+    const qint64 revision = movingInterface ? movingInterface->revision() : -1;
+    const bool multiLine = regExp.pattern().contains(QLatin1String("\\n"));
+
+    // every match of the longer text starts with a match of the previous one,
+    // so it can only be in one of the lines that matched before
+    TypingSearch &previous = m_typingSearch;
+    const bool refine = plainText && previous.plainText && previous.complete && !multiLine && revision != -1 && previous.doc == doc
+        && previous.revision == revision && regExp.patternOptions() == previous.regExp.patternOptions()
+        && regExp.pattern().startsWith(previous.regExp.pattern());
+
+    QVector<KateSearchMatch> matches;
+    int stopLine = 0;
+    if (refine) {
+        for (int line : qAsConst(previous.matchingLines)) {
+            searchLine(doc->line(line), line, regExp, matches);
+        }
+    } else {
+        stopLine = searchLines(takeLines(doc), regExp, matches, 100);
     }
 
-    if (regExp.pattern().contains(QLatin1String("\\n"))) {
-        return searchMultiLineRegExp(doc, regExp, startLine);
+    previous.doc = doc;
+    previous.revision = revision;
+    previous.regExp = regExp;
+    previous.plainText = plainText;
+    previous.complete = stopLine == 0 && !multiLine;
+    previous.matchingLines.clear();
+    for (const KateSearchMatch &match : qAsConst(matches)) {
+        if (previous.matchingLines.isEmpty() || previous.matchingLines.last() != match.startLine) {
+            previous.matchingLines << match.startLine;
+        }
     }
 
-    return searchSingleLineRegExp(doc, regExp, startLine);
+    if (!matches.isEmpty()) {
+        emit matchesFound(doc->url().toString(), doc->documentName(), matches);
+    }
+    return stopLine;
+}
+
+void SearchOpenFiles::searchLine(const QString &lineContent, int line, const QRegularExpression &regExp, QVector<KateSearchMatch> &matches)
+{
+    QRegularExpressionMatch match = regExp.match(lineContent);
+    int column = match.capturedStart();
+    while (column != -1 && !match.captured().isEmpty()) {
+        matches.append({lineContent, match.capturedLength(), line, column, line, column + match.capturedLength()});
+        match = regExp.match(lineContent, column + match.capturedLength());
+        column = match.capturedStart();
+    }
 }
 
-int SearchOpenFiles::searchSingleLineRegExp(KTextEditor::Document *doc, const QRegularExpression &regExp, int startLine)
+int SearchOpenFiles::searchLines(const QStringList &lines, const QRegularExpression &regExp, QVector<KateSearchMatch> &matches, int timeLimit) const
 {
-    int column;
+    if (regExp.pattern().contains(QLatin1String("\\n"))) {
+        return searchMultiLineRegExp(lines, regExp, matches, timeLimit);
+    }
+
     QElapsedTimer time;
+    int stopLine = 0;
 
     time.start();
-    for (int line = startLine; line < doc->lines(); line++) {
-        if (time.elapsed() > 100) {
-            // qDebug() << "Search time exceeded" << time.elapsed() << line;
-            return line;
+    for (int line = 0; line < lines.size(); line++) {
+        if (m_cancelSearch && timeLimit < 0) {
+            break;
         }
-        QRegularExpressionMatch match;
-        match = regExp.match(doc->line(line));
-        column = match.capturedStart();
-        while (column != -1 && !match.captured().isEmpty()) {
-            emit matchFound(doc->url().toString(), doc->documentName(), doc->line(line), match.capturedLength(), line, column, line, column + match.capturedLength());
-            match = regExp.match(doc->line(line), column + match.capturedLength());
-            column = match.capturedStart();
+        if (timeLimit >= 0 && time.elapsed() > timeLimit) {
+            // qDebug() << "Search time exceeded" << time.elapsed() << line;
+            stopLine = line;
+            break;
         }
+        searchLine(lines.at(line), line, regExp, matches);
     }
-    return 0;
+    return stopLine;
 }
 
-int SearchOpenFiles::searchMultiLineRegExp(KTextEditor::Document *doc, const QRegularExpression &regExp, int inStartLine)
+int SearchOpenFiles::searchMultiLineRegExp(const QStringList &lines, const QRegularExpression &regExp, QVector<KateSearchMatch> &matches, int timeLimit) const
 {
-    int column = 0;
-    int startLine = 0;
     QElapsedTimer time;
     time.start();
-    QRegularExpression tmpRegExp = regExp;
-
-    if (inStartLine == 0) {
-        // Copy the whole file to a temporary buffer to be able to search newlines
-        m_fullDoc.clear();
-        m_lineStart.clear();
-        m_lineStart << 0;
-        for (int i = 0; i < doc->lines(); i++) {
-            m_fullDoc += doc->line(i) + QLatin1Char('\n');
-            m_lineStart << m_fullDoc.size();
-        }
-        if (!regExp.pattern().endsWith(QLatin1Char('$'))) {
-            // if regExp ends with '$' leave the extra newline at the end as
-            // '$' will be replaced with (?=\\n), which needs the extra newline
-            m_fullDoc.remove(m_fullDoc.size() - 1, 1);
-        }
-    } else {
-        if (inStartLine > 0 && inStartLine < m_lineStart.size()) {
-            column = m_lineStart[inStartLine];
-            startLine = inStartLine;
-        } else {
-            return 0;
-        }
-    }
 
-    if (regExp.pattern().endsWith(QLatin1Char('$'))) {
-        QString newPatern = tmpRegExp.pattern();
-        newPatern.replace(QStringLiteral("$"), QStringLiteral("(?=\\n)"));
-        tmpRegExp.setPattern(newPatern);
+    // Copy the whole file to a temporary buffer to be able to search newlines
+    MultiLineText fullDoc;
+    for (const QString &line : lines) {
+        fullDoc.appendLine(line);
     }
+    fullDoc.appendFinalNewLine(regExp);
 
-    QRegularExpressionMatch match;
-    match = tmpRegExp.match(m_fullDoc, column);
-    column = match.capturedStart();
-    while (column != -1 && !match.captured().isEmpty()) {
-        // search for the line number of the match
-        int i;
-        startLine = -1;
-        for (i = 1; i < m_lineStart.size(); i++) {
-            if (m_lineStart[i] > column) {
-                startLine = i - 1;
-                break;
-            }
-        }
-        if (startLine == -1) {
+    const QRegularExpression lineEndRegExp = MultiLineText::regExp(regExp);
+    int line = 0;
+    QRegularExpressionMatch match = lineEndRegExp.match(fullDoc.text());
+    while (match.hasMatch() && match.capturedLength() > 0) {
+        if (m_cancelSearch && timeLimit < 0) {
             break;
         }
+        matches.append(fullDoc.toSearchMatch(match, line));
+        match = lineEndRegExp.match(fullDoc.text(), match.capturedEnd());
 
-        int startColumn = (column - m_lineStart[startLine]);
-        int endLine = startLine + match.captured().count(QLatin1Char('\n'));
-        int lastNL = match.captured().lastIndexOf(QLatin1Char('\n'));
-        int endColumn = lastNL == -1 ? startColumn + match.captured().length() : match.captured().length() - lastNL - 1;
-
-        emit matchFound(doc->url().toString(), doc->documentName(), doc->line(startLine).left(column - m_lineStart[startLine]) + match.captured(), match.capturedLength(), startLine, startColumn, endLine, endColumn);
-
-        match = tmpRegExp.match(m_fullDoc, column + match.capturedLength());
-        column = match.capturedStart();
-
-        if (time.elapsed() > 100) {
+        if (timeLimit >= 0 && time.elapsed() > timeLimit && match.hasMatch()) {
             // qDebug() << "Search time exceeded" << time.elapsed() << line;
-            return startLine;
+            return qMax(1, line);
         }
     }
     return 0;
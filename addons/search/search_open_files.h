@@ -21,17 +21,34 @@
 #ifndef _SEARCH_OPEN_FILES_H_
 #define _SEARCH_OPEN_FILES_H_
 
+#include <QAtomicInt>
 #include <QElapsedTimer>
 #include <QObject>
+#include <QPointer>
 #include <QRegularExpression>
+#include <QStringList>
+#include <QThreadPool>
+#include <QVector>
 #include <ktexteditor/document.h>
 
+#include "KateSearchMatch.h"
+
+/**
+ * Searches documents open in the editor.
+ *
+ * startSearch() takes a snapshot of the lines of every document, which is
+ * cheap as the lines are implicitly shared, and locks the current revision.
+ * The snapshots are searched on worker threads. When the matches of a
+ * document arrive back in the GUI thread, they are transformed to the current
+ * revision of the document, so edits done during the search don't shift them.
+ */
 class SearchOpenFiles : public QObject
 {
     Q_OBJECT
 
 public:
     SearchOpenFiles(QObject *parent = nullptr);
+    ~SearchOpenFiles() override;
 
     void startSearch(const QList<KTextEditor::Document *> &list, const QRegularExpression &regexp);
     bool searching();
@@ -39,30 +56,71 @@ public:
 public Q_SLOTS:
     void cancelSearch();
 
-    /// return 0 on success or a line number where we stopped.
-    int searchOpenFile(KTextEditor::Document *doc, const QRegularExpression &regExp, int startLine);
+    /**
+     * Searches one document right away for search-as-you-type, gives up after about 100ms.
+     *
+     * If the search only refines the previous one, the document didn't change and the
+     * pattern is plain text extending the previous text, only the lines that matched
+     * before are searched again. Everything else searches the whole document.
+     * @param plainText the pattern is escaped plain text, not a regular expression typed by the user
+     * @return 0 on success or a line number where we stopped.
+     */
+    int searchWhileTyping(KTextEditor::Document *doc, const QRegularExpression &regExp, bool plainText);
 
 private Q_SLOTS:
-    void doSearchNextFile(int startLine);
+    void snapshotSearched(int index, const QVector<KateSearchMatch> &matches);
 
 private:
-    int searchSingleLineRegExp(KTextEditor::Document *doc, const QRegularExpression &regExp, int startLine);
-    int searchMultiLineRegExp(KTextEditor::Document *doc, const QRegularExpression &regExp, int startLine);
+    struct Snapshot {
+        QPointer<KTextEditor::Document> doc;
+        QString url;
+        QString docName;
+        QStringList lines;
+        qint64 revision = -1;
+    };
+
+    class SearchTask;
+
+    void searchSnapshot(int index);
+    static void searchLine(const QString &lineContent, int line, const QRegularExpression &regExp, QVector<KateSearchMatch> &matches);
+    int searchLines(const QStringList &lines, const QRegularExpression &regExp, QVector<KateSearchMatch> &matches, int timeLimit) const;
+    int searchMultiLineRegExp(const QStringList &lines, const QRegularExpression &regExp, QVector<KateSearchMatch> &matches, int timeLimit) const;
+    void transformToCurrentRevision(const Snapshot &snapshot, QVector<KateSearchMatch> &matches) const;
+    void releaseSnapshots();
+
+    static QStringList takeLines(KTextEditor::Document *doc);
 
 Q_SIGNALS:
-    void searchNextFile(int startLine);
-    void matchFound(const QString &url, const QString &fileName, const QString &lineContent, int matchLen, int line, int column, int endLine, int endColumn);
+    void matchesFound(const QString &url, const QString &fileName, const QVector<KateSearchMatch> &searchMatches);
     void searchDone();
     void searching(const QString &file);
 
 private:
-    QList<KTextEditor::Document *> m_docList;
-    int m_nextIndex = -1;
+    QVector<Snapshot> m_snapshots;
     QRegularExpression m_regExp;
-    bool m_cancelSearch = true;
-    QString m_fullDoc;
-    QVector<int> m_lineStart;
+    QAtomicInt m_cancelSearch {1};
     QElapsedTimer m_statusTime;
+    QThreadPool m_workerPool;
+
+    /** snapshots not yet delivered, results are emitted in the order of the document list */
+    int m_pendingCount = 0;
+    int m_nextResultIndex = 0;
+    QVector<QVector<KateSearchMatch>> m_results;
+    QVector<bool> m_resultReady;
+
+    /**
+     * The last search-as-you-type, a refined search can start from its result.
+     */
+    struct TypingSearch {
+        QPointer<KTextEditor::Document> doc;
+        qint64 revision = -1;
+        QRegularExpression regExp;
+        bool plainText = false;
+        /** false if the search was interrupted, matchingLines is not complete then */
+        bool complete = false;
+        QVector<int> matchingLines;
+    };
+    TypingSearch m_typingSearch;
 };
 
 #endif
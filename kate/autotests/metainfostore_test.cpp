@@ -0,0 +1,131 @@
+/*  SPDX-License-Identifier: LGPL-2.0-or-later
+
+    Copyright (C) 2020 Kate Developers <kwrite-devel@kde.org>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Library General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Library General Public License for more details.
+
+    You should have received a copy of the GNU Library General Public License
+    along with this library; see the file COPYING.LIB.  If not, write to
+    the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+    Boston, MA 02110-1301, USA.
+*/
+
+#include "metainfostore_test.h"
+#include "katemetainfostore.h"
+
+#include <QFile>
+#include <QTemporaryDir>
+#include <QtTest>
+
+QTEST_MAIN(KateMetaInfoStoreTest)
+
+static KateMetaInfoStore::Entry testEntry(int i)
+{
+    KateMetaInfoStore::Entry entry;
+    entry.checksum = QByteArray::number(i).toHex();
+    entry.time = 1000 + i;
+    entry.config.insert(QStringLiteral("Mode"), QStringLiteral("Normal %1").arg(i));
+    return entry;
+}
+
+static QString testUrl(int i)
+{
+    return QStringLiteral("file:///tmp/file%1.txt").arg(i);
+}
+
+void KateMetaInfoStoreTest::init()
+{
+    m_tmpdir = new QTemporaryDir;
+    QVERIFY(m_tmpdir->isValid());
+}
+
+void KateMetaInfoStoreTest::cleanup()
+{
+    delete m_tmpdir;
+}
+
+void KateMetaInfoStoreTest::reopen()
+{
+    const QString baseName = m_tmpdir->filePath(QStringLiteral("store"));
+    {
+        KateMetaInfoStore store(baseName);
+        QVERIFY(store.isNew());
+        for (int i = 0; i < 10; ++i) {
+            store.insert(testUrl(i), testEntry(i));
+        }
+        store.remove(testUrl(3));
+    }
+
+    KateMetaInfoStore store(baseName);
+    QVERIFY(!store.isNew());
+    for (int i = 0; i < 10; ++i) {
+        KateMetaInfoStore::Entry entry;
+        QCOMPARE(store.find(testUrl(i), entry), i != 3);
+        if (i != 3) {
+            QCOMPARE(entry.checksum, testEntry(i).checksum);
+            QCOMPARE(entry.time, testEntry(i).time);
+            QCOMPARE(entry.config, testEntry(i).config);
+        }
+    }
+}
+
+void KateMetaInfoStoreTest::truncatedJournal()
+{
+    const QString baseName = m_tmpdir->filePath(QStringLiteral("store"));
+    {
+        KateMetaInfoStore store(baseName);
+        for (int i = 0; i < 10; ++i) {
+            store.insert(testUrl(i), testEntry(i));
+        }
+    }
+
+    // a crash while writing leaves the last record incomplete
+    QFile journal(baseName + QStringLiteral(".journal"));
+    QVERIFY(journal.exists());
+    QVERIFY(journal.resize(journal.size() / 2 + 1));
+
+    {
+        KateMetaInfoStore store(baseName);
+        KateMetaInfoStore::Entry entry;
+        QVERIFY(store.find(testUrl(0), entry));
+        QVERIFY(!store.find(testUrl(9), entry));
+        store.insert(testUrl(10), testEntry(10));
+    }
+
+    // the records written after the crash are read again
+    KateMetaInfoStore store(baseName);
+    KateMetaInfoStore::Entry entry;
+    QVERIFY(store.find(testUrl(0), entry));
+    QVERIFY(store.find(testUrl(10), entry));
+    QCOMPARE(entry.config, testEntry(10).config);
+}
+
+void KateMetaInfoStoreTest::invalidJournalHeader()
+{
+    const QString baseName = m_tmpdir->filePath(QStringLiteral("store"));
+    QFile journal(baseName + QStringLiteral(".journal"));
+    QVERIFY(journal.open(QIODevice::WriteOnly));
+    journal.write("not a journal");
+    journal.close();
+
+    {
+        KateMetaInfoStore store(baseName);
+        store.insert(testUrl(0), testEntry(0));
+    }
+
+    // the unreadable journal is moved aside and a new one is started
+    QVERIFY(QFile::exists(baseName + QStringLiteral(".journal.broken")));
+
+    KateMetaInfoStore store(baseName);
+    KateMetaInfoStore::Entry entry;
+    QVERIFY(store.find(testUrl(0), entry));
+    QCOMPARE(entry.checksum, testEntry(0).checksum);
+}
@@ -289,7 +289,48 @@ public Q_SLOTS:
      */
     KTextEditor::Document *findUrl(const QUrl &url)
     {
-        return m_docManager.findDocument(url);
+        // whoever looks for a document wants its content
+        KTextEditor::Document *doc = m_docManager.findDocument(url);
+        if (doc) {
+            m_docManager.loadDocument(doc);
+        }
+        return doc;
+    }
+
+    /**
+     * Get the url of the document \p document.
+     * Documents restored from a session are only loaded once shown, until then
+     * their own url is empty and this is the url they will be loaded from.
+     * Not part of KTextEditor::Application, plugins call it by name on its parent.
+     * \param document the document
+     * \return the url of the document
+     */
+    QUrl documentUrl(KTextEditor::Document *document)
+    {
+        return m_docManager.documentUrl(document);
+    }
+
+    /**
+     * Get the name of the document \p document, also for documents not loaded yet.
+     * Not part of KTextEditor::Application, plugins call it by name on its parent.
+     * \param document the document
+     * \return the name of the document
+     */
+    QString documentName(KTextEditor::Document *document)
+    {
+        return m_docManager.documentName(document);
+    }
+
+    /**
+     * Get the documents of many local files at once, e.g. to split a file list
+     * into open documents and files on disk.
+     * Not part of KTextEditor::Application, plugins call it by name on its parent.
+     * \param fileNames the local files, they have to match the document urls exactly
+     * \return for every file its document or NULL, in the order of \p fileNames
+     */
+    QList<KTextEditor::Document *> documentsForLocalFiles(const QStringList &fileNames)
+    {
+        return m_docManager.documentsForLocalFiles(fileNames);
     }
 
     /**
@@ -147,6 +147,41 @@ KateConfigDialog::KateConfigDialog(KateMainWindow *parent, KTextEditor::View *vi
     vbox->addWidget(metaInfos);
     buttonGroup->setLayout(vbox);
 
+    // GROUP with the one below: "Memory Usage"
+    buttonGroup = new QGroupBox(i18n("Memory Usage"), generalFrame);
+    vbox = new QVBoxLayout;
+    layout->addWidget(buttonGroup);
+
+    // hibernate views
+    hlayout = new QHBoxLayout;
+    label = new QLabel(i18n("&Keep views open for at most:"), buttonGroup);
+    hlayout->addWidget(label);
+    m_hibernateViewsAfter = new KPluralHandlingSpinBox(buttonGroup);
+    m_hibernateViewsAfter->setMaximum(1000);
+    m_hibernateViewsAfter->setSpecialValueText(i18nc("The special case of 'Keep views open for at most'", "(all documents)"));
+    m_hibernateViewsAfter->setSuffix(ki18ncp("The suffix of 'Keep views open for at most'", " document", " documents"));
+    m_hibernateViewsAfter->setValue(KateApp::self()->documentManager()->getHibernateViewsAfter());
+    m_hibernateViewsAfter->setWhatsThis(
+        i18n("Views of the least recently used documents beyond this count are closed, "
+             "their tabs stay. The view is created again with its cursor, selection and "
+             "folding once the document is shown."));
+    hlayout->addWidget(m_hibernateViewsAfter);
+    label->setBuddy(m_hibernateViewsAfter);
+    connect(m_hibernateViewsAfter, static_cast<void (KPluralHandlingSpinBox::*)(int)>(&KPluralHandlingSpinBox::valueChanged), this, &KateConfigDialog::slotChanged);
+
+    vbox->addLayout(hlayout);
+
+    // hibernate documents
+    m_hibernateDocuments = new QCheckBox(i18n("&Unload unmodified documents without views"), buttonGroup);
+    m_hibernateDocuments->setChecked(KateApp::self()->documentManager()->getHibernateDocuments());
+    m_hibernateDocuments->setWhatsThis(
+        i18n("If enabled, the text of unmodified documents whose views were closed is "
+             "unloaded. The document is loaded again from its file once it is needed."));
+    connect(m_hibernateDocuments, &QCheckBox::toggled, this, &KateConfigDialog::slotChanged);
+
+    vbox->addWidget(m_hibernateDocuments);
+    buttonGroup->setLayout(vbox);
+
     // quick search
     buttonGroup = new QGroupBox(i18n("&Quick Open"), generalFrame);
     vbox = new QVBoxLayout;
@@ -387,6 +422,12 @@ void KateConfigDialog::slotApply()
         cg.writeEntry("Days Meta Infos", m_daysMetaInfos->value());
         KateApp::self()->documentManager()->setDaysMetaInfos(m_daysMetaInfos->value());
 
+        cg.writeEntry("Hibernate Views After", m_hibernateViewsAfter->value());
+        KateApp::self()->documentManager()->setHibernateViewsAfter(m_hibernateViewsAfter->value());
+
+        cg.writeEntry("Hibernate Documents", m_hibernateDocuments->isChecked());
+        KateApp::self()->documentManager()->setHibernateDocuments(m_hibernateDocuments->isChecked());
+
         cg.writeEntry("Modified Notification", m_modNotifications->isChecked());
         m_mainWindow->setModNotificationEnabled(m_modNotifications->isChecked());
 
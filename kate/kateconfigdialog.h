@@ -94,6 +94,8 @@ private:
     QCheckBox *m_modCloseAfterLast;
     QCheckBox *m_saveMetaInfos;
     KPluralHandlingSpinBox *m_daysMetaInfos;
+    KPluralHandlingSpinBox *m_hibernateViewsAfter;
+    QCheckBox *m_hibernateDocuments;
     QComboBox *m_cmbQuickOpenMatchMode;
     QComboBox *m_cmbQuickOpenListMode;
 
@@ -40,21 +40,32 @@
 #include <QByteArray>
 #include <QDateTime>
 #include <QFileDialog>
+#include <QFileInfo>
 #include <QHash>
 #include <QListView>
-#include <QProgressDialog>
+#include <QStandardPaths>
 #include <QTextCodec>
 #include <QTimer>
 
 KateDocManager::KateDocManager(QObject *parent)
     : QObject(parent)
-    , m_metaInfos(QStringLiteral("katemetainfos"), KConfig::NoGlobals)
+    , m_metaInfos(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + QStringLiteral("/metainfos"))
     , m_saveMetaInfos(true)
     , m_daysMetaInfos(0)
+    , m_hibernateViewsAfter(0)
+    , m_hibernateDocuments(false)
 {
     // set our application wrapper
     KTextEditor::Editor::instance()->setApplication(KateApp::self()->wrapper());
 
+    // take over the meta-infos of older versions
+    if (m_metaInfos.isNew()) {
+        importMetaInfos();
+    }
+
+    // documents opened in a batch are loaded once their file was read ahead
+    connect(&m_fileLoader, &KateFileLoader::fileReady, this, &KateDocManager::loadDocument);
+
     // create one doc, we always have at least one around!
     createDoc();
 }
@@ -68,18 +79,7 @@ KateDocManager::~KateDocManager()
 
         // purge saved filesessions
         if (m_daysMetaInfos > 0) {
-            const QStringList groups = m_metaInfos.groupList();
-#if QT_VERSION < QT_VERSION_CHECK(5, 15, 0)
-            QDateTime def(QDate(1970, 1, 1));
-#else
-            QDateTime def(QDate(1970, 1, 1).startOfDay());
-#endif
-            for (const auto &group : groups) {
-                QDateTime last = m_metaInfos.group(group).readEntry("Time", def);
-                if (last.daysTo(QDateTime::currentDateTimeUtc()) > m_daysMetaInfos) {
-                    m_metaInfos.deleteGroup(group);
-                }
-            }
+            m_metaInfos.expire(m_daysMetaInfos);
         }
     }
 
@@ -99,9 +99,11 @@ KTextEditor::Document *KateDocManager::createDoc(const KateDocumentInfo &docInfo
 
     m_docList.append(doc);
     m_docInfos.insert(doc, new KateDocumentInfo(docInfo));
+    slotUrlChanged(doc);
 
     // connect internal signals...
     connect(doc, &KTextEditor::Document::modifiedChanged, this, &KateDocManager::slotModChanged1);
+    connect(doc, &KTextEditor::Document::documentUrlChanged, this, &KateDocManager::slotUrlChanged);
     connect(doc,
             SIGNAL(modifiedOnDisk(KTextEditor::Document *, bool, KTextEditor::ModificationInterface::ModifiedOnDiskReason)),
             this,
@@ -120,6 +122,17 @@ KateDocumentInfo *KateDocManager::documentInfo(KTextEditor::Document *doc)
     return m_docInfos.contains(doc) ? m_docInfos[doc] : nullptr;
 }
 
+/**
+ * Documents read and write their session config from config groups,
+ * the config is kept as plain map where they are not loaded.
+ */
+static void writeEntries(KConfigGroup &cg, const QMap<QString, QString> &entries)
+{
+    for (auto it = entries.constBegin(); it != entries.constEnd(); ++it) {
+        cg.writeEntry(it.key(), it.value());
+    }
+}
+
 static QUrl normalizeUrl(const QUrl &url)
 {
     // Resolve symbolic links for local files (done anyway in KTextEditor)
@@ -136,13 +149,144 @@ static QUrl normalizeUrl(const QUrl &url)
 
 KTextEditor::Document *KateDocManager::findDocument(const QUrl &url) const
 {
-    const QUrl u(normalizeUrl(url));
-    for (KTextEditor::Document *it : m_docList) {
-        if (it->url() == u) {
-            return it;
+    // several documents with the same url: return the first one opened, values() has it last
+    const QList<KTextEditor::Document *> docs = m_docsByUrl.values(normalizeUrl(url));
+    return docs.isEmpty() ? nullptr : docs.last();
+}
+
+QList<KTextEditor::Document *> KateDocManager::documentsForLocalFiles(const QStringList &fileNames) const
+{
+    QList<KTextEditor::Document *> docs;
+    docs.reserve(fileNames.size());
+    // only untitled documents, no need to create all the urls
+    if (m_docsByUrl.isEmpty()) {
+        for (int i = 0; i < fileNames.size(); ++i) {
+            docs.append(nullptr);
+        }
+        return docs;
+    }
+    for (const QString &fileName : fileNames) {
+        KTextEditor::Document *doc = m_docsByUrl.value(QUrl::fromLocalFile(fileName));
+        docs.append(doc && !isPlaceholder(doc) ? doc : nullptr);
+    }
+    return docs;
+}
+
+bool KateDocManager::isPlaceholder(KTextEditor::Document *doc) const
+{
+    const KateDocumentInfo *info = m_docInfos.value(doc);
+    return info && !info->placeholderUrl.isEmpty();
+}
+
+QUrl KateDocManager::documentUrl(KTextEditor::Document *doc) const
+{
+    const KateDocumentInfo *info = m_docInfos.value(doc);
+    return info && !info->placeholderUrl.isEmpty() ? info->placeholderUrl : doc->url();
+}
+
+QString KateDocManager::documentName(KTextEditor::Document *doc) const
+{
+    const KateDocumentInfo *info = m_docInfos.value(doc);
+    return info && !info->placeholderUrl.isEmpty() ? info->placeholderUrl.fileName() : doc->documentName();
+}
+
+void KateDocManager::loadDocument(KTextEditor::Document *doc)
+{
+    KateDocumentInfo *info = m_docInfos.value(doc);
+    if (!info || info->placeholderUrl.isEmpty()) {
+        return;
+    }
+
+    // opened in a batch, load it like openUrl() does
+    if (info->sessionConfig.isEmpty()) {
+        const QUrl url = info->placeholderUrl;
+        const QString encoding = info->encoding;
+        info->placeholderUrl.clear();
+        info->encoding.clear();
+
+        if (!encoding.isEmpty()) {
+            doc->setEncoding(encoding);
         }
+        doc->openUrl(url);
+        loadMetaInfos(doc, url);
+        slotUrlChanged(doc);
+        return;
+    }
+
+    // the document reads its session config from a group, rebuild it in memory
+    KConfig config(QString(), KConfig::SimpleConfig);
+    KConfigGroup cg(&config, "Document");
+    writeEntries(cg, info->sessionConfig);
+    const QUrl url = info->placeholderUrl;
+    const bool hibernated = info->hibernated;
+    info->placeholderUrl.clear();
+    info->sessionConfig.clear();
+    info->hibernated = false;
+
+    connect(doc, SIGNAL(completed()), this, SLOT(documentOpened()));
+    connect(doc, &KParts::ReadOnlyPart::canceled, this, &KateDocManager::documentOpened);
+
+    doc->readSessionConfig(cg);
+
+    // the url might not have changed if the file could not be opened
+    slotUrlChanged(doc);
+
+    // a file deleted while the document was hibernated is reported like one deleted while loaded
+    if (hibernated && url.isLocalFile() && !QFileInfo::exists(url.toLocalFile())) {
+        slotModifiedOnDisc(doc, true, KTextEditor::ModificationInterface::OnDiskDeleted);
     }
-    return nullptr;
+}
+
+bool KateDocManager::hibernateDocument(KTextEditor::Document *doc)
+{
+    KateDocumentInfo *info = m_docInfos.value(doc);
+    if (!m_hibernateDocuments || !info || !info->placeholderUrl.isEmpty()) {
+        return false;
+    }
+
+    // only documents that are loaded again exactly as they are now, a document modified
+    // on disk keeps the text the user decided to keep
+    if (!doc->views().isEmpty() || doc->isModified() || doc->url().isEmpty() || info->modifiedOnDisc || !info->openSuccess) {
+        return false;
+    }
+
+    KConfig config(QString(), KConfig::SimpleConfig);
+    KConfigGroup cg(&config, "Document");
+    doc->writeSessionConfig(cg);
+
+    // set before the url is closed, the document is still indexed and shown under its url
+    info->placeholderUrl = doc->url();
+    info->sessionConfig = cg.entryMap();
+    info->hibernated = true;
+    if (!doc->closeUrl()) {
+        info->placeholderUrl.clear();
+        info->sessionConfig.clear();
+        info->hibernated = false;
+        return false;
+    }
+
+    slotUrlChanged(doc);
+    return true;
+}
+
+void KateDocManager::slotUrlChanged(KTextEditor::Document *doc)
+{
+    const QUrl url = documentUrl(doc);
+    const auto indexed = m_indexedUrls.constFind(doc);
+    if (indexed != m_indexedUrls.constEnd()) {
+        if (indexed.value() == url) {
+            return;
+        }
+        m_docsByUrl.remove(indexed.value(), doc);
+    }
+
+    // untitled documents can't be found by url
+    if (url.isEmpty()) {
+        m_indexedUrls.remove(doc);
+        return;
+    }
+    m_docsByUrl.insert(url, doc);
+    m_indexedUrls.insert(doc, url);
 }
 
 QList<KTextEditor::Document *> KateDocManager::openUrls(const QList<QUrl> &urls, const QString &encoding, bool isTempFile, const KateDocumentInfo &docInfo)
@@ -152,7 +296,23 @@ QList<KTextEditor::Document *> KateDocManager::openUrls(const QList<QUrl> &urls,
     emit aboutToCreateDocuments();
 
     for (const QUrl &url : urls) {
-        docs << openUrl(url, encoding, isTempFile, docInfo);
+        // the first one might reuse the untitled document, all others are new
+        const QUrl u(normalizeUrl(url));
+        if (docs.isEmpty() || !u.isLocalFile() || findDocument(u)) {
+            docs << openUrl(url, encoding, isTempFile, docInfo);
+            continue;
+        }
+
+        // local files are read on worker threads first, the documents are loaded afterwards
+        KateDocumentInfo info(docInfo);
+        info.placeholderUrl = u;
+        info.encoding = encoding;
+        KTextEditor::Document *doc = createDoc(info);
+        if (isTempFile) {
+            registerTempFile(doc, u);
+        }
+        m_fileLoader.load(doc, u.toLocalFile());
+        docs << doc;
     }
 
     emit documentsCreated(docs);
@@ -165,7 +325,8 @@ KTextEditor::Document *KateDocManager::openUrl(const QUrl &url, const QString &e
     // special handling: if only one unmodified empty buffer in the list,
     // keep this buffer in mind to close it after opening the new url
     KTextEditor::Document *untitledDoc = nullptr;
-    if ((documentList().count() == 1) && (!documentList().at(0)->isModified() && documentList().at(0)->url().isEmpty())) {
+    if ((documentList().count() == 1) && (!documentList().at(0)->isModified() && documentList().at(0)->url().isEmpty())
+        && !isPlaceholder(documentList().at(0))) {
         untitledDoc = documentList().first();
     }
 
@@ -199,22 +360,29 @@ KTextEditor::Document *KateDocManager::openUrl(const QUrl &url, const QString &e
             doc->openUrl(u);
             loadMetaInfos(doc, u);
         }
+    } else {
+        loadDocument(doc);
     }
 
     //
     // if needed, register as temporary file
     //
     if (isTempFile && u.isLocalFile()) {
-        QFileInfo fi(u.toLocalFile());
-        if (fi.exists()) {
-            m_tempFiles[doc] = qMakePair(u, fi.lastModified());
-            qCDebug(LOG_KATE) << "temporary file will be deleted after use unless modified: " << u;
-        }
+        registerTempFile(doc, u);
     }
 
     return doc;
 }
 
+void KateDocManager::registerTempFile(KTextEditor::Document *doc, const QUrl &url)
+{
+    QFileInfo fi(url.toLocalFile());
+    if (fi.exists()) {
+        m_tempFiles[doc] = qMakePair(url, fi.lastModified());
+        qCDebug(LOG_KATE) << "temporary file will be deleted after use unless modified: " << url;
+    }
+}
+
 bool KateDocManager::closeDocuments(const QList<KTextEditor::Document *> &documents, bool closeUrl)
 {
     if (documents.isEmpty()) {
@@ -257,6 +425,8 @@ bool KateDocManager::closeDocuments(const QList<KTextEditor::Document *> &docume
 
         // really delete the document and its infos
         delete m_docInfos.take(doc);
+        m_fileLoader.remove(doc);
+        m_docsByUrl.remove(m_indexedUrls.take(doc), doc);
         delete m_docList.takeAt(m_docList.indexOf(doc));
 
         // document is gone, emit our signals
@@ -435,7 +605,13 @@ void KateDocManager::saveDocumentList(KConfig *config)
     int i = 0;
     for (KTextEditor::Document *doc : qAsConst(m_docList)) {
         KConfigGroup cg(config, QStringLiteral("Document %1").arg(i));
-        doc->writeSessionConfig(cg);
+        const KateDocumentInfo *info = m_docInfos.value(doc);
+        if (info && !info->placeholderUrl.isEmpty()) {
+            // not loaded yet, keep what was restored
+            writeEntries(cg, info->sessionConfig);
+        } else {
+            doc->writeSessionConfig(cg);
+        }
         i++;
     }
 }
@@ -449,17 +625,21 @@ void KateDocManager::restoreDocumentList(KConfig *config)
         return;
     }
 
-    QProgressDialog progress;
-    progress.setWindowTitle(i18n("Starting Up"));
-    progress.setLabelText(i18n("Reopening files from the last session..."));
-    progress.setModal(true);
-    progress.setCancelButton(nullptr);
-    progress.setRange(0, count);
-
     for (unsigned int i = 0; i < count; i++) {
         KConfigGroup cg(config, QStringLiteral("Document %1").arg(i));
-        KTextEditor::Document *doc = nullptr;
+        const QUrl url(cg.readEntry("URL"));
+
+        // documents with a url are placeholders until shown, the first one replaces
+        // the empty document that is already shown everywhere and is loaded at once
+        if (i > 0 && !url.isEmpty()) {
+            KateDocumentInfo docInfo;
+            docInfo.placeholderUrl = url;
+            docInfo.sessionConfig = cg.entryMap();
+            createDoc(docInfo);
+            continue;
+        }
 
+        KTextEditor::Document *doc = nullptr;
         if (i == 0) {
             doc = m_docList.first();
         } else {
@@ -470,8 +650,6 @@ void KateDocManager::restoreDocumentList(KConfig *config)
         connect(doc, &KParts::ReadOnlyPart::canceled, this, &KateDocManager::documentOpened);
 
         doc->readSessionConfig(cg);
-
-        progress.setValue(i);
     }
 }
 
@@ -493,29 +671,29 @@ bool KateDocManager::loadMetaInfos(KTextEditor::Document *doc, const QUrl &url)
         return false;
     }
 
-    if (!m_metaInfos.hasGroup(url.toDisplayString())) {
+    KateMetaInfoStore::Entry entry;
+    if (!m_metaInfos.find(url.toDisplayString(), entry)) {
         return false;
     }
 
     const QByteArray checksum = doc->checksum().toHex();
     bool ok = true;
     if (!checksum.isEmpty()) {
-        KConfigGroup urlGroup(&m_metaInfos, url.toDisplayString());
-        const QString old_checksum = urlGroup.readEntry("Checksum");
-
-        if (QString::fromLatin1(checksum) == old_checksum) {
+        if (checksum == entry.checksum) {
             QSet<QString> flags;
             if (documentInfo(doc)->openedByUser) {
                 flags << QStringLiteral("SkipEncoding");
             }
             flags << QStringLiteral("SkipUrl");
+
+            KConfig config(QString(), KConfig::SimpleConfig);
+            KConfigGroup urlGroup(&config, "Document");
+            writeEntries(urlGroup, entry.config);
             doc->readSessionConfig(urlGroup, flags);
         } else {
-            urlGroup.deleteGroup();
+            m_metaInfos.remove(url.toDisplayString());
             ok = false;
         }
-
-        m_metaInfos.sync();
     }
 
     return ok && doc->url() == url;
@@ -536,8 +714,9 @@ void KateDocManager::saveMetaInfos(const QList<KTextEditor::Document *> &documen
 
     /**
      * store meta info for all non-modified documents which have some checksum
+     * the store writes the changes in batches, no need to sync here
      */
-    const QDateTime now = QDateTime::currentDateTimeUtc();
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
     for (KTextEditor::Document *doc : documents) {
         /**
          * skip modified docs
@@ -548,24 +727,37 @@ void KateDocManager::saveMetaInfos(const QList<KTextEditor::Document *> &documen
 
         const QByteArray checksum = doc->checksum().toHex();
         if (!checksum.isEmpty()) {
-            /**
-             * write the group with checksum and time
-             */
-            KConfigGroup urlGroup(&m_metaInfos, doc->url().toString());
-            urlGroup.writeEntry("Checksum", QString::fromLatin1(checksum));
-            urlGroup.writeEntry("Time", now);
-
             /**
              * write document session config
              */
+            KConfig config(QString(), KConfig::SimpleConfig);
+            KConfigGroup urlGroup(&config, "Document");
             doc->writeSessionConfig(urlGroup);
+
+            KateMetaInfoStore::Entry entry;
+            entry.checksum = checksum;
+            entry.time = now;
+            entry.config = urlGroup.entryMap();
+            m_metaInfos.insert(doc->url().toString(), entry);
         }
     }
+}
 
-    /**
-     * sync to not loose data
-     */
-    m_metaInfos.sync();
+void KateDocManager::importMetaInfos()
+{
+    const KConfig oldMetaInfos(QStringLiteral("katemetainfos"), KConfig::NoGlobals);
+    const QStringList groups = oldMetaInfos.groupList();
+    for (const QString &group : groups) {
+        const KConfigGroup urlGroup(&oldMetaInfos, group);
+        KateMetaInfoStore::Entry entry;
+        entry.checksum = urlGroup.readEntry("Checksum").toLatin1();
+        entry.time = urlGroup.readEntry("Time", QDateTime::currentDateTimeUtc()).toMSecsSinceEpoch();
+        entry.config = urlGroup.entryMap();
+        entry.config.remove(QStringLiteral("Checksum"));
+        entry.config.remove(QStringLiteral("Time"));
+        m_metaInfos.insert(group, entry);
+    }
+    m_metaInfos.flush();
 }
 
 void KateDocManager::slotModChanged(KTextEditor::Document *doc)
@@ -20,6 +20,9 @@
 #ifndef __KATE_DOCMANAGER_H__
 #define __KATE_DOCMANAGER_H__
 
+#include "katefileloader.h"
+#include "katemetainfostore.h"
+
 #include <ktexteditor/document.h>
 #include <ktexteditor/editor.h>
 #include <ktexteditor/modificationinterface.h>
@@ -31,6 +34,8 @@
 #include <QMap>
 #include <QObject>
 #include <QPair>
+#include <QStringList>
+#include <QUrl>
 
 #include <KConfig>
 
@@ -49,6 +54,21 @@ public:
 
     bool openedByUser = false;
     bool openSuccess = true;
+
+    /**
+     * documents restored from a session or opened in a batch are placeholders until
+     * they are loaded, see KateDocManager::loadDocument(). Restored ones are loaded
+     * from their session config, the others from the url with the given encoding.
+     */
+    QUrl placeholderUrl;
+    QMap<QString, QString> sessionConfig;
+    QString encoding;
+
+    /**
+     * the placeholder had been loaded before and was hibernated, see
+     * KateDocManager::hibernateDocument()
+     */
+    bool hibernated = false;
 };
 
 class KateDocManager : public QObject
@@ -66,6 +86,37 @@ public:
     /** Returns the documentNumber of the doc with url URL or -1 if no such doc is found */
     KTextEditor::Document *findDocument(const QUrl &url) const;
 
+    /**
+     * Look up the documents of many local files at once.
+     * The file names are not normalized, they have to match the document urls exactly.
+     * Placeholders are left out, their content is the one on disk anyway.
+     * @return for every file its document or nullptr, in the order of \p fileNames
+     */
+    QList<KTextEditor::Document *> documentsForLocalFiles(const QStringList &fileNames) const;
+
+    /**
+     * Placeholders are documents restored from a session that are not loaded yet.
+     * They know their url, the content is only loaded once a view is created for
+     * them or they are looked up by url.
+     */
+    bool isPlaceholder(KTextEditor::Document *doc) const;
+
+    /** Returns the url of the document, for placeholders the one it will be loaded from */
+    QUrl documentUrl(KTextEditor::Document *doc) const;
+
+    /** Returns the name of the document, for placeholders the file name of its url */
+    QString documentName(KTextEditor::Document *doc) const;
+
+    /** Loads the content of a placeholder, other documents are left alone */
+    void loadDocument(KTextEditor::Document *doc);
+
+    /**
+     * Drops the text of an unmodified document without views, it becomes a placeholder
+     * again and is loaded from its url once it is needed.
+     * @return true if the document was hibernated
+     */
+    bool hibernateDocument(KTextEditor::Document *doc);
+
     const QList<KTextEditor::Document *> &documentList() const
     {
         return m_docList;
@@ -105,6 +156,28 @@ public:
         m_daysMetaInfos = i;
     }
 
+    /**
+     * views beyond this count are destroyed per main window, least recently used first,
+     * 0 keeps all views
+     */
+    inline int getHibernateViewsAfter()
+    {
+        return m_hibernateViewsAfter;
+    }
+    inline void setHibernateViewsAfter(int i)
+    {
+        m_hibernateViewsAfter = i;
+    }
+
+    inline bool getHibernateDocuments()
+    {
+        return m_hibernateDocuments;
+    }
+    inline void setHibernateDocuments(bool b)
+    {
+        m_hibernateDocuments = b;
+    }
+
 public Q_SLOTS:
     /**
      * saves all documents that has at least one view.
@@ -191,21 +264,39 @@ private Q_SLOTS:
     void slotModifiedOnDisc(KTextEditor::Document *doc, bool b, KTextEditor::ModificationInterface::ModifiedOnDiskReason reason);
     void slotModChanged(KTextEditor::Document *doc);
     void slotModChanged1(KTextEditor::Document *doc);
+    void slotUrlChanged(KTextEditor::Document *doc);
 
 private:
     bool loadMetaInfos(KTextEditor::Document *doc, const QUrl &url);
+    void importMetaInfos();
+    void registerTempFile(KTextEditor::Document *doc, const QUrl &url);
     void saveMetaInfos(const QList<KTextEditor::Document *> &docs);
 
     QList<KTextEditor::Document *> m_docList;
     QHash<KTextEditor::Document *, KateDocumentInfo *> m_docInfos;
 
-    KConfig m_metaInfos;
+    /**
+     * url -> documents with that url and the url each document is indexed under,
+     * to find it again once the url changed
+     */
+    QMultiHash<QUrl, KTextEditor::Document *> m_docsByUrl;
+    QHash<KTextEditor::Document *, QUrl> m_indexedUrls;
+
+    KateMetaInfoStore m_metaInfos;
     bool m_saveMetaInfos;
     int m_daysMetaInfos;
 
+    int m_hibernateViewsAfter;
+    bool m_hibernateDocuments;
+
     typedef QPair<QUrl, QDateTime> TPair;
     QMap<KTextEditor::Document *, TPair> m_tempFiles;
 
+    /**
+     * reads the files of documents opened in a batch ahead
+     */
+    KateFileLoader m_fileLoader;
+
 private Q_SLOTS:
     void documentOpened();
 };
@@ -0,0 +1,221 @@
+/*  SPDX-License-Identifier: LGPL-2.0-or-later
+
+    Copyright (C) 2020 Kate Developers <kwrite-devel@kde.org>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Library General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Library General Public License for more details.
+
+    You should have received a copy of the GNU Library General Public License
+    along with this library; see the file COPYING.LIB.  If not, write to
+    the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+    Boston, MA 02110-1301, USA.
+*/
+
+#include "katefileloader.h"
+
+#include <ktexteditor/document.h>
+
+#include <KIO/JobTracker>
+#include <KJob>
+#include <KJobTrackerInterface>
+#include <KLocalizedString>
+
+#include <QFile>
+#include <QFileInfo>
+#include <QRunnable>
+#include <QThread>
+
+/**
+ * more isn't read ahead of the documents loaded, a larger file is read alone
+ */
+static const qint64 maxInFlightBytes = 64 * 1024 * 1024;
+
+static const int readChunkSize = 1024 * 1024;
+
+/**
+ * Job only there to show the progress in the job tracker.
+ */
+class LoadFilesJob : public KJob
+{
+public:
+    explicit LoadFilesJob(QObject *parent)
+        : KJob(parent)
+    {
+    }
+
+    void start() override
+    {
+        emit description(this, i18n("Opening Files"));
+    }
+
+    void setProgress(int done, int total)
+    {
+        setTotalAmount(KJob::Files, total);
+        setProcessedAmount(KJob::Files, done);
+    }
+
+    void finish()
+    {
+        emitResult();
+    }
+};
+
+class KateFileLoader::ReadAheadJob : public QRunnable
+{
+public:
+    ReadAheadJob(KateFileLoader *loader, int id, const QString &fileName)
+        : m_loader(loader)
+        , m_id(id)
+        , m_fileName(fileName)
+    {
+    }
+
+    void run() override
+    {
+        // the content is read to have it cached, the document reads it again
+        QFile file(m_fileName);
+        if (file.open(QIODevice::ReadOnly)) {
+            QByteArray buffer(readChunkSize, Qt::Uninitialized);
+            while (!m_loader->m_cancel.loadAcquire() && file.read(buffer.data(), buffer.size()) > 0) {
+            }
+        }
+
+        KateFileLoader *loader = m_loader;
+        const int id = m_id;
+        QMetaObject::invokeMethod(
+            loader,
+            [loader, id]() {
+                loader->fileRead(id);
+            },
+            Qt::QueuedConnection);
+    }
+
+private:
+    KateFileLoader *const m_loader;
+    const int m_id;
+    const QString m_fileName;
+};
+
+KateFileLoader::KateFileLoader(QObject *parent)
+    : QObject(parent)
+{
+    m_readPool.setMaxThreadCount(qBound(1, QThread::idealThreadCount(), 4));
+
+    // one document per event loop iteration, the GUI stays responsive
+    m_handOutTimer.setInterval(0);
+    connect(&m_handOutTimer, &QTimer::timeout, this, &KateFileLoader::handOutFile);
+}
+
+KateFileLoader::~KateFileLoader()
+{
+    m_cancel = 1;
+    m_readPool.waitForDone();
+    if (m_progressJob) {
+        LoadFilesJob *job = static_cast<LoadFilesJob *>(m_progressJob.data());
+        m_progressJob = nullptr;
+        job->finish();
+    }
+}
+
+void KateFileLoader::load(KTextEditor::Document *doc, const QString &fileName)
+{
+    File file;
+    file.doc = doc;
+    file.fileName = fileName;
+    file.size = QFileInfo(fileName).size();
+
+    const int id = m_nextId++;
+    m_files.insert(id, file);
+    m_queued.enqueue(id);
+    ++m_totalCount;
+
+    updateProgress();
+    startReading();
+}
+
+void KateFileLoader::remove(KTextEditor::Document *doc)
+{
+    for (auto it = m_files.begin(); it != m_files.end(); ++it) {
+        if (it->doc != doc) {
+            continue;
+        }
+
+        // files being read are dropped once read
+        if (m_queued.removeOne(it.key())) {
+            m_files.erase(it);
+            ++m_doneCount;
+            updateProgress();
+        } else {
+            it->doc = nullptr;
+        }
+        return;
+    }
+}
+
+void KateFileLoader::startReading()
+{
+    while (!m_queued.isEmpty()) {
+        const File &file = m_files[m_queued.head()];
+        if (m_inFlightBytes > 0 && m_inFlightBytes + file.size > maxInFlightBytes) {
+            return;
+        }
+
+        m_inFlightBytes += file.size;
+        m_readPool.start(new ReadAheadJob(this, m_queued.dequeue(), file.fileName));
+    }
+}
+
+void KateFileLoader::fileRead(int id)
+{
+    m_ready.enqueue(id);
+    if (!m_handOutTimer.isActive()) {
+        m_handOutTimer.start();
+    }
+}
+
+void KateFileLoader::handOutFile()
+{
+    if (m_ready.isEmpty()) {
+        m_handOutTimer.stop();
+        return;
+    }
+
+    const File file = m_files.take(m_ready.dequeue());
+    m_inFlightBytes -= file.size;
+    ++m_doneCount;
+
+    if (file.doc) {
+        emit fileReady(file.doc);
+    }
+
+    updateProgress();
+    startReading();
+}
+
+void KateFileLoader::updateProgress()
+{
+    if (!m_progressJob) {
+        LoadFilesJob *job = new LoadFilesJob(this);
+        KIO::getJobTracker()->registerJob(job);
+        job->start();
+        m_progressJob = job;
+    }
+
+    LoadFilesJob *job = static_cast<LoadFilesJob *>(m_progressJob.data());
+    job->setProgress(m_doneCount, m_totalCount);
+
+    // all done, the finished job deletes itself later, the next batch gets its own job
+    if (m_doneCount == m_totalCount) {
+        m_progressJob = nullptr;
+        job->finish();
+        m_doneCount = 0;
+        m_totalCount = 0;
+    }
+}
@@ -0,0 +1,111 @@
+/*  SPDX-License-Identifier: LGPL-2.0-or-later
+
+    Copyright (C) 2020 Kate Developers <kwrite-devel@kde.org>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Library General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Library General Public License for more details.
+
+    You should have received a copy of the GNU Library General Public License
+    along with this library; see the file COPYING.LIB.  If not, write to
+    the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+    Boston, MA 02110-1301, USA.
+*/
+
+#ifndef __KATE_FILELOADER_H__
+#define __KATE_FILELOADER_H__
+
+#include <QAtomicInt>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QPointer>
+#include <QQueue>
+#include <QThreadPool>
+#include <QTimer>
+
+namespace KTextEditor
+{
+class Document;
+}
+
+class KJob;
+
+/**
+ * Loads the documents of a batch of local files without blocking the GUI.
+ *
+ * The documents are created as placeholders first. Worker threads read their
+ * files ahead, so that loading them in the GUI thread afterwards doesn't wait
+ * for the disk. Only a limited amount of bytes is read ahead of the documents
+ * created. The documents are handed out one per event loop iteration via
+ * fileReady() and the progress is shown by the job tracker.
+ */
+class KateFileLoader : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit KateFileLoader(QObject *parent = nullptr);
+    ~KateFileLoader() override;
+
+    /**
+     * Queue the file of a document, fileReady() is emitted once it was read ahead.
+     * @param doc document to load the file into
+     * @param fileName local file
+     */
+    void load(KTextEditor::Document *doc, const QString &fileName);
+
+    /**
+     * Forget a queued document, e.g. because it is closed.
+     */
+    void remove(KTextEditor::Document *doc);
+
+Q_SIGNALS:
+    /**
+     * The file of the document was read ahead, the document can be loaded now.
+     */
+    void fileReady(KTextEditor::Document *doc);
+
+private:
+    struct File {
+        QPointer<KTextEditor::Document> doc;
+        QString fileName;
+        qint64 size = 0;
+    };
+
+    class ReadAheadJob;
+
+    void startReading();
+    void fileRead(int id);
+    void handOutFile();
+    void updateProgress();
+
+private:
+    QThreadPool m_readPool;
+    QAtomicInt m_cancel;
+
+    /** files not read yet, in the order they were queued */
+    QQueue<int> m_queued;
+    /** files read, waiting for their documents to be loaded */
+    QQueue<int> m_ready;
+    QHash<int, File> m_files;
+    int m_nextId = 0;
+
+    /** bytes read ahead of the loaded documents */
+    qint64 m_inFlightBytes = 0;
+
+    QTimer m_handOutTimer;
+
+    /** job of the current batch, reset once it is finished */
+    QPointer<KJob> m_progressJob;
+    int m_doneCount = 0;
+    int m_totalCount = 0;
+};
+
+#endif
@@ -613,6 +613,8 @@ void KateMainWindow::readOptions()
     m_modCloseAfterLast = generalGroup.readEntry("Close After Last", false);
     KateApp::self()->documentManager()->setSaveMetaInfos(generalGroup.readEntry("Save Meta Infos", true));
     KateApp::self()->documentManager()->setDaysMetaInfos(generalGroup.readEntry("Days Meta Infos", 30));
+    KateApp::self()->documentManager()->setHibernateViewsAfter(generalGroup.readEntry("Hibernate Views After", 0));
+    KateApp::self()->documentManager()->setHibernateDocuments(generalGroup.readEntry("Hibernate Documents", false));
 
     m_paShowPath->setChecked(generalGroup.readEntry("Show Full Path in Title", false));
     m_paShowStatusBar->setChecked(generalGroup.readEntry("Show Status Bar", true));
@@ -638,6 +640,9 @@ void KateMainWindow::saveOptions()
 
     generalGroup.writeEntry("Days Meta Infos", KateApp::self()->documentManager()->getDaysMetaInfos());
 
+    generalGroup.writeEntry("Hibernate Views After", KateApp::self()->documentManager()->getHibernateViewsAfter());
+    generalGroup.writeEntry("Hibernate Documents", KateApp::self()->documentManager()->getHibernateDocuments());
+
     generalGroup.writeEntry("Show Full Path in Title", m_paShowPath->isChecked());
     generalGroup.writeEntry("Show Status Bar", m_paShowStatusBar->isChecked());
     generalGroup.writeEntry("Show Menu Bar", m_paShowMenuBar->isChecked());
@@ -774,6 +779,7 @@ void KateMainWindow::slotDropEvent(QDropEvent *event)
             }
         }
 
+        QList<QUrl> fileUrls;
         for (const QUrl &url : qAsConst(textlist)) {
             // if url has no file component, try and recursively scan dir
             KFileItem kitem(url);
@@ -788,7 +794,14 @@ void KateMainWindow::slotDropEvent(QDropEvent *event)
                     connect(list_job, &KIO::ListJob::entries, this, &KateMainWindow::slotListRecursiveEntries);
                 }
             } else {
-                m_viewManager->openUrl(url);
+                fileUrls.append(url);
+            }
+        }
+
+        // open the files as one batch, they are loaded in the background
+        if (!fileUrls.isEmpty()) {
+            if (KTextEditor::Document *doc = m_viewManager->openUrls(fileUrls, QString())) {
+                m_viewManager->activateView(doc);
             }
         }
     }
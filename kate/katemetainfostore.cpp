@@ -0,0 +1,305 @@
+/*  SPDX-License-Identifier: LGPL-2.0-or-later
+
+    Copyright (C) 2020 Kate Developers <kwrite-devel@kde.org>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Library General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Library General Public License for more details.
+
+    You should have received a copy of the GNU Library General Public License
+    along with this library; see the file COPYING.LIB.  If not, write to
+    the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+    Boston, MA 02110-1301, USA.
+*/
+
+#include "katemetainfostore.h"
+
+#include "katedebug.h"
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QRunnable>
+#include <QSaveFile>
+
+/**
+ * format of the data and journal files, bump the version if it changes
+ */
+static const quint32 storeFileMagic = 0x4b4d4953; // "KMIS"
+static const quint32 storeFileVersion = 1;
+static const qint64 storeFileHeaderSize = 2 * sizeof(quint32);
+
+/**
+ * changes are collected that long before they are written
+ */
+static const int flushDelay = 2000;
+
+/**
+ * the journal is compacted once it has more records than entries, but not for a few
+ */
+static const int minCompactRecords = 1000;
+
+class KateMetaInfoStore::CompactJob : public QRunnable
+{
+public:
+    CompactJob(const QHash<QString, Entry> &entries, const QString &dataFileName, const QString &journalFileName)
+        : m_entries(entries)
+        , m_dataFileName(dataFileName)
+        , m_journalFileName(journalFileName)
+    {
+    }
+
+    void run() override
+    {
+        // the journal is only needed as long as the data file doesn't contain its changes
+        if (writeDataFile(m_dataFileName, m_entries)) {
+            QFile::remove(m_journalFileName);
+        }
+    }
+
+private:
+    const QHash<QString, Entry> m_entries;
+    const QString m_dataFileName;
+    const QString m_journalFileName;
+};
+
+KateMetaInfoStore::KateMetaInfoStore(const QString &baseName, QObject *parent)
+    : QObject(parent)
+    , m_dataFileName(baseName + QStringLiteral(".data"))
+    , m_journalFileName(baseName + QStringLiteral(".journal"))
+    , m_compactingJournalFileName(baseName + QStringLiteral(".journal.compacting"))
+{
+    QDir().mkpath(QFileInfo(baseName).absolutePath());
+
+    m_isNew = !QFile::exists(m_dataFileName) && !QFile::exists(m_journalFileName) && !QFile::exists(m_compactingJournalFileName);
+
+    // the journals hold the changes since the data file was written, the older one first
+    int dataRecords = 0;
+    readFile(m_dataFileName, m_entries, &dataRecords);
+    repairJournal(m_compactingJournalFileName, readFile(m_compactingJournalFileName, m_entries, &m_journalRecords));
+    repairJournal(m_journalFileName, readFile(m_journalFileName, m_entries, &m_journalRecords));
+
+    m_compactPool.setMaxThreadCount(1);
+
+    m_flushTimer.setSingleShot(true);
+    m_flushTimer.setInterval(flushDelay);
+    connect(&m_flushTimer, &QTimer::timeout, this, &KateMetaInfoStore::flush);
+}
+
+KateMetaInfoStore::~KateMetaInfoStore()
+{
+    flush();
+    m_compactPool.waitForDone();
+}
+
+bool KateMetaInfoStore::find(const QString &url, Entry &entry) const
+{
+    const auto it = m_entries.constFind(url);
+    if (it == m_entries.constEnd()) {
+        return false;
+    }
+    entry = it.value();
+    return true;
+}
+
+void KateMetaInfoStore::insert(const QString &url, const Entry &entry)
+{
+    m_entries.insert(url, entry);
+    appendRecord(InsertRecord, url, entry);
+}
+
+void KateMetaInfoStore::remove(const QString &url)
+{
+    if (m_entries.remove(url) > 0) {
+        appendRecord(RemoveRecord, url, Entry());
+    }
+}
+
+void KateMetaInfoStore::expire(int days)
+{
+    const QDateTime now = QDateTime::currentDateTimeUtc();
+    QStringList expired;
+    for (auto it = m_entries.constBegin(); it != m_entries.constEnd(); ++it) {
+        if (QDateTime::fromMSecsSinceEpoch(it->time, Qt::UTC).daysTo(now) > days) {
+            expired.append(it.key());
+        }
+    }
+    for (const QString &url : qAsConst(expired)) {
+        remove(url);
+    }
+}
+
+void KateMetaInfoStore::appendRecord(RecordType type, const QString &url, const Entry &entry)
+{
+    QByteArray record;
+    QDataStream recordStream(&record, QIODevice::WriteOnly);
+    recordStream.setVersion(QDataStream::Qt_5_0);
+    recordStream << quint8(type) << url;
+    if (type == InsertRecord) {
+        recordStream << entry.checksum << entry.time << entry.config;
+    }
+
+    // every record is written with its size, a record cut off at the end is ignored when read
+    QDataStream stream(&m_pendingRecords, QIODevice::WriteOnly | QIODevice::Append);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream << record;
+    ++m_journalRecords;
+
+    if (!m_flushTimer.isActive()) {
+        m_flushTimer.start();
+    }
+}
+
+void KateMetaInfoStore::flush()
+{
+    m_flushTimer.stop();
+    if (m_pendingRecords.isEmpty()) {
+        return;
+    }
+
+    QFile journal(m_journalFileName);
+    if (!journal.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qCWarning(LOG_KATE) << "Could not write meta-information journal" << m_journalFileName;
+        return;
+    }
+    if (journal.size() == 0) {
+        QDataStream stream(&journal);
+        stream.setVersion(QDataStream::Qt_5_0);
+        stream << storeFileMagic << storeFileVersion;
+    }
+    journal.write(m_pendingRecords);
+    journal.close();
+    m_pendingRecords.clear();
+
+    if (m_journalRecords > qMax(minCompactRecords, m_entries.size())) {
+        startCompaction();
+    }
+}
+
+void KateMetaInfoStore::startCompaction()
+{
+    // one compaction at a time, the journal keeps growing meanwhile
+    if (m_compactPool.activeThreadCount() > 0) {
+        return;
+    }
+
+    // the records written from now on go to a fresh journal
+    if (QFile::exists(m_compactingJournalFileName)) {
+        // left over from a compaction that failed, it needs to keep all records until one succeeds
+        QFile journal(m_journalFileName);
+        if (journal.exists()) {
+            QFile compactingJournal(m_compactingJournalFileName);
+            if (!journal.open(QIODevice::ReadOnly) || !compactingJournal.open(QIODevice::WriteOnly | QIODevice::Append)) {
+                return;
+            }
+            journal.seek(storeFileHeaderSize);
+            compactingJournal.write(journal.readAll());
+            compactingJournal.close();
+            journal.remove();
+        }
+    } else if (!QFile::rename(m_journalFileName, m_compactingJournalFileName)) {
+        return;
+    }
+    m_journalRecords = 0;
+
+    m_compactPool.start(new CompactJob(m_entries, m_dataFileName, m_compactingJournalFileName));
+}
+
+qint64 KateMetaInfoStore::readFile(const QString &fileName, QHash<QString, Entry> &entries, int *recordCount)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return -1;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+    quint32 magic = 0;
+    quint32 version = 0;
+    stream >> magic >> version;
+    if (stream.status() != QDataStream::Ok || magic != storeFileMagic || version != storeFileVersion) {
+        return 0;
+    }
+
+    qint64 validSize = file.pos();
+    while (!stream.atEnd()) {
+        QByteArray record;
+        stream >> record;
+        if (stream.status() != QDataStream::Ok) {
+            break;
+        }
+        validSize = file.pos();
+
+        QDataStream recordStream(record);
+        recordStream.setVersion(QDataStream::Qt_5_0);
+        quint8 type = 0;
+        QString url;
+        recordStream >> type >> url;
+        if (type == InsertRecord) {
+            Entry entry;
+            recordStream >> entry.checksum >> entry.time >> entry.config;
+            if (recordStream.status() == QDataStream::Ok) {
+                entries.insert(url, entry);
+            }
+        } else if (type == RemoveRecord) {
+            entries.remove(url);
+        }
+        ++*recordCount;
+    }
+    return validSize;
+}
+
+void KateMetaInfoStore::repairJournal(const QString &fileName, qint64 validSize)
+{
+    if (validSize < 0) {
+        return;
+    }
+
+    // records appended behind a header that can't be read would never be read either
+    if (validSize == 0) {
+        const QString brokenFileName = fileName + QStringLiteral(".broken");
+        qCWarning(LOG_KATE) << "Unreadable meta-information journal moved to" << brokenFileName;
+        QFile::remove(brokenFileName);
+        if (!QFile::rename(fileName, brokenFileName)) {
+            QFile::remove(fileName);
+        }
+        return;
+    }
+
+    // a record cut off by a crash would hide all records appended behind it
+    QFile file(fileName);
+    if (file.size() > validSize) {
+        qCWarning(LOG_KATE) << "Incomplete record cut off from meta-information journal" << fileName;
+        if (!file.resize(validSize)) {
+            file.remove();
+        }
+    }
+}
+
+bool KateMetaInfoStore::writeDataFile(const QString &fileName, const QHash<QString, Entry> &entries)
+{
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream << storeFileMagic << storeFileVersion;
+    for (auto it = entries.constBegin(); it != entries.constEnd(); ++it) {
+        QByteArray record;
+        QDataStream recordStream(&record, QIODevice::WriteOnly);
+        recordStream.setVersion(QDataStream::Qt_5_0);
+        recordStream << quint8(InsertRecord) << it.key() << it->checksum << it->time << it->config;
+        stream << record;
+    }
+    return file.commit();
+}
@@ -0,0 +1,131 @@
+/*  SPDX-License-Identifier: LGPL-2.0-or-later
+
+    Copyright (C) 2020 Kate Developers <kwrite-devel@kde.org>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Library General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Library General Public License for more details.
+
+    You should have received a copy of the GNU Library General Public License
+    along with this library; see the file COPYING.LIB.  If not, write to
+    the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+    Boston, MA 02110-1301, USA.
+*/
+
+#ifndef __KATE_METAINFOSTORE_H__
+#define __KATE_METAINFOSTORE_H__
+
+#include <QByteArray>
+#include <QHash>
+#include <QMap>
+#include <QObject>
+#include <QString>
+#include <QThreadPool>
+#include <QTimer>
+
+/**
+ * Store for the meta-information of documents: their session config together
+ * with the checksum of the content it belongs to, by url.
+ *
+ * All entries are kept in a hash. Changes are appended to a journal file,
+ * collected and written in batches. Once the journal holds a lot more records
+ * than there are entries, it is compacted in the background: the entries are
+ * written to the data file and the journal starts over.
+ */
+class KateMetaInfoStore : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Entry {
+        /** checksum of the document content, hex encoded */
+        QByteArray checksum;
+        /** last time the entry was written, msecs since epoch UTC */
+        qint64 time = 0;
+        /** session config of the document */
+        QMap<QString, QString> config;
+    };
+
+    /**
+     * Reads the store.
+     * @param baseName the store consists of baseName.data and baseName.journal
+     */
+    explicit KateMetaInfoStore(const QString &baseName, QObject *parent = nullptr);
+
+    /**
+     * Writes all changes and waits for a running compaction.
+     */
+    ~KateMetaInfoStore() override;
+
+    /**
+     * @return true if there were no store files to read
+     */
+    bool isNew() const
+    {
+        return m_isNew;
+    }
+
+    /**
+     * Looks up the entry of an url.
+     * @return false if there is none
+     */
+    bool find(const QString &url, Entry &entry) const;
+
+    void insert(const QString &url, const Entry &entry);
+    void remove(const QString &url);
+
+    /**
+     * Removes the entries not written for more than \p days days.
+     */
+    void expire(int days);
+
+    /**
+     * Appends the collected changes to the journal.
+     */
+    void flush();
+
+private:
+    enum RecordType : quint8 { InsertRecord = 1, RemoveRecord = 2 };
+
+    class CompactJob;
+
+    void appendRecord(RecordType type, const QString &url, const Entry &entry);
+    void startCompaction();
+
+    /**
+     * Reads the records of a data or journal file into \p entries.
+     * @return size of the header and the complete records, 0 if the header is invalid, -1 if there is no file
+     */
+    static qint64 readFile(const QString &fileName, QHash<QString, Entry> &entries, int *recordCount);
+
+    /**
+     * Prepares a journal for appending, based on the result of readFile():
+     * a journal with an invalid header is moved aside, an incomplete record at its end is cut off.
+     */
+    static void repairJournal(const QString &fileName, qint64 validSize);
+    static bool writeDataFile(const QString &fileName, const QHash<QString, Entry> &entries);
+
+private:
+    const QString m_dataFileName;
+    const QString m_journalFileName;
+    /** journal of the changes while the compaction runs */
+    const QString m_compactingJournalFileName;
+
+    QHash<QString, Entry> m_entries;
+    bool m_isNew = false;
+
+    /** records in the journal file and collected but not written yet */
+    int m_journalRecords = 0;
+    QByteArray m_pendingRecords;
+    QTimer m_flushTimer;
+
+    QThreadPool m_compactPool;
+};
+
+#endif
@@ -24,6 +24,8 @@
 #include "katemainwindow.h"
 #include "kateviewmanager.h"
 
+#include "pathstore.h"
+
 #include <ktexteditor/document.h>
 #include <ktexteditor/view.h>
 
@@ -83,7 +85,9 @@ void KateQuickOpenModel::refresh()
     QObject *projectView = m_mainWindow->pluginView(QStringLiteral("kateprojectplugin"));
     const QList<KTextEditor::View *> sortedViews = m_mainWindow->viewManager()->sortedViews();
     const QList<KTextEditor::Document *> openDocs = KateApp::self()->documentManager()->documentList();
-    const QStringList projectDocs = projectView ? (m_listMode == CurrentProject ? projectView->property("projectFiles") : projectView->property("allProjectsFiles")).toStringList() : QStringList();
+    const PathStore projectDocs = projectView
+        ? (m_listMode == CurrentProject ? projectView->property("projectFilesStore") : projectView->property("allProjectsFilesStore")).value<PathStore>()
+        : PathStore();
 
     QVector<ModelEntry> allDocuments;
     allDocuments.reserve(sortedViews.size() + openDocs.size() + projectDocs.size());
@@ -94,15 +98,18 @@ void KateQuickOpenModel::refresh()
         allDocuments.push_back({doc->url(), doc->documentName(), doc->url().toDisplayString(QUrl::NormalizePathSegments | QUrl::PreferLocalFile), true, sort_id--});
     }
 
+    // documents not loaded yet are listed like the others
+    const KateDocManager *docManager = KateApp::self()->documentManager();
     for (auto *doc : qAsConst(openDocs)) {
-        const auto normalizedUrl = doc->url().toString(QUrl::NormalizePathSegments | QUrl::PreferLocalFile);
-        allDocuments.push_back({doc->url(), doc->documentName(), normalizedUrl, true, 0});
+        const QUrl url = docManager->documentUrl(doc);
+        const auto normalizedUrl = url.toString(QUrl::NormalizePathSegments | QUrl::PreferLocalFile);
+        allDocuments.push_back({url, docManager->documentName(doc), normalizedUrl, true, 0});
     }
 
-    for (const auto &file : qAsConst(projectDocs)) {
-        QFileInfo fi(file);
-        const auto localFile = QUrl::fromLocalFile(fi.absoluteFilePath());
-        allDocuments.push_back({localFile, fi.fileName(), localFile.toString(QUrl::NormalizePathSegments | QUrl::PreferLocalFile), false, 0});
+    // the project files are absolute paths, their names are stored separately
+    for (int i = 0; i < projectDocs.size(); ++i) {
+        const auto localFile = QUrl::fromLocalFile(projectDocs.at(i));
+        allDocuments.push_back({localFile, projectDocs.fileName(i).toString(), localFile.toString(QUrl::NormalizePathSegments | QUrl::PreferLocalFile), false, 0});
     }
 
     /** Sort the arrays by filePath. */
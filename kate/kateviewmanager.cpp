@@ -76,6 +76,10 @@ KateViewManager::KateViewManager(QWidget *parentW, KateMainWindow *parent)
 
     connect(this, &KateViewManager::viewChanged, this, &KateViewManager::slotViewChanged);
 
+    m_hibernateTimer.setSingleShot(true);
+    m_hibernateTimer.setInterval(500);
+    connect(&m_hibernateTimer, &QTimer::timeout, this, &KateViewManager::hibernateViews);
+
     connect(KateApp::self()->documentManager(), &KateDocManager::documentCreatedViewManager, this, &KateViewManager::documentCreated);
 
     /**
@@ -301,9 +305,11 @@ KTextEditor::Document *KateViewManager::openUrls(const QList<QUrl> &urls, const
 {
     const QList<KTextEditor::Document *> docs = KateApp::self()->documentManager()->openUrls(urls, encoding, isTempFile, docInfo);
 
-    for (const KTextEditor::Document *doc : docs) {
-        if (!doc->url().isEmpty()) {
-            m_mainWindow->fileOpenRecent()->addUrl(doc->url());
+    // most documents are loaded later, use the urls they will be loaded from
+    for (KTextEditor::Document *doc : docs) {
+        const QUrl url = KateApp::self()->documentManager()->documentUrl(doc);
+        if (!url.isEmpty()) {
+            m_mainWindow->fileOpenRecent()->addUrl(url);
         }
     }
 
@@ -641,6 +647,10 @@ void KateViewManager::activateView(KTextEditor::View *view)
         m_views[view].activityResource->setUri(view->document()->url());
         m_views[view].activityResource->notifyFocusedIn();
 #endif
+
+        if (KateApp::self()->documentManager()->getHibernateViewsAfter() > 0) {
+            m_hibernateTimer.start();
+        }
     }
 }
 
@@ -669,6 +679,33 @@ void KateViewManager::slotViewChanged()
     }
 }
 
+void KateViewManager::hibernateViews()
+{
+    const int maxViews = KateApp::self()->documentManager()->getHibernateViewsAfter();
+    if (maxViews <= 0 || m_views.size() <= maxViews || m_blockViewCreationAndActivation) {
+        return;
+    }
+
+    // most recently used first, the views beyond the limit go, apart from the ones shown
+    const QList<KTextEditor::View *> views = sortedViews();
+    for (int i = maxViews; i < views.size(); ++i) {
+        KTextEditor::View *view = views.at(i);
+        KateViewSpace *viewspace = static_cast<KateViewSpace *>(view->parentWidget()->parentWidget());
+        if (viewspace->currentView() == view) {
+            continue;
+        }
+
+        KTextEditor::Document *doc = view->document();
+        viewspace->rememberViewState(view);
+        deleteView(view);
+
+        // views of other main windows keep the document alive
+        if (doc->views().isEmpty()) {
+            KateApp::self()->documentManager()->hibernateDocument(doc);
+        }
+    }
+}
+
 void KateViewManager::activateNextView()
 {
     int i = m_viewSpaceList.indexOf(activeViewSpace()) + 1;
@@ -27,6 +27,7 @@
 #include <QMap>
 #include <QPointer>
 #include <QSplitter>
+#include <QTimer>
 
 namespace KActivities
 {
@@ -136,6 +137,12 @@ public:
 private Q_SLOTS:
     void slotViewChanged();
 
+    /**
+     * destroy the least recently used views beyond the configured limit,
+     * their documents are hibernated if they have no views left
+     */
+    void hibernateViews();
+
     void documentCreated(KTextEditor::Document *doc);
     void documentWillBeDeleted(KTextEditor::Document *doc);
 
@@ -337,6 +344,11 @@ private:
      */
     QPointer<KTextEditor::View> m_guiMergedView;
 
+    /**
+     * views are hibernated shortly after activation, not while switching through them
+     */
+    QTimer m_hibernateTimer;
+
     /**
      * last url of open file dialog, used if current document has no valid url
      */
@@ -30,7 +30,10 @@
 #include "kateupdatedisabler.h"
 #include "kateviewmanager.h"
 
+#include <ktexteditor_version.h> // delete, when we depend on KF 5.80
+
 #include <KAcceleratorManager>
+#include <KConfig>
 #include <KConfigGroup>
 #include <KLocalizedString>
 
@@ -201,6 +204,9 @@ KTextEditor::View *KateViewSpace::createView(KTextEditor::Document *doc)
     // should only be called if a view does not yet exist
     Q_ASSERT(!m_docToView.contains(doc));
 
+    // documents restored from the session are loaded once shown
+    KateApp::self()->documentManager()->loadDocument(doc);
+
     /**
      * Create a fresh view
      */
@@ -223,6 +229,29 @@ KTextEditor::View *KateViewSpace::createView(KTextEditor::Document *doc)
         }
     }
 
+    // give a hibernated view its state back
+    const auto hibernated = m_hibernatedViews.constFind(doc);
+    if (hibernated != m_hibernatedViews.constEnd()) {
+        const ViewState &state = hibernated.value();
+        KConfig config(QString(), KConfig::SimpleConfig);
+        KConfigGroup cg(&config, "View");
+        for (auto it = state.sessionConfig.constBegin(); it != state.sessionConfig.constEnd(); ++it) {
+            cg.writeEntry(it.key(), it.value());
+        }
+        v->readSessionConfig(cg);
+
+        if (state.selection.isValid()) {
+            v->setBlockSelection(state.blockSelection);
+            v->setSelection(state.selection);
+        }
+
+#if KTEXTEDITOR_VERSION >= QT_VERSION_CHECK(5, 80, 0)
+        KTextEditor::Cursor scrollPosition(state.firstDisplayedLine, 0);
+        v->setScrollPosition(scrollPosition);
+#endif
+        m_hibernatedViews.erase(hibernated);
+    }
+
     // register document, it is shown below through showView() then
     if (!m_lruDocList.contains(doc)) {
         registerDocument(doc);
@@ -237,6 +266,21 @@ KTextEditor::View *KateViewSpace::createView(KTextEditor::Document *doc)
     return v;
 }
 
+void KateViewSpace::rememberViewState(KTextEditor::View *v)
+{
+    Q_ASSERT(m_docToView.value(v->document()) == v);
+
+    KConfig config(QString(), KConfig::SimpleConfig);
+    KConfigGroup cg(&config, "View");
+    v->writeSessionConfig(cg);
+
+    ViewState &state = m_hibernatedViews[v->document()];
+    state.sessionConfig = cg.entryMap();
+    state.selection = v->selection() ? v->selectionRange() : KTextEditor::Range::invalid();
+    state.blockSelection = v->blockSelection();
+    state.firstDisplayedLine = v->firstDisplayedLine();
+}
+
 void KateViewSpace::removeView(KTextEditor::View *v)
 {
     // remove view mappings
@@ -353,8 +397,10 @@ void KateViewSpace::insertTab(int index, KTextEditor::Document *doc)
     // doc should not have a id
     Q_ASSERT(!m_docToTabId.contains(doc));
 
-    const int id = m_tabBar->insertTab(index, doc->documentName());
-    m_tabBar->setTabToolTip(id, doc->url().toDisplayString());
+    const KateDocManager *docManager = KateApp::self()->documentManager();
+    const int id = m_tabBar->insertTab(index, docManager->documentName(doc));
+    m_tabBar->setTabToolTip(id, docManager->documentUrl(doc).toDisplayString());
+    m_tabBar->setTabUrl(id, docManager->documentUrl(doc));
     m_docToTabId[doc] = id;
     updateDocumentState(doc);
 
@@ -467,6 +513,7 @@ void KateViewSpace::documentDestroyed(QObject *doc)
 
     // disconnect entirely
     disconnect(doc, nullptr, this, nullptr);
+    m_hibernatedViews.remove(invalidDoc);
 
     // case: there was no view created yet, but still a button was added
     if (m_docToTabId.contains(invalidDoc)) {
@@ -491,15 +538,16 @@ void KateViewSpace::updateDocumentName(KTextEditor::Document *doc)
 {
     const int buttonId = m_docToTabId[doc];
     Q_ASSERT(buttonId >= 0);
-    m_tabBar->setTabText(buttonId, doc->documentName());
-    m_tabBar->setTabToolTip(buttonId, doc->url().toDisplayString());
+    const KateDocManager *docManager = KateApp::self()->documentManager();
+    m_tabBar->setTabText(buttonId, docManager->documentName(doc));
+    m_tabBar->setTabToolTip(buttonId, docManager->documentUrl(doc).toDisplayString());
 }
 
 void KateViewSpace::updateDocumentUrl(KTextEditor::Document *doc)
 {
     const int buttonId = m_docToTabId[doc];
     Q_ASSERT(buttonId >= 0);
-    m_tabBar->setTabUrl(buttonId, doc->url());
+    m_tabBar->setTabUrl(buttonId, KateApp::self()->documentManager()->documentUrl(doc));
 }
 
 void KateViewSpace::updateDocumentState(KTextEditor::Document *doc)
@@ -605,7 +653,7 @@ void KateViewSpace::showContextMenu(int id, const QPoint &globalPos)
         aCloseOthers->setEnabled(false);
     }
 
-    if (doc->url().isEmpty()) {
+    if (KateApp::self()->documentManager()->documentUrl(doc).isEmpty()) {
         aCopyPath->setEnabled(false);
         aOpenFolder->setEnabled(false);
         aRenameFile->setEnabled(false);
@@ -629,6 +677,11 @@ void KateViewSpace::showContextMenu(int id, const QPoint &globalPos)
 
     QAction *choice = menu.exec(globalPos);
 
+    // the file actions need the loaded document
+    if (choice && choice != aCloseTab && choice != aCloseOthers) {
+        KateApp::self()->documentManager()->loadDocument(doc);
+    }
+
     if (!choice) {
         return;
     }
@@ -664,7 +717,7 @@ void KateViewSpace::saveConfig(KConfigBase *config, int myIndex, const QString &
     QVector<KTextEditor::View *> views;
     QStringList lruList;
     for (KTextEditor::Document *doc : qAsConst(m_lruDocList)) {
-        lruList << doc->url().toString();
+        lruList << KateApp::self()->documentManager()->documentUrl(doc).toString();
         if (m_docToView.contains(doc)) {
             views.append(m_docToView[doc]);
         }
@@ -692,6 +745,17 @@ void KateViewSpace::saveConfig(KConfigBase *config, int myIndex, const QString &
 
         ++idx;
     }
+
+    // hibernated views keep their state in the session, too
+    for (auto it = m_hibernatedViews.constBegin(); it != m_hibernatedViews.constEnd(); ++it) {
+        const QString url = KateApp::self()->documentManager()->documentUrl(it.key()).toString();
+        if (!url.isEmpty()) {
+            KConfigGroup viewGroup(config, QStringLiteral("%1 %2").arg(groupname, url));
+            for (auto entry = it.value().sessionConfig.constBegin(); entry != it.value().sessionConfig.constEnd(); ++entry) {
+                viewGroup.writeEntry(entry.key(), entry.value());
+            }
+        }
+    }
 }
 
 void KateViewSpace::restoreConfig(KateViewManager *viewMan, const KConfigBase *config, const QString &groupname)
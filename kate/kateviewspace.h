@@ -26,6 +26,7 @@
 #include <ktexteditor/view.h>
 
 #include <QHash>
+#include <QMap>
 #include <QWidget>
 
 class KConfigBase;
@@ -60,6 +61,13 @@ public:
     KTextEditor::View *createView(KTextEditor::Document *doc);
     void removeView(KTextEditor::View *v);
 
+    /**
+     * Remember the state of a view that is about to be hibernated.
+     * The next view created for its document in this view space gets it back.
+     * @param v view to hibernate
+     */
+    void rememberViewState(KTextEditor::View *v);
+
     bool showView(KTextEditor::View *view)
     {
         return showView(view->document());
@@ -210,6 +218,22 @@ private:
 
     // map from Document to button id
     QHash<KTextEditor::Document *, int> m_docToTabId;
+
+    /**
+     * state of a hibernated view, the session config of the view holds
+     * cursor and folding
+     */
+    class ViewState
+    {
+    public:
+        QMap<QString, QString> sessionConfig;
+        KTextEditor::Range selection = KTextEditor::Range::invalid();
+        bool blockSelection = false;
+        int firstDisplayedLine = 0;
+    };
+
+    // documents whose view was hibernated, mapped to the state of the view
+    QHash<KTextEditor::Document *, ViewState> m_hibernatedViews;
 };
 
 #endif
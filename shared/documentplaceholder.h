@@ -0,0 +1,92 @@
+/*  This file is part of the Kate project.
+ *
+ *  Copyright (C) 2020 by Kate Developers <kwrite-devel@kde.org>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Library General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public License
+ *  along with this library; see the file COPYING.LIB.  If not, write to
+ *  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DOCUMENTPLACEHOLDER_H
+#define DOCUMENTPLACEHOLDER_H
+
+#include <KTextEditor/Application>
+#include <KTextEditor/Document>
+#include <KTextEditor/Editor>
+
+#include <QMetaObject>
+#include <QString>
+#include <QUrl>
+
+/**
+ * Access to the documents Kate restored from a session without loading them.
+ *
+ * Until such a document is shown its own url is empty, the application knows
+ * the url and name it will be loaded with. Other applications have no
+ * placeholder documents, for them the document's own url and name are used.
+ */
+class DocumentPlaceholder
+{
+public:
+    /**
+     * @param doc document
+     * @return the url of \p doc if it is not loaded yet, else an empty url
+     */
+    static QUrl placeholderUrl(KTextEditor::Document *doc)
+    {
+        QUrl url;
+        QObject *app = application();
+        if (doc->url().isEmpty() && app) {
+            QMetaObject::invokeMethod(app, "documentUrl", Qt::DirectConnection, Q_RETURN_ARG(QUrl, url), Q_ARG(KTextEditor::Document *, doc));
+        }
+        return url;
+    }
+
+    /**
+     * @param doc document
+     * @return the url of \p doc, for documents not loaded yet the url they will be loaded from
+     */
+    static QUrl url(KTextEditor::Document *doc)
+    {
+        const QUrl url = doc->url();
+        return url.isEmpty() ? placeholderUrl(doc) : url;
+    }
+
+    /**
+     * @param doc document
+     * @return the name of \p doc, for documents not loaded yet the name they will get
+     */
+    static QString name(KTextEditor::Document *doc)
+    {
+        QString name;
+        QObject *app = application();
+        if (!doc->url().isEmpty() || !app
+            || !QMetaObject::invokeMethod(app, "documentName", Qt::DirectConnection, Q_RETURN_ARG(QString, name), Q_ARG(KTextEditor::Document *, doc))) {
+            name = doc->documentName();
+        }
+        return name;
+    }
+
+private:
+    /**
+     * the application object behind KTextEditor::Application, the Kate application provides the slots
+     */
+    static QObject *application()
+    {
+        KTextEditor::Application *app = KTextEditor::Editor::instance()->application();
+        return app ? app->parent() : nullptr;
+    }
+};
+
+#endif
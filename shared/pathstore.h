@@ -0,0 +1,227 @@
+/*  This file is part of the Kate project.
+ *
+ *  Copyright (C) 2020 by Kate Developers <kwrite-devel@kde.org>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Library General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public License
+ *  along with this library; see the file COPYING.LIB.  If not, write to
+ *  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301, USA.
+ */
+
+#ifndef PATHSTORE_H
+#define PATHSTORE_H
+
+#include <QExplicitlySharedDataPointer>
+#include <QHash>
+#include <QMetaType>
+#include <QSharedData>
+#include <QString>
+#include <QStringList>
+#include <QStringRef>
+#include <QVector>
+
+/**
+ * Compact, immutable list of file paths.
+ *
+ * Each directory is stored only once, a file is stored as index of its directory
+ * plus its name in one buffer shared by all names.
+ * Copies share the data, a path store can be handed out as snapshot, e.g. as
+ * value of a property, without copying any path.
+ * Use PathStore::Builder to create one.
+ */
+class PathStore
+{
+private:
+    struct File {
+        int directory;
+        int nameOffset;
+        int nameSize;
+    };
+
+    class Data : public QSharedData
+    {
+    public:
+        QVector<QString> directories;
+        QString names;
+        QVector<File> files;
+    };
+
+public:
+    /**
+     * Builder for path stores.
+     * Consecutive paths in the same directory, e.g. sorted ones, are added fastest.
+     */
+    class Builder
+    {
+    public:
+        Builder()
+            : m_data(new Data())
+            , m_lastDirectory(-1)
+        {
+        }
+
+        void reserve(int size)
+        {
+            m_data->files.reserve(size);
+        }
+
+        /**
+         * Add a path.
+         * @param path file path, everything up to the last slash is its directory
+         */
+        void append(const QString &path)
+        {
+            const int slash = path.lastIndexOf(QLatin1Char('/')) + 1;
+            const QStringRef directory = path.leftRef(slash);
+            if (m_lastDirectory < 0 || m_data->directories.at(m_lastDirectory) != directory) {
+                m_lastDirectory = directoryId(directory.toString());
+            }
+            m_data->files.append({m_lastDirectory, m_data->names.size(), path.size() - slash});
+            m_data->names.append(path.midRef(slash));
+        }
+
+        /**
+         * Create the path store with all paths added, the builder is empty afterwards.
+         * @return path store
+         */
+        PathStore build()
+        {
+            PathStore store;
+            if (!m_data->files.isEmpty()) {
+                m_data->names.squeeze();
+                m_data->files.squeeze();
+                store.d = m_data;
+            }
+            m_data = new Data();
+            m_directoryIds.clear();
+            m_lastDirectory = -1;
+            return store;
+        }
+
+    private:
+        int directoryId(const QString &directory)
+        {
+            auto it = m_directoryIds.constFind(directory);
+            if (it == m_directoryIds.constEnd()) {
+                it = m_directoryIds.insert(directory, m_data->directories.size());
+                m_data->directories.append(directory);
+            }
+            return it.value();
+        }
+
+        friend class PathStore;
+
+        QExplicitlySharedDataPointer<Data> m_data;
+        QHash<QString, int> m_directoryIds;
+        int m_lastDirectory;
+    };
+
+    int size() const
+    {
+        return d ? d->files.size() : 0;
+    }
+
+    bool isEmpty() const
+    {
+        return size() == 0;
+    }
+
+    /**
+     * @param i index of the file, 0 <= i < size()
+     * @return path of the file
+     */
+    QString at(int i) const
+    {
+        const File &file = d->files.at(i);
+        return d->directories.at(file.directory) + d->names.midRef(file.nameOffset, file.nameSize);
+    }
+
+    /**
+     * @param i index of the file, 0 <= i < size()
+     * @return directory of the file, with trailing slash
+     */
+    const QString &directory(int i) const
+    {
+        return d->directories.at(d->files.at(i).directory);
+    }
+
+    /**
+     * @param i index of the file, 0 <= i < size()
+     * @return name of the file, only valid as long as this store is
+     */
+    QStringRef fileName(int i) const
+    {
+        const File &file = d->files.at(i);
+        return d->names.midRef(file.nameOffset, file.nameSize);
+    }
+
+    /**
+     * @return all paths, for consumers that need a string list
+     */
+    QStringList toStringList() const
+    {
+        QStringList paths;
+        paths.reserve(size());
+        for (int i = 0; i < size(); ++i) {
+            paths.append(at(i));
+        }
+        return paths;
+    }
+
+    /**
+     * Does this store share the data with another one?
+     * Then both contain the same paths without comparing them.
+     */
+    bool isSharedWith(const PathStore &other) const
+    {
+        return d == other.d;
+    }
+
+    /**
+     * Join path stores, the directories are interned again, the names copied at once.
+     * @param stores stores to join, in order
+     * @return store with the paths of all stores
+     */
+    static PathStore joined(const QVector<PathStore> &stores)
+    {
+        if (stores.size() == 1) {
+            return stores.first();
+        }
+
+        Builder builder;
+        for (const PathStore &store : stores) {
+            if (!store.d) {
+                continue;
+            }
+            QVector<int> directoryIds;
+            directoryIds.reserve(store.d->directories.size());
+            for (const QString &directory : store.d->directories) {
+                directoryIds.append(builder.directoryId(directory));
+            }
+            const int nameOffset = builder.m_data->names.size();
+            builder.m_data->names.append(store.d->names);
+            builder.m_data->files.reserve(builder.m_data->files.size() + store.d->files.size());
+            for (const File &file : store.d->files) {
+                builder.m_data->files.append({directoryIds.at(file.directory), nameOffset + file.nameOffset, file.nameSize});
+            }
+        }
+        return builder.build();
+    }
+
+private:
+    QExplicitlySharedDataPointer<Data> d;
+};
+
+Q_DECLARE_METATYPE(PathStore)
+
+#endif